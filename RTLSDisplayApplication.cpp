@@ -16,6 +16,7 @@
 #include "SerialConnection.h"
 #include "RTLSClient.h"
 #include "ViewSettings.h"
+#include "FloorplanMap.h"
 #include "GraphicsWidget.h"
 
 #include <QMetaProperty>
@@ -48,6 +49,8 @@ RTLSDisplayApplication::RTLSDisplayApplication(int &argc, char **argv) : QApplic
 
     _client = new RTLSClient(this);
 
+    _floorplanMap = new FloorplanMap(this);
+
     _mainWindow = new MainWindow();
     _mainWindow->resize(desktopWidth/2,desktopHeight/2);
 
@@ -55,9 +58,13 @@ RTLSDisplayApplication::RTLSDisplayApplication(int &argc, char **argv) : QApplic
 
     //Connect the various signals and corresponding slots
     QObject::connect(_client, SIGNAL(anchPos(quint64,double,double,double,bool,bool)), graphicsWidget(), SLOT(anchPos(quint64,double,double,double,bool, bool)));
+    QObject::connect(_client, SIGNAL(anchHealth(quint64,int,double,double)), graphicsWidget(), SLOT(anchHealth(quint64,int,double,double)));
     QObject::connect(_client, SIGNAL(tagPos(quint64,double,double,double)), graphicsWidget(), SLOT(tagPos(quint64,double,double,double)));
     QObject::connect(_client, SIGNAL(tagStats(quint64,double,double,double,double)), graphicsWidget(), SLOT(tagStats(quint64,double,double,double,double)));
+    QObject::connect(_client, SIGNAL(tagVel(quint64,double,double,double)), graphicsWidget(), SLOT(tagVel(quint64,double,double,double)));
     QObject::connect(_client, SIGNAL(tagRange(quint64,quint64,double)), graphicsWidget(), SLOT(tagRange(quint64,quint64,double)));
+    QObject::connect(_client, SIGNAL(tagLink(quint64,double,double,double)), graphicsWidget(), SLOT(tagLink(quint64,double,double,double)));
+    QObject::connect(_client, SIGNAL(ancLink(quint64,quint64,double,double,double)), graphicsWidget(), SLOT(ancLink(quint64,quint64,double,double,double)));
     QObject::connect(_client, SIGNAL(statusBarMessage(QString)), _mainWindow, SLOT(statusBarMessage(QString)));
 
     QObject::connect(_client, SIGNAL(centerOnAnchors(void)), graphicsWidget(), SLOT(centerOnAnchors(void)));
@@ -68,9 +75,11 @@ RTLSDisplayApplication::RTLSDisplayApplication(int &argc, char **argv) : QApplic
     QObject::connect(_serialConnection, SIGNAL(connectionStateChanged(SerialConnection::ConnectionState)), _client, SLOT(connectionStateChanged(SerialConnection::ConnectionState)));
 
     QObject::connect(graphicsWidget(), SIGNAL(updateAnchorXYZ(int, int, double)), _client, SLOT(updateAnchorXYZ(int, int, double)));
-    QObject::connect(graphicsWidget(), SIGNAL(updateTagCorrection(int, int, int)), _client, SLOT(updateTagCorrection(int, int, int)));
+    QObject::connect(graphicsWidget(), SIGNAL(updateTagCorrection(int, quint64, int)), _client, SLOT(updateTagCorrection(int, quint64, int)));
 
     QObject::connect(_client, SIGNAL(ancRanges(int, int, int)), graphicsWidget(), SLOT(ancRanges(int, int, int)));
+
+    QObject::connect(_floorplanMap, SIGNAL(distanceFieldChanged(QSharedPointer<DistanceField>)), _client, SLOT(setDistanceField(QSharedPointer<DistanceField>)));
     //emit ready signal so other components can finish initialisation
     emit ready();
 }
@@ -80,6 +89,8 @@ RTLSDisplayApplication::~RTLSDisplayApplication()
     // Delete the objects manually, because we want to control the order
     delete _mainWindow;
 
+    delete _floorplanMap;
+
     delete _client;
 
     delete _serialConnection;
@@ -102,6 +113,11 @@ RTLSClient *RTLSDisplayApplication::client()
     return instance()->_client;
 }
 
+FloorplanMap *RTLSDisplayApplication::floorplanMap()
+{
+    return instance()->_floorplanMap;
+}
+
 SerialConnection *RTLSDisplayApplication::serialConnection()
 {
     return instance()->_serialConnection;
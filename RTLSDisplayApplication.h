@@ -24,6 +24,7 @@ class SerialConnection;
 class GraphicsWidget;
 class GraphicsView;
 class RTLSClient;
+class FloorplanMap;
 
 /**
  * The RTLSDisplayApplication class is a singleton class which handles the application.
@@ -50,6 +51,7 @@ public:
 
     static SerialConnection *serialConnection();
     static RTLSClient *client();
+    static FloorplanMap *floorplanMap();
     static MainWindow *mainWindow();
 
     static GraphicsWidget *graphicsWidget();
@@ -80,6 +82,8 @@ private:
 
     RTLSClient *_client;
 
+    FloorplanMap *_floorplanMap;
+
     MainWindow *_mainWindow;
 
     bool _ready;
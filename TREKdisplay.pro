@@ -5,7 +5,7 @@
 #-------------------------------------------------
 cache()
 
-QT       += core gui network xml serialport
+QT       += core gui network xml serialport concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -15,27 +15,46 @@ QMAKE_INFO_PLIST = Info.plist
 
 INCLUDEPATH += models network views util tools
 
-INCLUDEPATH += $$PWD/armadillo-3.930.0/include
+#gzip of the closed log segments
+LIBS += -lz
 
-
-LIBS += -L$$PWD/armadillo-3.930.0/lib/ -lblas
-
-LIBS += -L$$PWD/armadillo-3.930.0/lib/ -llapack
+#sqrt doesn't have to set errno and float operations don't trap, so the loops over the particles can be vectorised
+QMAKE_CXXFLAGS += -fno-math-errno
+*-g++*: QMAKE_CXXFLAGS += -fno-trapping-math -ftree-vectorize -fvect-cost-model=cheap
 
 SOURCES += main.cpp\
     RTLSDisplayApplication.cpp \
     views/mainwindow.cpp \
     network/RTLSClient.cpp \
+    network/TagProcessor.cpp \
     views/GraphicsView.cpp \
     views/GraphicsWidget.cpp \
     views/ViewSettingsWidget.cpp \
 	views/MinimapView.cpp \
     views/connectionwidget.cpp \
     models/ViewSettings.cpp \
+    models/DistanceField.cpp \
+    models/FloorplanMap.cpp \
+    models/TagStore.cpp \
+    models/PositionStore.cpp \
+    models/PositionIndex.cpp \
+    models/RangeCorrections.cpp \
+    models/AnchorHealth.cpp \
     tools/OriginTool.cpp \
     tools/RubberBandTool.cpp \
     tools/ScaleTool.cpp \
+    tools/ParticleFilter.cpp \
+    tools/KalmanFilter.cpp \
+    tools/AnchorPositioning.cpp \
     util/QPropertyModel.cpp \
+    util/RunningWindow.cpp \
+    util/IdMap.cpp \
+    util/LinkQuality.cpp \
+    util/WindowStats.cpp \
+    util/LogRecord.cpp \
+    util/LogWriter.cpp \
+    util/LogPolicy.cpp \
+    util/Snapshot.cpp \
     network/SerialConnection.cpp \
     tools/trilateration.cpp
 
@@ -43,17 +62,36 @@ HEADERS  += \
     RTLSDisplayApplication.h \
 	views/mainwindow.h \
     network/RTLSClient.h \
+    network/TagProcessor.h \
     views/GraphicsView.h \
     views/GraphicsWidget.h \
     views/ViewSettingsWidget.h \
     views/MinimapView.h \
     views/connectionwidget.h \
     models/ViewSettings.h \
+    models/DistanceField.h \
+    models/FloorplanMap.h \
+    models/TagStore.h \
+    models/PositionStore.h \
+    models/PositionIndex.h \
+    models/RangeCorrections.h \
+    models/AnchorHealth.h \
     tools/AbstractTool.h \
     tools/OriginTool.h \
     tools/RubberBandTool.h \
     tools/ScaleTool.h \
+    tools/ParticleFilter.h \
+    tools/KalmanFilter.h \
+    tools/AnchorPositioning.h \
     util/QPropertyModel.h \
+    util/RunningWindow.h \
+    util/IdMap.h \
+    util/LinkQuality.h \
+    util/WindowStats.h \
+    util/LogRecord.h \
+    util/LogWriter.h \
+    util/LogPolicy.h \
+    util/Snapshot.h \
     network/SerialConnection.h \
     tools/trilateration.h
 FORMS    += \
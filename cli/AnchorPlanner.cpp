@@ -0,0 +1,440 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorPlanner.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "AnchorPlanner.h"
+
+#include <QtConcurrent>
+#include <math.h>
+#include <string.h>
+
+#define PLAN_MIN_IMPROVEMENT (1e-6)
+#define PLAN_TIE_BREAK       (1e-3)     //weight of the mean GDOP when minimising the worst GDOP
+#define PLAN_MAX_SEED_WORK   (200000000LL) //(triples x coverage points) above which the first anchors are spread out instead
+
+typedef struct
+{
+    int out;
+    int in;
+    double cost;
+} plan_move_t;
+
+typedef struct
+{
+    int c[GDOP_MIN_ANCHORS];
+    double cost;
+} plan_seed_t;
+
+/**
+ * Functor evaluating one move, used by QtConcurrent::blockingMap()
+ */
+struct EvaluateMove
+{
+    EvaluateMove(const AnchorPlanner *planner) : _planner(planner) {}
+
+    void operator()(plan_move_t &m) const
+    {
+        m.cost = _planner->evaluate(m.out, m.in);
+    }
+
+    const AnchorPlanner *_planner;
+};
+
+/**
+ * Functor evaluating the first anchors, used by QtConcurrent::blockingMap()
+ */
+struct EvaluateSeed
+{
+    EvaluateSeed(const AnchorPlanner *planner) : _planner(planner) {}
+
+    void operator()(plan_seed_t &s) const
+    {
+        s.cost = _planner->evaluateSeed(s.c);
+    }
+
+    const AnchorPlanner *_planner;
+};
+
+AnchorPlanner::AnchorPlanner() :
+    _objective(MeanGdop),
+    _maxRange(0),
+    _maxIterations(100)
+{
+}
+
+void AnchorPlanner::setCoverage(const QVector<vec3d> &points)
+{
+    _points = points;
+}
+
+void AnchorPlanner::setCandidates(const QVector<vec3d> &candidates)
+{
+    _candidates = candidates;
+}
+
+void AnchorPlanner::setMaxRange(double range)
+{
+    _maxRange = range;
+}
+
+void AnchorPlanner::setObjective(Objective objective)
+{
+    _objective = objective;
+}
+
+void AnchorPlanner::setMaxIterations(int iterations)
+{
+    _maxIterations = iterations;
+}
+
+void AnchorPlanner::precompute()
+{
+    int np = _points.size();
+    int nc = _candidates.size();
+
+    _rows.resize(nc * np);
+
+    for(int c=0; c<nc; c++)
+    {
+        gdop_row_t *rows = _rows.data() + c * np;
+
+        for(int p=0; p<np; p++)
+        {
+            rows[p] = gdop_row(_points.at(p), _candidates.at(c), _maxRange);
+        }
+    }
+
+    _info.resize(np);
+    for(int p=0; p<np; p++)
+    {
+        gdop_info_clear(&_info[p]);
+    }
+
+    _selected.clear();
+    _used.fill(false, nc);
+}
+
+double AnchorPlanner::cost(double sum, double worst) const
+{
+    double mean = sum / _points.size();
+
+    if(_objective == WorstGdop)
+    {
+        return worst + PLAN_TIE_BREAK * mean;
+    }
+
+    return mean;
+}
+
+double AnchorPlanner::evaluate(int out, int in) const
+{
+    int np = _points.size();
+    const gdop_row_t *rowsOut = (out >= 0) ? _rows.constData() + out * np : NULL;
+    const gdop_row_t *rowsIn = (in >= 0) ? _rows.constData() + in * np : NULL;
+    double sum = 0, worst = 0;
+
+    for(int p=0; p<np; p++)
+    {
+        gdop_info_t info = _info.at(p);
+        double g;
+
+        if(rowsOut)
+        {
+            gdop_info_sub(&info, &rowsOut[p]);
+        }
+        if(rowsIn)
+        {
+            gdop_info_add(&info, &rowsIn[p]);
+        }
+
+        g = gdop_value(&info);
+
+        sum += g;
+        if(g > worst)
+        {
+            worst = g;
+        }
+    }
+
+    return cost(sum, worst);
+}
+
+double AnchorPlanner::evaluateSeed(const int *seed) const
+{
+    int np = _points.size();
+    double sum = 0, worst = 0;
+
+    for(int p=0; p<np; p++)
+    {
+        gdop_info_t info;
+        double g;
+
+        gdop_info_clear(&info);
+
+        for(int k=0; k<GDOP_MIN_ANCHORS; k++)
+        {
+            gdop_info_add(&info, &_rows.at(seed[k] * np + p));
+        }
+
+        g = gdop_value(&info);
+
+        sum += g;
+        if(g > worst)
+        {
+            worst = g;
+        }
+    }
+
+    return cost(sum, worst);
+}
+
+/* twice the area of the triangle a, b, c */
+static double plan_area(const vec3d &a, const vec3d &b, const vec3d &c)
+{
+    vec3d u = vdiff(b, a), v = vdiff(c, a);
+    double x = u.y * v.z - u.z * v.y, y = u.z * v.x - u.x * v.z, z = u.x * v.y - u.y * v.x;
+
+    return sqrt(x*x + y*y + z*z);
+}
+
+void AnchorPlanner::seed()
+{
+    int np = _points.size();
+    int nc = _candidates.size();
+    qint64 triples = (qint64) nc * (nc - 1) * (nc - 2) / 6;
+    int best[GDOP_MIN_ANCHORS] = {0, 1, 2};
+
+    //with fewer anchors no point can be solved, so the first ones are chosen together: the triple with the lowest
+    //cost, or the two candidates furthest apart and the one which makes the largest triangle with them
+    if(triples * np <= PLAN_MAX_SEED_WORK)
+    {
+        QVector<plan_seed_t> seeds;
+
+        seeds.reserve(triples);
+
+        for(int a=0; a<nc; a++)
+        {
+            for(int b=a+1; b<nc; b++)
+            {
+                for(int c=b+1; c<nc; c++)
+                {
+                    plan_seed_t t = {{a, b, c}, 0};
+                    seeds.append(t);
+                }
+            }
+        }
+
+        QtConcurrent::blockingMap(seeds, EvaluateSeed(this));
+
+        int k = 0;
+        for(int i=1; i<seeds.size(); i++)
+        {
+            if(seeds.at(i).cost < seeds.at(k).cost)
+            {
+                k = i;
+            }
+        }
+
+        memcpy(best, seeds.at(k).c, sizeof(best));
+    }
+    else
+    {
+        double d = -1;
+
+        for(int a=0; a<nc; a++)
+        {
+            for(int b=a+1; b<nc; b++)
+            {
+                vec3d v = vdiff(_candidates.at(a), _candidates.at(b));
+                double dd = v.x*v.x + v.y*v.y + v.z*v.z;
+
+                if(dd > d)
+                {
+                    d = dd;
+                    best[0] = a;
+                    best[1] = b;
+                }
+            }
+        }
+
+        d = -1;
+
+        for(int c=0; c<nc; c++)
+        {
+            double area = plan_area(_candidates.at(best[0]), _candidates.at(best[1]), _candidates.at(c));
+
+            if((c != best[0]) && (c != best[1]) && (area > d))
+            {
+                d = area;
+                best[2] = c;
+            }
+        }
+    }
+
+    for(int k=0; k<GDOP_MIN_ANCHORS; k++)
+    {
+        apply(-1, best[k]);
+    }
+}
+
+void AnchorPlanner::apply(int out, int in)
+{
+    int np = _points.size();
+
+    if(out >= 0)
+    {
+        const gdop_row_t *rows = _rows.constData() + out * np;
+
+        for(int p=0; p<np; p++)
+        {
+            gdop_info_sub(&_info[p], &rows[p]);
+        }
+
+        _selected.remove(_selected.indexOf(out));
+        _used[out] = false;
+    }
+
+    if(in >= 0)
+    {
+        const gdop_row_t *rows = _rows.constData() + in * np;
+
+        for(int p=0; p<np; p++)
+        {
+            gdop_info_add(&_info[p], &rows[p]);
+        }
+
+        _selected.append(in);
+        _used[in] = true;
+    }
+}
+
+QVector<int> AnchorPlanner::solve(int budget)
+{
+    QVector<plan_move_t> moves;
+    double current;
+    int iteration;
+
+    precompute();
+
+    if((budget <= 0) || _points.isEmpty())
+    {
+        return _selected;
+    }
+
+    if(budget > _candidates.size())
+    {
+        budget = _candidates.size();
+    }
+
+    if(budget >= GDOP_MIN_ANCHORS)
+    {
+        seed();
+    }
+
+    //greedy: add the candidate which lowers the cost the most
+    while(_selected.size() < budget)
+    {
+        moves.clear();
+        for(int c=0; c<_candidates.size(); c++)
+        {
+            if(!_used.at(c))
+            {
+                plan_move_t m = {-1, c, 0};
+                moves.append(m);
+            }
+        }
+
+        QtConcurrent::blockingMap(moves, EvaluateMove(this));
+
+        int best = 0;
+        for(int i=1; i<moves.size(); i++)
+        {
+            if(moves.at(i).cost < moves.at(best).cost)
+            {
+                best = i;
+            }
+        }
+
+        apply(-1, moves.at(best).in);
+    }
+
+    //local search: swap a placed anchor for an unused candidate while it improves the cost
+    current = evaluate(-1, -1);
+
+    for(iteration = 0; iteration < _maxIterations; iteration++)
+    {
+        moves.clear();
+        for(int s=0; s<_selected.size(); s++)
+        {
+            for(int c=0; c<_candidates.size(); c++)
+            {
+                if(!_used.at(c))
+                {
+                    plan_move_t m = {_selected.at(s), c, 0};
+                    moves.append(m);
+                }
+            }
+        }
+
+        if(moves.isEmpty())
+        {
+            break;
+        }
+
+        QtConcurrent::blockingMap(moves, EvaluateMove(this));
+
+        int best = 0;
+        for(int i=1; i<moves.size(); i++)
+        {
+            if(moves.at(i).cost < moves.at(best).cost)
+            {
+                best = i;
+            }
+        }
+
+        if(moves.at(best).cost > (current - PLAN_MIN_IMPROVEMENT))
+        {
+            break; //local minimum
+        }
+
+        apply(moves.at(best).out, moves.at(best).in);
+        current = moves.at(best).cost;
+    }
+
+    return _selected;
+}
+
+void AnchorPlanner::statistics(double *mean, double *worst, double *covered) const
+{
+    int np = _points.size();
+    int n = 0;
+    double sum = 0;
+
+    *worst = 0;
+
+    for(int p=0; p<np; p++)
+    {
+        double g = gdop_value(&_info.at(p));
+
+        sum += g;
+        if(g > *worst)
+        {
+            *worst = g;
+        }
+        if(g < GDOP_MAX)
+        {
+            n++;
+        }
+    }
+
+    *mean = (np > 0) ? (sum / np) : 0;
+    *covered = (np > 0) ? ((double)n / np) : 0;
+}
@@ -0,0 +1,93 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorPlanner.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef ANCHORPLANNER_H
+#define ANCHORPLANNER_H
+
+#include <QVector>
+
+#include "gdop.h"
+
+/**
+ * The AnchorPlanner class chooses which of a set of candidate mounting points should get an anchor.
+ *
+ * The coverage area is given as a set of sample points (usually the walkable area of the floorplan, at tag height).
+ * The cost of a placement is the mean or the worst GDOP over all the sample points.
+ *
+ * The first GDOP_MIN_ANCHORS anchors are chosen together (no point can be solved with fewer of them): the triple
+ * with the lowest cost, or for a large number of candidates the ones which are furthest apart. The search then goes
+ * on greedily (add the anchor which lowers the cost the most until the budget is used), followed by a local search
+ * which swaps a placed anchor for an unused candidate as long as that lowers the cost.
+ *
+ * The Jacobian rows of every candidate at every sample point are calculated once, and the information matrix of
+ * the current placement is kept for every sample point, so evaluating a move only adds/removes one or two rows
+ * per point instead of rebuilding the geometry. All the moves of one step are evaluated in parallel.
+ */
+class AnchorPlanner
+{
+public:
+    enum Objective {
+        MeanGdop,   ///< minimise the mean GDOP over the coverage area
+        WorstGdop   ///< minimise the worst GDOP over the coverage area (mean is used to break ties)
+    };
+
+    AnchorPlanner();
+
+    void setCoverage(const QVector<vec3d> &points);
+    void setCandidates(const QVector<vec3d> &candidates);
+    void setMaxRange(double range);
+    void setObjective(Objective objective);
+    void setMaxIterations(int iterations);
+
+    /**
+     * Search for the best placement of \a budget anchors.
+     * @return the indices of the chosen candidates
+     */
+    QVector<int> solve(int budget);
+
+    /**
+     * @return the mean GDOP, the worst GDOP and the fraction of the coverage points with a solution for the current placement
+     */
+    void statistics(double *mean, double *worst, double *covered) const;
+
+    /**
+     * Evaluate the cost of the current placement with candidate \a out removed and candidate \a in added.
+     * Either can be -1. Used by the parallel move evaluation.
+     */
+    double evaluate(int out, int in) const;
+
+    /**
+     * Evaluate the cost of a placement of the GDOP_MIN_ANCHORS candidates \a seed only. Used by the parallel search
+     * of the first anchors.
+     */
+    double evaluateSeed(const int *seed) const;
+
+private:
+    void precompute();
+    void seed();
+    void apply(int out, int in);
+    double cost(double sum, double worst) const;
+
+    Objective _objective;
+    double _maxRange;
+    int _maxIterations;
+
+    QVector<vec3d> _points;
+    QVector<vec3d> _candidates;
+
+    QVector<gdop_row_t> _rows;      ///< Jacobian row of candidate c at point p is _rows[c * points + p]
+    QVector<gdop_info_t> _info;     ///< information matrix of the current placement at each point
+    QVector<int> _selected;
+    QVector<bool> _used;
+};
+
+#endif // ANCHORPLANNER_H
@@ -0,0 +1,411 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: CalibrateCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "SiteFiles.h"
+#include "RangeLog.h"
+
+#include <QCommandLineParser>
+#include <QtConcurrent>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QRegExp>
+#include <QTextStream>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#define CALIB_LINE_LENGTH   (256)
+#define CALIB_MIN_SPREAD    (1.0)   //(m) the ranges of a pair must spread over this much to fit a scale
+
+/**
+ * Known position of a tag, for the whole log or for part of it
+ */
+typedef struct
+{
+    quint64 tag;
+    vec3d p;
+    int from, to;                   //(ms) time of day the tag was there, -1 for the whole log
+} calib_point_t;
+
+/**
+ * Ranges of one tag - anchor pair and their correction
+ */
+typedef struct
+{
+    quint64 tag;
+    int anc;
+    QVector<double> range;          //(m) measured range
+    QVector<double> dist;           //(m) distance between the known positions
+
+    int n;                          //ranges used for the fit
+    double offset;                  //(m) correction = offset + scale * range
+    double scale;
+    double rms;                     //(m) error left after the correction
+    bool ok;
+} calib_pair_t;
+
+/**
+ * Functor fitting the correction of one pair, used by QtConcurrent::blockingMap()
+ */
+struct CalibratePair
+{
+    CalibratePair(int minRanges, double outlier, bool fitScale) :
+        _minRanges(minRanges), _outlier(outlier), _fitScale(fitScale) {}
+
+    void operator()(calib_pair_t &p) const
+    {
+        int n = p.range.size();
+        QVector<double> err(n);
+
+        p.ok = false;
+        p.n = 0;
+
+        if(n < _minRanges)
+        {
+            return;
+        }
+
+        //ranges further than _outlier from the median error are left out (reflections, bad reports)
+        for(int i=0; i<n; i++)
+        {
+            err[i] = p.dist.at(i) - p.range.at(i);
+        }
+
+        QVector<double> sorted = err;
+        std::nth_element(sorted.begin(), sorted.begin() + n/2, sorted.end());
+        double median = sorted.at(n/2);
+
+        double sm = 0, se = 0, mmin = 1e9, mmax = -1e9;
+
+        for(int i=0; i<n; i++)
+        {
+            if(fabs(err.at(i) - median) <= _outlier)
+            {
+                sm += p.range.at(i);
+                se += err.at(i);
+                mmin = qMin(mmin, p.range.at(i));
+                mmax = qMax(mmax, p.range.at(i));
+                p.n++;
+            }
+        }
+
+        if(p.n < _minRanges)
+        {
+            return;
+        }
+
+        //least squares fit of err = offset + scale * range, the scale only if the ranges are spread enough
+        double mm = sm / p.n, me = se / p.n;
+        double smm = 0, sme = 0;
+
+        for(int i=0; i<n; i++)
+        {
+            if(fabs(err.at(i) - median) <= _outlier)
+            {
+                smm += (p.range.at(i) - mm) * (p.range.at(i) - mm);
+                sme += (p.range.at(i) - mm) * (err.at(i) - me);
+            }
+        }
+
+        p.scale = (_fitScale && ((mmax - mmin) >= CALIB_MIN_SPREAD) && (smm > 0)) ? (sme / smm) : 0;
+        p.offset = me - p.scale * mm;
+
+        double sq = 0;
+
+        for(int i=0; i<n; i++)
+        {
+            if(fabs(err.at(i) - median) <= _outlier)
+            {
+                double r = err.at(i) - p.offset - p.scale * p.range.at(i);
+                sq += r * r;
+            }
+        }
+
+        p.rms = sqrt(sq / p.n);
+        p.ok = true;
+    }
+
+    int _minRanges;
+    double _outlier;
+    bool _fitScale;
+};
+
+/* hh:mm:ss (or hhmmss) to ms of the day, -1 if it isn't a time */
+static int parseTime(const QString &s)
+{
+    QString t = s;
+    bool ok;
+
+    t.remove(':');
+
+    int v = t.toInt(&ok);
+
+    if(!ok || (t.size() != 6))
+    {
+        return -1;
+    }
+
+    return (((v / 10000) * 60 + (v / 100) % 100) * 60 + (v % 100)) * 1000;
+}
+
+/* tag positions, one "tag x y z [from to]" per line */
+static bool loadTagPoints(const QString &filename, QVector<calib_point_t> *points)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QTextStream ts(&file);
+
+    while(!ts.atEnd())
+    {
+        QString line = ts.readLine().trimmed();
+
+        if(line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        QStringList f = line.split(QRegExp("[\\s,]+"), QString::SkipEmptyParts);
+        bool okt, okx, oky, okz;
+        calib_point_t p;
+
+        if((f.size() != 4) && (f.size() != 6))
+        {
+            qDebug() << "ignoring point" << line;
+            continue;
+        }
+
+        p.tag = f.at(0).toULongLong(&okt);
+        p.p.x = f.at(1).toDouble(&okx);
+        p.p.y = f.at(2).toDouble(&oky);
+        p.p.z = f.at(3).toDouble(&okz);
+        p.from = (f.size() == 6) ? parseTime(f.at(4)) : -1;
+        p.to = (f.size() == 6) ? parseTime(f.at(5)) : -1;
+
+        if(!okt || !okx || !oky || !okz || ((f.size() == 6) && ((p.from < 0) || (p.to < 0))))
+        {
+            qDebug() << "ignoring point" << line;
+            continue;
+        }
+
+        points->append(p);
+    }
+
+    file.close();
+
+    return true;
+}
+
+/**
+* @brief rtlstool calibrate: fit the range correction of every tag - anchor pair from the ranges logged with the
+*        tags at known positions
+*/
+int calibrateCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Calibrate the tag - anchor range corrections from the ranges of tags at known positions.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "Application logs (RR or RC records) or raw captures of the range reports.", "log...");
+
+    QCommandLineOption anchorsOption("anchors", "Anchor positions and current corrections (TREKanc_config.xml).", "file");
+    QCommandLineOption pointsOption("points", "Tag positions, one \"tag x y z [from to]\" per line, from/to as hh:mm:ss.", "file");
+    QCommandLineOption scaleOption("scale", "Fit a correction proportional to the range as well, for tags at several distances.");
+    QCommandLineOption minRangesOption("min-ranges", "Ranges needed to calibrate a pair (default 20).", "n", "20");
+    QCommandLineOption outlierOption("outlier", "Range error in m from the median beyond which a range is left out (default 0.3).", "m", "0.3");
+    QCommandLineOption outputOption("output", "Anchor file to write (default TREKanc_config.xml).", "file", "TREKanc_config.xml");
+
+    parser.addOption(anchorsOption);
+    parser.addOption(pointsOption);
+    parser.addOption(scaleOption);
+    parser.addOption(minRangesOption);
+    parser.addOption(outlierOption);
+    parser.addOption(outputOption);
+
+    parser.process(args);
+
+    QStringList logs = parser.positionalArguments();
+
+    if(logs.isEmpty() || !parser.isSet(anchorsOption) || !parser.isSet(pointsOption))
+    {
+        err << "calibrate: logs, --anchors and --points are required\n";
+        return 1;
+    }
+
+    //anchors, current corrections and tag positions
+    QVector<site_anchor_t> anchors;
+    RangeCorrections corrections;
+    QVector<calib_point_t> points;
+    vec3d anc[RL_NUM_RANGES];
+    bool hasAnc[RL_NUM_RANGES] = {false, false, false, false};
+
+    if(!loadAnchorConfig(parser.value(anchorsOption), &anchors) || !loadRangeCorrections(parser.value(anchorsOption), &corrections))
+    {
+        err << "calibrate: cannot read " << parser.value(anchorsOption) << "\n";
+        return 1;
+    }
+
+    for(int i=0; i<anchors.size(); i++)
+    {
+        if(anchors.at(i).id < RL_NUM_RANGES)
+        {
+            int a = anchors.at(i).id;
+
+            anc[a].x = anchors.at(i).x;
+            anc[a].y = anchors.at(i).y;
+            anc[a].z = anchors.at(i).z;
+            hasAnc[a] = true;
+        }
+    }
+
+    if(!loadTagPoints(parser.value(pointsOption), &points) || points.isEmpty())
+    {
+        err << "calibrate: no tag positions\n";
+        return 1;
+    }
+
+    QHash<quint64, int> tagPoints;  //first point of each tag, the points of a tag don't have to be next to each other
+    QVector<int> nextPoint(points.size(), -1);
+
+    for(int i=points.size()-1; i>=0; i--)
+    {
+        nextPoint[i] = tagPoints.value(points.at(i).tag, -1);
+        tagPoints.insert(points.at(i).tag, i);
+    }
+
+    //ranges of each pair, pairs[row * RL_NUM_RANGES + anchor]
+    QHash<quint64, int> tagRows;
+    QVector<calib_pair_t> pairs;
+    int used = 0, unplaced = 0;
+
+    for(int l=0; l<logs.size(); l++)
+    {
+        QFile file(logs.at(l));
+        char line[CALIB_LINE_LENGTH];
+        range_log_record_t r;
+
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            err << "calibrate: cannot read " << logs.at(l) << "\n";
+            return 1;
+        }
+
+        while(file.readLine(line, sizeof(line)) > 0)
+        {
+            if(!rl_parse_line(line, &r) || (r.type != RL_TAG))
+            {
+                continue;
+            }
+
+            //where was the tag
+            int pt = tagPoints.value(r.id, -1);
+
+            while((pt != -1) && (points.at(pt).from != -1) &&
+                  ((r.time < points.at(pt).from) || (r.time > points.at(pt).to)))
+            {
+                pt = nextPoint.at(pt);
+            }
+
+            if(pt == -1)
+            {
+                unplaced++;
+                continue;
+            }
+
+            int row = tagRows.value(r.id, -1);
+
+            if(row == -1)
+            {
+                row = tagRows.size();
+                tagRows.insert(r.id, row);
+
+                for(int a=0; a<RL_NUM_RANGES; a++)
+                {
+                    calib_pair_t p;
+
+                    p.tag = r.id;
+                    p.anc = a;
+                    p.n = 0;
+                    p.ok = false;
+                    pairs.append(p);
+                }
+            }
+
+            for(int a=0; a<RL_NUM_RANGES; a++)
+            {
+                if((r.mask & (1 << a)) && hasAnc[a] && (r.range[a] > 0))
+                {
+                    calib_pair_t *p = &pairs[row * RL_NUM_RANGES + a];
+
+                    p->range.append(r.range[a] * 0.001);
+                    p->dist.append(vdist(points.at(pt).p, anc[a]));
+                    used++;
+                }
+            }
+        }
+
+        file.close();
+    }
+
+    out << QString("%1 ranges from %2 tags, %3 reports without a known tag position\n").arg(used).arg(tagRows.size()).arg(unplaced);
+
+    QtConcurrent::blockingMap(pairs, CalibratePair(parser.value(minRangesOption).toInt(), parser.value(outlierOption).toDouble(),
+                                                   parser.isSet(scaleOption)));
+
+    //the pairs which couldn't be calibrated keep their correction
+    int calibrated = 0;
+
+    out << "tag anchor ranges offset(cm) scale(ppm) rms(cm)\n";
+
+    for(int i=0; i<pairs.size(); i++)
+    {
+        const calib_pair_t *p = &pairs.at(i);
+
+        if(!p->ok)
+        {
+            if(p->range.size() > 0)
+            {
+                out << QString("%1 A%2 %3 not calibrated\n").arg(p->tag).arg(p->anc).arg(p->range.size());
+            }
+            continue;
+        }
+
+        int cm = qRound(p->offset * 100);
+        int ppm = qRound(p->scale * 1e6);
+
+        corrections.setCorrection(p->anc, p->tag, cm);
+        corrections.setScale(p->anc, p->tag, ppm);
+        calibrated++;
+
+        out << QString("%1 A%2 %3 %4 %5 %6\n").arg(p->tag).arg(p->anc).arg(p->n).arg(cm).arg(ppm).arg(p->rms * 100, 0, 'f', 1);
+    }
+
+    out << QString("%1 pairs calibrated\n").arg(calibrated);
+
+    if(!saveRangeCorrections(parser.value(outputOption), parser.value(anchorsOption), corrections))
+    {
+        return 1;
+    }
+
+    out << "written " << parser.value(outputOption) << "\n";
+
+    return 0;
+}
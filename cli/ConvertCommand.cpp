@@ -0,0 +1,157 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: ConvertCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "LogRecord.h"
+
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <stdio.h>
+
+#define CONVERT_BUFFER_SIZE (1 << 20)
+
+/**
+* @brief rtlstool convert: write a binary application log as the text log the application writes
+*/
+int convertCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Convert a binary application log (RTLS_log.bin) to the text log.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Binary application log.");
+
+    QCommandLineOption outputOption("output", "Text log to write (default the log with the extension .txt).", "file");
+
+    parser.addOption(outputOption);
+
+    parser.process(args);
+
+    if(parser.positionalArguments().size() != 1)
+    {
+        err << "convert: one log expected\n";
+        return 1;
+    }
+
+    QString input = parser.positionalArguments().at(0);
+    QString output = parser.value(outputOption);
+
+    if(output.isEmpty())
+    {
+        QFileInfo info(input);
+
+        output = info.path() + "/" + info.completeBaseName() + ".txt";
+    }
+
+    QFile in(input);
+
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        err << "convert: cannot read " << input << "\n";
+        return 1;
+    }
+
+    qint64 size = in.size();
+    const uchar *data = (size > 0) ? in.map(0, size) : NULL;
+    log_header_t h;
+    int n = data ? log_decode_header(data, size, &h) : -1;
+
+    if(n <= 0)
+    {
+        err << "convert: " << input << " is not a binary log\n";
+        return 1;
+    }
+
+    if(h.version > LOG_VERSION)
+    {
+        err << "convert: " << input << " has a newer version (" << h.version << "), the records the tool doesn't know are left out\n";
+    }
+
+    QFile file(output);
+
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        err << "convert: cannot write " << output << "\n";
+        return 1;
+    }
+
+    //the first line is the one which was the header, the records are formatted into a large buffer
+    QByteArray buffer(CONVERT_BUFFER_SIZE, 0);
+    char *start = buffer.data();
+    char *p = log_format_time(start, h.start);
+    qint64 offset = n, records = 0, skipped = 0;
+    log_record_t r;
+
+    file.write(start, p - start);
+    file.write(h.text);
+    p = start;
+
+    while(offset < size)
+    {
+        n = log_decode(data + offset, size - offset, &h, &r);
+
+        if(n <= 0)
+        {
+            if(n < 0)
+            {
+                err << "convert: bad record at " << offset << ", the rest of the log is left out\n";
+            }
+            break;
+        }
+
+        offset += n;
+
+        if(r.type >= LOG_TYPES)
+        {
+            skipped++;
+            continue;
+        }
+
+        if((r.type == LOG_TEXT) && (LOG_MAX_TEXT_LINE + r.length > CONVERT_BUFFER_SIZE))
+        {
+            file.write(start, p - start);
+            p = log_format_time(start, r.time);
+            file.write(start, p - start);
+            file.write(r.text, r.length);
+            p = start;
+            records++;
+            continue;
+        }
+
+        if((p - start) + LOG_MAX_TEXT_LINE + ((r.type == LOG_TEXT) ? r.length : 0) > CONVERT_BUFFER_SIZE)
+        {
+            file.write(start, p - start);
+            p = start;
+        }
+
+        p = log_format_text(p, &r);
+        records++;
+    }
+
+    file.write(start, p - start);
+    file.close();
+
+    out << QString("%1 records written to %2").arg(records).arg(output);
+
+    if(skipped > 0)
+    {
+        out << QString(", %1 of unknown types left out").arg(skipped);
+    }
+
+    out << "\n";
+
+    return 0;
+}
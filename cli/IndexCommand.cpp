@@ -0,0 +1,96 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: IndexCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "LogTable.h"
+#include "LogIndex.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+/**
+* @brief rtlstool index: parse text application logs and write the index of their records next to them
+*/
+int indexCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Index the records of text application logs (<log>.idx), for rtlstool query.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "Text application logs (RTLS_log.txt).", "log...");
+
+    QCommandLineOption dateOption("date", "Date of the first line, yyyy-MM-dd (default from the log file name).", "date");
+
+    parser.addOption(dateOption);
+
+    parser.process(args);
+
+    QStringList logs = parser.positionalArguments();
+    QDate date;
+
+    if(logs.isEmpty())
+    {
+        err << "index: no logs\n";
+        return 1;
+    }
+
+    if(parser.isSet(dateOption))
+    {
+        date = QDate::fromString(parser.value(dateOption), "yyyy-MM-dd");
+
+        if(!date.isValid())
+        {
+            err << "index: invalid --date\n";
+            return 1;
+        }
+    }
+
+    for(int i=0; i<logs.size(); i++)
+    {
+        LogTable table;
+        QElapsedTimer timer;
+        QString error;
+
+        timer.start();
+
+        if(!table.load(logs.at(i), date, false))
+        {
+            err << "index: " << table.errorString() << "\n";
+            return 1;
+        }
+
+        qint64 parsed = timer.elapsed();
+
+        if(!LogIndex::build(table, logs.at(i), LogIndex::indexName(logs.at(i)), &error))
+        {
+            err << "index: " << error << "\n";
+            return 1;
+        }
+
+        out << QString("%1: %2 MB, %3 lines, %4 text, %5 unreadable, parsed in %6 ms, indexed in %7 ms\n")
+               .arg(logs.at(i)).arg(table.size() / 1048576.0, 0, 'f', 1).arg(table.lines()).arg(table.textLines())
+               .arg(table.badLines()).arg(parsed).arg(timer.elapsed() - parsed);
+
+        for(int t=LOG_TEXT+1; t<LOG_TYPES; t++)
+        {
+            if(table.count(t) > 0)
+            {
+                out << QString("  %1 %2\n").arg(log_type_name(t)).arg(table.count(t));
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,409 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogIndex.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LogIndex.h"
+
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+#include <algorithm>
+#include <string.h>
+
+#define LI_WRITE_BLOCK  (65536)     //values converted and written at a time
+
+/* write n values of v, little endian */
+static bool li_write(QSaveFile *file, const qint64 *v, qint64 n)
+{
+    QVector<uchar> buf(LI_WRITE_BLOCK * 8);
+
+    for(qint64 k=0; k<n; k+=LI_WRITE_BLOCK)
+    {
+        int m = (int) qMin<qint64>(LI_WRITE_BLOCK, n - k);
+
+        for(int j=0; j<m; j++)
+        {
+            qToLittleEndian<qint64>(v[k + j], buf.data() + j * 8);
+        }
+
+        if(file->write((const char *) buf.constData(), m * 8) != m * 8)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* the key of each ID, in the order of the IDs, and the records grouped by key and sorted by time */
+static void li_group(int type, const log_column_t &col, qint64 first, QVector<log_index_key_t> *keys, qint64 *times,
+                     qint64 *offsets)
+{
+    int n = col.time.size();
+    QHash<quint64, int> map;
+    QVector<log_index_key_t> group;
+    QVector<int> key(n);
+
+    for(int j=0; j<n; j++)
+    {
+        QHash<quint64, int>::iterator it = map.find(col.id.at(j));
+
+        if(it == map.end())
+        {
+            log_index_key_t k;
+
+            memset(&k, 0, sizeof(k));
+            k.type = type;
+            k.id = col.id.at(j);
+            it = map.insert(k.id, group.size());
+            group.append(k);
+        }
+
+        key[j] = it.value();
+        group[it.value()].count++;
+    }
+
+    QVector<QPair<quint64, int> > order(group.size());
+
+    for(int k=0; k<order.size(); k++)
+    {
+        order[k] = qMakePair(group.at(k).id, k);
+    }
+
+    std::sort(order.begin(), order.end());
+
+    for(int k=0; k<order.size(); k++)
+    {
+        group[order.at(k).second].first = first;
+        first += group.at(order.at(k).second).count;
+    }
+
+    //counting sort, the records of a key stay in the order of the log
+    QVector<qint64> next(group.size());
+
+    for(int k=0; k<group.size(); k++)
+    {
+        next[k] = group.at(k).first;
+    }
+
+    for(int j=0; j<n; j++)
+    {
+        qint64 p = next[key.at(j)]++;
+
+        times[p] = col.time.at(j);
+        offsets[p] = col.offset.at(j);
+    }
+
+    //which is also the order of time, unless the clock was set back
+    for(int k=0; k<order.size(); k++)
+    {
+        log_index_key_t g = group.at(order.at(k).second);
+        qint64 *t = times + g.first, *o = offsets + g.first;
+
+        if(!std::is_sorted(t, t + g.count))
+        {
+            QVector<QPair<qint64, qint64> > r(g.count);
+
+            for(qint64 j=0; j<g.count; j++)
+            {
+                r[j] = qMakePair(t[j], o[j]);
+            }
+
+            //the offsets keep the records of the same time in the order of the log
+            std::sort(r.begin(), r.end());
+
+            for(qint64 j=0; j<g.count; j++)
+            {
+                t[j] = r.at(j).first;
+                o[j] = r.at(j).second;
+            }
+        }
+
+        g.firstTime = t[0];
+        g.lastTime = t[g.count - 1];
+        keys->append(g);
+    }
+}
+
+LogIndex::LogIndex() :
+    _data(NULL),
+    _records(0),
+    _date(0),
+    _times(0),
+    _offsets(0)
+{
+}
+
+LogIndex::~LogIndex()
+{
+    close();
+}
+
+QString LogIndex::indexName(const QString &log)
+{
+    return log + ".idx";
+}
+
+bool LogIndex::build(const LogTable &table, const QString &log, const QString &filename, QString *error)
+{
+    QFileInfo info(log);
+    QVector<log_index_key_t> keys;
+    qint64 n = 0;
+
+    for(int t=LOG_TEXT+1; t<LOG_TYPES; t++)
+    {
+        n += table.count(t);
+    }
+
+    QVector<qint64> times(n), offsets(n);
+
+    qint64 first = 0;
+
+    for(int t=LOG_TEXT+1; t<LOG_TYPES; t++)
+    {
+        li_group(t, table.column(t), first, &keys, times.data(), offsets.data());
+        first += table.count(t);
+    }
+
+    uchar header[LI_HEADER_SIZE];
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, LI_MAGIC, 8);
+    qToLittleEndian<quint16>(LI_VERSION, header + 8);
+    qToLittleEndian<quint32>(keys.size(), header + 12);
+    qToLittleEndian<qint64>(info.size(), header + 16);
+    qToLittleEndian<qint64>(info.lastModified().toMSecsSinceEpoch(), header + 24);
+    qToLittleEndian<qint64>(table.dateTime(), header + 32);
+    qToLittleEndian<qint64>(n, header + 40);
+
+    QByteArray k(keys.size() * LI_KEY_SIZE, 0);
+
+    for(int j=0; j<keys.size(); j++)
+    {
+        uchar *p = (uchar *) k.data() + j * LI_KEY_SIZE;
+
+        p[0] = (uchar) keys.at(j).type;
+        qToLittleEndian<quint64>(keys.at(j).id, p + 8);
+        qToLittleEndian<qint64>(keys.at(j).first, p + 16);
+        qToLittleEndian<qint64>(keys.at(j).count, p + 24);
+        qToLittleEndian<qint64>(keys.at(j).firstTime, p + 32);
+        qToLittleEndian<qint64>(keys.at(j).lastTime, p + 40);
+    }
+
+    //written to a temporary file which replaces the index when it is complete
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly) ||
+        (file.write((const char *) header, LI_HEADER_SIZE) != LI_HEADER_SIZE) ||
+        (file.write(k) != k.size()) ||
+        !li_write(&file, times.constData(), n) || !li_write(&file, offsets.constData(), n) ||
+        !file.commit())
+    {
+        *error = QString("cannot write %1 %2").arg(filename).arg(file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+bool LogIndex::open(const QString &filename, const QString &log)
+{
+    close();
+
+    QFileInfo info(log);
+
+    _file.setFileName(filename);
+
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        _error = QString("cannot read %1").arg(filename);
+        return false;
+    }
+
+    qint64 size = _file.size();
+
+    _data = (size >= LI_HEADER_SIZE) ? _file.map(0, size) : NULL;
+
+    if(!_data || (memcmp(_data, LI_MAGIC, 8) != 0) || (qFromLittleEndian<quint16>(_data + 8) != LI_VERSION))
+    {
+        _error = QString("%1 is not an index of this version").arg(filename);
+        close();
+        return false;
+    }
+
+    if((qFromLittleEndian<qint64>(_data + 16) != info.size()) ||
+       (qFromLittleEndian<qint64>(_data + 24) != info.lastModified().toMSecsSinceEpoch()))
+    {
+        _error = QString("%1 is out of date").arg(filename);
+        close();
+        return false;
+    }
+
+    int n = qFromLittleEndian<quint32>(_data + 12);
+
+    _date = qFromLittleEndian<qint64>(_data + 32);
+    _records = qFromLittleEndian<qint64>(_data + 40);
+    _times = LI_HEADER_SIZE + (qint64) n * LI_KEY_SIZE;
+    _offsets = _times + _records * 8;
+
+    if((_records < 0) || (_offsets + _records * 8 != size))
+    {
+        _error = QString("%1 is truncated").arg(filename);
+        close();
+        return false;
+    }
+
+    _keys.resize(n);
+
+    for(int j=0; j<n; j++)
+    {
+        const uchar *p = _data + LI_HEADER_SIZE + j * LI_KEY_SIZE;
+        log_index_key_t &k = _keys[j];
+
+        k.type = p[0];
+        k.id = qFromLittleEndian<quint64>(p + 8);
+        k.first = qFromLittleEndian<qint64>(p + 16);
+        k.count = qFromLittleEndian<qint64>(p + 24);
+        k.firstTime = qFromLittleEndian<qint64>(p + 32);
+        k.lastTime = qFromLittleEndian<qint64>(p + 40);
+
+        if((k.first < 0) || (k.count < 0) || (k.first + k.count > _records))
+        {
+            _error = QString("%1 is damaged").arg(filename);
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LogIndex::close()
+{
+    if(_data)
+    {
+        _file.unmap((uchar *) _data);
+        _data = NULL;
+    }
+
+    _file.close();
+    _keys.clear();
+    _records = 0;
+}
+
+QString LogIndex::errorString() const
+{
+    return _error;
+}
+
+int LogIndex::keys() const
+{
+    return _keys.size();
+}
+
+const log_index_key_t &LogIndex::key(int k) const
+{
+    return _keys.at(k);
+}
+
+qint64 LogIndex::records() const
+{
+    return _records;
+}
+
+qint64 LogIndex::dateTime() const
+{
+    return _date;
+}
+
+qint64 LogIndex::time(qint64 k) const
+{
+    return qFromLittleEndian<qint64>(_data + _times + k * 8);
+}
+
+qint64 LogIndex::offset(qint64 k) const
+{
+    return qFromLittleEndian<qint64>(_data + _offsets + k * 8);
+}
+
+qint64 LogIndex::find(int type, quint64 id, qint64 from, qint64 to, QVector<qint64> *offsets) const
+{
+    qint64 n = 0;
+    int keys = 0;
+
+    for(int j=0; j<_keys.size(); j++)
+    {
+        const log_index_key_t &k = _keys.at(j);
+
+        if((k.type != type) || ((id != LI_ANY_ID) && (k.id != id)) || (k.lastTime < from) || (k.firstTime > to))
+        {
+            continue;
+        }
+
+        //first record at or after from and first one after to
+        qint64 lo = k.first, hi = k.first + k.count;
+
+        while(lo < hi)
+        {
+            qint64 m = (lo + hi) / 2;
+
+            if(time(m) < from)
+            {
+                lo = m + 1;
+            }
+            else
+            {
+                hi = m;
+            }
+        }
+
+        qint64 begin = lo;
+
+        hi = k.first + k.count;
+
+        while(lo < hi)
+        {
+            qint64 m = (lo + hi) / 2;
+
+            if(time(m) <= to)
+            {
+                lo = m + 1;
+            }
+            else
+            {
+                hi = m;
+            }
+        }
+
+        n += lo - begin;
+
+        if(offsets && (lo > begin))
+        {
+            for(qint64 m=begin; m<lo; m++)
+            {
+                offsets->append(offset(m));
+            }
+
+            keys++;
+        }
+    }
+
+    //the records of several IDs in the order of the log
+    if(offsets && (keys > 1))
+    {
+        std::sort(offsets->begin(), offsets->end());
+    }
+
+    return n;
+}
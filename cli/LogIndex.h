@@ -0,0 +1,110 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogIndex.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LOGINDEX_H
+#define LOGINDEX_H
+
+#include <QVector>
+#include <QString>
+#include <QFile>
+
+#include "LogTable.h"
+
+#define LI_MAGIC            "RTLSIDX"
+#define LI_VERSION          (1)
+#define LI_HEADER_SIZE      (64)
+#define LI_KEY_SIZE         (48)
+#define LI_ANY_ID           (~0ULL)
+
+/**
+ * The records of one type and ID in the index
+ */
+typedef struct
+{
+    int type;
+    quint64 id;                     //tag ID, anchor ID of RA, AP and AH
+    qint64 first;                   //first of its records in the time and offset arrays
+    qint64 count;
+    qint64 firstTime, lastTime;     //(us)
+} log_index_key_t;
+
+/**
+ * The LogIndex class is the index of a text application log, kept next to it ("<log>.idx").
+ *
+ * The index has the time and the offset of the line of every record, grouped by type and ID (tag or anchor) and
+ * sorted by time within each group, so the records of a tag in a time range are found with two binary searches
+ * without reading the log. It is mapped into memory, the log is only read for the lines found.
+ *
+ * The file (all values little endian):
+ *   char[8]  "RTLSIDX\0"
+ *   u16      version
+ *   u16      0
+ *   u32      number of keys
+ *   i64      size and i64 (ms since 1970-01-01 UTC) modification time of the log when it was indexed
+ *   i64      (us) local time of the start of the date of the log
+ *   i64      number of records
+ *   to LI_HEADER_SIZE: 0
+ * the keys, LI_KEY_SIZE each: u8 type, 7 bytes 0, u64 ID, i64 first, i64 count, i64 first time, i64 last time,
+ * followed by the times (i64 us) and then by the offsets (i64) of the records.
+ */
+class LogIndex
+{
+public:
+    LogIndex();
+    ~LogIndex();
+
+    /**
+     * @return the file name of the index of \a log
+     */
+    static QString indexName(const QString &log);
+
+    /**
+     * Write the index of the records of \a table (of \a log) to \a filename
+     */
+    static bool build(const LogTable &table, const QString &log, const QString &filename, QString *error);
+
+    /**
+     * Open the index \a filename, which must be the one of the current \a log
+     * @return false if it can't be read or is out of date, see errorString()
+     */
+    bool open(const QString &filename, const QString &log);
+    void close();
+
+    QString errorString() const;
+
+    int keys() const;
+    const log_index_key_t &key(int k) const;
+    qint64 records() const;
+    qint64 dateTime() const;        //(us) local time of the start of the date of the log
+
+    /**
+     * Offsets of the lines of the records of \a type and \a id (LI_ANY_ID for all) from \a from to \a to (us,
+     * inclusive), in the order of the log, or only their number if \a offsets is NULL
+     * @return the number of records
+     */
+    qint64 find(int type, quint64 id, qint64 from, qint64 to, QVector<qint64> *offsets) const;
+
+private:
+    qint64 time(qint64 k) const;
+    qint64 offset(qint64 k) const;
+
+    QFile _file;
+    const uchar *_data;
+    QVector<log_index_key_t> _keys;
+    qint64 _records;
+    qint64 _date;
+    qint64 _times;                  //of the arrays in the file
+    qint64 _offsets;
+    QString _error;
+};
+
+#endif // LOGINDEX_H
@@ -0,0 +1,353 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogTable.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LogTable.h"
+
+#include <QtConcurrent>
+#include <QRegExp>
+#include <QFileInfo>
+#include <string.h>
+
+#define TB_HALF_DAY     (43200000)      //(ms)
+
+/* the records of an anchor, which have its ID in i[0] */
+static inline bool tb_anchor(int type)
+{
+    return (type == LOG_RA) || (type == LOG_AP) || (type == LOG_AH);
+}
+
+/**
+ * Functor parsing one part of the log, used by QtConcurrent::blockingMap()
+ */
+struct ParseChunk
+{
+    ParseChunk(const LogTable *table) : _table(table) {}
+
+    void operator()(log_chunk_t &c) const
+    {
+        _table->parse(&c);
+    }
+
+    const LogTable *_table;
+};
+
+LogTable::LogTable() :
+    _data(NULL),
+    _size(0),
+    _fields(false),
+    _date(0),
+    _lines(0),
+    _text(0),
+    _bad(0)
+{
+}
+
+LogTable::~LogTable()
+{
+    close();
+}
+
+void LogTable::close()
+{
+    if(_data)
+    {
+        _file.unmap((uchar *) _data);
+        _data = NULL;
+    }
+
+    _file.close();
+    _size = 0;
+    _lines = _text = _bad = 0;
+
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        _col[t] = log_column_t();
+        log_fields(t, &_col[t].ni, &_col[t].nd);
+    }
+}
+
+QDate LogTable::fileDate(const QString &filename)
+{
+    QRegExp rx("(\\d{8})_\\d{6}");
+    QDate date = (rx.indexIn(QFileInfo(filename).fileName()) >= 0) ? QDate::fromString(rx.cap(1), "yyyyMMdd") : QDate();
+
+    return date.isValid() ? date : QDate(1970, 1, 1);
+}
+
+bool LogTable::load(const QString &filename, const QDate &date, bool fields)
+{
+    close();
+
+    _file.setFileName(filename);
+
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        _error = QString("cannot read %1").arg(filename);
+        return false;
+    }
+
+    _size = _file.size();
+    _data = (_size > 0) ? _file.map(0, _size) : NULL;
+
+    if(!_data)
+    {
+        _error = QString("%1 is empty or cannot be mapped").arg(filename);
+        return false;
+    }
+
+    if((_size >= 2) && (_data[0] == 0x1f) && (_data[1] == 0x8b))
+    {
+        _error = QString("%1 is compressed, gunzip it first").arg(filename);
+        return false;
+    }
+
+    if((_size >= 8) && (memcmp(_data, LOG_MAGIC, 8) == 0))
+    {
+        _error = QString("%1 is a binary log, convert it to text first (rtlstool convert)").arg(filename);
+        return false;
+    }
+
+    _fields = fields;
+    _date = QDate(1970, 1, 1).daysTo(date.isValid() ? date : fileDate(filename)) * LT_DAY;
+
+    //parts of about LT_CHUNK_SIZE which start at the beginning of a line
+    QVector<log_chunk_t> chunks;
+    qint64 begin = 0;
+
+    while(begin < _size)
+    {
+        qint64 end = qMin(begin + LT_CHUNK_SIZE, _size);
+        const uchar *nl = (end < _size) ? (const uchar *) memchr(_data + end, '\n', _size - end) : NULL;
+
+        end = nl ? (nl - _data + 1) : _size;
+
+        log_chunk_t c;
+
+        c.begin = begin;
+        c.end = end;
+        chunks.append(c);
+        begin = end;
+    }
+
+    QtConcurrent::blockingMap(chunks, ParseChunk(this));
+
+    //the day each part starts on, from the times of the part before
+    QVector<qint64> base(chunks.size());
+    int day = 0, last = -1;
+
+    for(int c=0; c<chunks.size(); c++)
+    {
+        const log_chunk_t &k = chunks.at(c);
+
+        if(k.firstTime >= 0)
+        {
+            if((last >= 0) && (k.firstTime < last - TB_HALF_DAY))
+            {
+                day++;
+            }
+
+            last = k.lastTime;
+        }
+
+        base[c] = _date + day * LT_DAY;
+        day += k.days;
+
+        _lines += k.lines;
+        _text += k.text;
+        _bad += k.bad;
+    }
+
+    //append the columns of the parts, each part is freed when it has been copied
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        log_column_t &col = _col[t];
+        int n = 0;
+
+        for(int c=0; c<chunks.size(); c++)
+        {
+            n += chunks.at(c).col[t].time.size();
+        }
+
+        col.time.resize(n);
+        col.id.resize(n);
+        col.offset.resize(n);
+        col.i.resize(_fields ? n * col.ni : 0);
+        col.d.resize(_fields ? n * col.nd : 0);
+
+        for(int c=0, k=0; c<chunks.size(); c++)
+        {
+            log_column_t &part = chunks[c].col[t];
+            int m = part.time.size();
+
+            for(int j=0; j<m; j++)
+            {
+                col.time[k + j] = part.time.at(j) + base.at(c);
+            }
+
+            memcpy(col.id.data() + k, part.id.constData(), m * sizeof(quint64));
+            memcpy(col.offset.data() + k, part.offset.constData(), m * sizeof(qint64));
+
+            if(_fields)
+            {
+                memcpy(col.i.data() + k * col.ni, part.i.constData(), m * col.ni * sizeof(qint32));
+                memcpy(col.d.data() + k * col.nd, part.d.constData(), m * col.nd * sizeof(double));
+            }
+
+            part = log_column_t();
+            k += m;
+        }
+    }
+
+    return true;
+}
+
+void LogTable::parse(log_chunk_t *c) const
+{
+    const char *data = (const char *) _data;
+    const char *p = data + c->begin, *end = data + c->end;
+    log_record_t r;
+
+    c->firstTime = c->lastTime = -1;
+    c->days = 0;
+    c->lines = c->text = c->bad = 0;
+
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        log_fields(t, &c->col[t].ni, &c->col[t].nd);
+    }
+
+    while(p < end)
+    {
+        const char *e = (const char *) memchr(p, '\n', end - p);
+        const char *le;
+
+        e = e ? e : end;
+        le = ((e > p) && (e[-1] == '\r')) ? e - 1 : e;
+
+        c->lines++;
+
+        if(!log_parse_text(p, le, &r))
+        {
+            c->bad += (le > p);
+        }
+        else if(r.type == LOG_TEXT)
+        {
+            c->text++;
+        }
+        else
+        {
+            int ms = r.time / 1000;
+            log_column_t *col = &c->col[r.type];
+
+            //the time of day went back: the next day
+            if(c->firstTime < 0)
+            {
+                c->firstTime = ms;
+            }
+            else if(ms < c->lastTime - TB_HALF_DAY)
+            {
+                c->days++;
+            }
+
+            c->lastTime = ms;
+
+            col->time.append(r.time + c->days * LT_DAY);
+            col->id.append(tb_anchor(r.type) ? (quint64) r.i[0] : r.id);
+            col->offset.append(p - data);
+
+            if(_fields)
+            {
+                for(int k=0; k<col->ni; k++)
+                {
+                    col->i.append(r.i[k]);
+                }
+
+                for(int k=0; k<col->nd; k++)
+                {
+                    col->d.append(r.d[k]);
+                }
+            }
+        }
+
+        p = e + 1;
+    }
+}
+
+QString LogTable::errorString() const
+{
+    return _error;
+}
+
+const log_column_t &LogTable::column(int type) const
+{
+    return _col[type];
+}
+
+int LogTable::count(int type) const
+{
+    return _col[type].time.size();
+}
+
+void LogTable::record(int type, int k, log_record_t *r) const
+{
+    const log_column_t &col = _col[type];
+
+    memset(r, 0, sizeof(log_record_t));
+    r->type = type;
+    r->time = col.time.at(k);
+
+    if(_fields)
+    {
+        memcpy(r->i, col.i.constData() + k * col.ni, col.ni * sizeof(qint32));
+        memcpy(r->d, col.d.constData() + k * col.nd, col.nd * sizeof(double));
+    }
+
+    if(!tb_anchor(type))
+    {
+        r->id = col.id.at(k);
+    }
+}
+
+QByteArray LogTable::line(qint64 offset) const
+{
+    const char *p = (const char *) _data + offset;
+    const char *e = (const char *) memchr(p, '\n', _size - offset);
+
+    e = e ? e : (const char *) _data + _size;
+
+    return QByteArray(p, ((e > p) && (e[-1] == '\r')) ? (e - p - 1) : (e - p));
+}
+
+qint64 LogTable::size() const
+{
+    return _size;
+}
+
+qint64 LogTable::lines() const
+{
+    return _lines;
+}
+
+qint64 LogTable::textLines() const
+{
+    return _text;
+}
+
+qint64 LogTable::badLines() const
+{
+    return _bad;
+}
+
+qint64 LogTable::dateTime() const
+{
+    return _date;
+}
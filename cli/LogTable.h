@@ -0,0 +1,118 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogTable.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LOGTABLE_H
+#define LOGTABLE_H
+
+#include <QVector>
+#include <QString>
+#include <QDate>
+#include <QFile>
+
+#include "LogRecord.h"
+
+#define LT_CHUNK_SIZE       (4 << 20)           //(bytes) of the log parsed by one task
+#define LT_DAY              (86400000000LL)     //(us)
+
+/**
+ * The records of one type, one array per field
+ */
+typedef struct
+{
+    int ni, nd;                     //integer and floating point fields of the type
+    QVector<qint64> time;           //(us) local time
+    QVector<quint64> id;            //tag ID, the anchor ID (the first field) of RA, AP and AH
+    QVector<qint64> offset;         //of the line in the log
+    QVector<qint32> i;              //ni values per record, empty if the fields weren't loaded
+    QVector<double> d;              //nd values per record
+} log_column_t;
+
+/**
+ * Part of the log parsed by one task
+ */
+typedef struct
+{
+    qint64 begin, end;              //first line and end of the part
+    log_column_t col[LOG_TYPES];
+    int firstTime, lastTime;        //(ms) time of day of the first and last record, -1 if none
+    int days;                       //times of day which went back to the start of a day
+    qint64 lines;
+    qint64 text;                    //lines which aren't records
+    qint64 bad;                     //lines which can't be read
+} log_chunk_t;
+
+/**
+ * The LogTable class reads a text application log into columns.
+ *
+ * The log is mapped into memory and split into parts which start at the beginning of a line, the parts are parsed
+ * in parallel (log_parse_text()), each into columns of its own, which are then appended in the order of the parts.
+ * The text lines only have the time of day: the day starts at the date given (the date in the log file name by
+ * default) and a time more than 12 hours before the one of the line before is on the next day.
+ */
+class LogTable
+{
+public:
+    LogTable();
+    ~LogTable();
+
+    /**
+     * Read \a filename, with the values of the records if \a fields is set (only their time, ID and offset
+     * otherwise). An invalid \a date is taken from the file name ("yyyyMMdd_hhmmssRTLS_log.txt").
+     */
+    bool load(const QString &filename, const QDate &date, bool fields);
+    void close();
+
+    QString errorString() const;
+
+    /**
+     * @return the date of the first line, from a file name or 1970-01-01 if there was none
+     */
+    static QDate fileDate(const QString &filename);
+
+    const log_column_t &column(int type) const;
+    int count(int type) const;
+
+    /**
+     * Record \a k of \a type, the fields must have been loaded (the text of a record isn't kept)
+     */
+    void record(int type, int k, log_record_t *r) const;
+
+    /**
+     * @return the line at \a offset, without the line end
+     */
+    QByteArray line(qint64 offset) const;
+
+    qint64 size() const;
+    qint64 lines() const;
+    qint64 textLines() const;
+    qint64 badLines() const;
+    qint64 dateTime() const;        //(us) local time of the start of the date of the first line
+
+    /**
+     * Parse \a chunk, used by the parallel parsing
+     */
+    void parse(log_chunk_t *chunk) const;
+
+private:
+    QFile _file;
+    const uchar *_data;
+    qint64 _size;
+    bool _fields;
+    qint64 _date;
+    log_column_t _col[LOG_TYPES];
+    qint64 _lines;
+    qint64 _text;
+    qint64 _bad;
+    QString _error;
+};
+
+#endif // LOGTABLE_H
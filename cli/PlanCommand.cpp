@@ -0,0 +1,210 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: PlanCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "SiteFiles.h"
+#include "AnchorPlanner.h"
+#include "TagProcessor.h"
+
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QDir>
+#include <QImage>
+#include <QTextStream>
+#include <stdio.h>
+
+/**
+* @brief rtlstool plan: choose the anchor mounting points, out of a list of candidates,
+*        with the lowest GDOP over the walkable area of the floorplan (or over a rectangular area)
+*/
+int planCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Search the candidate mounting points for the anchor placement with the lowest GDOP.");
+    parser.addHelpOption();
+
+    QCommandLineOption viewOption("view", "Floorplan settings (TREKview_config.xml).", "file");
+    QCommandLineOption floorplanOption("floorplan", "Floorplan image, overrides the one in the floorplan settings.", "file");
+    QCommandLineOption areaOption("area", "Rectangular coverage area x0,y0,x1,y1 (m), instead of the floorplan.", "rect");
+    QCommandLineOption candidatesOption("candidates", "Candidate mounting points, one \"x y z [label]\" per line.", "file");
+    QCommandLineOption anchorsOption("anchors", QString("Number of anchors to place, %1 to %2 (default 4).").arg(GDOP_MIN_ANCHORS).arg(MAX_NUM_ANCS), "n", "4");
+    QCommandLineOption objectiveOption("objective", "Minimise the \"mean\" or the \"max\" GDOP (default mean).", "objective", "mean");
+    QCommandLineOption stepOption("step", "Coverage grid spacing in m (default 0.5).", "m", "0.5");
+    QCommandLineOption tagZOption("tag-z", "Tag height in m (default 1.0).", "m", "1.0");
+    QCommandLineOption rangeOption("max-range", "Maximum anchor range in m, 0 for no limit (default 0).", "m", "0");
+    QCommandLineOption thresholdOption("threshold", "Grey level (0-255) above which the floorplan is walkable (default 128).", "level", "128");
+    QCommandLineOption iterationsOption("iterations", "Maximum number of local search swaps (default 100).", "n", "100");
+    QCommandLineOption outputOption("output", "Anchor file to write (default TREKanc_config.xml).", "file", "TREKanc_config.xml");
+
+    parser.addOption(viewOption);
+    parser.addOption(floorplanOption);
+    parser.addOption(areaOption);
+    parser.addOption(candidatesOption);
+    parser.addOption(anchorsOption);
+    parser.addOption(objectiveOption);
+    parser.addOption(stepOption);
+    parser.addOption(tagZOption);
+    parser.addOption(rangeOption);
+    parser.addOption(thresholdOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(outputOption);
+
+    parser.process(args);
+
+    double step = parser.value(stepOption).toDouble();
+    double tagZ = parser.value(tagZOption).toDouble();
+    int budget = parser.value(anchorsOption).toInt();
+
+    if(!parser.isSet(candidatesOption))
+    {
+        err << "plan: --candidates is required\n";
+        return 1;
+    }
+
+    if(step <= 0)
+    {
+        err << "plan: invalid --step\n";
+        return 1;
+    }
+
+    //coverage area
+    QVector<vec3d> coverage;
+
+    if(parser.isSet(areaOption))
+    {
+        QStringList r = parser.value(areaOption).split(',');
+
+        if(r.size() != 4)
+        {
+            err << "plan: --area needs x0,y0,x1,y1\n";
+            return 1;
+        }
+
+        double x0 = qMin(r.at(0).toDouble(), r.at(2).toDouble());
+        double x1 = qMax(r.at(0).toDouble(), r.at(2).toDouble());
+        double y0 = qMin(r.at(1).toDouble(), r.at(3).toDouble());
+        double y1 = qMax(r.at(1).toDouble(), r.at(3).toDouble());
+
+        for(double y = y0 + step/2; y < y1; y += step)
+        {
+            for(double x = x0 + step/2; x < x1; x += step)
+            {
+                vec3d p;
+                p.x = x;
+                p.y = y;
+                p.z = tagZ;
+                coverage.append(p);
+            }
+        }
+    }
+    else
+    {
+        site_view_t view;
+        QString viewFile = parser.value(viewOption);
+
+        if(viewFile.isEmpty() || !loadViewConfig(viewFile, &view))
+        {
+            err << "plan: --view or --area is required\n";
+            return 1;
+        }
+
+        QString floorplan = parser.isSet(floorplanOption) ? parser.value(floorplanOption) : view.floorplan;
+
+        //a relative floorplan path is relative to the view settings file
+        if(QFileInfo(floorplan).isRelative())
+        {
+            floorplan = QFileInfo(viewFile).absoluteDir().filePath(floorplan);
+        }
+
+        QImage image(floorplan);
+
+        if(image.isNull())
+        {
+            err << "plan: cannot load floorplan " << floorplan << "\n";
+            return 1;
+        }
+
+        coverage = sampleWalkableArea(image, floorplanTransform(view), step, tagZ, parser.value(thresholdOption).toInt());
+    }
+
+    if(coverage.isEmpty())
+    {
+        err << "plan: the coverage area is empty\n";
+        return 1;
+    }
+
+    //candidate mounting points
+    QVector<vec3d> candidates;
+    QStringList labels;
+
+    if(!loadPoints(parser.value(candidatesOption), &candidates, &labels) || candidates.isEmpty())
+    {
+        err << "plan: no candidate points\n";
+        return 1;
+    }
+
+    //the application only uses anchors 0 to MAX_NUM_ANCS - 1 of the site file
+    if((budget < GDOP_MIN_ANCHORS) || (budget > qMin(candidates.size(), MAX_NUM_ANCS)))
+    {
+        err << QString("plan: --anchors must be between %1 and %2 (and at most the number of candidates, %3)\n")
+               .arg(GDOP_MIN_ANCHORS).arg(MAX_NUM_ANCS).arg(candidates.size());
+        return 1;
+    }
+
+    AnchorPlanner planner;
+
+    planner.setCoverage(coverage);
+    planner.setCandidates(candidates);
+    planner.setMaxRange(parser.value(rangeOption).toDouble());
+    planner.setMaxIterations(parser.value(iterationsOption).toInt());
+    planner.setObjective((parser.value(objectiveOption) == "max") ? AnchorPlanner::WorstGdop : AnchorPlanner::MeanGdop);
+
+    out << QString("%1 coverage points, %2 candidates, %3 anchors\n").arg(coverage.size()).arg(candidates.size()).arg(budget);
+    out.flush();
+
+    QVector<int> selected = planner.solve(budget);
+
+    double mean, worst, covered;
+    planner.statistics(&mean, &worst, &covered);
+
+    out << QString("mean GDOP %1, worst GDOP %2, %3% of the area covered\n").arg(mean, 0, 'f', 2).arg(worst, 0, 'f', 2).arg(covered * 100, 0, 'f', 1);
+
+    //anchor IDs follow the order the candidates were chosen in
+    QVector<site_anchor_t> anchors;
+
+    for(int i=0; i<selected.size(); i++)
+    {
+        int c = selected.at(i);
+        site_anchor_t a;
+
+        a.id = i;
+        a.label = labels.at(c).isEmpty() ? QString("A%1").arg(i) : labels.at(c);
+        a.x = candidates.at(c).x;
+        a.y = candidates.at(c).y;
+        a.z = candidates.at(c).z;
+        anchors.append(a);
+
+        out << QString("A%1 %2 (%3, %4, %5)\n").arg(i).arg(a.label).arg(a.x).arg(a.y).arg(a.z);
+    }
+
+    if(!saveAnchorConfig(parser.value(outputOption), anchors))
+    {
+        return 1;
+    }
+
+    out << "written " << parser.value(outputOption) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: QueryCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "LogTable.h"
+#include "LogIndex.h"
+
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/* "hh:mm[:ss[.zzz]]" on the day starting at day (us), or "yyyy-MM-ddThh:mm[:ss[.zzz]]", to us, -1 if it isn't one */
+static qint64 parseQueryTime(const QString &s, qint64 day)
+{
+    QDateTime dt = QDateTime::fromString(s, Qt::ISODate);
+    QTime t;
+
+    if(dt.isValid())
+    {
+        return QDate(1970, 1, 1).daysTo(dt.date()) * LT_DAY + dt.time().msecsSinceStartOfDay() * 1000LL;
+    }
+
+    t = QTime::fromString(s, "h:mm:ss.zzz");
+    t = t.isValid() ? t : QTime::fromString(s, "h:mm:ss");
+    t = t.isValid() ? t : QTime::fromString(s, "h:mm");
+
+    return t.isValid() ? day + t.msecsSinceStartOfDay() * 1000LL : -1;
+}
+
+/**
+* @brief rtlstool query: print the records of a type (and tag) in a time range of a text application log, using
+*        its index (written first if there is none or the log has changed)
+*/
+int queryCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Print the records of a type, tag and time range of a text application log.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Text application log (RTLS_log.txt), indexed first if needed.");
+
+    QCommandLineOption typeOption("type", "Record type (RR, RJ, RM, RC, LE, NL, RA, AP, AH, TS, RS or RG).", "type");
+    QCommandLineOption tagOption("tag", "Tag ID (anchor ID of RA, AP and AH), all by default.", "id");
+    QCommandLineOption fromOption("from", "Start, hh:mm[:ss[.zzz]] on the first day or yyyy-MM-ddThh:mm[:ss].", "time");
+    QCommandLineOption toOption("to", "End (included), as --from.", "time");
+    QCommandLineOption dateOption("date", "Date of the first line, yyyy-MM-dd (default from the log file name).", "date");
+    QCommandLineOption countOption("count", "Only print the number of records.");
+
+    parser.addOption(typeOption);
+    parser.addOption(tagOption);
+    parser.addOption(fromOption);
+    parser.addOption(toOption);
+    parser.addOption(dateOption);
+    parser.addOption(countOption);
+
+    parser.process(args);
+
+    if(parser.positionalArguments().size() != 1)
+    {
+        err << "query: one log expected\n";
+        return 1;
+    }
+
+    QString log = parser.positionalArguments().at(0);
+    QString name = LogIndex::indexName(log);
+    int type = log_type(qPrintable(parser.value(typeOption)));
+    quint64 id = LI_ANY_ID;
+    QDate date;
+    bool ok = true;
+
+    if(type <= LOG_TEXT)
+    {
+        err << "query: invalid --type\n";
+        return 1;
+    }
+
+    if(parser.isSet(tagOption))
+    {
+        id = parser.value(tagOption).toULongLong(&ok);
+
+        if(!ok)
+        {
+            err << "query: invalid --tag\n";
+            return 1;
+        }
+    }
+
+    if(parser.isSet(dateOption))
+    {
+        date = QDate::fromString(parser.value(dateOption), "yyyy-MM-dd");
+
+        if(!date.isValid())
+        {
+            err << "query: invalid --date\n";
+            return 1;
+        }
+    }
+
+    //the index is written again if it is out of date or for another date
+    LogIndex index;
+
+    if(!index.open(name, log) ||
+       (date.isValid() && (index.dateTime() != QDate(1970, 1, 1).daysTo(date) * LT_DAY)))
+    {
+        LogTable table;
+        QString error;
+
+        if(!table.load(log, date, false))
+        {
+            err << "query: " << table.errorString() << "\n";
+            return 1;
+        }
+
+        if(!LogIndex::build(table, log, name, &error) || !index.open(name, log))
+        {
+            err << "query: " << (error.isEmpty() ? index.errorString() : error) << "\n";
+            return 1;
+        }
+    }
+
+    qint64 from = parser.isSet(fromOption) ? parseQueryTime(parser.value(fromOption), index.dateTime()) : LLONG_MIN;
+    qint64 to = parser.isSet(toOption) ? parseQueryTime(parser.value(toOption), index.dateTime()) : LLONG_MAX;
+
+    if((from == -1) || (to == -1))
+    {
+        err << "query: invalid --from or --to\n";
+        return 1;
+    }
+
+    //the log has ms, --to includes the whole ms
+    to = (to == LLONG_MAX) ? to : to + 999;
+
+    if(parser.isSet(countOption))
+    {
+        out << index.find(type, id, from, to, NULL) << "\n";
+        return 0;
+    }
+
+    QVector<qint64> offsets;
+    QFile file(log);
+    const char *data;
+    qint64 size;
+
+    index.find(type, id, from, to, &offsets);
+
+    if (!file.open(QIODevice::ReadOnly) || ((size = file.size()) <= 0) || !(data = (const char *) file.map(0, size)))
+    {
+        err << "query: cannot read " << log << "\n";
+        return 1;
+    }
+
+    //the lines as they are in the log
+    for(int k=0; k<offsets.size(); k++)
+    {
+        const char *p = data + offsets.at(k);
+        const char *e = (const char *) memchr(p, '\n', size - offsets.at(k));
+
+        fwrite(p, 1, e ? (e - p + 1) : (data + size - p), stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RangeLog.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "RangeLog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* "RR:tid:k:range:corrected:seq:lnum", see TagProcessor::processTagRangeReports() */
+static bool rl_parse_rr(const char *s, range_log_record_t *r)
+{
+    unsigned long long id;
+    int k, range, corrected;
+
+    if((sscanf(s, "%llu:%d:%d:%d:%d:%d", &id, &k, &range, &corrected, &r->seq, &r->lnum) != 6) || (k < 0) || (k >= RL_NUM_RANGES))
+    {
+        return false;
+    }
+
+    r->type = RL_TAG;
+    r->id = id;
+    r->mask = 1 << k;
+    r->range[k] = range;
+    r->corrected[k] = corrected;
+
+    return true;
+}
+
+/* "RC:tid:mask:r0:r1:r2:r3:c0:c1:c2:c3:seq:lnum", the RR records of a range report in one (log policy) */
+static bool rl_parse_rc(const char *s, range_log_record_t *r)
+{
+    unsigned long long id;
+    int *v = r->range, *c = r->corrected;
+
+    if(sscanf(s, "%llu:%d:%d:%d:%d:%d:%d:%d:%d:%d:%d:%d", &id, &r->mask, &v[0], &v[1], &v[2], &v[3],
+              &c[0], &c[1], &c[2], &c[3], &r->seq, &r->lnum) != 12)
+    {
+        return false;
+    }
+
+    r->type = RL_TAG;
+    r->id = id;
+    r->mask &= (1 << RL_NUM_RANGES) - 1;
+
+    return true;
+}
+
+/* "RA:j:i:range:0:seq:lnum", see RTLSClient::processAnchRangeReport() */
+static bool rl_parse_ra(const char *s, range_log_record_t *r)
+{
+    int i, j, range, zero, k;
+
+    if(sscanf(s, "%d:%d:%d:%d:%d:%d", &j, &i, &range, &zero, &r->seq, &r->lnum) != 6)
+    {
+        return false;
+    }
+
+    if(i > j)
+    {
+        int t = i; i = j; j = t;
+    }
+
+    if((i == 0) && (j == 1))
+        k = 1;
+    else if((i == 0) && (j == 2))
+        k = 2;
+    else if((i == 1) && (j == 2))
+        k = 3;
+    else
+        return false;
+
+    r->type = RL_ANCHOR;
+    r->id = 0;
+    r->mask = 1 << k;
+    r->range[k] = range;
+    r->corrected[k] = range;
+
+    return true;
+}
+
+bool rl_parse_line(const char *line, range_log_record_t *r)
+{
+    int hh, mm, ss, ms, pos = 0;
+    char type[3];
+
+    memset(r, 0, sizeof(range_log_record_t));
+
+    //application log: T:hhmmsszzz:XX:...
+    if(sscanf(line, "T:%2d%2d%2d%3d:%2[A-Z]:%n", &hh, &mm, &ss, &ms, type, &pos) == 5)
+    {
+        if(pos == 0)
+        {
+            return false;
+        }
+
+        r->time = ((hh * 60 + mm) * 60 + ss) * 1000 + ms;
+
+        if(strcmp(type, "RR") == 0)
+        {
+            return rl_parse_rr(line + pos, r);
+        }
+
+        if(strcmp(type, "RC") == 0)
+        {
+            return rl_parse_rc(line + pos, r);
+        }
+
+        if(strcmp(type, "RA") == 0)
+        {
+            return rl_parse_ra(line + pos, r);
+        }
+
+        return false;
+    }
+
+    //raw report, same format as RTLSClient::newData() reads:
+    //mc 0f 00000663 000005a3 00000512 000004cb 095f c1 00024c24 a0:0
+    int tid, aid, mask, lnum, seq, rangetime;
+    char c, t;
+
+    if(sscanf(line, "m%c %x %x %x %x %x %x %x %x %c%d:%d", &t, &mask, &r->range[0], &r->range[1], &r->range[2], &r->range[3],
+              &lnum, &seq, &rangetime, &c, &tid, &aid) != 12)
+    {
+        return false;
+    }
+
+    if(t == 'c')
+    {
+        r->type = RL_TAG;
+        r->id = tid;
+        r->mask = mask & 0xF;
+    }
+    else if(t == 'a')
+    {
+        r->type = RL_ANCHOR;
+        r->mask = mask & 0xE;
+    }
+    else
+    {
+        return false;
+    }
+
+    r->time = -1;
+    r->seq = seq;
+    r->lnum = lnum;
+    memcpy(r->corrected, r->range, sizeof(r->corrected));
+
+    return true;
+}
+
+void rl_anchor_pair(int k, int *i, int *j)
+{
+    switch(k)
+    {
+        case 1: //range A0 to A1
+        *i = 0;
+        *j = 1;
+        break;
+        case 2: //range A0 to A2
+        *i = 0;
+        *j = 2;
+        break;
+        default: //range A1 to A2
+        *i = 1;
+        *j = 2;
+        break;
+    }
+}
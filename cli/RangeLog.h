@@ -0,0 +1,51 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RangeLog.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef RANGELOG_H
+#define RANGELOG_H
+
+#include <QtGlobal>
+
+#define RL_NUM_RANGES       (4)     //ranges in a range report
+
+#define RL_TAG              (1)     //tag - anchor ranges
+#define RL_ANCHOR           (2)     //anchor - anchor ranges
+
+/*
+ * Range reports read back from the application log (RR, RC and RA records) or from a raw capture of the
+ * serial data ("mc" and "ma" reports, one per line).
+ *
+ * An RR or RA line holds a single range, an RC line or a raw report up to four. Both are returned in the layout of the raw report:
+ * for tag ranges range[k] is the range to anchor k, for anchor ranges range[1], range[2] and range[3] are the
+ * A0-A1, A0-A2 and A1-A2 ranges. Bit k of mask is set if range[k] is valid. corrected[k] is the range with the
+ * tag - anchor range correction of the application, for raw reports it is the same as range[k].
+ */
+
+typedef struct
+{
+    int type;                       //RL_TAG or RL_ANCHOR
+    int time;                       //(ms) time of day of the log record, -1 for raw reports
+    quint64 id;                     //tag ID (tag ranges)
+    int mask;
+    int range[RL_NUM_RANGES];       //(mm) range as reported
+    int corrected[RL_NUM_RANGES];   //(mm) range with the range correction
+    int seq;
+    int lnum;
+} range_log_record_t;
+
+/* parse one line (without the line end), returns false if it isn't a range record */
+bool rl_parse_line(const char *line, range_log_record_t *r);
+
+/* anchors i and j of anchor range k (1-3) */
+void rl_anchor_pair(int k, int *i, int *j);
+
+#endif // RANGELOG_H
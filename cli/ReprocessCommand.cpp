@@ -0,0 +1,402 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: ReprocessCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "Reprocessor.h"
+#include "LogTable.h"
+#include "RangeLog.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QThread>
+#include <string.h>
+#include <stdio.h>
+
+#define REPROCESS_PERIOD    (100)   //(ms) default time between two range reports of a tag in a raw capture
+
+/**
+ * Time of the last report of a tag in a raw capture
+ */
+typedef struct
+{
+    qint64 time;                    //(us)
+    int seq;
+} raw_clock_t;
+
+/* add the RR, RM and RC records of a text log in the order of the lines, returns false if it has none */
+static bool readTextLog(const LogTable &table, Reprocessor *rp)
+{
+    const int types[3] = {LOG_RR, LOG_RM, LOG_RC};
+    int next[3] = {0, 0, 0};
+    log_record_t r;
+
+    if(table.count(LOG_RR) + table.count(LOG_RM) + table.count(LOG_RC) == 0)
+    {
+        return false;
+    }
+
+    for(;;)
+    {
+        int c = -1;
+
+        for(int j=0; j<3; j++)
+        {
+            if((next[j] < table.count(types[j])) &&
+               ((c == -1) || (table.column(types[j]).offset.at(next[j]) < table.column(types[c]).offset.at(next[c]))))
+            {
+                c = j;
+            }
+        }
+
+        if(c == -1)
+        {
+            break;
+        }
+
+        table.record(types[c], next[c]++, &r);
+        rp->addRecord(r);
+    }
+
+    return true;
+}
+
+/* add the records of a binary log, returns false if one can't be read */
+static bool readBinaryLog(const uchar *data, qint64 size, const log_header_t &h, qint64 offset, Reprocessor *rp)
+{
+    log_record_t r;
+
+    while(offset < size)
+    {
+        int n = log_decode(data + offset, size - offset, &h, &r);
+
+        if(n <= 0)
+        {
+            return (n == 0);
+        }
+
+        rp->addRecord(r);
+        offset += n;
+    }
+
+    return true;
+}
+
+/* add the tag range reports of a raw capture ("mc" lines), which don't have a time: the first report of each tag is
+   at start (us), the next ones period (ms) times the difference of their sequence numbers later */
+static qint64 readRawCapture(const QString &filename, qint64 start, int period, QHash<quint64, raw_clock_t> *clocks,
+                             Reprocessor *rp)
+{
+    QFile file(filename);
+    char line[256];
+    range_log_record_t r;
+    qint64 reports = 0;
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return -1;
+    }
+
+    while(file.readLine(line, sizeof(line)) > 0)
+    {
+        if(!rl_parse_line(line, &r) || (r.type != RL_TAG) || (r.time != -1))
+        {
+            continue;
+        }
+
+        raw_clock_t c;
+        QHash<quint64, raw_clock_t>::iterator it = clocks->find(r.id);
+
+        if(it == clocks->end())
+        {
+            c.time = start;
+        }
+        else
+        {
+            c.time = it.value().time + qMax(1, (r.seq - it.value().seq) & 0xff) * period * 1000LL;
+        }
+
+        c.seq = r.seq;
+        clocks->insert(r.id, c);
+
+        reprocess_report_t report;
+
+        report.time = c.time;
+        report.tag = r.id;
+        report.mask = r.mask;
+        memcpy(report.range, r.range, sizeof(report.range));
+        report.seq = r.seq;
+        report.lnum = r.lnum;
+        rp->add(report);
+        reports++;
+    }
+
+    return reports;
+}
+
+/**
+* @brief rtlstool reprocess: run the range reports of application logs or raw captures through the processing of
+*        the application again (range corrections, range gate, anchor health, trilateration and tag statistics),
+*        with the anchors and settings of a configuration file, and write the new log
+*/
+int reprocessCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Process the range reports of application logs or raw captures again and write the new log.\n"
+                                     "The logs are read one after the other, as the parts of one log. The ranges must all be\n"
+                                     "in them (RR and RM or RC records, without decimation or deadband).");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "Text or binary application logs, or raw captures (\"mc\" lines).", "logs...");
+
+    QCommandLineOption configOption("config", "Anchors, range corrections, filter_cfg and log policies (default TREKanc_config.xml).", "file");
+    QCommandLineOption outputOption("output", "Log to write (default the first log with _reprocessed.txt or .bin).", "file");
+    QCommandLineOption formatOption("format", "Format of the log written, text (default) or binary.", "format");
+    QCommandLineOption typesOption("types", "Record types written, e.g. LE,NL,TS (default all of them).", "types");
+    QCommandLineOption gateOption("gate", "Range gate speed (m/s, 0 for no range gate) instead of the one of the configuration.", "speed");
+    QCommandLineOption historyOption("history", "Positions in the tag statistics instead of the configured ones.", "n");
+    QCommandLineOption r95Option("r95-interval", "Positions between two tag statistics instead of the configured ones.", "n");
+    QCommandLineOption threadsOption("threads", "Threads the tags are shared out to (default the number of cores), 1 for the log of the application.", "n");
+    QCommandLineOption dateOption("date", "Date of the first line of a text log or raw capture, yyyy-MM-dd (default from the file name).", "date");
+    QCommandLineOption periodOption("period", QString("Time between two range reports of a tag in a raw capture (ms, default %1).").arg(REPROCESS_PERIOD), "ms");
+
+    parser.addOption(configOption);
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(typesOption);
+    parser.addOption(gateOption);
+    parser.addOption(historyOption);
+    parser.addOption(r95Option);
+    parser.addOption(threadsOption);
+    parser.addOption(dateOption);
+    parser.addOption(periodOption);
+
+    parser.process(args);
+
+    QStringList logs = parser.positionalArguments();
+
+    if(logs.isEmpty())
+    {
+        err << "reprocess: no log given\n";
+        return 1;
+    }
+
+    QString config = parser.isSet(configOption) ? parser.value(configOption) : QString("TREKanc_config.xml");
+    int format = LOG_FORMAT_TEXT;
+    int threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : QThread::idealThreadCount();
+    int period = parser.isSet(periodOption) ? parser.value(periodOption).toInt() : REPROCESS_PERIOD;
+    quint32 types = 0xffffffff;
+    QDate date;
+
+    if(parser.isSet(formatOption))
+    {
+        if(parser.value(formatOption) == "binary")
+        {
+            format = LOG_FORMAT_BINARY;
+        }
+        else if(parser.value(formatOption) != "text")
+        {
+            err << "reprocess: invalid --format\n";
+            return 1;
+        }
+    }
+
+    if(parser.isSet(typesOption))
+    {
+        QStringList names = parser.value(typesOption).split(",", QString::SkipEmptyParts);
+
+        types = 0;
+
+        for(int i=0; i<names.size(); i++)
+        {
+            int type = log_type(qPrintable(names.at(i).trimmed().toUpper()));
+
+            if(type <= LOG_TEXT)
+            {
+                err << "reprocess: invalid type " << names.at(i) << " in --types\n";
+                return 1;
+            }
+
+            types |= (1 << type);
+        }
+    }
+
+    if((threads < 1) || (period < 1))
+    {
+        err << "reprocess: invalid --threads or --period\n";
+        return 1;
+    }
+
+    if(parser.isSet(dateOption))
+    {
+        date = QDate::fromString(parser.value(dateOption), "yyyy-MM-dd");
+
+        if(!date.isValid())
+        {
+            err << "reprocess: invalid --date\n";
+            return 1;
+        }
+    }
+
+    //the anchors which aren't in the configuration are where the application puts them
+    anc_struct_t anchors[MAX_NUM_ANCS];
+    double x[MAX_NUM_ANCS] = {0.0, 5.0, 0.0, 5.0};
+    double y[MAX_NUM_ANCS] = {0.0, 0.0, 5.0, 5.0};
+    QVector<site_anchor_t> site;
+    RangeCorrections corrections;
+    site_processing_t processing;
+    log_policies_t policies;
+
+    for(int j=0; j<MAX_NUM_ANCS; j++)
+    {
+        anchors[j].id = j;
+        anchors[j].x = x[j];
+        anchors[j].y = y[j];
+        anchors[j].z = 3.0;
+    }
+
+    if(!loadAnchorConfig(config, &site) || !loadRangeCorrections(config, &corrections) ||
+       !loadProcessingConfig(config, &processing, &policies))
+    {
+        err << "reprocess: cannot read " << config << "\n";
+        return 1;
+    }
+
+    for(int i=0; i<site.size(); i++)
+    {
+        int j = site.at(i).id & 0x3;
+
+        anchors[j].label = site.at(i).label;
+        anchors[j].x = site.at(i).x;
+        anchors[j].y = site.at(i).y;
+        anchors[j].z = site.at(i).z;
+    }
+
+    if(parser.isSet(gateOption))
+    {
+        processing.rangeGateSpeed = qMax(0.0, parser.value(gateOption).toDouble());
+    }
+
+    if(parser.isSet(historyOption))
+    {
+        processing.hisLength = parser.value(historyOption).toInt();
+    }
+
+    if(parser.isSet(r95Option))
+    {
+        processing.r95Interval = qMax(1, parser.value(r95Option).toInt());
+    }
+
+    QString output = parser.value(outputOption);
+
+    if(output.isEmpty())
+    {
+        QFileInfo info(logs.at(0));
+
+        output = info.path() + "/" + info.completeBaseName() + "_reprocessed" + ((format == LOG_FORMAT_BINARY) ? ".bin" : ".txt");
+    }
+
+    Reprocessor rp(anchors, &corrections, &policies, processing, threads);
+
+    rp.setTypes(types);
+
+    if(!rp.open(output, format))
+    {
+        err << "reprocess: cannot write " << output << "\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    QHash<quint64, raw_clock_t> clocks;
+
+    timer.start();
+
+    for(int i=0; i<logs.size(); i++)
+    {
+        QFile in(logs.at(i));
+
+        if (!in.open(QIODevice::ReadOnly))
+        {
+            err << "reprocess: cannot read " << logs.at(i) << "\n";
+            return 1;
+        }
+
+        //a binary log is read record by record, a text log into a LogTable (in parallel)
+        qint64 size = in.size();
+        const uchar *data = (size > 0) ? in.map(0, size) : NULL;
+        log_header_t h;
+        int n = data ? log_decode_header(data, size, &h) : -1;
+
+        if(n > 0)
+        {
+            if(i == 0)
+            {
+                rp.setHeader(h.text, h.utcOffset);
+            }
+
+            if(!readBinaryLog(data, size, h, n, &rp))
+            {
+                err << "reprocess: bad record in " << logs.at(i) << ", the rest of it is left out\n";
+            }
+            continue;
+        }
+
+        in.close();
+
+        LogTable table;
+
+        if(!table.load(logs.at(i), date, true))
+        {
+            err << "reprocess: " << table.errorString() << "\n";
+            return 1;
+        }
+
+        QByteArray first = table.line(0);
+        int k = first.indexOf("DecaRangeRTLS:LogFile:");
+
+        if((i == 0) && (k >= 0))
+        {
+            rp.setHeader(first.mid(k) + "\n", 0);
+        }
+
+        if(!readTextLog(table, &rp))
+        {
+            qint64 start = table.dateTime();
+
+            table.close();
+
+            if(readRawCapture(logs.at(i), start, period, &clocks, &rp) <= 0)
+            {
+                err << "reprocess: " << logs.at(i) << " has no range reports\n";
+            }
+        }
+    }
+
+    if(!rp.close())
+    {
+        err << "reprocess: cannot write " << output << " " << rp.errorString() << "\n";
+        return 1;
+    }
+
+    double seconds = qMax(timer.nsecsElapsed() * 1e-9, 1e-9);
+
+    out << QString("%1 range reports of %2 tags processed by %3 threads in %4 s (%5 reports/s)\n")
+           .arg(rp.reports()).arg(rp.tags()).arg(threads).arg(seconds, 0, 'f', 3).arg(rp.reports() / seconds, 0, 'f', 0);
+    out << QString("%1 records written to %2\n").arg(rp.records()).arg(output);
+
+    return 0;
+}
@@ -0,0 +1,435 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: Reprocessor.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "Reprocessor.h"
+
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * Functor processing the reports of one thread, used by QtConcurrent::blockingMap()
+ */
+struct RunShard
+{
+    void operator()(ReprocessShard *shard) const
+    {
+        shard->run();
+    }
+};
+
+ReprocessShard::ReprocessShard(const anc_struct_t *anchors, const RangeCorrections *corrections,
+                               const log_policies_t *policies, const site_processing_t &processing, bool excludeBiased) :
+    _processor(anchors, corrections, policies, &_log),
+    _format(LOG_FORMAT_TEXT),
+    _types(0xffffffff)
+{
+    _log.setCapture(&_records);
+
+    _processor.setWindowSizes(processing.hisLength, FILTER_SIZE, FILTER_SIZE_SHORT);
+    _processor.setR95Interval(processing.r95Interval);
+    _processor.setRangeGateSpeed(processing.rangeGateSpeed);
+    _processor.setExcludeBiased(excludeBiased);
+}
+
+void ReprocessShard::setOutput(int format, quint32 types)
+{
+    _format = format;
+    _types = types;
+}
+
+void ReprocessShard::run()
+{
+    _records.resize(0);
+
+    for(int i=0; i<reports.size(); i++)
+    {
+        reprocess_report_t *rp = &reports[i];
+
+        //the processing runs on the time of the log, its ms are only compared with each other
+        _processor.processReport(rp->time / 1000, rp->time, rp->tag, rp->range, rp->lnum, rp->seq, rp->mask);
+    }
+
+    reports.resize(0);
+
+    //format the records here, so the merge only has to copy them
+    int len = 0;
+
+    times.resize(0);
+    ends.resize(0);
+
+    if(out.size() < RP_BUFFER_SIZE)
+    {
+        out.resize(RP_BUFFER_SIZE);
+    }
+
+    for(int i=0; i<_records.size(); i++)
+    {
+        const log_record_t *r = &_records.at(i);
+
+        if(_types & (1 << r->type))
+        {
+            int need = LOG_MAX_TEXT_LINE + ((r->type == LOG_TEXT) ? r->length : 0);
+
+            while(len + need > out.size())
+            {
+                out.resize(out.size() * 2);
+            }
+
+            char *start = out.data();
+
+            if(_format == LOG_FORMAT_BINARY)
+            {
+                len += log_encode((uchar *) start + len, r);
+            }
+            else
+            {
+                len = log_format_text(start + len, r) - start;
+            }
+
+            times.append(r->time);
+            ends.append(len);
+        }
+
+        if(r->type == LOG_TEXT)
+        {
+            delete[] r->text;
+        }
+    }
+}
+
+Reprocessor::Reprocessor(const anc_struct_t *anchors, const RangeCorrections *corrections,
+                         const log_policies_t *policies, const site_processing_t &processing, int threads) :
+    _anchors(anchors),
+    _types(0xffffffff),
+    _format(LOG_FORMAT_TEXT),
+    _text("DecaRangeRTLS:LogFile:rtlstool reprocess\n"),
+    _utcOffset(0),
+    _first(true),
+    _failed(false),
+    _batch(0),
+    _reports(0),
+    _records(0),
+    _pending(false)
+{
+    threads = qMax(1, threads);
+
+    if(QThreadPool::globalInstance()->maxThreadCount() < threads)
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+
+    for(int i=0; i<threads; i++)
+    {
+        _shards.append(new ReprocessShard(anchors, corrections, policies, processing, threads == 1));
+    }
+
+    memset(&_report, 0, sizeof(_report));
+}
+
+Reprocessor::~Reprocessor()
+{
+    qDeleteAll(_shards);
+}
+
+void Reprocessor::setTypes(quint32 types)
+{
+    _types = types;
+}
+
+bool Reprocessor::open(const QString &filename, int format)
+{
+    _format = format;
+    _file.setFileName(filename);
+
+    if (!_file.open(QFile::WriteOnly | ((format == LOG_FORMAT_TEXT) ? QFile::Text : QFile::NotOpen)))
+    {
+        return false;
+    }
+
+    for(int i=0; i<_shards.size(); i++)
+    {
+        _shards[i]->setOutput(_format, _types);
+    }
+
+    return true;
+}
+
+void Reprocessor::setHeader(const QByteArray &text, int utcOffset)
+{
+    _text = text;
+    _utcOffset = utcOffset;
+}
+
+void Reprocessor::writeHeader(qint64 start)
+{
+    if(_format == LOG_FORMAT_BINARY)
+    {
+        log_header_t h;
+
+        h.version = LOG_VERSION;
+        h.start = start;
+        h.utcOffset = _utcOffset;
+        h.text = _text;
+
+        for(int j=0; j<MAX_NUM_ANCS; j++)
+        {
+            log_anchor_t a;
+
+            a.id = j;
+            a.x = _anchors[j].x;
+            a.y = _anchors[j].y;
+            a.z = _anchors[j].z;
+            h.anchors.append(a);
+        }
+
+        QByteArray data = log_encode_header(&h);
+
+        write(data.constData(), data.size());
+    }
+    else
+    {
+        char line[LOG_MAX_TEXT_LINE];
+
+        write(line, log_format_time(line, start) - line);
+        write(_text.constData(), _text.size());
+    }
+}
+
+bool Reprocessor::close()
+{
+    flushReport();
+    process();
+
+    //a log without reports only has the header
+    if(_first)
+    {
+        _first = false;
+        writeHeader(0);
+    }
+
+    _file.close();
+
+    return !_failed;
+}
+
+QString Reprocessor::errorString() const
+{
+    return _file.errorString();
+}
+
+void Reprocessor::add(const reprocess_report_t &report)
+{
+    //like the application, log the anchor positions with the first report
+    if(_first)
+    {
+        _first = false;
+        writeHeader(report.time);
+
+        for(int j=0; (j<MAX_NUM_ANCS) && (_types & (1 << LOG_AP)); j++)
+        {
+            char line[LOG_MAX_TEXT_LINE];
+            log_record_t r;
+
+            r.type = LOG_AP;
+            r.time = report.time;
+            r.id = 0;
+            r.i[0] = j;
+            r.d[0] = _anchors[j].x;
+            r.d[1] = _anchors[j].y;
+            r.d[2] = _anchors[j].z;
+
+            int n = (_format == LOG_FORMAT_BINARY) ? log_encode((uchar *) line, &r) : (log_format_text(line, &r) - line);
+
+            write(line, n);
+            _records++;
+        }
+    }
+
+    //the tags are shared out in the order they are first seen
+    int shard = _shardOf.value(report.tag, -1);
+
+    if(shard == -1)
+    {
+        shard = _shardOf.size() % _shards.size();
+        _shardOf.insert(report.tag, shard);
+    }
+
+    _shards[shard]->reports.append(report);
+    _reports++;
+
+    if(++_batch >= RP_BATCH_SIZE)
+    {
+        process();
+    }
+}
+
+void Reprocessor::addRecord(const log_record_t &r)
+{
+    if(r.type == LOG_RR)
+    {
+        int k = r.i[0] & 0x3;
+
+        //the RR records of a report are logged one after the other, with the same time and sequence number
+        if(!_pending || (_report.tag != r.id) || (_report.seq != r.i[3]) || (_report.time != r.time) || (_report.mask & (1 << k)))
+        {
+            flushReport();
+
+            memset(&_report, 0, sizeof(_report));
+            _report.time = r.time;
+            _report.tag = r.id;
+            _report.seq = r.i[3];
+            _report.lnum = r.i[4];
+            _pending = true;
+        }
+
+        _report.mask |= (1 << k);
+        _report.range[k] = r.i[1];
+    }
+    else if(r.type == LOG_RM)
+    {
+        //the RM record ends the report, a report without ranges only has the RM record
+        if(_pending && (_report.tag == r.id) && (_report.seq == r.i[1]) && (_report.time == r.time))
+        {
+            flushReport();
+        }
+        else if(r.i[0] == 0)
+        {
+            flushReport();
+
+            memset(&_report, 0, sizeof(_report));
+            _report.time = r.time;
+            _report.tag = r.id;
+            _report.seq = r.i[1];
+            _report.lnum = r.i[2];
+            _pending = true;
+            flushReport();
+        }
+    }
+    else if(r.type == LOG_RC)
+    {
+        flushReport();
+
+        memset(&_report, 0, sizeof(_report));
+        _report.time = r.time;
+        _report.tag = r.id;
+        _report.mask = r.i[0];
+        memcpy(_report.range, &r.i[1], sizeof(_report.range));
+        _report.seq = r.i[9];
+        _report.lnum = r.i[10];
+        _pending = true;
+        flushReport();
+    }
+}
+
+void Reprocessor::flushReport()
+{
+    if(_pending)
+    {
+        _pending = false;
+        add(_report);
+    }
+}
+
+void Reprocessor::process()
+{
+    if(_batch == 0)
+    {
+        return;
+    }
+
+    _batch = 0;
+
+    QtConcurrent::blockingMap(_shards, RunShard());
+
+    //merge the records of the threads by time, the ones with the same time in the order of the threads, and write
+    //each run of records of the same thread in one go
+    int n = _shards.size();
+    QVector<int> next(n, 0);
+
+    for(;;)
+    {
+        int s = -1;
+
+        for(int j=0; j<n; j++)
+        {
+            if((next[j] < _shards[j]->times.size()) && ((s == -1) || (_shards[j]->times[next[j]] < _shards[s]->times[next[s]])))
+            {
+                s = j;
+            }
+        }
+
+        if(s == -1)
+        {
+            break;
+        }
+
+        //the run ends before the next record of a thread before s, or after the next one of a thread after it
+        qint64 before = LLONG_MAX, after = LLONG_MAX;
+
+        for(int j=0; j<n; j++)
+        {
+            if((j != s) && (next[j] < _shards[j]->times.size()))
+            {
+                qint64 t = _shards[j]->times[next[j]];
+
+                if(j < s)
+                {
+                    before = qMin(before, t);
+                }
+                else
+                {
+                    after = qMin(after, t);
+                }
+            }
+        }
+
+        const ReprocessShard *shard = _shards[s];
+        int k = next[s];
+        int begin = (k > 0) ? shard->ends[k - 1] : 0;
+
+        while((k < shard->times.size()) && (shard->times[k] < before) && (shard->times[k] <= after))
+        {
+            k++;
+        }
+
+        write(shard->out.constData() + begin, shard->ends[k - 1] - begin);
+        _records += k - next[s];
+        next[s] = k;
+    }
+}
+
+bool Reprocessor::write(const char *data, qint64 len)
+{
+    if(_file.write(data, len) != len)
+    {
+        _failed = true;
+    }
+
+    return !_failed;
+}
+
+qint64 Reprocessor::reports() const
+{
+    return _reports;
+}
+
+qint64 Reprocessor::records() const
+{
+    return _records;
+}
+
+int Reprocessor::tags() const
+{
+    return _shardOf.size();
+}
@@ -0,0 +1,157 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: Reprocessor.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef REPROCESSOR_H
+#define REPROCESSOR_H
+
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QByteArray>
+
+#include "TagProcessor.h"
+#include "SiteFiles.h"
+
+#define RP_BATCH_SIZE       (65536)     //range reports processed by the threads in one go
+#define RP_BUFFER_SIZE      (1 << 20)   //(bytes) initial size of the formatted records of a thread
+
+/**
+ * One tag range report, as received from the serial port
+ */
+typedef struct
+{
+    qint64 time;                    //(us) local time
+    quint64 tag;
+    int mask;                       //bit k set if range[k] is valid
+    int range[MAX_NUM_ANCS];        //(mm) as reported, without the range correction
+    int seq;
+    int lnum;
+} reprocess_report_t;
+
+/**
+ * The tags of one thread: their range reports are processed by a TagProcessor of its own, which logs into
+ * records (LogWriter::setCapture()), the records are then formatted into out. The anchors its anchor health
+ * finds biased are only left out of the solver if \a excludeBiased (see TagProcessor::setExcludeBiased()).
+ */
+class ReprocessShard
+{
+public:
+    ReprocessShard(const anc_struct_t *anchors, const RangeCorrections *corrections, const log_policies_t *policies,
+                   const site_processing_t &processing, bool excludeBiased);
+
+    /**
+     * Format the records as LOG_FORMAT_TEXT or LOG_FORMAT_BINARY, only the types with their bit set in \a types
+     */
+    void setOutput(int format, quint32 types);
+
+    /**
+     * Process the reports and format the records of the types written, the reports are then cleared
+     */
+    void run();
+
+    QVector<reprocess_report_t> reports;
+    QByteArray out;                 //formatted records
+    QVector<qint64> times;          //(us) of each record in out
+    QVector<int> ends;              //end of each record in out
+
+private:
+    LogWriter _log;
+    TagProcessor _processor;
+    QVector<log_record_t> _records;
+    int _format;
+    quint32 _types;
+};
+
+/**
+ * The Reprocessor class runs the range reports of a log through the processing of the application again
+ * (TagProcessor) and writes the new log.
+ *
+ * The tags are shared out among the threads when their first report is added, each thread processes the
+ * reports of its tags in the order they were added. The reports are processed in batches of RP_BATCH_SIZE:
+ * the threads process their part and format the records, which are then merged by time into the file. With
+ * a single thread the log is the one the application would have written. With several threads each of them
+ * keeps the anchor health of its own tags, so their AH records differ from it, and the biased anchors aren't
+ * left out of the solver: a thread would leave an anchor out at other times than the application or the
+ * other threads, the locations (LE, NL and TS records) would then depend on how the tags are shared out.
+ *
+ * The records of a log can be added as they are read (addRecord()): the RR records of a range report and its
+ * RM record are put together again, an RC record is a report of its own.
+ */
+class Reprocessor
+{
+public:
+    Reprocessor(const anc_struct_t *anchors, const RangeCorrections *corrections, const log_policies_t *policies,
+                const site_processing_t &processing, int threads);
+    ~Reprocessor();
+
+    /**
+     * Set the record types written (bit type set), all of them by default
+     */
+    void setTypes(quint32 types);
+
+    /**
+     * Create \a filename, the header is written with the first report (its time is the start of the log).
+     * @param format LOG_FORMAT_TEXT or LOG_FORMAT_BINARY
+     */
+    bool open(const QString &filename, int format);
+
+    /**
+     * Set the \a text of the log header (the device version and configuration, with the line end) and, for a
+     * binary log, the \a utcOffset (s) of its times, before the first report is added
+     */
+    void setHeader(const QByteArray &text, int utcOffset);
+
+    /**
+     * Process the reports not processed yet and close the file.
+     * @return false if the file couldn't be written
+     */
+    bool close();
+
+    QString errorString() const;
+
+    void add(const reprocess_report_t &report);
+
+    /**
+     * Add the RR, RM and RC records of a log in the order they were logged, the other types are skipped
+     */
+    void addRecord(const log_record_t &r);
+
+    qint64 reports() const;
+    qint64 records() const;
+    int tags() const;
+
+private:
+    void writeHeader(qint64 start);
+    void flushReport();
+    void process();
+    bool write(const char *data, qint64 len);
+
+    const anc_struct_t *_anchors;
+    QVector<ReprocessShard *> _shards;
+    QHash<quint64, int> _shardOf;   //of each tag
+    quint32 _types;
+    int _format;
+
+    QFile _file;
+    QByteArray _text;               //of the header
+    int _utcOffset;
+    bool _first;                    //no report added yet, the header and anchor positions are written before it
+    bool _failed;
+    int _batch;                     //reports added since the last batch was processed
+    qint64 _reports;
+    qint64 _records;
+
+    reprocess_report_t _report;     //report of the RR records read, _pending if it has any
+    bool _pending;
+};
+
+#endif // REPROCESSOR_H
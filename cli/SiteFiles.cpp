@@ -0,0 +1,459 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: SiteFiles.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "SiteFiles.h"
+#include "TagProcessor.h"
+
+#include <QDomDocument>
+#include <QFile>
+#include <QImage>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <QDebug>
+#include <math.h>
+
+bool loadViewConfig(const QString &filename, site_view_t *view)
+{
+    QFile file(filename);
+
+    view->floorplan = "";
+    view->scaleX = view->scaleY = 100;
+    view->offsetX = view->offsetY = 0;
+    view->flipX = true; //set when the floorplan is loaded
+    view->flipY = false;
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QDomDocument doc;
+    doc.setContent(&file, false);
+    file.close();
+
+    QDomElement config = doc.documentElement();
+
+    if( config.tagName() == "config" )
+    {
+        QDomNode n = config.firstChild();
+        while( !n.isNull() )
+        {
+            QDomElement e = n.toElement();
+            if( !e.isNull() && (e.tagName() == "view_cfg") )
+            {
+                view->floorplan = e.attribute( "fplan", "" );
+                view->scaleX = (e.attribute( "scaleX", "100" )).toDouble();
+                view->scaleY = (e.attribute( "scaleY", "100" )).toDouble();
+                view->offsetX = (e.attribute( "offsetX", "0" )).toDouble();
+                view->offsetY = (e.attribute( "offsetY", "0" )).toDouble();
+                view->flipX = (e.attribute( "flipX", "1" )).toInt();
+                view->flipY = (e.attribute( "flipY", "0" )).toInt();
+            }
+
+            n = n.nextSibling();
+        }
+    }
+
+    return true;
+}
+
+QTransform floorplanTransform(const site_view_t &view)
+{
+    QTransform t;
+
+    //NOTE: this needs to match ViewSettings::viewSettingsChanged()
+    if ((view.scaleX != 0) && (view.scaleY != 0))
+    {
+        if (view.flipX)
+        {
+            t.scale(1, -1);
+        }
+        if (view.flipY)
+        {
+            t.scale(-1, 1);
+        }
+
+        t.scale(1. / view.scaleX, 1. / view.scaleY);
+        t.translate(-view.offsetX, -view.offsetY);
+    }
+
+    return t;
+}
+
+QVector<vec3d> sampleWalkableArea(const QImage &image, const QTransform &t, double step, double z, int threshold)
+{
+    QVector<vec3d> points;
+    bool invertible = false;
+    QTransform inv = t.inverted(&invertible);
+
+    if(image.isNull() || !invertible || (step <= 0))
+    {
+        return points;
+    }
+
+    QRectF area = t.mapRect(QRectF(0, 0, image.width(), image.height()));
+
+    for(double y = area.top() + step/2; y < area.bottom(); y += step)
+    {
+        for(double x = area.left() + step/2; x < area.right(); x += step)
+        {
+            QPointF px = inv.map(QPointF(x, y));
+            int i = (int)floor(px.x());
+            int j = (int)floor(px.y());
+
+            if(image.valid(i, j) && (qGray(image.pixel(i, j)) >= threshold))
+            {
+                vec3d p;
+                p.x = x;
+                p.y = y;
+                p.z = z;
+                points.append(p);
+            }
+        }
+    }
+
+    return points;
+}
+
+bool loadPoints(const QString &filename, QVector<vec3d> *points, QStringList *labels)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QTextStream ts(&file);
+
+    while(!ts.atEnd())
+    {
+        QString line = ts.readLine().trimmed();
+
+        if(line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        QStringList f = line.split(QRegExp("[\\s,]+"), QString::SkipEmptyParts);
+        bool okx, oky, okz;
+        vec3d p;
+
+        if(f.size() < 3)
+        {
+            qDebug() << "ignoring point" << line;
+            continue;
+        }
+
+        p.x = f.at(0).toDouble(&okx);
+        p.y = f.at(1).toDouble(&oky);
+        p.z = f.at(2).toDouble(&okz);
+
+        if(!okx || !oky || !okz)
+        {
+            qDebug() << "ignoring point" << line;
+            continue;
+        }
+
+        points->append(p);
+
+        if(labels)
+        {
+            labels->append((f.size() > 3) ? f.at(3) : QString());
+        }
+    }
+
+    file.close();
+
+    return true;
+}
+
+bool loadAnchorConfig(const QString &filename, QVector<site_anchor_t> *anchors)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QDomDocument doc;
+    doc.setContent(&file, false);
+    file.close();
+
+    QDomElement config = doc.documentElement();
+
+    if( config.tagName() == "config" )
+    {
+        QDomNode n = config.firstChild();
+        while( !n.isNull() )
+        {
+            QDomElement e = n.toElement();
+            if( !e.isNull() && (e.tagName() == "anc") )
+            {
+                bool ok;
+                site_anchor_t a;
+
+                a.id = (e.attribute( "ID", "" )).toULongLong(&ok);
+
+                if(ok)
+                {
+                    a.label = e.attribute( "label", "" );
+                    a.x = (e.attribute("x", "0.0")).toDouble();
+                    a.y = (e.attribute("y", "0.0")).toDouble();
+                    a.z = (e.attribute("z", "0.0")).toDouble();
+                    anchors->append(a);
+                }
+            }
+
+            n = n.nextSibling();
+        }
+    }
+
+    return true;
+}
+
+bool saveAnchorConfig(const QString &filename, const QVector<site_anchor_t> &anchors)
+{
+    QFile file( filename );
+
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        qDebug(qPrintable(QString("Error: Cannot write file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QDomDocument doc;
+
+    //same layout as RTLSClient::saveConfigFile() so the file can be loaded by the application
+    QDomElement config = doc.createElement("config");
+    doc.appendChild(config);
+
+    for(int i=0; i<anchors.size(); i++)
+    {
+        QDomElement cn = doc.createElement( "anc" );
+        cn.setAttribute("ID", QString::number(anchors.at(i).id));
+        cn.setAttribute("label", anchors.at(i).label);
+        cn.setAttribute("x", anchors.at(i).x);
+        cn.setAttribute("y", anchors.at(i).y);
+        cn.setAttribute("z", anchors.at(i).z);
+        config.appendChild(cn);
+    }
+
+    QTextStream ts( &file );
+    ts << doc.toString();
+
+    file.close();
+
+    return true;
+}
+
+bool loadRangeCorrections(const QString &filename, RangeCorrections *corrections)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QDomDocument doc;
+    doc.setContent(&file, false);
+    file.close();
+
+    QDomElement config = doc.documentElement();
+
+    if( config.tagName() == "config" )
+    {
+        QDomNode n = config.firstChild();
+        while( !n.isNull() )
+        {
+            QDomElement e = n.toElement();
+            if( !e.isNull() && (e.tagName() == "anc") )
+            {
+                bool ok;
+                int id = (e.attribute( "ID", "" )).toInt(&ok);
+
+                for(int t=0; ok && (t<8); t++)
+                {
+                    if(e.hasAttribute(QString("t%1").arg(t)))
+                    {
+                        corrections->setCorrection(id, t, (e.attribute(QString("t%1").arg(t), "0")).toInt());
+                    }
+                }
+            }
+
+            if( !e.isNull() && (e.tagName() == "corr") )
+            {
+                bool ok, okt;
+                int anc = (e.attribute("anc", "")).toInt(&ok);
+                quint64 tag = (e.attribute("tag", "")).toULongLong(&okt);
+
+                if(ok && okt)
+                {
+                    corrections->setCorrection(anc, tag, (e.attribute("cm", "0")).toInt());
+                    corrections->setScale(anc, tag, (e.attribute("ppm", "0")).toInt());
+                }
+            }
+
+            n = n.nextSibling();
+        }
+    }
+
+    return true;
+}
+
+bool loadProcessingConfig(const QString &filename, site_processing_t *processing, log_policies_t *policies)
+{
+    QFile file(filename);
+
+    processing->hisLength = HIS_LENGTH;
+    processing->r95Interval = R95_INTERVAL;
+    processing->rangeGateSpeed = RANGE_GATE_SPEED;
+    lp_init(policies);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QDomDocument doc;
+    doc.setContent(&file, false);
+    file.close();
+
+    QDomElement config = doc.documentElement();
+
+    if( config.tagName() == "config" )
+    {
+        QDomNode n = config.firstChild();
+        while( !n.isNull() )
+        {
+            QDomElement e = n.toElement();
+            if( !e.isNull() && (e.tagName() == "filter_cfg") )
+            {
+                processing->hisLength = (e.attribute("hisLength", QString::number(HIS_LENGTH))).toInt();
+                processing->r95Interval = qMax(1, (e.attribute("r95Interval", QString::number(R95_INTERVAL))).toInt());
+                processing->rangeGateSpeed = qMax(0.0, (e.attribute("rangeGateSpeed", QString::number(RANGE_GATE_SPEED))).toDouble());
+            }
+
+            if( !e.isNull() && (e.tagName() == "log_cfg") )
+            {
+                policies->combineRanges = ((e.attribute("combineRanges", "0")).toInt() != 0);
+            }
+
+            if( !e.isNull() && (e.tagName() == "log_policy") )
+            {
+                int type = log_type(qPrintable(e.attribute("type", "")));
+
+                if(type > LOG_TEXT)
+                {
+                    policies->type[type].decimate = qBound(1, (e.attribute("decimate", "1")).toInt(), LP_MAX_DECIMATE);
+                    policies->type[type].deadband = qMax(0.0, (e.attribute("deadband", "0")).toDouble());
+                }
+            }
+
+            n = n.nextSibling();
+        }
+    }
+
+    return true;
+}
+
+bool saveRangeCorrections(const QString &filename, const QString &source, const RangeCorrections &corrections)
+{
+    QDomDocument doc;
+    QFile in( source );
+
+    if (in.open(QIODevice::ReadOnly))
+    {
+        doc.setContent(&in, false);
+        in.close();
+    }
+
+    QDomElement config = doc.documentElement();
+
+    if( config.isNull() || (config.tagName() != "config") )
+    {
+        doc = QDomDocument();
+        config = doc.createElement("config");
+        doc.appendChild(config);
+    }
+
+    //drop the old corrections
+    QDomNode n = config.firstChild();
+    while( !n.isNull() )
+    {
+        QDomNode next = n.nextSibling();
+        QDomElement e = n.toElement();
+
+        if( !e.isNull() && (e.tagName() == "corr") )
+        {
+            config.removeChild(n);
+        }
+        else if( !e.isNull() && (e.tagName() == "anc") )
+        {
+            for(int t=0; t<8; t++)
+            {
+                e.removeAttribute(QString("t%1").arg(t));
+            }
+        }
+
+        n = next;
+    }
+
+    //same layout as RTLSClient::saveConfigFile()
+    for(int row=0; row<corrections.rows(); row++)
+    {
+        const QVector<int> &cm = corrections.rowCorrections(row);
+        const QVector<int> &ppm = corrections.rowScales(row);
+
+        for(int anc=0; anc<qMax(cm.size(), ppm.size()); anc++)
+        {
+            int c = (anc < cm.size()) ? cm.at(anc) : 0;
+            int p = (anc < ppm.size()) ? ppm.at(anc) : 0;
+
+            if((c != 0) || (p != 0))
+            {
+                QDomElement corr = doc.createElement( "corr" );
+                corr.setAttribute("anc", anc);
+                corr.setAttribute("tag", QString::number(corrections.rowTag(row)));
+                corr.setAttribute("cm", c);
+                if(p != 0)
+                {
+                    corr.setAttribute("ppm", p);
+                }
+                config.appendChild(corr);
+            }
+        }
+    }
+
+    QFile file( filename );
+
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        qDebug(qPrintable(QString("Error: Cannot write file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    QTextStream ts( &file );
+    ts << doc.toString();
+
+    file.close();
+
+    return true;
+}
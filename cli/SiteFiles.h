@@ -0,0 +1,108 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: SiteFiles.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef SITEFILES_H
+#define SITEFILES_H
+
+#include <QString>
+#include <QVector>
+#include <QTransform>
+
+#include "trilateration.h"
+#include "RangeCorrections.h"
+#include "LogPolicy.h"
+
+class QImage;
+
+/**
+ * Floorplan settings, as saved in the view_cfg element of TREKview_config.xml
+ */
+typedef struct
+{
+    QString floorplan;
+    double scaleX, scaleY;      //pixels per metre
+    double offsetX, offsetY;    //origin (pixels)
+    bool flipX, flipY;
+} site_view_t;
+
+/**
+ * One anchor, as saved in the anc element of TREKanc_config.xml
+ */
+typedef struct
+{
+    quint64 id;
+    QString label;
+    double x, y, z;
+} site_anchor_t;
+
+/**
+ * Load the floorplan settings from a TREKview_config.xml file.
+ * @return false if the file can't be read
+ */
+bool loadViewConfig(const QString &filename, site_view_t *view);
+
+/**
+ * @return the transformation from floorplan pixels to metres, the same as ViewSettings uses to draw the floorplan
+ */
+QTransform floorplanTransform(const site_view_t &view);
+
+/**
+ * Sample the walkable (light coloured) area of the floorplan on a regular grid.
+ * @param image the floorplan image
+ * @param t the pixel to metre transformation
+ * @param step grid spacing (m)
+ * @param z height of the returned points (m)
+ * @param threshold grey level (0-255) at or above which a pixel is considered walkable
+ */
+QVector<vec3d> sampleWalkableArea(const QImage &image, const QTransform &t, double step, double z, int threshold);
+
+/**
+ * Load points from a text file, one "x y z" point per line, optionally followed by a label.
+ * Empty lines and lines starting with # are ignored.
+ */
+bool loadPoints(const QString &filename, QVector<vec3d> *points, QStringList *labels);
+
+/**
+ * Tag processing settings, as saved in the filter_cfg element of TREKanc_config.xml (the ones which change the log)
+ */
+typedef struct
+{
+    int hisLength;              //positions in the tag statistics
+    int r95Interval;            //positions between two updates of the tag statistics
+    double rangeGateSpeed;      //(m/s) 0 if the range gate is off
+} site_processing_t;
+
+/**
+ * Load/save the anchors of a TREKanc_config.xml file.
+ */
+bool loadAnchorConfig(const QString &filename, QVector<site_anchor_t> *anchors);
+bool saveAnchorConfig(const QString &filename, const QVector<site_anchor_t> &anchors);
+
+/**
+ * Load the tag - anchor range corrections of a TREKanc_config.xml file (corr elements and the t0 to t7 attributes
+ * of older files).
+ */
+bool loadRangeCorrections(const QString &filename, RangeCorrections *corrections);
+
+/**
+ * Load the tag processing settings (filter_cfg element) and the log policies (log_cfg and log_policy elements) of a
+ * TREKanc_config.xml file. The settings which aren't in the file are the defaults of the application.
+ */
+bool loadProcessingConfig(const QString &filename, site_processing_t *processing, log_policies_t *policies);
+
+/**
+ * Write \a source (a TREKanc_config.xml file, it may not exist) to \a filename with its range corrections replaced
+ * by \a corrections. Everything else in the file is kept.
+ */
+bool saveRangeCorrections(const QString &filename, const QString &source, const RangeCorrections &corrections);
+
+#endif // SITEFILES_H
@@ -0,0 +1,363 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: SurveyCommand.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+#include "SiteFiles.h"
+#include "RangeLog.h"
+#include "SurveySolver.h"
+#include "AnchorPositioning.h"
+
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SURVEY_LINE_LENGTH  (256)
+
+/* read the tag range reports and the anchor - anchor ranges of one log or raw capture */
+static bool loadSurveyLog(const QString &filename, QVector<survey_epoch_t> *epochs, ap_ranges_t *ancRanges)
+{
+    QFile file(filename);
+    QHash<quint64, int> last;   //last epoch of each tag
+    char line[SURVEY_LINE_LENGTH];
+    range_log_record_t r;
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    while(file.readLine(line, sizeof(line)) > 0)
+    {
+        if(!rl_parse_line(line, &r))
+        {
+            continue;
+        }
+
+        if(r.type == RL_ANCHOR)
+        {
+            for(int k=1; k<RL_NUM_RANGES; k++)
+            {
+                if(r.mask & (1 << k))
+                {
+                    int i, j;
+
+                    rl_anchor_pair(k, &i, &j);
+                    ap_add(ancRanges, i, j, r.corrected[k] * 0.001, INT_MAX); //plain average of all the ranges
+                }
+            }
+            continue;
+        }
+
+        //the RR records of one report are on consecutive lines
+        int idx = last.value(r.id, -1);
+
+        if((idx == -1) || (epochs->at(idx).seq != r.seq) || (epochs->at(idx).mask & r.mask))
+        {
+            survey_epoch_t e;
+
+            memset(&e, 0, sizeof(e));
+            e.tag = r.id;
+            e.seq = r.seq;
+
+            idx = epochs->size();
+            epochs->append(e);
+            last.insert(r.id, idx);
+        }
+
+        survey_epoch_t *e = &(*epochs)[idx];
+
+        for(int k=0; k<RL_NUM_RANGES; k++)
+        {
+            if((r.mask & (1 << k)) && (r.corrected[k] > 0))
+            {
+                e->mask |= (1 << k);
+                e->range[k] = r.corrected[k] * 0.001;
+            }
+        }
+    }
+
+    file.close();
+
+    return true;
+}
+
+/**
+* @brief rtlstool survey: estimate the anchor positions, together with the tag positions, from the ranges
+*        logged while a tag is walked around the site
+*/
+int surveyCommand(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Estimate the anchor positions from the ranges of a survey walk.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "Application logs (RR, RC and RA records) or raw captures of the range reports.", "log...");
+
+    QCommandLineOption anchorsOption("anchors", "Initial anchor positions (TREKanc_config.xml), by default from the anchor - anchor ranges.", "file");
+    QCommandLineOption dimOption("dim", "Solve the anchor positions in 2 or 3 dimensions (default 2).", "n", "2");
+    QCommandLineOption anchorZOption("anchor-z", "Height in m of the anchors without an initial position (default 0).", "m", "0");
+    QCommandLineOption tagZOption("tag-z", "Height in m at which the tag was carried (default 0).", "m", "0");
+    QCommandLineOption outlierOption("outlier", "Range error in m beyond which a range is treated as a reflection (default 0.1).", "m", "0.1");
+    QCommandLineOption iterationsOption("iterations", "Maximum number of iterations (default 50).", "n", "50");
+    QCommandLineOption trajectoryOption("trajectory", "Write the tag positions, one \"tag seq x y z\" per line.", "file");
+    QCommandLineOption outputOption("output", "Anchor file to write (default TREKanc_config.xml).", "file", "TREKanc_config.xml");
+
+    parser.addOption(anchorsOption);
+    parser.addOption(dimOption);
+    parser.addOption(anchorZOption);
+    parser.addOption(tagZOption);
+    parser.addOption(outlierOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(trajectoryOption);
+    parser.addOption(outputOption);
+
+    parser.process(args);
+
+    QStringList logs = parser.positionalArguments();
+    double anchorZ = parser.value(anchorZOption).toDouble();
+    double outlier = parser.value(outlierOption).toDouble();
+
+    if(logs.isEmpty())
+    {
+        err << "survey: no logs\n";
+        return 1;
+    }
+
+    if(outlier <= 0)
+    {
+        err << "survey: invalid --outlier\n";
+        return 1;
+    }
+
+    //ranges
+    QVector<survey_epoch_t> all, epochs;
+    ap_ranges_t ancRanges;
+    bool present[SURVEY_MAX_ANCS];
+
+    ap_init(&ancRanges);
+
+    for(int i=0; i<logs.size(); i++)
+    {
+        if(!loadSurveyLog(logs.at(i), &all, &ancRanges))
+        {
+            err << "survey: cannot read " << logs.at(i) << "\n";
+            return 1;
+        }
+    }
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        present[a] = false;
+
+        for(int j=0; j<SURVEY_MAX_ANCS; j++)
+        {
+            present[a] = present[a] || (ap_range(&ancRanges, a, j) > 0);
+        }
+    }
+
+    for(int i=0; i<all.size(); i++)
+    {
+        if(qPopulationCount((quint32) all.at(i).mask) >= SURVEY_MIN_RANGES)
+        {
+            epochs.append(all.at(i));
+
+            for(int a=0; a<SURVEY_MAX_ANCS; a++)
+            {
+                present[a] = present[a] || (all.at(i).mask & (1 << a));
+            }
+        }
+    }
+
+    out << QString("%1 range reports, %2 with at least %3 ranges\n").arg(all.size()).arg(epochs.size()).arg(SURVEY_MIN_RANGES);
+    all.clear();
+
+    //initial anchor positions
+    SurveySolver solver;
+    QVector<site_anchor_t> anchors;
+    QString labels[SURVEY_MAX_ANCS];
+    bool given[SURVEY_MAX_ANCS];
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        vec3d p;
+
+        p.x = p.y = 0;
+        p.z = anchorZ;
+        solver.setAnchor(a, p, false);
+        labels[a] = QString("A%1").arg(a);
+        given[a] = false;
+    }
+
+    if(parser.isSet(anchorsOption))
+    {
+        if(!loadAnchorConfig(parser.value(anchorsOption), &anchors))
+        {
+            err << "survey: cannot read " << parser.value(anchorsOption) << "\n";
+            return 1;
+        }
+
+        for(int i=0; i<anchors.size(); i++)
+        {
+            const site_anchor_t *s = &anchors.at(i);
+
+            if(s->id < SURVEY_MAX_ANCS)
+            {
+                vec3d p;
+
+                p.x = s->x;
+                p.y = s->y;
+                p.z = s->z;
+                solver.setAnchor(s->id, p, true);
+                labels[s->id] = s->label.isEmpty() ? labels[s->id] : s->label;
+                given[s->id] = true;
+            }
+        }
+    }
+    else
+    {
+        //locate the anchors which have ranges to each other, the same as the auto positioning does
+        int idx[SURVEY_MAX_ANCS];
+        int n = ap_anchors(&ancRanges, SURVEY_MAX_ANCS, idx);
+        double d[SURVEY_MAX_ANCS * SURVEY_MAX_ANCS];
+        double xyz[SURVEY_MAX_ANCS * 3];
+
+        for(int i=0; i<n; i++)
+        {
+            for(int j=0; j<n; j++)
+            {
+                d[i * n + j] = (i == j) ? 0 : ap_range(&ancRanges, idx[i], idx[j]);
+            }
+        }
+
+        if((n >= SURVEY_MIN_RANGES) && ap_locate(d, n, 2, xyz))
+        {
+            for(int i=0; i<n; i++)
+            {
+                vec3d p;
+
+                p.x = xyz[i * 3];
+                p.y = xyz[i * 3 + 1];
+                p.z = anchorZ;
+                solver.setAnchor(idx[i], p, true);
+            }
+        }
+    }
+
+    for(int i=0; i<SURVEY_MAX_ANCS; i++)
+    {
+        for(int j=i+1; j<SURVEY_MAX_ANCS; j++)
+        {
+            const ap_range_t *r = &ancRanges.r[i][j];
+
+            if(r->n > 0)
+            {
+                solver.setAnchorRange(i, j, r->est, r->n);
+            }
+        }
+    }
+
+    solver.setDimension(parser.value(dimOption).toInt());
+    solver.setTagHeight(parser.value(tagZOption).toDouble());
+    solver.setHuberWidth(outlier);
+    solver.setMaxIterations(parser.value(iterationsOption).toInt());
+    solver.setEpochs(epochs);
+    epochs.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(!solver.solve())
+    {
+        err << "survey: " << solver.errorString() << "\n";
+        return 1;
+    }
+
+    out << QString("%1 epochs used, %2 iterations, %3 s, range RMS %4 m\n").arg(solver.usedEpochs()).arg(solver.iterations())
+           .arg(timer.elapsed() * 0.001, 0, 'f', 2).arg(solver.rms(), 0, 'f', 3);
+
+    //the anchors which were given keep their place in the file, even if they had no ranges
+    anchors.clear();
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        if(!present[a] && !given[a])
+        {
+            continue;
+        }
+
+        vec3d p = solver.anchor(a);
+        site_anchor_t s;
+
+        s.id = a;
+        s.label = labels[a];
+        s.x = p.x;
+        s.y = p.y;
+        s.z = p.z;
+        anchors.append(s);
+
+        if(present[a])
+        {
+            out << QString("A%1 %2 (%3, %4, %5) range RMS %6 m\n").arg(a).arg(s.label).arg(s.x, 0, 'f', 3).arg(s.y, 0, 'f', 3)
+                   .arg(s.z, 0, 'f', 3).arg(solver.rms(a), 0, 'f', 3);
+        }
+        else
+        {
+            out << QString("A%1 %2 has no ranges, not moved\n").arg(a).arg(s.label);
+        }
+    }
+
+    if(parser.isSet(trajectoryOption))
+    {
+        QFile file(parser.value(trajectoryOption));
+
+        if (!file.open(QFile::WriteOnly | QFile::Text))
+        {
+            err << "survey: cannot write " << parser.value(trajectoryOption) << "\n";
+            return 1;
+        }
+
+        QTextStream ts(&file);
+        const QVector<survey_epoch_t> &solved = solver.epochs();
+
+        for(int i=0; i<solved.size(); i++)
+        {
+            const survey_epoch_t *e = &solved.at(i);
+
+            if(e->used)
+            {
+                ts << e->tag << " " << e->seq << " " << e->p[0] << " " << e->p[1] << " " << e->p[2] << "\n";
+            }
+        }
+
+        file.close();
+    }
+
+    if(!saveAnchorConfig(parser.value(outputOption), anchors))
+    {
+        return 1;
+    }
+
+    out << "written " << parser.value(outputOption) << "\n";
+
+    return 0;
+}
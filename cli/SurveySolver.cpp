@@ -0,0 +1,1058 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: SurveySolver.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "SurveySolver.h"
+
+#include <QtConcurrent>
+#include <string.h>
+#include <math.h>
+
+#define SURVEY_BLOCK_SIZE   (1024)      //epochs per block
+#define SURVEY_LAMBDA       (1e-3)      //initial damping
+#define SURVEY_MIN_LAMBDA   (1e-12)
+#define SURVEY_MAX_LAMBDA   (1e10)
+#define SURVEY_TOLERANCE    (1e-6)      //relative cost decrease at which the iterations stop
+#define SURVEY_HUBER_TOLERANCE (1e-4)   //the same for the Huber loss, it only has to get close
+#define SURVEY_MIN_STEP     (1e-4)      //(m) the iterations stop when no anchor moves more than this
+#define SURVEY_MIN_DIST     (1e-6)      //(m) ranges from closer than this don't give a direction
+#define SURVEY_MIN_DET      (1e-9)
+#define SURVEY_EPOCH_DIM    (2)         //the tag height is known, x and y of each epoch are solved
+
+/**
+ * Normal equations of one epoch
+ */
+typedef struct
+{
+    double inv[SURVEY_EPOCH_DIM][SURVEY_EPOCH_DIM]; //inverse of the damped epoch block
+    double ge[SURVEY_EPOCH_DIM];                    //epoch gradient
+    double hea[SURVEY_MAX_ANCS][SURVEY_EPOCH_DIM][3]; //epoch - anchor blocks, [a][epoch coordinate][anchor coordinate]
+    double haa[SURVEY_MAX_ANCS][3][3];              //anchor blocks
+    double ga[SURVEY_MAX_ANCS][3];                  //anchor gradient
+    double cost;
+} survey_lin_t;
+
+/**
+ * Functor running one pass over one block, used by QtConcurrent::blockingMap()
+ */
+struct RunPass
+{
+    RunPass(SurveySolver *solver, SurveySolver::Pass pass) : _solver(solver), _pass(pass) {}
+
+    void operator()(survey_block_t &b) const
+    {
+        _solver->run(_pass, &b);
+    }
+
+    SurveySolver *_solver;
+    SurveySolver::Pass _pass;
+};
+
+/* Huber (or Cauchy) weight of residual r, its cost is added to cost */
+static inline double survey_weight(double r, double width, bool cauchy, double *cost)
+{
+    double ar = fabs(r);
+
+    if(cauchy)
+    {
+        double q = (r / width) * (r / width);
+
+        *cost += 0.5 * width * width * log(1 + q);
+        return 1 / (1 + q);
+    }
+
+    if(ar <= width)
+    {
+        *cost += 0.5 * r * r;
+        return 1;
+    }
+
+    *cost += width * (ar - 0.5 * width);
+    return width / ar;
+}
+
+/* invert the symmetric 2 x 2 matrix m in place */
+static bool survey_invert(double m[2][2])
+{
+    double det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+    if(det < SURVEY_MIN_DET)
+    {
+        return false;
+    }
+
+    double a = m[0][0];
+
+    m[0][0] = m[1][1] / det;
+    m[1][1] = a / det;
+    m[0][1] = m[1][0] = -m[0][1] / det;
+
+    return true;
+}
+
+/* solve m x = b (m is n x n, symmetric positive definite) by Cholesky factorisation, m is overwritten */
+static bool survey_cholesky(double m[SURVEY_MAX_PARAMS][SURVEY_MAX_PARAMS], const double *b, int n, double *x)
+{
+    for(int j=0; j<n; j++)
+    {
+        double d = m[j][j];
+
+        for(int k=0; k<j; k++)
+        {
+            d -= m[j][k] * m[j][k];
+        }
+
+        if(d <= 0)
+        {
+            return false;
+        }
+
+        m[j][j] = sqrt(d);
+
+        for(int i=j+1; i<n; i++)
+        {
+            double s = m[i][j];
+
+            for(int k=0; k<j; k++)
+            {
+                s -= m[i][k] * m[j][k];
+            }
+
+            m[i][j] = s / m[j][j];
+        }
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        double s = b[i];
+
+        for(int k=0; k<i; k++)
+        {
+            s -= m[i][k] * x[k];
+        }
+
+        x[i] = s / m[i][i];
+    }
+
+    for(int i=n-1; i>=0; i--)
+    {
+        double s = x[i];
+
+        for(int k=i+1; k<n; k++)
+        {
+            s -= m[k][i] * x[k];
+        }
+
+        x[i] = s / m[i][i];
+    }
+
+    return true;
+}
+
+/* normal equations of epoch e with the anchors at anc, the epoch block is damped by lambda */
+static bool survey_linearise(const survey_epoch_t *e, const double (*anc)[3], double width, bool cauchy, double lambda, survey_lin_t *l)
+{
+    double hee[SURVEY_EPOCH_DIM][SURVEY_EPOCH_DIM];
+
+    memset(hee, 0, sizeof(hee));
+    memset(l->ge, 0, sizeof(l->ge));
+    l->cost = 0;
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        if(!(e->mask & (1 << a)))
+        {
+            continue;
+        }
+
+        double v[3], u[3];
+
+        v[0] = e->p[0] - anc[a][0];
+        v[1] = e->p[1] - anc[a][1];
+        v[2] = e->p[2] - anc[a][2];
+
+        double d = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+        if(d < SURVEY_MIN_DIST)
+        {
+            memset(l->hea[a], 0, sizeof(l->hea[a]));
+            memset(l->haa[a], 0, sizeof(l->haa[a]));
+            memset(l->ga[a], 0, sizeof(l->ga[a]));
+            continue;
+        }
+
+        u[0] = v[0] / d;
+        u[1] = v[1] / d;
+        u[2] = v[2] / d;
+
+        double r = d - e->range[a];
+        double w = survey_weight(r, width, cauchy, &l->cost);
+
+        //the range Jacobian is u for the epoch and -u for the anchor
+        for(int i=0; i<3; i++)
+        {
+            for(int j=0; j<3; j++)
+            {
+                double h = w * u[i] * u[j];
+
+                l->haa[a][i][j] = h;
+
+                if(i < SURVEY_EPOCH_DIM)
+                {
+                    l->hea[a][i][j] = -h;
+
+                    if(j < SURVEY_EPOCH_DIM)
+                    {
+                        hee[i][j] += h;
+                    }
+                }
+            }
+
+            l->ga[a][i] = -w * r * u[i];
+
+            if(i < SURVEY_EPOCH_DIM)
+            {
+                l->ge[i] += w * r * u[i];
+            }
+        }
+    }
+
+    for(int i=0; i<SURVEY_EPOCH_DIM; i++)
+    {
+        hee[i][i] += lambda * hee[i][i] + SURVEY_MIN_DET;
+    }
+
+    if(!survey_invert(hee))
+    {
+        return false;
+    }
+
+    memcpy(l->inv, hee, sizeof(hee));
+
+    return true;
+}
+
+SurveySolver::SurveySolver() :
+    _dim(2),
+    _tagZ(0),
+    _huber(0.1),
+    _maxIterations(50),
+    _numParams(0),
+    _lambda(SURVEY_LAMBDA),
+    _cauchy(false),
+    _iterations(0),
+    _used(0)
+{
+    memset(_anc, 0, sizeof(_anc));
+    memset(_known, 0, sizeof(_known));
+    memset(_ancRange, 0, sizeof(_ancRange));
+    memset(_ancCount, 0, sizeof(_ancCount));
+    memset(_sq, 0, sizeof(_sq));
+    memset(_count, 0, sizeof(_count));
+}
+
+void SurveySolver::setDimension(int dim)
+{
+    _dim = (dim == 3) ? 3 : 2;
+}
+
+void SurveySolver::setTagHeight(double z)
+{
+    _tagZ = z;
+}
+
+void SurveySolver::setHuberWidth(double width)
+{
+    _huber = width;
+}
+
+void SurveySolver::setMaxIterations(int iterations)
+{
+    _maxIterations = iterations;
+}
+
+void SurveySolver::setAnchor(int a, const vec3d &p, bool known)
+{
+    if((a < 0) || (a >= SURVEY_MAX_ANCS))
+    {
+        return;
+    }
+
+    _anc[a][0] = p.x;
+    _anc[a][1] = p.y;
+    _anc[a][2] = p.z;
+    _known[a] = known;
+}
+
+void SurveySolver::setAnchorRange(int i, int j, double range, int count)
+{
+    if((i == j) || (i < 0) || (j < 0) || (i >= SURVEY_MAX_ANCS) || (j >= SURVEY_MAX_ANCS))
+    {
+        return;
+    }
+
+    _ancRange[i][j] = _ancRange[j][i] = range;
+    _ancCount[i][j] = _ancCount[j][i] = count;
+}
+
+void SurveySolver::setEpochs(const QVector<survey_epoch_t> &epochs)
+{
+    _epochs = epochs;
+}
+
+QString SurveySolver::errorString() const
+{
+    return _error;
+}
+
+vec3d SurveySolver::anchor(int a) const
+{
+    vec3d p;
+
+    p.x = _anc[a][0];
+    p.y = _anc[a][1];
+    p.z = _anc[a][2];
+
+    return p;
+}
+
+const QVector<survey_epoch_t> &SurveySolver::epochs() const
+{
+    return _epochs;
+}
+
+double SurveySolver::rms(int a) const
+{
+    double sq = 0;
+    int n = 0;
+
+    for(int k=0; k<SURVEY_MAX_ANCS; k++)
+    {
+        if((a == -1) || (a == k))
+        {
+            sq += _sq[k];
+            n += _count[k];
+        }
+    }
+
+    return (n > 0) ? sqrt(sq / n) : 0;
+}
+
+int SurveySolver::iterations() const
+{
+    return _iterations;
+}
+
+int SurveySolver::usedEpochs() const
+{
+    return _used;
+}
+
+void SurveySolver::run(Pass pass, survey_block_t *b)
+{
+    survey_lin_t l;
+
+    if(pass == Reduce)
+    {
+        memset(b->s, 0, sizeof(b->s));
+        memset(b->b, 0, sizeof(b->b));
+        memset(b->diag, 0, sizeof(b->diag));
+    }
+
+    b->cost = 0;
+    memset(b->sq, 0, sizeof(b->sq));
+    memset(b->count, 0, sizeof(b->count));
+
+    for(int i=b->begin; i<b->end; i++)
+    {
+        survey_epoch_t *e = &_epochs[i];
+
+        if(pass == Place)
+        {
+            //linear least squares from the known anchors, the first one is subtracted from the others
+            double m[2][2], v[2] = {0, 0};
+            double x0 = 0, y0 = 0, h0 = 0;
+            int n = 0;
+
+            memset(m, 0, sizeof(m));
+
+            for(int a=0; a<SURVEY_MAX_ANCS; a++)
+            {
+                if(!(e->mask & (1 << a)) || !_known[a])
+                {
+                    continue;
+                }
+
+                double dz = _tagZ - _anc[a][2];
+                double h = e->range[a] * e->range[a] - dz * dz; //squared horizontal range
+                double x = _anc[a][0], y = _anc[a][1];
+
+                if(h < 0)
+                {
+                    h = 0;
+                }
+
+                if(n++ == 0)
+                {
+                    x0 = x;
+                    y0 = y;
+                    h0 = h;
+                    continue;
+                }
+
+                double rx = 2 * (x - x0);
+                double ry = 2 * (y - y0);
+                double rhs = h0 - h + x * x + y * y - x0 * x0 - y0 * y0;
+
+                m[0][0] += rx * rx;
+                m[0][1] += rx * ry;
+                m[1][1] += ry * ry;
+                v[0] += rx * rhs;
+                v[1] += ry * rhs;
+            }
+
+            m[1][0] = m[0][1];
+            e->used = (n >= SURVEY_MIN_RANGES) && survey_invert(m);
+
+            if(e->used)
+            {
+                e->p[0] = m[0][0] * v[0] + m[0][1] * v[1];
+                e->p[1] = m[1][0] * v[0] + m[1][1] * v[1];
+                e->p[2] = _tagZ;
+            }
+
+            e->dp[0] = e->dp[1] = 0;
+            continue;
+        }
+
+        if(!e->used)
+        {
+            continue;
+        }
+
+        if(pass == Accept)
+        {
+            for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+            {
+                e->p[k] += e->dp[k];
+                e->dp[k] = 0;
+            }
+            continue;
+        }
+
+        if(pass == Cost)
+        {
+            for(int a=0; a<SURVEY_MAX_ANCS; a++)
+            {
+                if(e->mask & (1 << a))
+                {
+                    double dx = e->p[0] + e->dp[0] - _trial[a][0];
+                    double dy = e->p[1] + e->dp[1] - _trial[a][1];
+                    double dz = e->p[2] - _trial[a][2];
+                    double r = sqrt(dx * dx + dy * dy + dz * dz) - e->range[a];
+
+                    survey_weight(r, _huber, _cauchy, &b->cost);
+                    b->sq[a] += r * r;
+                    b->count[a]++;
+                }
+            }
+            continue;
+        }
+
+        if(!survey_linearise(e, _anc, _huber, _cauchy, _lambda, &l))
+        {
+            //the epoch isn't fixed by its ranges, it doesn't move
+            e->dp[0] = e->dp[1] = 0;
+            b->cost += l.cost;
+            continue;
+        }
+
+        if(pass == Step)
+        {
+            //dp = -inv (ge + hea da)
+            double g[SURVEY_EPOCH_DIM];
+
+            for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+            {
+                g[k] = l.ge[k];
+
+                for(int a=0; a<SURVEY_MAX_ANCS; a++)
+                {
+                    if(e->mask & (1 << a))
+                    {
+                        for(int c=0; c<3; c++)
+                        {
+                            int pc = _param[a][c];
+
+                            if(pc >= 0)
+                            {
+                                g[k] += l.hea[a][k][c] * _delta[pc];
+                            }
+                        }
+                    }
+                }
+            }
+
+            for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+            {
+                e->dp[k] = 0;
+
+                for(int j=0; j<SURVEY_EPOCH_DIM; j++)
+                {
+                    e->dp[k] -= l.inv[k][j] * g[j];
+                }
+            }
+            continue;
+        }
+
+        //Reduce: S = Haa - Hae inv Hea, b = -ga + Hae inv ge
+        double t[SURVEY_MAX_ANCS][SURVEY_EPOCH_DIM][3]; //inv hea
+        double ig[SURVEY_EPOCH_DIM];                    //inv ge
+
+        b->cost += l.cost;
+
+        for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+        {
+            ig[k] = 0;
+
+            for(int j=0; j<SURVEY_EPOCH_DIM; j++)
+            {
+                ig[k] += l.inv[k][j] * l.ge[j];
+            }
+        }
+
+        for(int a=0; a<SURVEY_MAX_ANCS; a++)
+        {
+            if(!(e->mask & (1 << a)))
+            {
+                continue;
+            }
+
+            for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+            {
+                for(int c=0; c<3; c++)
+                {
+                    t[a][k][c] = 0;
+
+                    for(int j=0; j<SURVEY_EPOCH_DIM; j++)
+                    {
+                        t[a][k][c] += l.inv[k][j] * l.hea[a][j][c];
+                    }
+                }
+            }
+
+            for(int c=0; c<3; c++)
+            {
+                int pc = _param[a][c];
+
+                if(pc < 0)
+                {
+                    continue;
+                }
+
+                b->b[pc] -= l.ga[a][c];
+                b->diag[pc] += l.haa[a][c][c];
+
+                for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+                {
+                    b->b[pc] += l.hea[a][k][c] * ig[k];
+                }
+
+                for(int c2=0; c2<3; c2++)
+                {
+                    int pc2 = _param[a][c2];
+
+                    if(pc2 >= 0)
+                    {
+                        b->s[pc][pc2] += l.haa[a][c][c2];
+                    }
+                }
+            }
+        }
+
+        for(int a=0; a<SURVEY_MAX_ANCS; a++)
+        {
+            if(!(e->mask & (1 << a)))
+            {
+                continue;
+            }
+
+            for(int a2=0; a2<SURVEY_MAX_ANCS; a2++)
+            {
+                if(!(e->mask & (1 << a2)))
+                {
+                    continue;
+                }
+
+                for(int c=0; c<3; c++)
+                {
+                    int pc = _param[a][c];
+
+                    if(pc < 0)
+                    {
+                        continue;
+                    }
+
+                    for(int c2=0; c2<3; c2++)
+                    {
+                        int pc2 = _param[a2][c2];
+
+                        if(pc2 < 0)
+                        {
+                            continue;
+                        }
+
+                        double s = 0;
+
+                        for(int k=0; k<SURVEY_EPOCH_DIM; k++)
+                        {
+                            s += l.hea[a][k][c] * t[a2][k][c2];
+                        }
+
+                        b->s[pc][pc2] -= s;
+                    }
+                }
+            }
+        }
+    }
+}
+
+double SurveySolver::runPass(Pass pass)
+{
+    double cost = 0;
+
+    QtConcurrent::blockingMap(_blocks, RunPass(this, pass));
+
+    if(pass == Reduce)
+    {
+        memset(_s, 0, sizeof(_s));
+        memset(_b, 0, sizeof(_b));
+        memset(_diag, 0, sizeof(_diag));
+    }
+
+    memset(_sq, 0, sizeof(_sq));
+    memset(_count, 0, sizeof(_count));
+
+    for(int k=0; k<_blocks.size(); k++)
+    {
+        const survey_block_t *b = &_blocks.at(k);
+
+        cost += b->cost;
+
+        for(int a=0; a<SURVEY_MAX_ANCS; a++)
+        {
+            _sq[a] += b->sq[a];
+            _count[a] += b->count[a];
+        }
+
+        if(pass == Reduce)
+        {
+            for(int i=0; i<_numParams; i++)
+            {
+                _b[i] += b->b[i];
+                _diag[i] += b->diag[i];
+
+                for(int j=0; j<_numParams; j++)
+                {
+                    _s[i][j] += b->s[i][j];
+                }
+            }
+        }
+    }
+
+    return cost;
+}
+
+/* cost of the anchor - anchor ranges with the anchors at anc, their normal equations are added if add is set */
+double SurveySolver::anchorRangeCost(const double (*anc)[3], bool add)
+{
+    double cost = 0;
+
+    for(int i=0; i<SURVEY_MAX_ANCS; i++)
+    {
+        for(int j=i+1; j<SURVEY_MAX_ANCS; j++)
+        {
+            if((_ancCount[i][j] == 0) || !_known[i] || !_known[j])
+            {
+                continue;
+            }
+
+            double v[3], u[3];
+            double w = _ancCount[i][j]; //the average of n ranges weighs as much as the n ranges
+
+            v[0] = anc[i][0] - anc[j][0];
+            v[1] = anc[i][1] - anc[j][1];
+            v[2] = anc[i][2] - anc[j][2];
+
+            double d = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+            if(d < SURVEY_MIN_DIST)
+            {
+                continue;
+            }
+
+            double r = d - _ancRange[i][j];
+
+            cost += 0.5 * w * r * r;
+
+            if(!add)
+            {
+                continue;
+            }
+
+            u[0] = v[0] / d;
+            u[1] = v[1] / d;
+            u[2] = v[2] / d;
+
+            //the range Jacobian is u for anchor i and -u for anchor j
+            for(int c=0; c<3; c++)
+            {
+                int pi = _param[i][c];
+                int pj = _param[j][c];
+
+                if(pi >= 0)
+                {
+                    _b[pi] -= w * r * u[c];
+                }
+                if(pj >= 0)
+                {
+                    _b[pj] += w * r * u[c];
+                }
+
+                for(int c2=0; c2<3; c2++)
+                {
+                    int pi2 = _param[i][c2];
+                    int pj2 = _param[j][c2];
+                    double h = w * u[c] * u[c2];
+
+                    if(pi >= 0)
+                    {
+                        if(pi2 >= 0) _s[pi][pi2] += h;
+                        if(pj2 >= 0) _s[pi][pj2] -= h;
+                    }
+                    if(pj >= 0)
+                    {
+                        if(pi2 >= 0) _s[pj][pi2] -= h;
+                        if(pj2 >= 0) _s[pj][pj2] += h;
+                    }
+                }
+
+                if(pi >= 0) _diag[pi] += w * u[c] * u[c];
+                if(pj >= 0) _diag[pj] += w * u[c] * u[c];
+            }
+        }
+    }
+
+    return cost;
+}
+
+/* place anchor a by linear least squares from the ranges of the placed epochs */
+bool SurveySolver::placeAnchor(int a)
+{
+    double m[2][2], v[2] = {0, 0};
+    double x0 = 0, y0 = 0, h0 = 0;
+    int n = 0;
+
+    memset(m, 0, sizeof(m));
+
+    for(int i=0; i<_epochs.size(); i++)
+    {
+        const survey_epoch_t *e = &_epochs.at(i);
+
+        if(!e->used || !(e->mask & (1 << a)))
+        {
+            continue;
+        }
+
+        double dz = e->p[2] - _anc[a][2];
+        double h = e->range[a] * e->range[a] - dz * dz;
+        double x = e->p[0], y = e->p[1];
+
+        if(h < 0)
+        {
+            h = 0;
+        }
+
+        if(n++ == 0)
+        {
+            x0 = x;
+            y0 = y;
+            h0 = h;
+            continue;
+        }
+
+        double rx = 2 * (x - x0);
+        double ry = 2 * (y - y0);
+        double rhs = h0 - h + x * x + y * y - x0 * x0 - y0 * y0;
+
+        m[0][0] += rx * rx;
+        m[0][1] += rx * ry;
+        m[1][1] += ry * ry;
+        v[0] += rx * rhs;
+        v[1] += ry * rhs;
+    }
+
+    m[1][0] = m[0][1];
+
+    if((n < SURVEY_MIN_RANGES) || !survey_invert(m))
+    {
+        return false;
+    }
+
+    _anc[a][0] = m[0][0] * v[0] + m[0][1] * v[1];
+    _anc[a][1] = m[1][0] * v[0] + m[1][1] * v[1];
+
+    return true;
+}
+
+/* move the anchors to the frame with anchor 0 at the origin and anchor 1 on the +x axis, and back with the epochs */
+void SurveySolver::setFrame(bool forward)
+{
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        double x = _anc[a][0], y = _anc[a][1];
+
+        if(forward)
+        {
+            _anc[a][0] = _cos * (x - _origin[0]) + _sin * (y - _origin[1]);
+            _anc[a][1] = -_sin * (x - _origin[0]) + _cos * (y - _origin[1]);
+        }
+        else
+        {
+            _anc[a][0] = _cos * x - _sin * y + _origin[0];
+            _anc[a][1] = _sin * x + _cos * y + _origin[1];
+        }
+    }
+
+    if(forward)
+    {
+        return;
+    }
+
+    for(int i=0; i<_epochs.size(); i++)
+    {
+        survey_epoch_t *e = &_epochs[i];
+        double x = e->p[0], y = e->p[1];
+
+        e->p[0] = _cos * x - _sin * y + _origin[0];
+        e->p[1] = _sin * x + _cos * y + _origin[1];
+    }
+}
+
+bool SurveySolver::solve()
+{
+    bool seen[SURVEY_MAX_ANCS];
+    int known = 0;
+
+    _error.clear();
+    _iterations = 0;
+    _used = 0;
+
+    //anchors with ranges
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        seen[a] = false;
+
+        for(int j=0; j<SURVEY_MAX_ANCS; j++)
+        {
+            seen[a] = seen[a] || (_ancCount[a][j] > 0);
+        }
+    }
+
+    for(int i=0; i<_epochs.size(); i++)
+    {
+        for(int a=0; a<SURVEY_MAX_ANCS; a++)
+        {
+            seen[a] = seen[a] || (_epochs.at(i).mask & (1 << a));
+        }
+    }
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        _known[a] = _known[a] && seen[a];
+        known += _known[a] ? 1 : 0;
+    }
+
+    if(!_known[0] || !_known[1] || (known < SURVEY_MIN_RANGES))
+    {
+        _error = QString("the initial positions of anchor 0, anchor 1 and at least one other anchor are needed");
+        return false;
+    }
+
+    double dx = _anc[1][0] - _anc[0][0];
+    double dy = _anc[1][1] - _anc[0][1];
+    double d = sqrt(dx * dx + dy * dy);
+
+    if(d < SURVEY_MIN_DIST)
+    {
+        _error = QString("anchors 0 and 1 are at the same place");
+        return false;
+    }
+
+    _origin[0] = _anc[0][0];
+    _origin[1] = _anc[0][1];
+    _cos = dx / d;
+    _sin = dy / d;
+
+    setFrame(true);
+
+    //the frame is fixed by anchor 0 (x, y), anchor 1 (y) and, in 3D, the heights of anchors 0-2
+    _numParams = 0;
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        for(int c=0; c<3; c++)
+        {
+            bool free = seen[a] && (((c == 0) && (a >= 1)) || ((c == 1) && (a >= 2)) || ((c == 2) && (_dim == 3) && (a >= 3)));
+
+            _param[a][c] = free ? _numParams++ : -1;
+        }
+    }
+
+    _blocks.clear();
+
+    for(int i=0; i<_epochs.size(); i+=SURVEY_BLOCK_SIZE)
+    {
+        survey_block_t b;
+
+        b.begin = i;
+        b.end = qMin(i + SURVEY_BLOCK_SIZE, _epochs.size());
+        _blocks.append(b);
+    }
+
+    //place the epochs from the known anchors, then the other anchors from the epochs, then all the epochs again
+    runPass(Place);
+
+    bool placed = false;
+
+    for(int a=0; a<SURVEY_MAX_ANCS; a++)
+    {
+        if(seen[a] && !_known[a])
+        {
+            if(!placeAnchor(a))
+            {
+                _error = QString("anchor %1 can't be placed, it needs an initial position").arg(a);
+                setFrame(false);
+                return false;
+            }
+
+            _known[a] = true;
+            placed = true;
+        }
+    }
+
+    if(placed)
+    {
+        runPass(Place);
+    }
+
+    for(int i=0; i<_epochs.size(); i++)
+    {
+        _used += _epochs.at(i).used ? 1 : 0;
+    }
+
+    if(_used == 0)
+    {
+        _error = QString("none of the epochs has ranges to %1 placed anchors").arg(SURVEY_MIN_RANGES);
+        setFrame(false);
+        return false;
+    }
+
+    //Levenberg-Marquardt, first with the Huber loss, then from there with the Cauchy loss which leaves out the
+    //reflected ranges almost completely (but could settle on a wrong solution from a poor start)
+    for(int stage=0; stage<2; stage++)
+    {
+        double tolerance = (stage == 0) ? SURVEY_HUBER_TOLERANCE : SURVEY_TOLERANCE;
+
+        _cauchy = (stage == 1);
+        _lambda = SURVEY_LAMBDA;
+
+        for(int it=0; it<_maxIterations; it++)
+        {
+            double s[SURVEY_MAX_PARAMS][SURVEY_MAX_PARAMS];
+            double cost = runPass(Reduce) + anchorRangeCost(_anc, true);
+
+            memcpy(s, _s, sizeof(s));
+
+            for(int i=0; i<_numParams; i++)
+            {
+                s[i][i] += _lambda * _diag[i] + SURVEY_MIN_DET;
+            }
+
+            memset(_delta, 0, sizeof(_delta));
+
+            if((_numParams > 0) && !survey_cholesky(s, _b, _numParams, _delta))
+            {
+                _lambda *= 10;
+
+                if(_lambda > SURVEY_MAX_LAMBDA)
+                {
+                    break;
+                }
+                continue;
+            }
+
+            memcpy(_trial, _anc, sizeof(_trial));
+
+            for(int a=0; a<SURVEY_MAX_ANCS; a++)
+            {
+                for(int c=0; c<3; c++)
+                {
+                    if(_param[a][c] >= 0)
+                    {
+                        _trial[a][c] += _delta[_param[a][c]];
+                    }
+                }
+            }
+
+            runPass(Step);
+
+            double newCost = runPass(Cost) + anchorRangeCost(_trial, false);
+
+            if(newCost < cost)
+            {
+                runPass(Accept);
+                memcpy(_anc, _trial, sizeof(_anc));
+                _lambda = qMax(_lambda / 10, SURVEY_MIN_LAMBDA);
+                _iterations++;
+
+                double step = 0;
+
+                for(int i=0; i<_numParams; i++)
+                {
+                    step = qMax(step, fabs(_delta[i]));
+                }
+
+                if(((cost - newCost) <= tolerance * cost) || (step < SURVEY_MIN_STEP))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                _lambda *= 10;
+
+                if(_lambda > SURVEY_MAX_LAMBDA)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    //residuals of the solution (the steps are all 0 now)
+    memcpy(_trial, _anc, sizeof(_trial));
+    runPass(Cost);
+
+    setFrame(false);
+
+    return true;
+}
@@ -0,0 +1,155 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: SurveySolver.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef SURVEYSOLVER_H
+#define SURVEYSOLVER_H
+
+#include <QVector>
+#include <QString>
+
+#include "trilateration.h"
+
+#define SURVEY_MAX_ANCS     (4)                     //anchors in a tag range report
+#define SURVEY_MAX_PARAMS   (3 * SURVEY_MAX_ANCS)   //anchor coordinates
+#define SURVEY_MIN_RANGES   (3)                     //ranges needed to place an epoch
+
+/**
+ * One range report of a tag during the survey walk
+ */
+typedef struct
+{
+    quint64 tag;
+    int seq;
+    int mask;                       //bit k is set if there is a range to anchor k
+    double range[SURVEY_MAX_ANCS];  //(m)
+    double p[3];                    //(m) estimated tag position (z is the tag height)
+    double dp[2];                   //(m) step of the current iteration
+    bool used;                      //false if the epoch couldn't be placed
+} survey_epoch_t;
+
+/**
+ * Sums of one block of epochs, each block is handled by one thread
+ */
+typedef struct
+{
+    int begin, end;                                 //epochs of the block
+    double s[SURVEY_MAX_PARAMS][SURVEY_MAX_PARAMS]; //anchor normal matrix with the epochs eliminated (Schur complement)
+    double b[SURVEY_MAX_PARAMS];                    //right hand side of the same
+    double diag[SURVEY_MAX_PARAMS];                 //diagonal of the anchor normal matrix, for the damping
+    double cost;
+    double sq[SURVEY_MAX_ANCS];                     //sum of the squared residuals of each anchor
+    int count[SURVEY_MAX_ANCS];
+} survey_block_t;
+
+/**
+ * The SurveySolver class estimates the anchor positions, and the tag positions, from the ranges of a survey walk.
+ *
+ * All the positions are solved together by Levenberg-Marquardt (bundle adjustment). The tag is carried at a known
+ * height, so each epoch has an x and a y. Each range only involves one epoch and one anchor, so the normal matrix
+ * is an arrow: a 2x2 block per epoch and a dense block for the anchors. The epochs are eliminated block by block
+ * (Schur complement), which leaves a system the size of the anchor coordinates; the epoch steps then follow from
+ * the anchor step, again epoch by epoch. The epochs are processed in blocks in parallel and nothing is allocated
+ * in the iterations. A Huber loss, and then a Cauchy loss, limit the pull of reflected (NLOS) ranges.
+ *
+ * The frame is set by anchor 0, which stays where it was given, and anchor 1, which stays in the direction it was
+ * given in. The anchor heights are taken as given, except in 3D where the heights of the anchors after anchor 2
+ * are solved as well.
+ */
+class SurveySolver
+{
+public:
+    enum Pass {
+        Place,      ///< initial position of the epochs from the anchors
+        Reduce,     ///< normal equations of the epochs, reduced to the anchors
+        Step,       ///< epoch steps from the anchor step
+        Cost,       ///< cost after the step
+        Accept      ///< apply the step
+    };
+
+    SurveySolver();
+
+    void setDimension(int dim);
+    void setTagHeight(double z);
+    void setHuberWidth(double width);
+    void setMaxIterations(int iterations);
+
+    /**
+     * Initial position of anchor \a a, \a known is false if only the height is known.
+     * At least 3 anchors, including anchors 0 and 1, must be known.
+     */
+    void setAnchor(int a, const vec3d &p, bool known);
+
+    /**
+     * Average range \a range (m) between anchors \a i and \a j, from \a count ranges.
+     */
+    void setAnchorRange(int i, int j, double range, int count);
+
+    void setEpochs(const QVector<survey_epoch_t> &epochs);
+
+    bool solve();
+
+    QString errorString() const;
+
+    vec3d anchor(int a) const;
+    const QVector<survey_epoch_t> &epochs() const;
+
+    /**
+     * @return the RMS range residual over all the ranges, or over the ranges of anchor \a a
+     */
+    double rms(int a = -1) const;
+    int iterations() const;
+    int usedEpochs() const;
+
+    /**
+     * Run \a pass over block \a b, used by the parallel passes.
+     */
+    void run(Pass pass, survey_block_t *b);
+
+private:
+    double runPass(Pass pass);
+    bool placeAnchor(int a);
+    double anchorRangeCost(const double (*anc)[3], bool add);
+    void setFrame(bool forward);
+
+    int _dim;
+    double _tagZ;
+    double _huber;
+    int _maxIterations;
+
+    double _anc[SURVEY_MAX_ANCS][3];
+    double _trial[SURVEY_MAX_ANCS][3];                  ///< anchors after the step
+    bool _known[SURVEY_MAX_ANCS];
+    double _ancRange[SURVEY_MAX_ANCS][SURVEY_MAX_ANCS];
+    int _ancCount[SURVEY_MAX_ANCS][SURVEY_MAX_ANCS];
+    int _param[SURVEY_MAX_ANCS][3];                     ///< index of each anchor coordinate in the reduced system, -1 if fixed
+    int _numParams;
+
+    double _s[SURVEY_MAX_PARAMS][SURVEY_MAX_PARAMS];
+    double _b[SURVEY_MAX_PARAMS];
+    double _diag[SURVEY_MAX_PARAMS];
+    double _delta[SURVEY_MAX_PARAMS];
+    double _lambda;
+    bool _cauchy;                                       ///< Cauchy instead of Huber loss
+    double _origin[2];
+    double _cos, _sin;
+
+    QVector<survey_epoch_t> _epochs;
+    QVector<survey_block_t> _blocks;
+
+    double _sq[SURVEY_MAX_ANCS];
+    int _count[SURVEY_MAX_ANCS];
+    int _iterations;
+    int _used;
+    QString _error;
+};
+
+#endif // SURVEYSOLVER_H
@@ -0,0 +1,32 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: commands.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <QStringList>
+
+/**
+ * Entry points of the rtlstool sub-commands.
+ *
+ * Each command receives the command line with the sub-command name removed (args[0] is still the program name),
+ * so it can be passed straight to a QCommandLineParser. The return value is used as the process exit code.
+ */
+int planCommand(const QStringList &args);
+int surveyCommand(const QStringList &args);
+int calibrateCommand(const QStringList &args);
+int convertCommand(const QStringList &args);
+int indexCommand(const QStringList &args);
+int queryCommand(const QStringList &args);
+int reprocessCommand(const QStringList &args);
+
+#endif // COMMANDS_H
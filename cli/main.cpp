@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: main.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "commands.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <stdio.h>
+
+typedef int (*command_fn)(const QStringList &args);
+
+typedef struct
+{
+    const char *name;
+    command_fn fn;
+    const char *help;
+} command_t;
+
+static const command_t commands[] =
+{
+    {"plan", planCommand, "search candidate mounting points for the anchor placement with the lowest GDOP"},
+    {"survey", surveyCommand, "estimate the anchor positions from the ranges of a survey walk"},
+    {"calibrate", calibrateCommand, "fit the tag - anchor range corrections from tags at known positions"},
+    {"convert", convertCommand, "convert a binary application log to the text log"},
+    {"index", indexCommand, "index the records of text application logs"},
+    {"query", queryCommand, "print the records of a type, tag and time range of a text application log"},
+    {"reprocess", reprocessCommand, "process the range reports of logs again with other anchors or settings"},
+};
+
+#define NUM_COMMANDS (int)(sizeof(commands)/sizeof(commands[0]))
+
+static void usage(void)
+{
+    QTextStream err(stderr);
+
+    err << "Usage: rtlstool <command> [options]\n\nCommands:\n";
+
+    for(int i=0; i<NUM_COMMANDS; i++)
+    {
+        err << QString("  %1 %2\n").arg(QString(commands[i].name), -12).arg(QString(commands[i].help));
+    }
+
+    err << "\nUse rtlstool <command> --help for the options of each command.\n";
+}
+
+/**
+* @brief this is the command line tools main entry point
+*
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    app.setOrganizationName("Decawave");
+    app.setOrganizationDomain("decawave.com");
+    app.setApplicationName("rtlstool");
+
+    QStringList args = app.arguments();
+
+    if(args.size() < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    QString name = args.takeAt(1);
+
+    for(int i=0; i<NUM_COMMANDS; i++)
+    {
+        if(name == commands[i].name)
+        {
+            return commands[i].fn(args);
+        }
+    }
+
+    usage();
+    return 1;
+}
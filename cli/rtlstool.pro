@@ -0,0 +1,83 @@
+#-------------------------------------------------
+#
+# Command line tools for site planning and log processing
+#
+#-------------------------------------------------
+
+QT       += core gui xml concurrent
+QT       -= widgets
+
+CONFIG   += console c++11
+
+#gzip of the closed log segments (LogWriter)
+LIBS += -lz
+CONFIG   -= app_bundle
+
+TARGET = rtlstool
+TEMPLATE = app
+
+INCLUDEPATH += .. ../models ../network ../views ../util ../tools
+
+SOURCES += main.cpp \
+    SiteFiles.cpp \
+    AnchorPlanner.cpp \
+    PlanCommand.cpp \
+    RangeLog.cpp \
+    SurveySolver.cpp \
+    SurveyCommand.cpp \
+    CalibrateCommand.cpp \
+    ConvertCommand.cpp \
+    LogTable.cpp \
+    LogIndex.cpp \
+    IndexCommand.cpp \
+    QueryCommand.cpp \
+    Reprocessor.cpp \
+    ReprocessCommand.cpp \
+    ../network/TagProcessor.cpp \
+    ../models/RangeCorrections.cpp \
+    ../models/TagStore.cpp \
+    ../models/PositionStore.cpp \
+    ../models/PositionIndex.cpp \
+    ../models/AnchorHealth.cpp \
+    ../models/DistanceField.cpp \
+    ../util/IdMap.cpp \
+    ../util/LogRecord.cpp \
+    ../util/LogWriter.cpp \
+    ../util/LogPolicy.cpp \
+    ../util/RunningWindow.cpp \
+    ../util/LinkQuality.cpp \
+    ../util/WindowStats.cpp \
+    ../tools/trilateration.cpp \
+    ../tools/gdop.cpp \
+    ../tools/AnchorPositioning.cpp \
+    ../tools/ParticleFilter.cpp \
+    ../tools/KalmanFilter.cpp
+
+HEADERS  += \
+    commands.h \
+    SiteFiles.h \
+    AnchorPlanner.h \
+    RangeLog.h \
+    SurveySolver.h \
+    LogTable.h \
+    LogIndex.h \
+    Reprocessor.h \
+    ../network/TagProcessor.h \
+    ../models/RangeCorrections.h \
+    ../models/TagStore.h \
+    ../models/PositionStore.h \
+    ../models/PositionIndex.h \
+    ../models/AnchorHealth.h \
+    ../models/DistanceField.h \
+    ../util/IdMap.h \
+    ../util/LogRecord.h \
+    ../util/LogWriter.h \
+    ../util/LogPolicy.h \
+    ../util/RunningWindow.h \
+    ../util/LinkQuality.h \
+    ../util/WindowStats.h \
+    ../tools/trilateration.h \
+    ../tools/gdop.h \
+    ../tools/AnchorPositioning.h \
+    ../tools/ParticleFilter.h \
+    ../tools/KalmanFilter.h
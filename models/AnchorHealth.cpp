@@ -0,0 +1,132 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorHealth.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "AnchorHealth.h"
+
+#include <string.h>
+#include <math.h>
+
+void ah_init(anchor_health_t *h, int n)
+{
+    memset(h, 0, sizeof(anchor_health_t));
+    h->n = qBound(0, n, AH_MAX_ANCS);
+}
+
+void ah_count(anchor_health_t *h, int seqs, int mask)
+{
+    for(int a=0; a<h->n; a++)
+    {
+        h->anc[a].expected += seqs;
+
+        if(mask & (1 << a))
+        {
+            h->anc[a].received++;
+        }
+    }
+}
+
+void ah_residual(anchor_health_t *h, int a, double r)
+{
+    h->anc[a].resSum += r;
+    h->anc[a].resSquares += r * r;
+    h->anc[a].resCount++;
+}
+
+bool ah_usable(const anchor_health_t *h, int a)
+{
+    return h->anc[a].state != AH_BIASED;
+}
+
+bool ah_update(anchor_health_t *h, qint64 time)
+{
+    int alive = 0;
+    int worst = -1;
+    double worstSpread = 0;
+    double spread[AH_MAX_ANCS];     //of the anchors with residuals in this period, -1 for the others
+
+    if(h->start == 0)
+    {
+        h->start = time;
+        return false;
+    }
+
+    if((time - h->start) < AH_PERIOD)
+    {
+        return false;
+    }
+
+    h->start = time;
+
+    for(int a=0; a<h->n; a++)
+    {
+        ah_anchor_t *s = &h->anc[a];
+
+        if(s->expected < AH_MIN_SEQS)
+        {
+            s->state = AH_UNKNOWN;
+        }
+        else
+        {
+            s->rate = (100.0 * s->received) / s->expected;
+
+            if(s->rate < AH_DEAD_RATE)
+            {
+                s->state = AH_DEAD;
+            }
+            else
+            {
+                s->state = (s->rate < AH_MIN_RATE) ? AH_INTERMITTENT : AH_OK;
+                alive++;
+            }
+        }
+
+        spread[a] = -1;
+
+        //the anchors without enough residuals (e.g. while one is biased) keep their last bias
+        if(s->resCount >= AH_MIN_RESIDUALS)
+        {
+            s->bias = s->resSum / s->resCount;
+            s->spread = sqrt(qMax(0.0, (s->resSquares / s->resCount) - (s->bias * s->bias)));
+            spread[a] = s->spread;
+
+            if(((s->state == AH_OK) || (s->state == AH_INTERMITTENT)) && (fabs(s->bias) > AH_MAX_BIAS) &&
+               (s->spread < (fabs(s->bias) * AH_MAX_SPREAD)) && ((worst == -1) || (s->spread < worstSpread)))
+            {
+                worst = a;
+                worstSpread = s->spread;
+            }
+        }
+
+        s->expected = 0;
+        s->received = 0;
+        s->resSum = 0;
+        s->resSquares = 0;
+        s->resCount = 0;
+    }
+
+    //the residuals of the other anchors must spread more, or the biased one can't be told from them
+    for(int a=0; (worst != -1) && (a<h->n); a++)
+    {
+        if((a != worst) && (spread[a] >= 0) && (spread[a] < (worstSpread * AH_MIN_CONTRAST)))
+        {
+            worst = -1;
+        }
+    }
+
+    //3 anchors are needed for a location, so one can only be left out if there are 4
+    if((worst != -1) && (alive >= 4))
+    {
+        h->anc[worst].state = AH_BIASED;
+    }
+
+    return true;
+}
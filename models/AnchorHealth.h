@@ -0,0 +1,86 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorHealth.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef ANCHORHEALTH_H
+#define ANCHORHEALTH_H
+
+#include <QtGlobal>
+
+#define AH_MAX_ANCS         (4)
+
+#define AH_UNKNOWN          (0)     //not enough range sequences yet
+#define AH_OK               (1)
+#define AH_INTERMITTENT     (2)     //less than AH_MIN_RATE % of the ranges are received
+#define AH_DEAD             (3)     //(almost) no ranges are received
+#define AH_BIASED           (4)     //the ranges don't agree with the other anchors, not used by the solver
+
+#define AH_PERIOD           (5000)  //(ms) the states are updated this often
+#define AH_MIN_SEQS         (20)    //range sequences needed in a period to rate an anchor
+#define AH_DEAD_RATE        (5.0)   //(%)
+#define AH_MIN_RATE         (50.0)  //(%)
+#define AH_MIN_RESIDUALS    (10)    //residuals needed in a period to check the bias
+#define AH_MAX_BIAS         (0.3)   //(m)
+#define AH_MIN_WEIGHT       (0.01)  //anchors with less of the squared location weights don't get residuals
+#define AH_MAX_SPREAD       (0.5)   //standard deviation of the residuals of a biased anchor, over its bias
+#define AH_MIN_CONTRAST     (2.0)   //standard deviation of the residuals of the other anchors, over that one
+
+typedef struct
+{
+    int state;
+    double rate;            //(%) range sequences with a range from the anchor, in the last period
+    double bias;            //(m) mean residual, in the last period with enough residuals
+    double spread;          //(m) standard deviation of the residuals, in the same period
+
+    int expected;           //range sequences in the current period
+    int received;           //ranges received in the current period
+    double resSum;
+    double resSquares;
+    int resCount;
+} ah_anchor_t;
+
+/**
+ * Health of the anchors, updated every AH_PERIOD from the ranges received and from the residuals of
+ * the locations (the range measured by an anchor, minus the distance from the anchor to the location
+ * solved without it).
+ *
+ * With 4 anchors a range error of one anchor shows in the residuals of all of them, but only the
+ * residuals of that anchor stay the same as the tags move (those of the others scale with the geometry).
+ * So at most one anchor is flagged as biased: of the ones with a mean residual over AH_MAX_BIAS and a
+ * spread under AH_MAX_SPREAD of it, the one with the lowest spread, if the residuals of the others spread
+ * AH_MIN_CONTRAST times more (they don't while the tags stay still) and the other anchors are enough to
+ * solve the locations without it. The biased anchor is then only used to check the locations, so its
+ * residuals keep being measured and it is used again once they are small.
+ *
+ * The structure is saved as it is in the snapshots, see TAG_STATE_LAYOUT.
+ */
+typedef struct
+{
+    ah_anchor_t anc[AH_MAX_ANCS];
+    int n;                  //number of anchors
+    qint64 start;           //(ms) start of the current period, 0 if not started
+} anchor_health_t;
+
+void ah_init(anchor_health_t *h, int n);
+
+/* count a range report with ranges from the anchors in mask, after seqs range sequences */
+void ah_count(anchor_health_t *h, int seqs, int mask);
+
+/* add residual r (m) of anchor a */
+void ah_residual(anchor_health_t *h, int a, double r);
+
+/* false if the ranges of anchor a shouldn't be used to solve the locations */
+bool ah_usable(const anchor_health_t *h, int a);
+
+/* update the states at time (ms) if the period has ended, returns true if it has */
+bool ah_update(anchor_health_t *h, qint64 time);
+
+#endif // ANCHORHEALTH_H
@@ -0,0 +1,390 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: DistanceField.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "DistanceField.h"
+
+#include <QImage>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+#include <QVector>
+#include <QDebug>
+#include <math.h>
+#include <string.h>
+
+#define DF_INF  (1e20)      //squared distance of cells without a site
+#define DF_FAR  (1000.0f)   //distance (m) reported outside the floorplan, or when there are no obstacles
+
+/* One dimensional squared Euclidean distance transform (Felzenszwalb & Huttenlocher).
+ * f holds 0 at the sites and DF_INF elsewhere, d receives the squared distance (in cells) to the nearest site.
+ * v and z are work buffers of n and n + 1 elements.
+ */
+static void edt1d(const double *f, double *d, int *v, double *z, int n)
+{
+    int k = 0;
+
+    v[0] = 0;
+    z[0] = -DF_INF;
+    z[1] = DF_INF;
+
+    for(int q=1; q<n; q++)
+    {
+        double s = ((f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k])) / (2.0*q - 2.0*v[k]);
+
+        while(s <= z[k])
+        {
+            k--;
+            s = ((f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k])) / (2.0*q - 2.0*v[k]);
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = DF_INF;
+    }
+
+    k = 0;
+
+    for(int q=0; q<n; q++)
+    {
+        while(z[k+1] < q)
+        {
+            k++;
+        }
+
+        d[q] = (double)(q - v[k])*(q - v[k]) + f[v[k]];
+    }
+}
+
+/* Exact two dimensional squared distance transform: the squared distance (in cells) from every cell
+ * to the nearest cell where sites[i] == site. Columns are transformed first, then rows.
+ */
+static void edt2d(const uchar *sites, uchar site, float *out, int w, int h)
+{
+    int n = qMax(w, h);
+    QVector<double> f(n), d(n), z(n + 1);
+    QVector<int> v(n);
+
+    for(int x=0; x<w; x++)
+    {
+        for(int y=0; y<h; y++)
+        {
+            f[y] = (sites[y*w + x] == site) ? 0 : DF_INF;
+        }
+
+        edt1d(f.constData(), d.data(), v.data(), z.data(), h);
+
+        for(int y=0; y<h; y++)
+        {
+            out[y*w + x] = d[y];
+        }
+    }
+
+    for(int y=0; y<h; y++)
+    {
+        for(int x=0; x<w; x++)
+        {
+            f[x] = out[y*w + x];
+        }
+
+        edt1d(f.constData(), d.data(), v.data(), z.data(), w);
+
+        for(int x=0; x<w; x++)
+        {
+            out[y*w + x] = d[x];
+        }
+    }
+}
+
+DistanceField::DistanceField() :
+    _header(NULL),
+    _cells(NULL)
+{
+}
+
+DistanceField::~DistanceField()
+{
+    _file.close();
+}
+
+bool DistanceField::load(const QString &filename)
+{
+    _header = NULL;
+    _cells = NULL;
+    _file.close();
+    _file.setFileName(filename);
+
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(_file.errorString())));
+        return false;
+    }
+
+    qint64 size = _file.size();
+    uchar *data = (size >= (qint64)sizeof(df_header_t)) ? _file.map(0, size) : NULL;
+
+    if(data == NULL)
+    {
+        qDebug(qPrintable(QString("Error: Cannot map file %1 %2").arg(filename).arg(_file.errorString())));
+        _file.close();
+        return false;
+    }
+
+    const df_header_t *header = (const df_header_t *) data;
+
+    if((memcmp(header->magic, "DFLD", 4) != 0) || (header->version != DF_VERSION) || (header->cell <= 0) ||
+       (size != (qint64)(sizeof(df_header_t) + (qint64)header->width * header->height * sizeof(df_cell_t))))
+    {
+        qDebug(qPrintable(QString("Error: Invalid distance field %1").arg(filename)));
+        _file.close();
+        return false;
+    }
+
+    _header = header;
+    _cells = (const df_cell_t *) (data + sizeof(df_header_t));
+
+    return true;
+}
+
+bool DistanceField::isValid() const
+{
+    return (_cells != NULL);
+}
+
+const df_cell_t *DistanceField::cellAt(double x, double y) const
+{
+    if(_cells == NULL)
+    {
+        return NULL;
+    }
+
+    double cx = floor((x - _header->originX) / _header->cell);
+    double cy = floor((y - _header->originY) / _header->cell);
+
+    if((cx < 0) || (cy < 0) || (cx >= _header->width) || (cy >= _header->height))
+    {
+        return NULL;
+    }
+
+    return &_cells[(int)cy * _header->width + (int)cx];
+}
+
+float DistanceField::distance(double x, double y) const
+{
+    const df_cell_t *c = cellAt(x, y);
+
+    return c ? c->d : DF_FAR;
+}
+
+bool DistanceField::project(double *x, double *y, double margin) const
+{
+    bool moved = false;
+
+    for(int i=0; i<DF_PROJECT_ITERATIONS; i++)
+    {
+        const df_cell_t *c = cellAt(*x, *y);
+
+        if((c == NULL) || (c->d >= margin) || ((c->gx == 0) && (c->gy == 0)))
+        {
+            break;
+        }
+
+        //the field is sampled, so step a little further than the distance to the edge
+        double step = (margin - c->d) + 0.5 * _header->cell;
+
+        *x += step * c->gx;
+        *y += step * c->gy;
+        moved = true;
+    }
+
+    return moved;
+}
+
+bool DistanceField::crosses(double x0, double y0, double x1, double y1) const
+{
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double length = sqrt(dx*dx + dy*dy);
+    double t = 0;
+
+    if(_cells == NULL)
+    {
+        return false;
+    }
+
+    //sphere tracing: there is no obstacle closer than the distance at the current point, so skip that far ahead
+    while(t < length)
+    {
+        float d = distance(x0 + dx * t / length, y0 + dy * t / length);
+
+        if(d < 0)
+        {
+            return true;
+        }
+
+        t += qMax((double) d, 0.5 * _header->cell);
+    }
+
+    return (distance(x1, y1) < 0);
+}
+
+bool DistanceField::build(const QImage &mask, const QTransform &t, int threshold, const QString &filename)
+{
+    if(mask.isNull())
+    {
+        return false;
+    }
+
+    QImage image = mask.convertToFormat(QImage::Format_RGB32);
+    QRectF area = t.mapRect(QRectF(0, 0, image.width(), image.height()));
+    QPointF p0 = t.map(QPointF(0, 0));
+    QPointF dx = t.map(QPointF(1, 0)) - p0; //one pixel along a row (m)
+    QPointF dy = t.map(QPointF(0, 1)) - p0; //one pixel along a column (m)
+    double cell = qMax(DF_MIN_CELL, qMax(hypot(dx.x(), dx.y()), hypot(dy.x(), dy.y())));
+    int w, h;
+
+    //the cells are at least as large as a pixel, so walls one pixel thick don't fall between cells
+    while((ceil(area.width() / cell) * ceil(area.height() / cell)) > DF_MAX_CELLS)
+    {
+        cell *= 1.25;
+    }
+
+    w = qMax(1, (int)ceil(area.width() / cell));
+    h = qMax(1, (int)ceil(area.height() / cell));
+
+    QVector<uchar> obstacle(w * h, 0);
+
+    for(int j=0; j<image.height(); j++)
+    {
+        const QRgb *line = (const QRgb *) image.constScanLine(j);
+        QPointF p = t.map(QPointF(0.5, j + 0.5));
+
+        for(int i=0; i<image.width(); i++, p += dx)
+        {
+            if(qGray(line[i]) < threshold)
+            {
+                int cx = qBound(0, (int)((p.x() - area.left()) / cell), w - 1);
+                int cy = qBound(0, (int)((p.y() - area.top()) / cell), h - 1);
+
+                obstacle[cy * w + cx] = 1;
+            }
+        }
+    }
+
+    QVector<float> sq(w * h);
+    QVector<df_cell_t> cells(w * h);
+
+    //distance from the free cells to the nearest obstacle...
+    edt2d(obstacle.constData(), 1, sq.data(), w, h);
+    for(int i=0; i<w*h; i++)
+    {
+        cells[i].d = obstacle[i] ? 0 : qMin(DF_FAR, (float)((sqrt(sq[i]) - 0.5) * cell));
+    }
+
+    //...and from the obstacle cells to the nearest free cell
+    edt2d(obstacle.constData(), 0, sq.data(), w, h);
+    for(int i=0; i<w*h; i++)
+    {
+        if(obstacle[i])
+        {
+            cells[i].d = -qMin(DF_FAR, (float)((sqrt(sq[i]) - 0.5) * cell));
+        }
+    }
+
+    //gradient (central differences, one sided at the edges)
+    for(int y=0; y<h; y++)
+    {
+        for(int x=0; x<w; x++)
+        {
+            int x0 = qMax(x - 1, 0), x1 = qMin(x + 1, w - 1);
+            int y0 = qMax(y - 1, 0), y1 = qMin(y + 1, h - 1);
+            double gx = (x1 > x0) ? (cells[y*w + x1].d - cells[y*w + x0].d) / (x1 - x0) : 0;
+            double gy = (y1 > y0) ? (cells[y1*w + x].d - cells[y0*w + x].d) / (y1 - y0) : 0;
+            double norm = sqrt(gx*gx + gy*gy);
+            df_cell_t *c = &cells[y*w + x];
+
+            if(norm > 1e-6)
+            {
+                c->gx = gx / norm;
+                c->gy = gy / norm;
+            }
+            else
+            {
+                c->gx = c->gy = 0;
+            }
+        }
+    }
+
+    df_header_t header;
+
+    memcpy(header.magic, "DFLD", 4);
+    header.version = DF_VERSION;
+    header.width = w;
+    header.height = h;
+    header.originX = area.left();
+    header.originY = area.top();
+    header.cell = cell;
+
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot write file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    file.write((const char *) &header, sizeof(header));
+    file.write((const char *) cells.constData(), cells.size() * sizeof(df_cell_t));
+
+    return file.commit();
+}
+
+QString DistanceField::prepare(const QString &path, const QTransform &t, int threshold)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(path).arg(file.errorString())));
+        return QString();
+    }
+
+    //the cache file name is the hash of the image, the floorplan settings and the field version
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    double m[9] = {t.m11(), t.m12(), t.m13(), t.m21(), t.m22(), t.m23(), t.m31(), t.m32(), t.m33()};
+    qint32 k[2] = {threshold, DF_VERSION};
+
+    hash.addData(&file);
+    hash.addData((const char *) m, sizeof(m));
+    hash.addData((const char *) k, sizeof(k));
+    file.close();
+
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString filename = dir + "/floorplan_" + QString(hash.result().toHex()) + ".sdf";
+
+    if(QFile::exists(filename))
+    {
+        return filename;
+    }
+
+    QDir().mkpath(dir);
+
+    if(!build(QImage(path), t, threshold, filename))
+    {
+        return QString();
+    }
+
+    qDebug() << "distance field saved to" << filename;
+
+    return filename;
+}
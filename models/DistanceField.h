@@ -0,0 +1,105 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: DistanceField.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <QFile>
+#include <QString>
+#include <QTransform>
+
+class QImage;
+
+#define DF_VERSION              (1)
+#define DF_MIN_CELL             (0.05)  //smallest grid cell (m)
+#define DF_MAX_CELLS            (2048 * 2048)
+#define DF_WALKABLE_THRESHOLD   (128)   //grey level (0-255) at or above which a pixel is walkable
+#define DF_MARGIN               (0.15)  //distance (m) positions are kept away from obstacles
+#define DF_PROJECT_ITERATIONS   (3)
+
+typedef struct
+{
+    char magic[4];          //"DFLD"
+    quint32 version;
+    quint32 width;          //cells
+    quint32 height;
+    double originX;         //position of the corner of cell (0, 0) (m)
+    double originY;
+    double cell;            //cell size (m)
+} df_header_t;
+
+typedef struct
+{
+    float d;                //signed distance to the nearest obstacle edge (m), negative inside obstacles
+    float gx, gy;           //unit gradient of d, i.e. the direction away from the nearest obstacle
+} df_cell_t;
+
+/**
+ * The DistanceField class is a signed distance field of the walkable area of the floorplan.
+ *
+ * The field is built from a mask image (the floorplan itself or a separate image with the same pixel layout), where
+ * dark pixels are obstacles (walls, racking...). It is sampled on a regular grid in metres, and saved to a cache file
+ * which is memory mapped, so loading it again for the same image and floorplan settings is immediate.
+ *
+ * Lookups are O(1): a position is mapped to its grid cell, which holds the distance and the gradient.
+ */
+class DistanceField
+{
+public:
+    DistanceField();
+    ~DistanceField();
+
+    /**
+     * Memory map a cache file written by build().
+     * @return false if the file can't be mapped or is not a valid distance field
+     */
+    bool load(const QString &filename);
+
+    bool isValid() const;
+
+    /**
+     * @return the signed distance (m) from (x, y) to the nearest obstacle, or a large value outside the floorplan
+     */
+    float distance(double x, double y) const;
+
+    /**
+     * Move (x, y) along the gradient until it is at least \a margin (m) away from any obstacle.
+     * @return true if the position was moved
+     */
+    bool project(double *x, double *y, double margin) const;
+
+    /**
+     * @return true if the segment from (x0, y0) to (x1, y1) goes through an obstacle
+     */
+    bool crosses(double x0, double y0, double x1, double y1) const;
+
+    /**
+     * Build the distance field of \a mask, which is mapped to metres with \a t, and save it to \a filename.
+     */
+    static bool build(const QImage &mask, const QTransform &t, int threshold, const QString &filename);
+
+    /**
+     * Find (or build) the cache file of the distance field for the mask image \a path, mapped to metres with \a t.
+     * This is slow if the cache file doesn't exist, so it is meant to be run on a background thread.
+     * @return the cache file name or an empty string if the mask image can't be loaded
+     */
+    static QString prepare(const QString &path, const QTransform &t, int threshold);
+
+private:
+    const df_cell_t *cellAt(double x, double y) const;
+
+    QFile _file;
+    const df_header_t *_header;
+    const df_cell_t *_cells;
+};
+
+#endif // DISTANCEFIELD_H
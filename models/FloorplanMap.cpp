@@ -0,0 +1,120 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: FloorplanMap.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "FloorplanMap.h"
+
+#include "RTLSDisplayApplication.h"
+#include "ViewSettings.h"
+
+#include <QtConcurrent>
+#include <QDebug>
+
+#define FLOORPLAN_MAP_DELAY (500) //ms to wait for the floorplan settings to settle before building the field
+
+FloorplanMap::FloorplanMap(QObject *parent) :
+    QObject(parent)
+{
+    _timer.setSingleShot(true);
+    _timer.setInterval(FLOORPLAN_MAP_DELAY);
+
+    QObject::connect(&_timer, SIGNAL(timeout()), this, SLOT(update()));
+    QObject::connect(&_watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+
+    RTLSDisplayApplication::connectReady(this, "onReady()");
+}
+
+void FloorplanMap::onReady()
+{
+    QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(floorplanChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(mapConstraintChanged(bool)), this, SLOT(settingsChanged()));
+    QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(maskChanged()), this, SLOT(settingsChanged()));
+}
+
+QSharedPointer<DistanceField> FloorplanMap::distanceField() const
+{
+    return _field;
+}
+
+bool FloorplanMap::currentSettings(QString *path, QTransform *t, QString *key) const
+{
+    ViewSettings *vs = RTLSDisplayApplication::viewSettings();
+
+    *path = vs->getMaskPath().isEmpty() ? vs->getFloorplanPath() : vs->getMaskPath();
+    *t = vs->floorplanTransform();
+
+    if(!vs->mapConstraint() || !vs->getFloorplanShow() || vs->floorplanPixmap().isNull() || path->isEmpty())
+    {
+        return false;
+    }
+
+    *key = QString("%1:%2:%3:%4:%5:%6:%7").arg(*path).arg(t->m11()).arg(t->m12()).arg(t->m21()).arg(t->m22()).arg(t->dx()).arg(t->dy());
+
+    return true;
+}
+
+void FloorplanMap::settingsChanged()
+{
+    _timer.start();
+}
+
+void FloorplanMap::update()
+{
+    QString path, key;
+    QTransform t;
+
+    if(!currentSettings(&path, &t, &key))
+    {
+        _key.clear();
+
+        if(_field)
+        {
+            _field.clear();
+            emit distanceFieldChanged(_field);
+        }
+        return;
+    }
+
+    //a running build calls update() again when it finishes
+    if((key == _key) || _watcher.isRunning())
+    {
+        return;
+    }
+
+    _buildKey = key;
+    _watcher.setFuture(QtConcurrent::run(DistanceField::prepare, path, t, (int) DF_WALKABLE_THRESHOLD));
+}
+
+void FloorplanMap::buildFinished()
+{
+    QString filename = _watcher.result();
+    QString path, key;
+    QTransform t;
+
+    //only use the field if the settings haven't changed while it was built
+    if(currentSettings(&path, &t, &key) && (key == _buildKey))
+    {
+        QSharedPointer<DistanceField> field(new DistanceField());
+
+        if(filename.isEmpty() || !field->load(filename))
+        {
+            field.clear(); //don't keep using the field of the old settings
+        }
+
+        _key = _buildKey;
+        _field = field;
+        emit distanceFieldChanged(_field);
+    }
+
+    _buildKey.clear();
+
+    update();
+}
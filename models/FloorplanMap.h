@@ -0,0 +1,59 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: FloorplanMap.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef FLOORPLANMAP_H
+#define FLOORPLANMAP_H
+
+#include <QObject>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+
+#include "DistanceField.h"
+
+/**
+ * The FloorplanMap class keeps the distance field of the floorplan up to date.
+ *
+ * When map constraints are enabled in the ViewSettings, the distance field of the mask image (or of the floorplan if
+ * there is no mask) is built on a background thread whenever the floorplan or its settings change.
+ * distanceFieldChanged() is emitted with the new field, or with a null pointer when constraints are disabled.
+ */
+class FloorplanMap : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FloorplanMap(QObject *parent = 0);
+
+    QSharedPointer<DistanceField> distanceField() const;
+
+signals:
+    void distanceFieldChanged(QSharedPointer<DistanceField> field);
+
+protected slots:
+    void onReady();
+
+private slots:
+    void settingsChanged();
+    void update();
+    void buildFinished();
+
+private:
+    bool currentSettings(QString *path, QTransform *t, QString *key) const;
+
+    QSharedPointer<DistanceField> _field;
+    QFutureWatcher<QString> _watcher;
+    QTimer _timer;
+    QString _key;       //mask and settings of the current field
+    QString _buildKey;  //mask and settings of the field being built
+};
+
+#endif // FLOORPLANMAP_H
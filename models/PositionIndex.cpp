@@ -0,0 +1,157 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: PositionIndex.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "PositionIndex.h"
+
+#include <math.h>
+#include <limits.h>
+
+/* grid cell of coordinate v (m) */
+static int pi_cell(double v)
+{
+    return (int) qBound(-2147483647.0, floor(v / PI_CELL_SIZE), 2147483647.0);
+}
+
+static quint64 pi_key(int cx, int cy)
+{
+    return ((quint64) (quint32) cx << 32) | (quint32) cy;
+}
+
+/* time bucket of time (ms) */
+static qint64 pi_bucket(qint64 time)
+{
+    return (time >= 0) ? (time / PI_BUCKET) : -((-time + PI_BUCKET - 1) / PI_BUCKET);
+}
+
+PositionIndex::PositionIndex() :
+    _cells(0)
+{
+}
+
+void PositionIndex::clear()
+{
+    _buckets.clear();
+    _lastCell.clear();
+    _lastBucket.clear();
+    _cells = 0;
+}
+
+void PositionIndex::add(int tag, qint64 time, double x, double y)
+{
+    quint64 key = pi_key(pi_cell(x), pi_cell(y));
+    qint64 b = pi_bucket(time);
+
+    if(tag >= _lastCell.size())
+    {
+        int n = _lastCell.size();
+
+        _lastCell.resize(tag + 1);
+        _lastBucket.resize(tag + 1);
+
+        for(int i=n; i<=tag; i++)
+        {
+            _lastBucket[i] = LLONG_MIN;
+        }
+    }
+
+    if((_lastCell.at(tag) == key) && (_lastBucket.at(tag) == b))
+    {
+        return;
+    }
+
+    _lastCell[tag] = key;
+    _lastBucket[tag] = b;
+
+    Bucket &bucket = _buckets[b];
+    Bucket::iterator it = bucket.find(key);
+
+    if(it == bucket.end())
+    {
+        it = bucket.insert(key, QBitArray(tag + 1));
+        _cells++;
+    }
+    else if(it.value().size() <= tag)
+    {
+        it.value().resize(tag + 1);
+    }
+
+    it.value().setBit(tag);
+}
+
+void PositionIndex::remove(qint64 before)
+{
+    qint64 b = pi_bucket(before);
+
+    //a bucket ends before the start of bucket b
+    while(!_buckets.isEmpty() && (_buckets.firstKey() < b))
+    {
+        _cells -= _buckets.first().size();
+        _buckets.erase(_buckets.begin());
+    }
+}
+
+QBitArray PositionIndex::find(const QRectF &area, qint64 from, qint64 to) const
+{
+    QBitArray tags;
+    QRectF r = area.normalized();
+    int cx0 = pi_cell(r.left()), cx1 = pi_cell(r.right());
+    int cy0 = pi_cell(r.top()), cy1 = pi_cell(r.bottom());
+    qint64 area_cells = (qint64) (cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+
+    for(QMap<qint64, Bucket>::const_iterator it = _buckets.lowerBound(pi_bucket(from));
+        (it != _buckets.constEnd()) && (it.key() <= pi_bucket(to)); ++it)
+    {
+        const Bucket &bucket = it.value();
+
+        //look up the cells of the area, or go through the cells of the bucket if it has fewer of them
+        if(area_cells <= bucket.size())
+        {
+            for(int cx=cx0; cx<=cx1; cx++)
+            {
+                for(int cy=cy0; cy<=cy1; cy++)
+                {
+                    Bucket::const_iterator c = bucket.find(pi_key(cx, cy));
+
+                    if(c != bucket.constEnd())
+                    {
+                        tags |= c.value();
+                    }
+                }
+            }
+        }
+        else
+        {
+            for(Bucket::const_iterator c = bucket.constBegin(); c != bucket.constEnd(); ++c)
+            {
+                int cx = (int) (qint32) (c.key() >> 32);
+                int cy = (int) (qint32) (c.key() & 0xffffffff);
+
+                if((cx >= cx0) && (cx <= cx1) && (cy >= cy0) && (cy <= cy1))
+                {
+                    tags |= c.value();
+                }
+            }
+        }
+    }
+
+    return tags;
+}
+
+int PositionIndex::buckets() const
+{
+    return _buckets.size();
+}
+
+qint64 PositionIndex::cells() const
+{
+    return _cells;
+}
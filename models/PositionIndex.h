@@ -0,0 +1,68 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: PositionIndex.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QBitArray>
+#include <QRectF>
+
+#define PI_CELL_SIZE        (2.0)           //(m) side of the grid cells
+#define PI_BUCKET           (60000)         //(ms) length of the time buckets
+
+/**
+ * The PositionIndex class is a spatio-temporal index of the tag positions: for every time bucket, the grid cells
+ * (x, y) the tags were in, each with a bitmap of the tags (their index, e.g. in the PositionStore).
+ *
+ * A region and time range is answered by OR-ing the bitmaps of the cells it overlaps in the buckets it overlaps,
+ * without looking at the positions. The result is a superset of the tags which were in the region: a tag
+ * may have been in a cell, but not in the part of the cell in the region, or in the bucket but not in the time
+ * range.
+ */
+class PositionIndex
+{
+public:
+    PositionIndex();
+
+    void clear();
+
+    /**
+     * Add the position (\a x, \a y) of tag \a tag at \a time (ms)
+     */
+    void add(int tag, qint64 time, double x, double y);
+
+    /**
+     * Remove the buckets which end before \a before (ms)
+     */
+    void remove(qint64 before);
+
+    /**
+     * @return the tags (bit set) which may have been in \a area from \a from to \a to (ms, included)
+     */
+    QBitArray find(const QRectF &area, qint64 from, qint64 to) const;
+
+    int buckets() const;
+    qint64 cells() const;           //cells of all the buckets
+
+private:
+    typedef QHash<quint64, QBitArray> Bucket;   //bitmap of each cell
+
+    QMap<qint64, Bucket> _buckets;  //by start time / PI_BUCKET
+    QVector<quint64> _lastCell;     //of each tag, to skip the lookup while it stays in the same cell
+    QVector<qint64> _lastBucket;
+    qint64 _cells;
+};
+
+#endif // POSITIONINDEX_H
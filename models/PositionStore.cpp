@@ -0,0 +1,835 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: PositionStore.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "PositionStore.h"
+
+#include <string.h>
+#include <math.h>
+
+static const qint64 ps_period[PS_LEVELS] = {1000, 60000, 3600000};     //(ms) of each rollup level
+static const int ps_keep[PS_LEVELS] = {1, 7 * 24, 90 * 24};            //(h) time the rollups are kept
+
+/*
+ * Bit streams of the columns, written and read most significant bit first
+ */
+
+typedef struct
+{
+    QByteArray *out;
+    quint64 acc;
+    int bits;                       //in acc, less than 8 between two calls
+} ps_writer_t;
+
+typedef struct
+{
+    const uchar *p, *end;
+    quint64 acc;
+    int bits;
+} ps_reader_t;
+
+/* append the n (up to 32) low bits of v */
+static void ps_put(ps_writer_t *w, quint64 v, int n)
+{
+    w->acc = (w->acc << n) | (v & ((1ULL << n) - 1));
+    w->bits += n;
+
+    while(w->bits >= 8)
+    {
+        w->bits -= 8;
+        w->out->append((char) (w->acc >> w->bits));
+    }
+}
+
+/* write the bits left in the last byte */
+static void ps_flush(ps_writer_t *w)
+{
+    if(w->bits > 0)
+    {
+        ps_put(w, 0, 8 - w->bits);
+    }
+}
+
+static quint32 ps_get(ps_reader_t *r, int n)
+{
+    while(r->bits < n)
+    {
+        r->acc = (r->acc << 8) | ((r->p < r->end) ? *r->p++ : 0);
+        r->bits += 8;
+    }
+
+    r->bits -= n;
+
+    return (quint32) ((r->acc >> r->bits) & ((1ULL << n) - 1));
+}
+
+/* a signed value in as few bits as its size needs: '0' for 0, '10' and 7 bits, '110' and 12 bits, '1110' and 20 bits
+   or '1111' and 64 bits, of the value with its sign in the lowest bit */
+static void ps_put_value(ps_writer_t *w, qint64 v)
+{
+    quint64 u = ((quint64) v << 1) ^ (quint64) (v >> 63);
+
+    if(u == 0)
+    {
+        ps_put(w, 0x0, 1);
+    }
+    else if(u < (1 << 7))
+    {
+        ps_put(w, 0x2, 2);
+        ps_put(w, u, 7);
+    }
+    else if(u < (1 << 12))
+    {
+        ps_put(w, 0x6, 3);
+        ps_put(w, u, 12);
+    }
+    else if(u < (1 << 20))
+    {
+        ps_put(w, 0xe, 4);
+        ps_put(w, u, 20);
+    }
+    else
+    {
+        ps_put(w, 0xf, 4);
+        ps_put(w, u >> 32, 32);
+        ps_put(w, u, 32);
+    }
+}
+
+static qint64 ps_get_value(ps_reader_t *r)
+{
+    quint64 u;
+
+    if(!ps_get(r, 1))
+    {
+        return 0;
+    }
+
+    if(!ps_get(r, 1))
+    {
+        u = ps_get(r, 7);
+    }
+    else if(!ps_get(r, 1))
+    {
+        u = ps_get(r, 12);
+    }
+    else if(!ps_get(r, 1))
+    {
+        u = ps_get(r, 20);
+    }
+    else
+    {
+        u = (quint64) ps_get(r, 32) << 32;
+        u |= ps_get(r, 32);
+    }
+
+    return (qint64) (u >> 1) ^ -((qint64) (u & 1));
+}
+
+/* value k of column c of a fix: the time (ms), the coordinates (mm) or the quality */
+static qint64 ps_column(const position_fix_t *f, int c)
+{
+    switch(c)
+    {
+    case 0:
+        return f->time;
+    case 1:
+        return qRound64(f->x * 1000);
+    case 2:
+        return qRound64(f->y * 1000);
+    case 3:
+        return qRound64(f->z * 1000);
+    default:
+        return f->quality;
+    }
+}
+
+void ps_decode(const position_chunk_t *c, position_fix_t *fixes)
+{
+    for(int col=0; col<PS_COLUMNS; col++)
+    {
+        ps_reader_t r;
+        qint64 v = 0, delta = 0;
+
+        r.p = c->data + c->offset[col];
+        r.end = c->data + c->offset[col + 1];
+        r.acc = 0;
+        r.bits = 0;
+
+        for(int i=0; i<c->count; i++)
+        {
+            position_fix_t *f = &fixes[i];
+
+            if(col == PS_COLUMNS - 1)
+            {
+                //the quality is only stored when it changes
+                if((i == 0) || ps_get(&r, 1))
+                {
+                    v = ps_get(&r, 8);
+                }
+
+                f->quality = (int) v;
+                continue;
+            }
+
+            delta += ps_get_value(&r);
+            v += delta;
+
+            switch(col)
+            {
+            case 0:
+                f->time = v;
+                break;
+            case 1:
+                f->x = v * 0.001;
+                break;
+            case 2:
+                f->y = v * 0.001;
+                break;
+            default:
+                f->z = v * 0.001;
+                break;
+            }
+        }
+    }
+}
+
+PositionStore::PositionStore() :
+    _fixes(0),
+    _memory(0),
+    _spilled(0),
+    _retention(PS_RETENTION),
+    _maxMemory(PS_MAX_MEMORY),
+    _used(0)
+{
+}
+
+PositionStore::~PositionStore()
+{
+    clear();
+}
+
+void PositionStore::clear()
+{
+    for(int i=0; i<_series.size(); i++)
+    {
+        qDeleteAll(_series.at(i)->chunks);
+        delete _series.at(i);
+    }
+
+    _series.clear();
+    _index.clear();
+    _grid.clear();
+    _fixes = 0;
+    _memory = 0;
+    _spilled = 0;
+
+    //the spill file is only used by the chunks which were just removed
+    for(int i=0; i<_segments.size(); i++)
+    {
+        _spill.unmap(_segments.at(i));
+    }
+
+    _segments.clear();
+    _used = 0;
+
+    if(_spill.isOpen())
+    {
+        _spill.close();
+        _spill.remove();
+    }
+}
+
+void PositionStore::setLimits(int hours, int memory, const QString &spill)
+{
+    _retention = qMax(1, hours);
+    _maxMemory = qMax(1, memory);
+
+    //the file is created when the first chunk is spilled, the one in use is kept until clear()
+    if(!_spill.isOpen())
+    {
+        _spill.setFileName(spill);
+    }
+}
+
+int PositionStore::retention() const
+{
+    return _retention;
+}
+
+int PositionStore::maxMemory() const
+{
+    return _maxMemory;
+}
+
+void PositionStore::append(quint64 id, qint64 time, double x, double y, double z, int quality)
+{
+    int idx = _index.value(id);
+    double step = 0;
+
+    if(idx == -1)
+    {
+        position_series_t *s = new position_series_t;
+
+        s->id = id;
+        s->resident = 0;
+        s->count = 0;
+        s->start = time;
+
+        idx = _series.size();
+        _series.append(s);
+        _index.insert(id, idx);
+    }
+    else
+    {
+        const position_fix_t *p = &_series.at(idx)->previous;
+
+        time = qMax(time, p->time);
+        step = sqrt((x - p->x) * (x - p->x) + (y - p->y) * (y - p->y) + (z - p->z) * (z - p->z));
+    }
+
+    position_series_t *s = _series.at(idx);
+    position_fix_t *f = &s->open[s->count];
+
+    f->time = time;
+    f->x = x;
+    f->y = y;
+    f->z = z;
+    f->quality = qBound(0, quality, 255);
+
+    s->previous = *f;
+    s->count++;
+    _fixes++;
+
+    _grid.add(idx, time, x, y);
+
+    //the fix is added to the last period of each level, or starts a new one
+    for(int level=0; level<PS_LEVELS; level++)
+    {
+        QVector<position_rollup_t> &v = s->rollups[level];
+        qint64 start = time - time % ps_period[level];
+
+        if(v.isEmpty() || (v.last().time != start))
+        {
+            position_rollup_t r;
+
+            r.time = start;
+            r.count = 0;
+            r.x = r.y = r.z = 0;
+            r.left = r.right = x;
+            r.top = r.bottom = y;
+            r.distance = 0;
+            v.append(r);
+        }
+
+        position_rollup_t *r = &v.last();
+
+        r->count++;
+        r->x += (x - r->x) / r->count;
+        r->y += (y - r->y) / r->count;
+        r->z += (z - r->z) / r->count;
+        r->left = qMin(r->left, (float) x);
+        r->right = qMax(r->right, (float) x);
+        r->top = qMin(r->top, (float) y);
+        r->bottom = qMax(r->bottom, (float) y);
+        r->distance += step;
+    }
+
+    if(s->count == PS_CHUNK_FIXES)
+    {
+        seal(s);
+
+        //the chunks of the tags which are no longer seen expire as well
+        for(int i=0; i<_series.size(); i++)
+        {
+            remove(_series.at(i), time - _retention * 3600000LL);
+            removeRollups(_series.at(i), time);
+        }
+
+        _grid.remove(time - _retention * 3600000LL);
+    }
+}
+
+/* compress the open fixes of s into a chunk */
+void PositionStore::seal(position_series_t *s)
+{
+    position_chunk_t *c = new position_chunk_t;
+    ps_writer_t w;
+
+    c->first = s->open[0].time;
+    c->last = s->open[s->count - 1].time;
+    c->count = s->count;
+
+    //the box of the coordinates as they are decoded
+    qint64 left = ps_column(&s->open[0], 1), right = left;
+    qint64 top = ps_column(&s->open[0], 2), bottom = top;
+
+    for(int i=1; i<s->count; i++)
+    {
+        left = qMin(left, ps_column(&s->open[i], 1));
+        right = qMax(right, ps_column(&s->open[i], 1));
+        top = qMin(top, ps_column(&s->open[i], 2));
+        bottom = qMax(bottom, ps_column(&s->open[i], 2));
+    }
+
+    c->left = left * 0.001;
+    c->right = right * 0.001;
+    c->top = top * 0.001;
+    c->bottom = bottom * 0.001;
+
+    w.out = &c->buffer;
+
+    for(int col=0; col<PS_COLUMNS; col++)
+    {
+        qint64 prev = 0, delta = 0;
+
+        c->offset[col] = c->buffer.size();
+        w.acc = 0;
+        w.bits = 0;
+
+        for(int i=0; i<s->count; i++)
+        {
+            qint64 v = ps_column(&s->open[i], col);
+
+            if(col == PS_COLUMNS - 1)
+            {
+                if(i > 0)
+                {
+                    ps_put(&w, (v != prev) ? 1 : 0, 1);
+                }
+
+                if((i == 0) || (v != prev))
+                {
+                    ps_put(&w, v, 8);
+                }
+
+                prev = v;
+                continue;
+            }
+
+            ps_put_value(&w, (v - prev) - delta);
+            delta = v - prev;
+            prev = v;
+        }
+
+        ps_flush(&w);
+    }
+
+    c->offset[PS_COLUMNS] = c->buffer.size();
+    c->buffer.squeeze();
+    c->data = (const uchar *) c->buffer.constData();
+
+    s->chunks.append(c);
+    s->count = 0;
+    _memory += c->buffer.size();
+
+    //the oldest chunks of the tag are spilled first
+    while((_memory > _maxMemory * 1048576LL) && (s->resident < s->chunks.size()) && !_spill.fileName().isEmpty())
+    {
+        position_chunk_t *old = s->chunks.at(s->resident);
+
+        if(!old->buffer.isEmpty())
+        {
+            spill(old);
+
+            if(!old->buffer.isEmpty())
+            {
+                break; //the spill file can't be written
+            }
+        }
+
+        s->resident++;
+    }
+}
+
+/* move the data of chunk c to the spill file */
+void PositionStore::spill(position_chunk_t *c)
+{
+    int size = c->buffer.size();
+
+    if(!_spill.isOpen() && !_spill.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        return;
+    }
+
+    if(_segments.isEmpty() || (_used + size > PS_SPILL_SEGMENT))
+    {
+        qint64 offset = (qint64) _segments.size() * PS_SPILL_SEGMENT;
+        uchar *segment = _spill.resize(offset + PS_SPILL_SEGMENT) ? _spill.map(offset, PS_SPILL_SEGMENT) : NULL;
+
+        if(!segment)
+        {
+            return;
+        }
+
+        _segments.append(segment);
+        _used = 0;
+    }
+
+    uchar *p = _segments.last() + _used;
+
+    memcpy(p, c->buffer.constData(), size);
+    c->data = p;
+    c->buffer = QByteArray();
+
+    _used += size;
+    _memory -= size;
+    _spilled += size;
+}
+
+/* remove the chunks of s which end before time before (the space of the spilled ones isn't used again) */
+void PositionStore::remove(position_series_t *s, qint64 before)
+{
+    while(!s->chunks.isEmpty() && (s->chunks.first()->last < before))
+    {
+        position_chunk_t *c = s->chunks.first();
+
+        if(c->buffer.isEmpty())
+        {
+            _spilled -= c->offset[PS_COLUMNS];
+        }
+        else
+        {
+            _memory -= c->buffer.size();
+        }
+
+        _fixes -= c->count;
+        s->resident = qMax(0, s->resident - 1);
+        s->chunks.remove(0);
+        delete c;
+    }
+}
+
+/* remove the rollups of s older than the time they are kept at now, several at once as they are removed from the
+   start of the vectors */
+void PositionStore::removeRollups(position_series_t *s, qint64 now)
+{
+    for(int level=0; level<PS_LEVELS; level++)
+    {
+        QVector<position_rollup_t> &v = s->rollups[level];
+        qint64 before = now - ps_keep[level] * 3600000LL;
+        int n = 0;
+
+        while((n < v.size()) && (v.at(n).time + ps_period[level] <= before))
+        {
+            n++;
+        }
+
+        if((n > 0) && ((n >= v.size() / 8) || (n == v.size())))
+        {
+            v.remove(0, n);
+        }
+    }
+}
+
+/* index of the first chunk of s which ends at or after from */
+int PositionStore::firstChunk(const position_series_t *s, qint64 from) const
+{
+    int lo = 0, hi = s->chunks.size();
+
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if(s->chunks.at(mid)->last < from)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+int PositionStore::query(quint64 id, qint64 from, qint64 to, QVector<position_fix_t> *fixes) const
+{
+    int idx = _index.value(id);
+    int n = fixes->size();
+
+    if(idx == -1)
+    {
+        return 0;
+    }
+
+    const position_series_t *s = _series.at(idx);
+    QVector<position_fix_t> decoded(PS_CHUNK_FIXES);
+
+    for(int k=firstChunk(s, from); (k<s->chunks.size()) && (s->chunks.at(k)->first <= to); k++)
+    {
+        const position_chunk_t *c = s->chunks.at(k);
+
+        ps_decode(c, decoded.data());
+
+        for(int i=0; i<c->count; i++)
+        {
+            if((decoded.at(i).time >= from) && (decoded.at(i).time <= to))
+            {
+                fixes->append(decoded.at(i));
+            }
+        }
+    }
+
+    for(int i=0; i<s->count; i++)
+    {
+        if((s->open[i].time >= from) && (s->open[i].time <= to))
+        {
+            fixes->append(s->open[i]);
+        }
+    }
+
+    return fixes->size() - n;
+}
+
+bool PositionStore::last(quint64 id, position_fix_t *fix) const
+{
+    int idx = _index.value(id);
+
+    if(idx == -1)
+    {
+        return false;
+    }
+
+    const position_series_t *s = _series.at(idx);
+
+    if(s->count > 0)
+    {
+        *fix = s->open[s->count - 1];
+        return true;
+    }
+
+    if(s->chunks.isEmpty())
+    {
+        return false;
+    }
+
+    QVector<position_fix_t> decoded(PS_CHUNK_FIXES);
+
+    ps_decode(s->chunks.last(), decoded.data());
+    *fix = decoded.at(s->chunks.last()->count - 1);
+
+    return true;
+}
+
+int PositionStore::find(const QRectF &area, qint64 from, qint64 to, QVector<quint64> *tags) const
+{
+    QBitArray candidates = _grid.find(area, from, to);
+    QRectF r = area.normalized();
+    int n = tags->size();
+
+    //the index only gives the tags which were in the cells of the area, their fixes tell if they were in it
+    for(int i=0; i<candidates.size(); i++)
+    {
+        if(candidates.testBit(i) && visited(_series.at(i), r, from, to))
+        {
+            tags->append(_series.at(i)->id);
+        }
+    }
+
+    return tags->size() - n;
+}
+
+/* true if a fix of s from from to to is in area, the chunks out of the area aren't decoded */
+bool PositionStore::visited(const position_series_t *s, const QRectF &area, qint64 from, qint64 to) const
+{
+    QVector<position_fix_t> decoded;
+
+    for(int k=firstChunk(s, from); (k<s->chunks.size()) && (s->chunks.at(k)->first <= to); k++)
+    {
+        const position_chunk_t *c = s->chunks.at(k);
+
+        if((c->right < area.left()) || (c->left > area.right()) || (c->bottom < area.top()) || (c->top > area.bottom()))
+        {
+            continue;
+        }
+
+        decoded.resize(PS_CHUNK_FIXES);
+        ps_decode(c, decoded.data());
+
+        for(int i=0; i<c->count; i++)
+        {
+            const position_fix_t *f = &decoded.at(i);
+
+            if((f->time >= from) && (f->time <= to) && area.contains(f->x, f->y))
+            {
+                return true;
+            }
+        }
+    }
+
+    for(int i=0; i<s->count; i++)
+    {
+        const position_fix_t *f = &s->open[i];
+
+        if((f->time >= from) && (f->time <= to) && area.contains(f->x, f->y))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int PositionStore::rollups(quint64 id, int level, qint64 from, qint64 to, QVector<position_rollup_t> *periods) const
+{
+    int idx = _index.value(id);
+    int n = periods->size();
+
+    if((idx == -1) || (level < 0) || (level >= PS_LEVELS))
+    {
+        return 0;
+    }
+
+    const QVector<position_rollup_t> &v = _series.at(idx)->rollups[level];
+
+    //first period which ends after from
+    int lo = 0, hi = v.size();
+
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if(v.at(mid).time + ps_period[level] <= from)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for(int k=lo; (k<v.size()) && (v.at(k).time <= to); k++)
+    {
+        periods->append(v.at(k));
+    }
+
+    return periods->size() - n;
+}
+
+/* true if level (PS_RAW for the fixes) still has the first fixes of s from from */
+bool PositionStore::covers(const position_series_t *s, int level, qint64 from) const
+{
+    from = qMax(from, s->start);
+
+    if(level == PS_RAW)
+    {
+        if(!s->chunks.isEmpty())
+        {
+            return s->chunks.first()->first <= from;
+        }
+
+        return (s->count > 0) && (s->open[0].time <= from);
+    }
+
+    return !s->rollups[level].isEmpty() && (s->rollups[level].first().time <= from);
+}
+
+int PositionStore::pathLevel(quint64 id, qint64 from, qint64 to, double tolerance) const
+{
+    int idx = _index.value(id);
+
+    if(idx == -1)
+    {
+        return PS_RAW;
+    }
+
+    const position_series_t *s = _series.at(idx);
+    QVector<position_rollup_t> periods;
+
+    for(int level=PS_LEVELS-1; level>=0; level--)
+    {
+        if(!covers(s, level, from))
+        {
+            continue;
+        }
+
+        bool detailed = true;
+
+        periods.resize(0);
+        rollups(id, level, from, to, &periods);
+
+        for(int k=0; (k<periods.size()) && detailed; k++)
+        {
+            const position_rollup_t *r = &periods.at(k);
+
+            detailed = ((r->right - r->left) <= tolerance) && ((r->bottom - r->top) <= tolerance);
+        }
+
+        if(detailed)
+        {
+            return level;
+        }
+    }
+
+    if(covers(s, PS_RAW, from))
+    {
+        return PS_RAW;
+    }
+
+    //the fixes have expired, the finest level left
+    for(int level=0; level<PS_LEVELS; level++)
+    {
+        if(covers(s, level, from))
+        {
+            return level;
+        }
+    }
+
+    return PS_LEVELS - 1;
+}
+
+double PositionStore::distance(quint64 id, qint64 from, qint64 to) const
+{
+    QVector<position_rollup_t> periods;
+    double d = 0;
+
+    rollups(id, 1, from, to, &periods);
+
+    for(int k=0; k<periods.size(); k++)
+    {
+        d += periods.at(k).distance;
+    }
+
+    return d;
+}
+
+qint64 PositionStore::levelPeriod(int level)
+{
+    return ((level >= 0) && (level < PS_LEVELS)) ? ps_period[level] : 0;
+}
+
+int PositionStore::tagCount() const
+{
+    return _series.size();
+}
+
+quint64 PositionStore::tagId(int idx) const
+{
+    return _series.at(idx)->id;
+}
+
+qint64 PositionStore::fixes() const
+{
+    return _fixes;
+}
+
+qint64 PositionStore::memory() const
+{
+    return _memory;
+}
+
+qint64 PositionStore::spilled() const
+{
+    return _spilled;
+}
@@ -0,0 +1,195 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: PositionStore.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef POSITIONSTORE_H
+#define POSITIONSTORE_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QFile>
+#include <QRectF>
+
+#include "IdMap.h"
+#include "PositionIndex.h"
+
+#define PS_CHUNK_FIXES      (1024)          //fixes of a chunk, the last chunk of a tag is open (not compressed yet)
+#define PS_COLUMNS          (5)             //time, x, y, z, quality
+#define PS_RETENTION        (24)            //(h) default time the fixes are kept
+#define PS_MAX_MEMORY       (1024)          //(MB) default size of the compressed chunks kept in memory
+#define PS_SPILL_SEGMENT    (64 << 20)      //(bytes) the spill file is mapped in segments of this size
+#define PS_LEVELS           (3)             //rollups of 1 s, 1 min and 1 h
+#define PS_RAW              (-1)            //level of the fixes themselves
+
+/**
+ * One position of a tag
+ */
+typedef struct
+{
+    qint64 time;                    //(ms) since 1970-01-01 UTC
+    double x, y, z;                 //(m) kept to the mm
+    int quality;                    //0-255, the number of ranges of the last range report in the application
+} position_fix_t;
+
+/**
+ * Fixes of a tag compressed into columns
+ */
+typedef struct
+{
+    qint64 first, last;             //(ms) time of the first and last fix
+    int count;
+    double left, top, right, bottom;    //(m) bounding box of the fixes
+    int offset[PS_COLUMNS + 1];     //of each column in data, and the end
+    const uchar *data;              //buffer, or the spill file once spilled
+    QByteArray buffer;
+} position_chunk_t;
+
+/**
+ * Fixes of a tag during one period of a rollup level
+ */
+typedef struct
+{
+    qint64 time;                    //(ms) start of the period
+    int count;                      //fixes
+    double x, y, z;                 //(m) mean position
+    float left, top, right, bottom; //(m) extent
+    double distance;                //(m) travelled, from the fix before the period to the last one in it
+} position_rollup_t;
+
+/**
+ * Position history of a tag
+ */
+typedef struct
+{
+    quint64 id;
+    QVector<position_chunk_t *> chunks; //compressed, in time order
+    int resident;                   //chunks before this one have been spilled
+    position_fix_t open[PS_CHUNK_FIXES];
+    int count;                      //fixes in open
+    qint64 start;                   //(ms) time of the first fix
+    position_fix_t previous;        //last fix
+    QVector<position_rollup_t> rollups[PS_LEVELS];  //of the periods with fixes, in time order
+} position_series_t;
+
+/**
+ * The PositionStore class keeps the position history of the tags as a time series per tag.
+ *
+ * The fixes of a tag are appended to its open chunk, which is compressed when it is full: each column (time,
+ * x, y, z, quality) is stored on its own, the time in ms and the coordinates in mm as the difference of the
+ * difference from one fix to the next in a few bits (0 bits for a tag which moves steadily, about 5 bytes a
+ * fix for a walking tag), the quality only when it changes. The chunks of a tag are in time order, so a
+ * time range only decodes the chunks it overlaps.
+ *
+ * The chunks older than the retention time are removed. When the compressed chunks take up more than the
+ * memory limit, the oldest ones are moved to a spill file which is mapped into memory, so the system can page
+ * them out. The positions are also added to a PositionIndex, which finds the tags which were in an area during a
+ * time range.
+ *
+ * Each fix also updates the rollups of its tag at three levels, of 1 s, 1 min and 1 h periods: the mean
+ * position, the extent, the number of fixes and the distance travelled in each period. A long time range can
+ * be drawn from the rollups of the level which is detailed enough (pathLevel()) instead of the fixes. The 1 s
+ * rollups are kept for 1 hour, the 1 min ones for 7 days and the 1 h ones for 90 days, whatever the retention
+ * time of the fixes. All the functions must be called from the same thread.
+ */
+class PositionStore
+{
+public:
+    PositionStore();
+    ~PositionStore();
+
+    void clear();
+
+    /**
+     * Keep the fixes of the last \a hours, and up to \a memory (MB) of compressed chunks in memory, the older ones
+     * are moved to \a spill (a file which is created, empty for none)
+     */
+    void setLimits(int hours, int memory, const QString &spill);
+    int retention() const;
+    int maxMemory() const;
+
+    /**
+     * Add a fix of tag \a id, the fixes of a tag must be added in time order (an earlier time is taken as the
+     * time of the fix before)
+     */
+    void append(quint64 id, qint64 time, double x, double y, double z, int quality);
+
+    /**
+     * Append the fixes of tag \a id from \a from to \a to (ms, included) to \a fixes, in time order.
+     * @return the number of fixes appended
+     */
+    int query(quint64 id, qint64 from, qint64 to, QVector<position_fix_t> *fixes) const;
+
+    /**
+     * @return false if there is no fix of tag \a id, the last fix in \a fix otherwise
+     */
+    bool last(quint64 id, position_fix_t *fix) const;
+
+    /**
+     * Append the IDs of the tags which were in \a area (x, y in m) from \a from to \a to (ms, included) to \a tags.
+     * @return the number of tags appended
+     */
+    int find(const QRectF &area, qint64 from, qint64 to, QVector<quint64> *tags) const;
+
+    /**
+     * Append the rollups of tag \a id at \a level (0 to PS_LEVELS - 1) which overlap \a from to \a to (ms,
+     * included) to \a periods, in time order.
+     * @return the number of rollups appended
+     */
+    int rollups(quint64 id, int level, qint64 from, qint64 to, QVector<position_rollup_t> *periods) const;
+
+    /**
+     * @return the coarsest level (PS_RAW for the fixes) with the fixes of tag \a id from \a from to \a to (ms)
+     * in which the extent of every period is at most \a tolerance (m), e.g. the size of a pixel on the screen
+     */
+    int pathLevel(quint64 id, qint64 from, qint64 to, double tolerance) const;
+
+    /**
+     * @return the distance (m) travelled by tag \a id from \a from to \a to (ms), to the nearest 1 min period
+     */
+    double distance(quint64 id, qint64 from, qint64 to) const;
+
+    static qint64 levelPeriod(int level);   //(ms)
+
+    int tagCount() const;
+    quint64 tagId(int idx) const;
+
+    qint64 fixes() const;           //fixes kept
+    qint64 memory() const;          //(bytes) of the compressed chunks in memory
+    qint64 spilled() const;         //(bytes) of the chunks in the spill file
+
+private:
+    void seal(position_series_t *s);
+    void spill(position_chunk_t *c);
+    void remove(position_series_t *s, qint64 before);
+    void removeRollups(position_series_t *s, qint64 now);
+    bool covers(const position_series_t *s, int level, qint64 from) const;
+    int firstChunk(const position_series_t *s, qint64 from) const;
+    bool visited(const position_series_t *s, const QRectF &area, qint64 from, qint64 to) const;
+
+    QVector<position_series_t *> _series;
+    IdMap _index;                   //tag ID to index in _series
+    PositionIndex _grid;            //positions of the tags by their index in _series
+
+    qint64 _fixes;
+    qint64 _memory;
+    qint64 _spilled;
+    int _retention;                 //(h)
+    int _maxMemory;                 //(MB)
+
+    QFile _spill;
+    QVector<uchar *> _segments;     //mapped parts of the spill file
+    int _used;                      //bytes used in the last segment
+};
+
+/* decode the count fixes of chunk c into fixes */
+void ps_decode(const position_chunk_t *c, position_fix_t *fixes);
+
+#endif // POSITIONSTORE_H
@@ -0,0 +1,130 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RangeCorrections.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "RangeCorrections.h"
+
+RangeCorrections::RangeCorrections()
+{
+}
+
+void RangeCorrections::clear()
+{
+    _index.clear();
+    _tagIds.clear();
+    _cm.clear();
+    _ppm.clear();
+}
+
+int RangeCorrections::correction(int anc, quint64 tagId) const
+{
+    int row = _index.value(tagId);
+
+    if((row == -1) || (anc < 0) || (anc >= _cm.at(row).size()))
+    {
+        return 0;
+    }
+
+    return _cm.at(row).at(anc);
+}
+
+int RangeCorrections::scale(int anc, quint64 tagId) const
+{
+    int row = _index.value(tagId);
+
+    if((row == -1) || (anc < 0) || (anc >= _ppm.at(row).size()))
+    {
+        return 0;
+    }
+
+    return _ppm.at(row).at(anc);
+}
+
+int RangeCorrections::apply(int anc, quint64 tagId, int range) const
+{
+    int row = _index.value(tagId);
+
+    if((row == -1) || (anc < 0))
+    {
+        return range;
+    }
+
+    int cm = (anc < _cm.at(row).size()) ? _cm.at(row).at(anc) : 0;
+    int ppm = (anc < _ppm.at(row).size()) ? _ppm.at(row).at(anc) : 0;
+
+    return range + cm * 10 + (int)(((qint64) range * ppm) / 1000000);
+}
+
+void RangeCorrections::setCorrection(int anc, quint64 tagId, int cm)
+{
+    set(_cm, anc, tagId, cm);
+}
+
+void RangeCorrections::setScale(int anc, quint64 tagId, int ppm)
+{
+    set(_ppm, anc, tagId, ppm);
+}
+
+void RangeCorrections::set(QVector<QVector<int> > &values, int anc, quint64 tagId, int value)
+{
+    int row = _index.value(tagId);
+
+    if(anc < 0)
+    {
+        return;
+    }
+
+    if(row == -1)
+    {
+        if(value == 0) //nothing to store
+        {
+            return;
+        }
+
+        row = _tagIds.size();
+        _tagIds.append(tagId);
+        _cm.append(QVector<int>());
+        _ppm.append(QVector<int>());
+        _index.insert(tagId, row);
+    }
+
+    if(anc >= values.at(row).size())
+    {
+        if(value == 0)
+        {
+            return;
+        }
+
+        values[row].resize(anc + 1); //new entries are 0
+    }
+
+    values[row][anc] = value;
+}
+
+int RangeCorrections::rows() const
+{
+    return _tagIds.size();
+}
+
+quint64 RangeCorrections::rowTag(int row) const
+{
+    return _tagIds.at(row);
+}
+
+const QVector<int> &RangeCorrections::rowCorrections(int row) const
+{
+    return _cm.at(row);
+}
+
+const QVector<int> &RangeCorrections::rowScales(int row) const
+{
+    return _ppm.at(row);
+}
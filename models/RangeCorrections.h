@@ -0,0 +1,70 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RangeCorrections.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef RANGECORRECTIONS_H
+#define RANGECORRECTIONS_H
+
+#include <QVector>
+
+#include "IdMap.h"
+
+/**
+ * The RangeCorrections class holds the tag - anchor range corrections: an offset (in cm) and a scale (in ppm of the
+ * range), so the corrected range is range + cm * 10 + range * ppm / 1000000 (mm).
+ *
+ * Only the tags which have a correction get a row, found by tag ID through an IdMap. A row has one entry per
+ * anchor (by anchor index) and grows to the highest anchor with a correction. Pairs without a correction read as 0.
+ */
+class RangeCorrections
+{
+public:
+    RangeCorrections();
+
+    void clear();
+
+    /**
+     * @return the correction (in cm) of the range between anchor \a anc and tag \a tagId
+     */
+    int correction(int anc, quint64 tagId) const;
+
+    void setCorrection(int anc, quint64 tagId, int cm);
+
+    /**
+     * @return the scale correction (in ppm) of the range between anchor \a anc and tag \a tagId
+     */
+    int scale(int anc, quint64 tagId) const;
+
+    void setScale(int anc, quint64 tagId, int ppm);
+
+    /**
+     * @return \a range (mm) between anchor \a anc and tag \a tagId with the corrections applied
+     */
+    int apply(int anc, quint64 tagId, int range) const;
+
+    /**
+     * @return the number of tags with a row, the rows are numbered 0 to rows()-1
+     */
+    int rows() const;
+    quint64 rowTag(int row) const;
+    const QVector<int> &rowCorrections(int row) const;
+    const QVector<int> &rowScales(int row) const;
+
+private:
+    void set(QVector<QVector<int> > &values, int anc, quint64 tagId, int value);
+
+    IdMap _index;               //tag ID to row
+    QVector<quint64> _tagIds;
+    QVector<QVector<int> > _cm;
+    QVector<QVector<int> > _ppm;
+};
+
+#endif // RANGECORRECTIONS_H
@@ -0,0 +1,161 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: TagStore.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "TagStore.h"
+
+#include <QtAlgorithms>
+#include <string.h>
+
+TagStore::TagStore() :
+    _size(0)
+{
+}
+
+TagStore::~TagStore()
+{
+    clear();
+}
+
+void TagStore::clear()
+{
+    for(int i=0; i<_stateBlocks.size(); i++)
+    {
+        delete [] _stateBlocks.at(i);
+        delete [] _historyBlocks.at(i);
+    }
+
+    _stateBlocks.clear();
+    _historyBlocks.clear();
+    _index.clear();
+    _size = 0;
+}
+
+int TagStore::size() const
+{
+    return _size;
+}
+
+int TagStore::find(quint64 id) const
+{
+    return _index.value(id);
+}
+
+int TagStore::add(quint64 id)
+{
+    int idx = _size;
+
+    if((idx % TAG_BLOCK_SIZE) == 0)
+    {
+        _stateBlocks.append(new tag_state_t[TAG_BLOCK_SIZE]);
+        _historyBlocks.append(new tag_history_t[TAG_BLOCK_SIZE]);
+    }
+
+    tag_state_t *t = state(idx);
+
+    memset(t, 0, sizeof(tag_state_t));
+    memset(history(idx), 0, sizeof(tag_history_t));
+    memset(t->rangeValue, -1, sizeof(t->rangeValue));
+    t->id = id;
+    t->rangeSeq = -1;
+
+    _index.insert(id, idx);
+    _size++;
+
+    return idx;
+}
+
+tag_state_t *TagStore::state(int idx) const
+{
+    return &_stateBlocks.at(idx / TAG_BLOCK_SIZE)[idx % TAG_BLOCK_SIZE];
+}
+
+tag_history_t *TagStore::history(int idx) const
+{
+    return &_historyBlocks.at(idx / TAG_BLOCK_SIZE)[idx % TAG_BLOCK_SIZE];
+}
+
+void tag_set_range_mask(tag_state_t *t, int seq, int mask)
+{
+    int w = (seq & 0xFF) >> 6;
+    quint64 bit = 1ULL << (seq & 0x3F);
+
+    for(int a=0; a<TAG_MAX_ANCS; a++)
+    {
+        if(mask & (1 << a))
+        {
+            t->rangeMask[a][w] |= bit;
+        }
+        else
+        {
+            t->rangeMask[a][w] &= ~bit;
+        }
+    }
+}
+
+int tag_range_count(const tag_state_t *t, int a)
+{
+    int n = 0;
+
+    for(int w=0; w<TAG_SEQ_WORDS; w++)
+    {
+        n += qPopulationCount(t->rangeMask[a][w]);
+    }
+
+    return n;
+}
+
+int tag_missing_count(const tag_state_t *t)
+{
+    int n = 0;
+
+    for(int w=0; w<TAG_SEQ_WORDS; w++)
+    {
+        quint64 any = 0;
+
+        for(int a=0; a<TAG_MAX_ANCS; a++)
+        {
+            any |= t->rangeMask[a][w];
+        }
+
+        n += 64 - qPopulationCount(any);
+    }
+
+    return n;
+}
+
+void tag_clear_range_mask(tag_state_t *t)
+{
+    memset(t->rangeMask, 0, sizeof(t->rangeMask));
+}
+
+bool tag_range_gate(tag_state_t *t, int a, int range, qint64 time, double maxSpeed)
+{
+    range_gate_t *g = &t->gate[a];
+
+    if((maxSpeed > 0) && (g->time != 0) && (g->rejects < TAG_GATE_MAX_REJECTS))
+    {
+        double limit = maxSpeed * (time - g->time) + TAG_GATE_MARGIN; //m/s * ms = mm
+
+        if(qAbs(range - g->range) > limit)
+        {
+            g->rejects++;
+            t->rejected[a]++;
+            return false;
+        }
+    }
+
+    g->range = range;
+    g->rejects = 0;
+    g->time = time;
+
+    return true;
+}
@@ -0,0 +1,133 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: TagStore.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef TAGSTORE_H
+#define TAGSTORE_H
+
+#include <QVector>
+
+#include "RunningWindow.h"
+#include "IdMap.h"
+#include "LinkQuality.h"
+#include "WindowStats.h"
+#include "LogPolicy.h"
+
+#define HIS_LENGTH          50      //default length of the position history
+#define HIS_MAX_LENGTH      WS_MAX_SAMPLES
+#define TAG_MAX_ANCS        (4)
+#define TAG_SEQ_WORDS       (4)     //256 range sequence numbers, one bit each
+#define TAG_BLOCK_SIZE      (32)    //tags are allocated in blocks of this many, so they never move
+#define TAG_GATE_MARGIN     (250)   //(mm) range noise allowed on top of the maximum tag speed
+#define TAG_GATE_MAX_REJECTS (3)    //after this many rejections in a row the next range is accepted (the tag may have moved out of sight)
+
+/**
+ * Range gate state of a tag - anchor pair
+ */
+typedef struct
+{
+    int range;                          //(mm) last accepted range
+    int rejects;                        //number of ranges rejected in a row
+    qint64 time;                        //(ms) time of the last accepted range, 0 if none yet
+} range_gate_t;
+
+/**
+ * State of a tag which is used for every range report and every position. It is saved as it is in the snapshots,
+ * see TAG_STATE_LAYOUT.
+ */
+typedef struct
+{
+    quint64 id;
+    int rangeSeq;
+    int printStats;
+    int numberOfLEs;
+    int rangeCount;                     //number of ranges in the current range sequence
+    int rangeValue[TAG_MAX_ANCS];       //(mm) ranges of the current range sequence, 0 if missing
+    quint64 rangeMask[TAG_MAX_ANCS][TAG_SEQ_WORDS]; //bit n is set if there was a range with the anchor in sequence n (used to calculate missing ranges)
+    range_gate_t gate[TAG_MAX_ANCS];
+    int rejected[TAG_MAX_ANCS];         //ranges rejected by the range gate since the last range statistics
+    link_quality_t link;                //success rates of the last 1, 10 and 60 s
+    log_filter_t log;                   //ranges and location last logged
+
+    double fx, fy, fz;                  //filter average
+    running_window_t win[3];            //last _filterSize samples of x, y, z
+    qint64 hsum[3];                     //sum of the history (um)
+    int arr_idx;
+    int count;
+    int filterReady;
+    bool ready;
+    double r95;
+} tag_state_t;
+
+/**
+ * History of the tag positions, only read when the statistics (R95) are calculated (saved in the snapshots too)
+ */
+typedef struct
+{
+    double x_arr[HIS_MAX_LENGTH];       //only the first _hisLength (see TagProcessor) are used
+    double y_arr[HIS_MAX_LENGTH];
+    double z_arr[HIS_MAX_LENGTH];
+    double av_x, av_y, av_z;            //average
+} tag_history_t;
+
+/**
+ * The TagStore class holds the state of all the tags seen so far.
+ *
+ * The state is accessed in place through pointers which stay valid when tags are added, so nothing is copied
+ * for each report. The per report state and the position history are kept apart, so a range report only
+ * touches the few hundred bytes it needs. Tags are found by ID through a hash map.
+ */
+class TagStore
+{
+public:
+    TagStore();
+    ~TagStore();
+
+    void clear();
+
+    int size() const;
+
+    /**
+     * @return the index of tag \a id, or -1 if it hasn't been added
+     */
+    int find(quint64 id) const;
+
+    /**
+     * Add tag \a id and return its index.
+     */
+    int add(quint64 id);
+
+    tag_state_t *state(int idx) const;
+    tag_history_t *history(int idx) const;
+
+private:
+    QVector<tag_state_t *> _stateBlocks;
+    QVector<tag_history_t *> _historyBlocks;
+    IdMap _index;               //tag ID to index
+    int _size;
+};
+
+/* record which anchors (mask bits 0-3) had a range in range sequence seq */
+void tag_set_range_mask(tag_state_t *t, int seq, int mask);
+
+/* number of range sequences in which there was a range with anchor a */
+int tag_range_count(const tag_state_t *t, int a);
+
+/* number of range sequences without any range */
+int tag_missing_count(const tag_state_t *t);
+
+void tag_clear_range_mask(tag_state_t *t);
+
+/* check a range (mm) to anchor a received at time (ms) against the last accepted one, returns false (and counts
+   the rejection) if the tag would have had to move faster than maxSpeed (m/s), maxSpeed 0 accepts all ranges */
+bool tag_range_gate(tag_state_t *t, int a, int range, qint64 time, double maxSpeed);
+
+#endif // TAGSTORE_H
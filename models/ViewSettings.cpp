@@ -25,6 +25,8 @@ ViewSettings::ViewSettings(QObject *parent)
       _showOrigin(true),
       _showGrid(true),
       _floorplanPath(""),
+      _maskPath(""),
+      _mapConstraint(false),
       _floorplanShow(false)
 {
     QObject::connect(this, SIGNAL(gridWidthChanged(double)), this, SLOT(viewSettingsChanged()));
@@ -127,6 +129,16 @@ const QString &ViewSettings::getFloorplanPath()
     return _floorplanPath;
 }
 
+const QString &ViewSettings::getMaskPath()
+{
+    return _maskPath;
+}
+
+bool ViewSettings::mapConstraint() const
+{
+    return _mapConstraint;
+}
+
 bool ViewSettings::floorplanSave() const
 {
     return _floorplanSave;
@@ -213,6 +225,22 @@ void ViewSettings::setFloorplanPath(const QString &arg)
     _floorplanPath = arg;
 }
 
+void ViewSettings::setMaskPath(const QString &arg)
+{
+    if (_maskPath != arg) {
+        _maskPath = arg;
+        emit maskChanged();
+    }
+}
+
+void ViewSettings::setMapConstraint(bool arg)
+{
+    if (_mapConstraint != arg) {
+        _mapConstraint = arg;
+        emit mapConstraintChanged(arg);
+    }
+}
+
 void ViewSettings::setFloorplanPathN(void)
 {
     if (!_floorplanPath.isNull())
@@ -36,6 +36,7 @@ class ViewSettings : public QObject
     Q_PROPERTY(bool showGrid READ gridShow WRITE setShowGrid NOTIFY showGridChanged)
     Q_PROPERTY(bool showOrigin READ originShow WRITE setShowOrigin NOTIFY showOriginChanged)
     Q_PROPERTY(QPixmap floorplanPixmap READ floorplanPixmap WRITE setFloorplanPixmap NOTIFY floorplanPixmapChanged)
+    Q_PROPERTY(bool mapConstraint READ mapConstraint WRITE setMapConstraint NOTIFY mapConstraintChanged)
 
     Q_PROPERTY(QTransform floorplanTransform READ floorplanTransform)
 
@@ -67,6 +68,10 @@ public:
     void setFloorplanPath(const QString &arg);
     void setFloorplanPathN(void);
     const QString &getFloorplanPath();
+    void setMaskPath(const QString &arg);
+    const QString &getMaskPath();
+
+    bool mapConstraint() const;
 
     bool gridShow();
     bool originShow();
@@ -91,6 +96,8 @@ public slots:
 
     void setSaveFP(bool);
 
+    void setMapConstraint(bool arg);
+
 signals:
     void gridWidthChanged(double arg);
     void gridHeightChanged(double arg);
@@ -111,6 +118,9 @@ signals:
 
     void floorplanChanged();
 
+    void mapConstraintChanged(bool arg);
+    void maskChanged();
+
     void showGO(bool, bool);
     void showSave(bool);
 
@@ -133,6 +143,8 @@ private:
     bool _floorplanSave;
     QPixmap _floorplanPixmap;
     QString _floorplanPath;
+    QString _maskPath;
+    bool _mapConstraint;
     bool _floorplanShow;
     QTransform _floorplanTransform;
 };
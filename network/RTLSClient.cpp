@@ -14,14 +14,17 @@
 
 #include "RTLSDisplayApplication.h"
 #include "SerialConnection.h"
+#include "GraphicsWidget.h"
 #include "trilateration.h"
 
 #include <QTextStream>
+#include <QDataStream>
 #include <QDateTime>
 #include <QThread>
 #include <QFile>
 #include <QDebug>
 #include <math.h>
+#include <string.h>
 #include <QMessageBox>
 
 #include <QDomDocument>
@@ -34,8 +37,6 @@
 
 using namespace std;
 
-#define nDim (2)
-
 
 /**
 * @brief RTLSDisplayApplication
@@ -46,8 +47,8 @@ RTLSClient::RTLSClient(QObject *parent) :
     QObject(parent),
     _first(true),
     _useAutoPos (false),
-    _file(NULL),
-    _fileDbg(NULL)
+    _fileDbg(NULL),
+    _processor(_ancArray, &_corrections, &_logPolicy, &_log)
 {
 
     /*
@@ -55,29 +56,53 @@ RTLSClient::RTLSClient(QObject *parent) :
     0 - No Filtering
     1 - Moving Average
     2 - Moving Average excluding max and min
+    3 - Particle Filter
+    4 - Kalman Filter
     */
-    _locationFilterTypes << "None" << "Moving Average" << "Moving Avg. Ex";
-    _usingFilter = 0;
+    _locationFilterTypes << "None" << "Moving Average" << "Moving Avg. Ex" << "Particle Filter" << "Kalman Filter";
 
     _graphicsWidgetReady = false ;
-    _tagList.clear();
 
     //memset(&_ancArray, 0, MAX_NUM_ANCS*sizeof(anc_struct_t));
     _serial = NULL;
 
-    _filterSize = FILTER_SIZE_SHORT ;
+    _ancRangeHist = ANC_RANGE_HIST;
 
     for(int a0 = 0; a0 < MAX_NUM_ANCS; a0++)
     {
         for(int b0 = 0; b0 < MAX_NUM_ANCS; b0++)
         {
             _ancRangeValues[a0][b0] = 0;
-            _ancRangeValuesAvg[a0][b0] = 0;
         }
     }
 
     _ancRangeLastSeq = 0x0;
     _ancRangeCount = 0;
+    ap_init(&_ancRanges);
+    _autoPosDim = 2;
+    _logFormat = LOG_FORMAT_TEXT;
+    lp_init(&_logPolicy);
+
+    _positionsSpill = "./Logs/RTLS_positions.dat";
+    _positions.setLimits(PS_RETENTION, PS_MAX_MEMORY, _positionsSpill);
+    _processor.setPositionStore(&_positions);
+
+    _snapshotFile = "./RTLS_snapshot.bin";
+    _snapshotInterval = SNAPSHOT_INTERVAL;
+    _snapshotMaxAge = SNAPSHOT_MAX_AGE;
+    _restored = false;
+    connect(&_snapshotTimer, SIGNAL(timeout()), this, SLOT(saveSnapshot()));
+
+    //the signals of the tag processing are the ones of the client
+    connect(&_processor, SIGNAL(anchHealth(quint64, int, double, double)), this, SIGNAL(anchHealth(quint64, int, double, double)));
+    connect(&_processor, SIGNAL(tagPos(quint64, double, double, double)), this, SIGNAL(tagPos(quint64, double, double, double)));
+    connect(&_processor, SIGNAL(tagVel(quint64, double, double, double)), this, SIGNAL(tagVel(quint64, double, double, double)));
+    connect(&_processor, SIGNAL(tagStats(quint64, double, double, double, double)), this, SIGNAL(tagStats(quint64, double, double, double, double)));
+    connect(&_processor, SIGNAL(tagRange(quint64, quint64, double)), this, SIGNAL(tagRange(quint64, quint64, double)));
+    connect(&_processor, SIGNAL(tagLink(quint64, double, double, double)), this, SIGNAL(tagLink(quint64, double, double, double)));
+    connect(&_processor, SIGNAL(ancLink(quint64, quint64, double, double, double)), this, SIGNAL(ancLink(quint64, quint64, double, double, double)));
+    connect(&_processor, SIGNAL(statusBarMessage(QString)), this, SIGNAL(statusBarMessage(QString)));
+    connect(&_processor, SIGNAL(enableFiltering()), this, SIGNAL(enableFiltering()));
 
     RTLSDisplayApplication::connectReady(this, "onReady()");
 }
@@ -86,6 +111,66 @@ void RTLSClient::onReady()
 {
     QObject::connect(RTLSDisplayApplication::serialConnection(), SIGNAL(serialOpened(QString, QString)),
                          this, SLOT(onConnected(QString, QString)));
+    QObject::connect(RTLSDisplayApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(onAboutToQuit()));
+}
+
+void RTLSClient::restoreSnapshot(void)
+{
+    QByteArray state;
+    qint64 time;
+
+    if(_restored)
+    {
+        return;
+    }
+
+    _restored = true;
+
+    if(_snapshotInterval <= 0)
+    {
+        return;
+    }
+
+    //the tag table first, the statistics of the processing are shown in it
+    if(SnapshotWriter::read(_snapshotFile, &state, &time) && (_processor.tagCount() == 0) &&
+       (QDateTime::currentMSecsSinceEpoch() - time <= _snapshotMaxAge * 60000LL))
+    {
+        QByteArray processor, tags;
+        QDataStream in(state);
+
+        in >> processor >> tags;
+
+        RTLSDisplayApplication::graphicsWidget()->restoreState(tags);
+
+        if(!_processor.restoreState(processor))
+        {
+            qDebug() << "snapshot of another version or history length, the tag statistics start again";
+        }
+    }
+
+    _snapshotTimer.start(_snapshotInterval * 1000);
+}
+
+void RTLSClient::saveSnapshot(void)
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+
+    out << _processor.saveState() << RTLSDisplayApplication::graphicsWidget()->saveState();
+
+    //skipped if the last one is still being written
+    _snapshot.write(_snapshotFile, QDateTime::currentMSecsSinceEpoch(), state);
+}
+
+void RTLSClient::onAboutToQuit(void)
+{
+    if(_snapshotTimer.isActive())
+    {
+        _snapshotTimer.stop();
+        _snapshot.wait();
+        saveSnapshot();
+        _snapshot.wait();
+    }
 }
 
 void RTLSClient::onConnected(QString ver, QString conf)
@@ -103,14 +188,7 @@ void RTLSClient::onConnected(QString ver, QString conf)
     {
         m = (_configuration & 6) >> 1;
 
-        if(m & 0x1)
-        {
-            _filterSize = FILTER_SIZE ;
-        }
-        else
-        {
-            _filterSize = FILTER_SIZE_SHORT ;
-        }
+        _processor.setLongFilter(m & 0x1);
 
         if(_configuration & 0x8)
         {
@@ -178,42 +256,47 @@ void RTLSClient::openLogFile(QString userfilename)
 {
     QDateTime now = QDateTime::currentDateTime();
 
-    _logFilePath = "./Logs/"+now.toString("yyyyMMdd_hhmmss")+"RTLS_log.txt";
+    _logFilePath = "./Logs/"+now.toString("yyyyMMdd_hhmmss")+"RTLS_log" + ((_logFormat == LOG_FORMAT_BINARY) ? ".bin" : ".txt");
 
     _first = true;
 
-    _file = new QFile(_logFilePath);
 #if (DEBUG_FILE==1)
     QString filenameDbg("./Logs/"+now.toString("yyyyMMdd_hhmmss")+"RTLS_log_dbg.txt");
     _fileDbg = new QFile(filenameDbg);
     if (!_fileDbg->open(QFile::ReadWrite | QFile::Text))
     {
-        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(_file->errorString())));
-        //QMessageBox::critical(NULL, tr("Logfile Error"), QString("Cannot create file %1 %2\nPlease make sure ./Logs/ folder exists.").arg(filename).arg(_file->errorString()));
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filenameDbg).arg(_fileDbg->errorString())));
+        //QMessageBox::critical(NULL, tr("Logfile Error"), QString("Cannot create file %1 %2\nPlease make sure ./Logs/ folder exists.").arg(filenameDbg).arg(_fileDbg->errorString()));
     }
 #endif
-    if (!_file->open(QFile::ReadWrite | QFile::Text))
+    //the anchors are also in the header of a binary log
+    QVector<log_anchor_t> anchors(MAX_NUM_ANCS);
+
+    for(int j=0; j<MAX_NUM_ANCS; j++)
     {
-        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(_logFilePath).arg(_file->errorString())));
-        QMessageBox::critical(NULL, tr("Logfile Error"), QString("Cannot create file %1 %2\nPlease make sure ./Logs/ folder exists.").arg(_logFilePath).arg(_file->errorString()));
+        anchors[j].id = j;
+        anchors[j].x = _ancArray[j].x;
+        anchors[j].y = _ancArray[j].y;
+        anchors[j].z = _ancArray[j].z;
     }
-    else
+
+    if (!_log.open(_logFilePath, _logFormat, QString("DecaRangeRTLS:LogFile:") + _version + _config, anchors))
     {
-        QString nowstr = now.toString("T:hhmmsszzz:");
-        QString s = nowstr + QString("DecaRangeRTLS:LogFile:") + _version + _config;
-        QTextStream ts( _file );
-        ts << s;
+        qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(_logFilePath).arg(_log.errorString())));
+        QMessageBox::critical(NULL, tr("Logfile Error"), QString("Cannot create file %1 %2\nPlease make sure ./Logs/ folder exists.").arg(_logFilePath).arg(_log.errorString()));
     }
 }
 
 void RTLSClient::closeLogFile(void)
 {
-    if(_file)
+    if(_log.isOpen())
     {
-        _file->flush();
-        _file->close();
+        //the records dropped when the disk couldn't keep up
+        qDebug() << "log" << _logFilePath << _log.queued() << "records," << _log.dropped() << "dropped, up to" << _log.maxPending() << "pending";
+
+        _log.close();
 
-        _file = NULL ;
+        qDebug() << "log" << _log.segments() << "segments," << _log.lost() << "bytes not written";
     }
 
 #if (DEBUG_FILE==1)
@@ -232,216 +315,30 @@ const QString &RTLSClient::getLogFilePath()
     return _logFilePath;
 }
 
-//initialise the tag reports strusture and add to the list
-void RTLSClient::initialiseTagList(int id)
+void RTLSClient::setLogPolicy(int type, int decimate, double deadband)
 {
-    tag_reports_t r;
-    memset(&r, 0, sizeof(tag_reports_t));
-    r.id = id;
-    r.ready = false;
-    r.filterReady = 0;
-    r.rangeSeq = -1;
-    r.printStats = 0;
-    memset(&r.rangeValue[0][0], -1, sizeof(r.rangeValue));
-    _tagList.append(r);
+    _logPolicy.type[type].decimate = qBound(1, decimate, LP_MAX_DECIMATE);
+    _logPolicy.type[type].deadband = qMax(0.0, deadband);
 }
 
-//calculate average of last 10
-double RTLSClient::process_ma(double *array, int idx)
+const log_policy_t &RTLSClient::logPolicy(int type) const
 {
-    double sum = 0;
-    int i, j;
-
-    for(j=0, i=idx; j<_filterSize; i--, j++)
-    {
-        if(i < 0)
-        {
-            i = (HIS_LENGTH - 1);
-        }
-        sum += array[i];
-    }
-    return (sum / _filterSize);
+    return _logPolicy.type[type];
 }
 
-//calculate average (of last 10) excluding min and max
-double RTLSClient::process_me(double *array, int idx)
+void RTLSClient::setCombineRanges(bool combine)
 {
-    double max, min, sum;
-    int i, j;
-
-    sum = max = min = array[idx];
-
-    i=(idx--);
-
-    if(i < 0)
-    {
-        i = (HIS_LENGTH - 1);
-    }
-
-    for(j=0; j<(_filterSize-1); i--, j++)
-    {
-        if(i < 0)
-        {
-            i = (HIS_LENGTH - 1);
-        }
-        if (array[i] > max)
-        {
-            max = array[i];
-        }
-        if (array[i] < min)
-        {
-            min = array[i];
-        }
-        sum += array[i];
-    }
-
-    sum = sum - max - min;
-
-    return (sum / (_filterSize - 2));
+    _logPolicy.combineRanges = combine;
 }
 
-void RTLSClient::updateTagStatistics(int i, double x, double y, double z)
-//update the history array and the average
+bool RTLSClient::combineRanges() const
 {
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
-    int j = 0;
-    int idx = _tagList.at(i).arr_idx;
-    uint64_t id = _tagList.at(i).id;
-    tag_reports_t rp = _tagList.at(i);
-    double avDistanceXY = 0;
-    double sum_std = 0;
-    double DistanceXY[HIS_LENGTH];
-    double DstCentreXY[HIS_LENGTH];
-    double stdevXY = 0;
-
-    rp.av_x = 0;
-    rp.av_y = 0;
-    rp.av_z = 0;
-
-
-    for(j=0; j<HIS_LENGTH; j++)
-    {
-       rp.av_x += rp.x_arr[j];
-       rp.av_y += rp.y_arr[j];
-       rp.av_z += rp.z_arr[j];
-    }
-
-    rp.av_x /= HIS_LENGTH;
-    rp.av_y /= HIS_LENGTH;
-    rp.av_z /= HIS_LENGTH;
-
-    for(j=0; j<HIS_LENGTH; j++)
-    {
-        DistanceXY[j] = sqrt((rp.x_arr[j] - rp.av_x)*(rp.x_arr[j] - rp.av_x) + (rp.y_arr[j] - rp.av_y)*(rp.y_arr[j] - rp.av_y));
-    }
-
-    for (j=0; j<HIS_LENGTH; j++)
-    {
-        avDistanceXY += DistanceXY[j]/HIS_LENGTH;
-    }
-
-    for(j=0; j<HIS_LENGTH; j++)
-    {
-        sum_std += (DistanceXY[j]-avDistanceXY)*(DistanceXY[j]-avDistanceXY);
-
-    }
-
-    stdevXY = sqrt(sum_std/HIS_LENGTH);
-
-    vec2d sum_tempXY = {0, 0};
-    vec2d CentrerXY = {0, 0};
-
-    int counterXY = 0;
-
-    for(j=0; j<HIS_LENGTH; j++)
-    {
-        if (DistanceXY[j] < stdevXY*2)
-        {
-            sum_tempXY.x += rp.x_arr[j];
-            sum_tempXY.y += rp.y_arr[j];
-            counterXY++;
-        }
-
-    }
-
-    CentrerXY.x  = sum_tempXY.x/counterXY;
-    CentrerXY.y  = sum_tempXY.y/counterXY;
-
-    for(j=0; j<HIS_LENGTH; j++)
-    {
-        DstCentreXY[j] = sqrt((rp.x_arr[j] - CentrerXY.x)*(rp.x_arr[j] - CentrerXY.x) + (rp.y_arr[j] - CentrerXY.y)*(rp.y_arr[j] - CentrerXY.y));
-    }
-
-    r95Sort(DstCentreXY,0,HIS_LENGTH-1);
-
-    rp.r95 = DstCentreXY[int(0.95*HIS_LENGTH)];
-
-    //R95 = SQRT(meanErrx*meanErrx + meanErry*meanErry) + 2*SQRT(stdx*stdx+stdy*stdy)
-    //rp.r95 = sqrt((rp.averr_x*rp.averr_x) + (rp.averr_y*rp.averr_y)) +
-    //        2.0 * sqrt((rp.std_x*rp.std_x) + (rp.std_y*rp.std_y)) ;
-
-
-    //update the value in the array
-    rp.x_arr[idx] = x;
-    rp.y_arr[idx] = y;
-    rp.z_arr[idx] = z;
-
-    rp.arr_idx++;
-    //wrap the index
-    if(rp.arr_idx >= HIS_LENGTH)
-    {
-        rp.arr_idx = 0;
-        rp.ready = true;
-        rp.filterReady = 1;
-    }
-
-    rp.count++;
-
-
-    if(rp.filterReady > 0)
-    {
-        if(_usingFilter == 2)
-        {
-            rp.fx = process_me(rp.x_arr, idx);
-            rp.fy = process_me(rp.y_arr, idx);
-            rp.fz = process_me(rp.z_arr, idx);
-        }
-        else if (_usingFilter == 1)
-        {
-            rp.fx = process_ma(rp.x_arr, idx);
-            rp.fy = process_ma(rp.y_arr, idx);
-            rp.fz = process_ma(rp.z_arr, idx);
-        }
-
-        //qDebug() << rp.fx << rp.fy << rp.fz ;
-
-        if(rp.filterReady == 1)
-        {
-            emit enableFiltering();
-            rp.filterReady++;
-        }
-    }
-
-    //update the list entry
-    _tagList.replace(i, rp);
-
-    if(rp.ready)
-    {
-        if(_graphicsWidgetReady)
-        {
-            emit tagStats(id, CentrerXY.x, CentrerXY.y, rp.av_z, rp.r95);
-        }
+    return _logPolicy.combineRanges;
+}
 
-        if(_file)
-        {
-            //log data to file
-            QString s = nowstr + QString("TS:%1 avx:%2 avy:%3 avz:%4 r95:%5\n").arg(id).arg(rp.av_x).arg(rp.av_y).arg(rp.av_z).arg(rp.r95);
-            QTextStream ts( _file );
-            ts << s;
-        }
-        rp.ready = false;
-    }
+PositionStore *RTLSClient::positions()
+{
+    return &_positions;
 }
 
 void RTLSClient::setUseAutoPos(bool useAutoPos)
@@ -461,19 +358,19 @@ Filter Types
 0 - No Filtering
 1 - Moving Average
 2 - Moving Average excluding max and min
-3 - Kalman Filter
+3 - Particle Filter
+4 - Kalman Filter
 */
 void RTLSClient::setLocationFilter(int filter)
 {
-    _usingFilter = filter ;
+    _processor.setLocationFilter(filter);
 }
 
 
 void RTLSClient::newData()
 {
     QByteArray data = _serial->readAll();
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
+    qint64 logTime = _log.now();
     int length = data.length();
     int offset = 0;
     QString statusMsg;
@@ -511,7 +408,7 @@ void RTLSClient::newData()
 
         if(length < TOF_REPORT_LEN)
         {
-            return;
+            break;
         }
 
 
@@ -526,7 +423,7 @@ void RTLSClient::newData()
         char c, type;
         int n = sscanf(tofReport.constData(),"m%c %x %x %x %x %x %x %x %x %c%d:%d", &type, &mask, &range[0], &range[1], &range[2], &range[3], &lnum, &seq, &rangetime, &c, &tid, &aid);
 
-        aid &= 0x3;
+        //aid is the ID of the anchor or listener the application is connected to, it is only shown to the user
 
         //qDebug() << "anc"<< aid << "tag" << tid << "range(mm)" << range ;
         //qDebug() << "number"<< lnum << "seq" << seq << c << i ;
@@ -571,23 +468,14 @@ void RTLSClient::newData()
             //log the anchor co-ordinates to the file
             for(int j=0; j<MAX_NUM_ANCS; j++)
             {
-                if(_file)
-                {
-                    QString s =  nowstr + QString("AP:%1:%2:%3:%4\n").arg(j).arg(_ancArray[j].x).arg(_ancArray[j].y).arg(_ancArray[j].z);
-                    QTextStream ts( _file );
-                    ts << s;
-                }
+                _log.anchorPos(logTime, j, _ancArray[j].x, _ancArray[j].y, _ancArray[j].z);
             }
             _first = false;
         }
 
         if(type == 'c') //if 'c' these reports relate to tag <-> anchor ranges
         {
-            int idx = processTagRangeReports(tid, range, lnum, seq, mask); //this is received when tags range to anchors
-
-            if(idx != -1)
-                trilaterateTag(tid, seq, idx);
-
+            _processor.processReport(QDateTime::currentMSecsSinceEpoch(), _log.now(), tid, range, lnum, seq, mask);
         }
 
         if(type == 'a') //if 'a' these reports relate to anchor <-> anchor ranges
@@ -623,102 +511,47 @@ void RTLSClient::newData()
         }   
     }
 
+    //update the particle/Kalman filter once for all the reports in this block of data
+    _processor.processFilters();
 }
 
-
-//calculate average (of last 50) excluding min and max
-double RTLSClient::process_avg(int idx)
+void RTLSClient::setWindowSizes(int hisLength, int filterSize, int filterSizeShort, int ancRangeHist)
 {
-    double max, min, sum;
-    int i;
+    _processor.setWindowSizes(hisLength, filterSize, filterSizeShort);
 
-    sum = max = min = _ancRangeArray[idx][0];
+    ancRangeHist = qBound(3, ancRangeHist, ANC_RANGE_MAX_HIST);
 
-    for(i=0; i<ANC_RANGE_HIST; i++)
+    if(ancRangeHist != _ancRangeHist)
     {
-        if (_ancRangeArray[idx][i] > max) max = _ancRangeArray[idx][i];
-        if (_ancRangeArray[idx][i] < min) min = _ancRangeArray[idx][i];
-        sum += _ancRangeArray[idx][i];
+        _ancRangeHist = ancRangeHist;
+        _ancRangeCount = 0;
     }
-
-    sum = sum - max - min;
-
-    return sum / (ANC_RANGE_HIST - 2);
 }
 
 void RTLSClient::processAnchRangeReport(int aid, int tid, int range, int lnum, int seq)
 {
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
     //qDebug() << "a and t " << aid << tid << "correction = " << (_ancArray[aid].tagRangeCorection[tid] * 0.01);
 
     //log data to file
-    if(_file)
-    {
-        QString s =  nowstr + QString("RA:%1:%2:%3:%4:%5:%6\n").arg(tid).arg(aid).arg(range).arg(0).arg(seq).arg(lnum);
-        QTextStream ts( _file );
-        ts << s;
-    }
+    _log.anchorRange(_log.now(), tid, aid, range, seq, lnum);
 
     //find the anchor in the list (A0 to A1, is the same as A1 to A0)
     _ancRangeValues[aid][tid] = ((double)range) / 1000;
     _ancRangeValues[tid][aid] = _ancRangeValues[aid][tid];
 
+    //the average is updated with each range, outliers are limited
+    ap_add(&_ancRanges, aid, tid, _ancRangeValues[aid][tid], _ancRangeHist);
+
     if(seq != _ancRangeLastSeq) //new ranges - send signal to GUI
     {
-        //first we store the 50 ranges and find and average range, then we calculate position
-        if(_ancRangeCount < ANC_RANGE_HIST)
-        {
-            _ancRangeArray[0][_ancRangeCount] = _ancRangeValues[0][1]; //range A0-A1
-            _ancRangeArray[1][_ancRangeCount] = _ancRangeValues[0][2]; //range A0-A2
-            _ancRangeArray[2][_ancRangeCount] = _ancRangeValues[1][2]; //rnage A1-A2
-            _ancRangeCount++;
-        }
-        else //calculate average and then location
+        //the anchors are located again every _ancRangeHist range sequences
+        if(++_ancRangeCount >= _ancRangeHist)
         {
             _ancRangeCount = 0;
 
             if(_useAutoPos) //if Anchor auto positioning is enabled then process Anchor-Anchor TWR data
             {
-                //we have 3 ranges (A0 to A1, A0 to A2 and A1 to A2)
-                //calculate A0, A1 and A2 coordinates (x, y) based on A0 = 0,0 and assume A2 is to the right of A1
-
-                int nNodes = 3;
-                int viewNode = 0;
-                mat twrdistance = zeros<mat>(nNodes,nNodes);
-                mat transCoord = zeros<mat>(nNodes,nDim);
-                mat estCoord = zeros<mat>(nNodes,nDim);
-
-                //calculate average (exclude min, max)
-                _ancRangeValuesAvg[0][1] = _ancRangeValuesAvg[1][0] = process_avg(0);
-                _ancRangeValuesAvg[0][2] = _ancRangeValuesAvg[2][0] = process_avg(1);
-                _ancRangeValuesAvg[1][2] = _ancRangeValuesAvg[2][1] = process_avg(2);
-
-                for (int i = 0; i<nNodes; i++)                  // change the array to mat format
-                {
-                    for (int j = 0; j<nNodes; j++)
-                    {
-                       twrdistance(i,j) =  _ancRangeValuesAvg[i][j];
-                    }
-                }
-
-                mds(twrdistance, nNodes, viewNode, &transCoord); // Using multi-dimension scaling to estimation the shape
-
-                angleRotation(transCoord, nNodes, &estCoord); // estCoord is the coordinates with a1 on the x axis and a2 in the first quadrant
-
-                //emit ancRanges(_ancRangeValues[0][1], _ancRangeValues[0][2], _ancRangeValues[1][2]); //send the update to graphic
-                for(int i=0; i<(MAX_NUM_ANCS-1); i++) // Only update positions of A0, A1 and A2
-                {
-                    _ancArray[i].x = estCoord.at(i,0);
-                    _ancArray[i].y = estCoord.at(i,1);
-
-                    emit anchPos(i, _ancArray[i].x, _ancArray[i].y, _ancArray[i].z, false, true); // Update table entry
-                }
-
-                //if()
-                //{
-                   // emit centerOnAnchors(); - don't auto center ...
-                //}
+                autoPositionAnchors();
             }
         }
     }
@@ -726,351 +559,67 @@ void RTLSClient::processAnchRangeReport(int aid, int tid, int range, int lnum, i
     _ancRangeLastSeq = seq;
 }
 
-
-
-
-
-void RTLSClient::mds(mat twrdistance, int nNodes, int viewNode, mat* transCoord)
-{
-    mat         distSquared = zeros<mat>(nNodes,nNodes);
-    mat         u = zeros<mat>(nNodes,nNodes);
-    mat         v = zeros<mat>(nNodes,nNodes);
-    colvec      s = zeros<vec>(nNodes);
-    mat         estGeom = zeros<mat>(nNodes,nDim);
-
-    distSquared = square(twrdistance);
-
-    mat centeringOperator = eye<mat>(nNodes,nNodes)-(ones<mat>(nNodes,nNodes)/nNodes);
-
-    mat centeredDistSquared = -0.5 * centeringOperator * distSquared * centeringOperator;
-
-    svd(u,s,v,centeredDistSquared);
-
-    for (int i = 0; i<nDim; i++)
-    {
-        estGeom.col(i) = u.col(i)*sqrt(s(i));
-    }
-
-    for (int i = 0; i<nNodes; i++)
-    {
-        transCoord->row(i) = estGeom.row(i)-estGeom.row(viewNode);
-    }
-
-
-}
-
-void RTLSClient::angleRotation(mat transCoord, int nNodes, mat* estCoord)
-{
-    mat rotationMatrix = -ones<mat>(2,2);
-    colvec transdistance = zeros(nNodes,1);
-    mat Coord = zeros<mat>(nNodes,nDim);
-
-
-    for (int i = 0; i<nNodes; i++)
-    {
-        transdistance.at(i) = sqrt(transCoord(i,0)*transCoord(i,0) + transCoord(i,1)*transCoord(i,1));
-
-    }
-
-
-    colvec currentAngle = acos(transCoord.col(0)/transdistance);
-
-    for (int i = 0; i<nNodes; i++)
-    {
-        if (transCoord(i,1)<0)
-        {
-            currentAngle(i) = -currentAngle(i);
-        }
-    }
-
-    double rotateAngle = currentAngle(1);
-
-    rotationMatrix << cos(rotateAngle) << (-sin(rotateAngle)) << endr
-                   << sin(rotateAngle) << cos(rotateAngle) <<endr;
-
-    Coord = transCoord*rotationMatrix;
-
-    if (Coord.at(2,1)<0)
-    {
-        Coord.at(2,1) = -Coord.at(2,1);
-    }
-
-    *estCoord = Coord;
-
-}
-
-
-
-int RTLSClient::processTagRangeReports(int tid, int *range, int lnum, int seq, int mask)
+/**
+ * @fn    autoPositionAnchors
+ * @brief  locate the anchors which have ranges to each other (A0 at 0,0, A1 on the x axis, A2 at y > 0)
+ *
+ *         with _autoPosDim 3 and the ranges between 4 anchors the z coordinates are also located, relative
+ *         to the z of A0, otherwise the z coordinates are not changed. The anchor range report only has the
+ *         ranges between A0, A1 and A2, so only they are located, in 2D.
+ * */
+void RTLSClient::autoPositionAnchors(void)
 {
-    int range_corrected = 0;
-    int idx = 0;
-    int seq_i ;
-    int tag_index = -1;
-    uint8_t seq_diff = 0;
-    QTextStream ts (_file);
-
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
-    //qDebug() << "a and t " << aid << tid << "correction = " << (_ancArray[aid].tagRangeCorection[tid] * 0.01);
-
-    //find the tag in the list
-    for(idx=0; idx<_tagList.size(); idx++)
-    {
-        //find this tag in the list
-        if(_tagList.at(idx).id == tid)
-        {
-            tag_index = idx;
-            break;
-        }
-    }
-
-    //if we don't have this tag in the list add it
-    if(idx == _tagList.size())
-    {
-        initialiseTagList(tid);
-    }
+    int idx[MAX_NUM_ANCS];
+    int n = ap_anchors(&_ancRanges, MAX_NUM_ANCS, idx);
+    double d[MAX_NUM_ANCS * MAX_NUM_ANCS];
+    double xyz[MAX_NUM_ANCS][3];
+    int dim = (n > 3) ? _autoPosDim : 2;   //z needs the ranges between 4 anchors
 
-    tag_reports_t rp = _tagList.at(idx);
-
-    seq_i =  seq & 0xFF;
-
-    if(rp.rangeSeq != -1)
-    {
-        seq_diff = (seq_i - rp.rangeSeq) & 0xFF;
-
-        rp.printStats += seq_diff;
-
-        //qDebug() << rp.printStats ;
-    }
-    else
+    if(n < 3)
     {
-        rp.printStats = 1;
+        return;
     }
-    rp.rangeCount[seq_i] = 0;
-    rp.rangeSeq = seq_i;
 
-    //check the mask and process the tag - anchor ranges
-    for(int k=0; k<MAX_NUM_ANCS; k++)
+    for(int i=0; i<n; i++)
     {
-        if((0x1 << k) & mask) //we have a valid range
-        {
-            range_corrected = range[k] + (_ancArray[k].tagRangeCorection[tid] * 10); //range correction is in cm (range is in mm)
-
-            //log data to file
-            if(_file)
-            {
-                QString s =  nowstr + QString("RR:%1:%2:%3:%4:%5:%6\n").arg(tid).arg(k).arg(range[k]).arg(range_corrected).arg(seq).arg(lnum);
-                ts << s;
-            }
-
-            emit tagRange(tid, k, (range_corrected * 0.001)); //convert to meters
-
-            rp.rangeCount[seq_i]++;
-            rp.rangeValue[seq_i][k & 0x3] = range_corrected;
-        }
-        else
+        for(int j=0; j<n; j++)
         {
-            rp.rangeValue[seq_i][k & 0x3] = 0;
-
-            emit tagRange(tid, k, -1); //report no/missing range
+            d[i*n + j] = (i == j) ? 0 : ap_range(&_ancRanges, idx[i], idx[j]);
         }
     }
 
-    //log data to file
-    if(_file)
-    {
-        QString s =  nowstr + QString("RM:%1:%2:%3:%4\n").arg(tid).arg(mask).arg(seq).arg(lnum);
-        ts << s;
-    }
-
-    rp.rangeCountM[seq_i] = mask ;
-
-    if(rp.printStats == 256) //print every 256 ranges
+    if(!ap_locate(d, n, dim, &xyz[0][0]))
     {
-        float a0r = 0;
-        float a1r = 0;
-        float a2r = 0;
-        float a3r = 0;
-        int missing = 0;
-
-        for(int i=0; i<256; i++)
-        {
-            if(rp.rangeCountM[i] & 0x1) {a0r++;}
-            if(rp.rangeCountM[i] & 0x2) {a1r++;}
-            if(rp.rangeCountM[i] & 0x4) {a2r++;}
-            if(rp.rangeCountM[i] & 0x8) {a3r++;}
-            if(rp.rangeCountM[i] == 0) {missing++;}
-            rp.rangeCountM[i] = 0 ; //clear all masks/data
-        }
-
-        a0r *= 100.0/256;
-        a1r *= 100.0/256;
-        a2r *= 100.0/256;
-        a3r *= 100.0/256;
-
-        //log data to file
-        if(_file)
-        {
-            QString s =  nowstr +
-                    QString("RS:%1:%2:%3:%4:%5:%6\n").arg(tid).
-                    arg(QString::number(a0r, 'f', 2)).
-                    arg(QString::number(a1r, 'f', 2)).
-                    arg(QString::number(a2r, 'f', 2)).
-                    arg(QString::number(a3r, 'f', 2)).arg(missing);
-            ts << s;
-        }
-
-        rp.printStats = 0;
+        return;
     }
 
-    //update the list entry
-    _tagList.replace(idx, rp);
-
-    return tag_index;
-}
-
-void RTLSClient::trilaterateTag(int tid, int seq, int idx)
-{
-    int count = 0;
-    //bool trilaterate = false;
-    vec3d report;
-    bool newposition = false;
-    int nolocation = 0;
-    int lastSeq = 0;
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
-
-    tag_reports_t rp = _tagList.at(idx);
-
-    //lastSeq = (seq-1) & 0xFF ;
-    lastSeq = seq;
-    count = rp.rangeCount[lastSeq] ;
+    double z0 = _ancArray[idx[0]].z;
 
-    //we got next range seq. lets try and trilaterate the previous
-    if(count >= 3)
+    for(int i=0; i<n; i++)
     {
-        //qDebug() << "try to get location" ;
-
-        if(calculateTagLocation(&report, count, &rp.rangeValue[lastSeq][0] ) == TRIL_3SPHERES)
-        {
-            newposition = true;
-            rp.numberOfLEs++;
-            //log data to file
-            if(_file)
-            {
-                QString s = nowstr + QString("LE:%1:%2:%3:[%4,%5,%6]:").arg(tid).arg(rp.numberOfLEs).arg(lastSeq).arg(report.x).arg(report.y).arg(report.z) +
-                        QString("%1:%2:%3:%4\n").arg(rp.rangeValue[lastSeq][0]).arg(rp.rangeValue[lastSeq][1]).arg(rp.rangeValue[lastSeq][2]).arg(rp.rangeValue[lastSeq][3]);
-                QTextStream ts( _file );
-                ts << s;
-            }
-
-            //qDebug() << "emit tagPos" << rp.numberOfLEs;
-
-            if(_usingFilter == 0)
-            {
-                emit tagPos(tid, report.x, report.y, report.z); //send the update to graphic
-            }
-            if(nolocation)
-            {
-                emit statusBarMessage("");
-            }
+        int a = idx[i];
 
-            nolocation = 0;
+        _ancArray[a].x = xyz[i][0];
+        _ancArray[a].y = xyz[i][1];
 
-        }
-        else //no solution
+        if(dim == 3)
         {
-            nolocation++;
-
-            //log data to file
-            if(_file)
-            {
-                QString s = nowstr + QString("NL:%1:%2:%3:[nan,nan,nan]:").arg(tid).arg(rp.numberOfLEs).arg(lastSeq) +
-                        QString("%1:%2:%3:%4\n").arg(rp.rangeValue[lastSeq][0]).arg(rp.rangeValue[lastSeq][1]).arg(rp.rangeValue[lastSeq][2]).arg(rp.rangeValue[lastSeq][3]);
-                QTextStream ts( _file );
-                ts << s;
-            }
-
-            if( nolocation >= 5)
-            {
-                emit statusBarMessage("No location solution.");
-            }
+            _ancArray[a].z = z0 + xyz[i][2];
         }
 
+        emit anchPos(a, _ancArray[a].x, _ancArray[a].y, _ancArray[a].z, false, true); // Update table entry
     }
-    //clear the count
-    rp.rangeCount[lastSeq] = 0;
-
-    //update the list entry
-    _tagList.replace(idx, rp);
-
-    //update statistics if new position has been calculated
-    if(newposition)
-    {
-        updateTagStatistics(idx, report.x, report.y, report.z);
-
-        if(_usingFilter != 0)
-        {
-            emit tagPos(tid, rp.fx, rp.fy, rp.fz); //send the update to graphic
-        }
-    }
-
-    //qDebug() << "newposition" << newposition << idx << lastSeq << seq;
-}
-
-int RTLSClient::calculateTagLocation(vec3d *report, int count, int *ranges)
-{
-    int result = 0;
-    vec3d anchorArray[4];
-
-    anchorArray[0].x = _ancArray[0].x;
-    anchorArray[0].y = _ancArray[0].y;
-    anchorArray[0].z = _ancArray[0].z;
-
-    anchorArray[1].x = _ancArray[1].x;
-    anchorArray[1].y = _ancArray[1].y;
-    anchorArray[1].z = _ancArray[1].z;
-
-    anchorArray[2].x = _ancArray[2].x;
-    anchorArray[2].y = _ancArray[2].y;
-    anchorArray[2].z = _ancArray[2].z;
-
-    anchorArray[3].x = _ancArray[3].x;
-    anchorArray[3].y = _ancArray[3].y;
-    anchorArray[3].z = _ancArray[3].z;
-
-    result = GetLocation(report, ((count==4) ? 1 : 0), &anchorArray[0], ranges);
-
-    return result;
 }
 
 void RTLSClient::setGWReady(bool set)
 {
     _graphicsWidgetReady = set;
-}
+    _processor.setEmitStats(set);
 
-void r95Sort (double s[], int l, int r)
-{
-    int i,j;
-    double x;
-    if(l<r)
+    if(set)
     {
-        i = l;
-        j = r;
-        x = s[i];
-        while(i<j)
-        {
-            while (i<j&&s[j]>x) j--;
-            if (i<j) s[i++] = s[j];
-            while (i<j&&s[i]<x) i++;
-            if (i < j) s[j--] = s[i];
-        }
-        s[i] = x;
-        r95Sort(s, l, i-1);
-        r95Sort(s, i+1, r);
+        restoreSnapshot();
     }
-
 }
 
 void RTLSClient::connectionStateChanged(SerialConnection::ConnectionState state)
@@ -1084,10 +633,7 @@ void RTLSClient::connectionStateChanged(SerialConnection::ConnectionState state)
             disconnect(_serial, SIGNAL(readyRead()), this, SLOT(newData()));
             _serial = NULL;
         }
-        if(_file)
-        {
-            _file->close(); //close the Log file
-        }
+        _log.close(); //close the Log file
     }
 
 }
@@ -1123,17 +669,16 @@ void RTLSClient::loadConfigFile(QString filename)
         _ancArray[i].x = x[i];  //default x
         _ancArray[i].y = y[i];  //default y
         _ancArray[i].z = 3.00;  //default z
-
-        for(int j = 0; j<MAX_NUM_TAGS; j++)
-        {
-            _ancArray[i].tagRangeCorection[j] =  0;
-        }
     }
 
+    _corrections.clear();
+    lp_init(&_logPolicy);
+
     if (!file.open(QIODevice::ReadOnly))
     {
         qDebug(qPrintable(QString("Error: Cannot read file %1 %2").arg(filename).arg(file.errorString())));
         addMissingAnchors();
+        emit logPolicyChanged();
         return;
     }
 
@@ -1157,14 +702,96 @@ void RTLSClient::loadConfigFile(QString filename)
             QDomElement e = n.toElement();
             if( !e.isNull() )
             {
+                if( e.tagName() == "filter_cfg" )
+                {
+                    double q = (e.attribute("kfQ", QString::number(KF_DEFAULT_Q))).toDouble();
+                    double r = (e.attribute("kfR", QString::number(KF_DEFAULT_R))).toDouble();
+
+                    _processor.kalmanFilter()->setNoise(q, r);
+                    _processor.kalmanFilter()->setMode((e.attribute("kfMode", "0")).toInt());
+
+                    _processor.setR95Interval((e.attribute("r95Interval", QString::number(R95_INTERVAL))).toInt());
+                    _processor.setRangeGateSpeed((e.attribute("rangeGateSpeed", QString::number(RANGE_GATE_SPEED))).toDouble());
+
+                    setWindowSizes((e.attribute("hisLength", QString::number(HIS_LENGTH))).toInt(),
+                                   (e.attribute("filterSize", QString::number(FILTER_SIZE))).toInt(),
+                                   (e.attribute("filterSizeShort", QString::number(FILTER_SIZE_SHORT))).toInt(),
+                                   (e.attribute("ancRangeHist", QString::number(ANC_RANGE_HIST))).toInt());
+                }
+
+                if( e.tagName() == "autopos_cfg" )
+                {
+                    _autoPosDim = ((e.attribute("dim", "2")).toInt() == 3) ? 3 : 2;
+                }
+
+                if( e.tagName() == "log_cfg" )
+                {
+                    _log.setFlushInterval((e.attribute("flushInterval", QString::number(LOG_FLUSH_INTERVAL))).toInt());
+                    _logFormat = (e.attribute("format", "text") == "binary") ? LOG_FORMAT_BINARY : LOG_FORMAT_TEXT;
+                    _log.setRotation((e.attribute("maxSize", QString::number(LOG_MAX_SIZE))).toInt(),
+                                     (e.attribute("maxMinutes", "0")).toInt());
+                    _log.setRetention((e.attribute("keep", "0")).toInt(),
+                                      (e.attribute("compress", "0")).toInt() != 0);
+                    _logPolicy.combineRanges = ((e.attribute("combineRanges", "0")).toInt() != 0);
+                }
+
+                if( e.tagName() == "history_cfg" )
+                {
+                    _positionsSpill = e.attribute("spill", _positionsSpill);
+                    _positions.setLimits((e.attribute("hours", QString::number(PS_RETENTION))).toInt(),
+                                         (e.attribute("memory", QString::number(PS_MAX_MEMORY))).toInt(),
+                                         _positionsSpill);
+                }
+
+                if( e.tagName() == "snapshot_cfg" )
+                {
+                    _snapshotFile = e.attribute("file", _snapshotFile);
+                    _snapshotInterval = (e.attribute("interval", QString::number(SNAPSHOT_INTERVAL))).toInt();
+                    _snapshotMaxAge = (e.attribute("maxAge", QString::number(SNAPSHOT_MAX_AGE))).toInt();
+
+                    if(_snapshotTimer.isActive())
+                    {
+                        if(_snapshotInterval > 0)
+                        {
+                            _snapshotTimer.setInterval(_snapshotInterval * 1000);
+                        }
+                        else
+                        {
+                            _snapshotTimer.stop();
+                        }
+                    }
+                }
+
+                if( e.tagName() == "log_policy" )
+                {
+                    int type = log_type(qPrintable(e.attribute("type", "")));
+
+                    if(type > LOG_TEXT)
+                    {
+                        setLogPolicy(type, (e.attribute("decimate", "1")).toInt(), (e.attribute("deadband", "0")).toDouble());
+                    }
+                }
+
+                if( e.tagName() == "corr" )
+                {
+                    bool ok, okt;
+                    int anc = (e.attribute("anc", "")).toInt(&ok);
+                    quint64 tag = (e.attribute("tag", "")).toULongLong(&okt);
+
+                    if(ok && okt)
+                    {
+                        _corrections.setCorrection(anc, tag, (e.attribute("cm", "0")).toInt());
+                        _corrections.setScale(anc, tag, (e.attribute("ppm", "0")).toInt());
+                    }
+                }
+
                 if( e.tagName() == "anc" )
                 {
                     bool ok;
                     int id = (e.attribute( "ID", "" )).toInt(&ok);
 
-                    id &= 0x3;
-
-                    if(ok)
+                    //the tag range report only has ranges to anchors 0 to 3, other IDs can't be used
+                    if(ok && (id >= 0) && (id < MAX_NUM_ANCS))
                     {
                         _ancArray[id].id = id & 0xf;
                         _ancArray[id].label = (e.attribute( "label", "" ));
@@ -1172,23 +799,13 @@ void RTLSClient::loadConfigFile(QString filename)
                         _ancArray[id].y = (e.attribute("y", "0.0")).toDouble(&ok);
                         _ancArray[id].z = (e.attribute("z", "0.0")).toDouble(&ok);
 
-                        //tag distance correction (in cm)
-                        _ancArray[id].tagRangeCorection[0] = (e.attribute("t0", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[1] = (e.attribute("t1", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[2] = (e.attribute("t2", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[3] = (e.attribute("t3", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[4] = (e.attribute("t4", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[5] = (e.attribute("t5", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[6] = (e.attribute("t6", "0")).toDouble(&ok);
-                        _ancArray[id].tagRangeCorection[7] = (e.attribute("t7", "0")).toDouble(&ok);
-
-                        if(id == 3) //hide anchor 4 by default
+                        //tag distance correction (in cm), older config files have t0 to t7 attributes
+                        for(int t=0; t<8; t++)
                         {
-                            emit anchPos(id, _ancArray[id].x, _ancArray[id].y, _ancArray[id].z, false, false);
-                        }
-                        else
-                        {
-                            emit anchPos(id, _ancArray[id].x, _ancArray[id].y, _ancArray[id].z, true, false);
+                            if(e.hasAttribute(QString("t%1").arg(t)))
+                            {
+                                _corrections.setCorrection(id, t, (e.attribute(QString("t%1").arg(t), "0")).toDouble(&ok));
+                            }
                         }
                     }
                 }
@@ -1201,7 +818,26 @@ void RTLSClient::loadConfigFile(QString filename)
 
     file.close();
 
+    //the anchors are shown once the corrections (which follow them in the file) are all read
+    for(int id=0; id<MAX_NUM_ANCS; id++)
+    {
+        if(_ancArray[id].id == 0xff)
+        {
+            continue;
+        }
+
+        if(id == 3) //hide anchor 4 by default
+        {
+            emit anchPos(id, _ancArray[id].x, _ancArray[id].y, _ancArray[id].z, false, false);
+        }
+        else
+        {
+            emit anchPos(id, _ancArray[id].x, _ancArray[id].y, _ancArray[id].z, true, false);
+        }
+    }
+
     addMissingAnchors();
+    emit logPolicyChanged();
 }
 
 QDomElement AnchorToNode( QDomDocument &d, anc_struct_t * anc )
@@ -1212,14 +848,6 @@ QDomElement AnchorToNode( QDomDocument &d, anc_struct_t * anc )
     cn.setAttribute("x", anc->x);
     cn.setAttribute("y", anc->y);
     cn.setAttribute("z", anc->z);
-    cn.setAttribute("t0", anc->tagRangeCorection[0]);
-    cn.setAttribute("t1", anc->tagRangeCorection[1]);
-    cn.setAttribute("t2", anc->tagRangeCorection[2]);
-    cn.setAttribute("t3", anc->tagRangeCorection[3]);
-    cn.setAttribute("t4", anc->tagRangeCorection[4]);
-    cn.setAttribute("t5", anc->tagRangeCorection[5]);
-    cn.setAttribute("t6", anc->tagRangeCorection[6]);
-    cn.setAttribute("t7", anc->tagRangeCorection[7]);
 
     return cn;
 }
@@ -1248,15 +876,89 @@ void RTLSClient::saveConfigFile(QString filename)
         i++;
     }
 
+    //only the tag - anchor pairs with a correction are saved
+    for(int row=0; row<_corrections.rows(); row++)
+    {
+        const QVector<int> &cm = _corrections.rowCorrections(row);
+        const QVector<int> &ppm = _corrections.rowScales(row);
+
+        for(int anc=0; anc<qMax(cm.size(), ppm.size()); anc++)
+        {
+            int c = (anc < cm.size()) ? cm.at(anc) : 0;
+            int p = (anc < ppm.size()) ? ppm.at(anc) : 0;
+
+            if((c != 0) || (p != 0))
+            {
+                QDomElement corr = doc.createElement( "corr" );
+                corr.setAttribute("anc", anc);
+                corr.setAttribute("tag", QString::number(_corrections.rowTag(row)));
+                corr.setAttribute("cm", c);
+                if(p != 0)
+                {
+                    corr.setAttribute("ppm", p);
+                }
+                config.appendChild(corr);
+            }
+        }
+    }
+
+    QDomElement cn = doc.createElement( "filter_cfg" );
+    cn.setAttribute("kfQ", _processor.kalmanFilter()->processNoise());
+    cn.setAttribute("kfR", _processor.kalmanFilter()->measurementNoise());
+    cn.setAttribute("kfMode", _processor.kalmanFilter()->mode());
+    cn.setAttribute("r95Interval", _processor.r95Interval());
+    cn.setAttribute("rangeGateSpeed", _processor.rangeGateSpeed());
+    cn.setAttribute("hisLength", _processor.hisLength());
+    cn.setAttribute("filterSize", _processor.filterSize());
+    cn.setAttribute("filterSizeShort", _processor.filterSizeShort());
+    cn.setAttribute("ancRangeHist", _ancRangeHist);
+    config.appendChild(cn);
+
+    QDomElement ap = doc.createElement( "autopos_cfg" );
+    ap.setAttribute("dim", _autoPosDim);
+    config.appendChild(ap);
+
+    QDomElement lc = doc.createElement( "log_cfg" );
+    lc.setAttribute("flushInterval", _log.flushInterval());
+    lc.setAttribute("format", (_logFormat == LOG_FORMAT_BINARY) ? "binary" : "text");
+    lc.setAttribute("maxSize", _log.maxSize());
+    lc.setAttribute("maxMinutes", _log.maxMinutes());
+    lc.setAttribute("keep", _log.keep());
+    lc.setAttribute("compress", _log.compress() ? 1 : 0);
+    lc.setAttribute("combineRanges", _logPolicy.combineRanges ? 1 : 0);
+    config.appendChild(lc);
+
+    QDomElement hc = doc.createElement( "history_cfg" );
+    hc.setAttribute("hours", _positions.retention());
+    hc.setAttribute("memory", _positions.maxMemory());
+    hc.setAttribute("spill", _positionsSpill);
+    config.appendChild(hc);
+
+    QDomElement sc = doc.createElement( "snapshot_cfg" );
+    sc.setAttribute("file", _snapshotFile);
+    sc.setAttribute("interval", _snapshotInterval);
+    sc.setAttribute("maxAge", _snapshotMaxAge);
+    config.appendChild(sc);
+
+    //only the policies which don't log all the records
+    for(int t=LOG_TEXT+1; t<LOG_TYPES; t++)
+    {
+        if((_logPolicy.type[t].decimate != 1) || (_logPolicy.type[t].deadband != 0))
+        {
+            QDomElement lp = doc.createElement( "log_policy" );
+            lp.setAttribute("type", log_type_name(t));
+            lp.setAttribute("decimate", _logPolicy.type[t].decimate);
+            lp.setAttribute("deadband", _logPolicy.type[t].deadband);
+            config.appendChild(lp);
+        }
+    }
+
     QTextStream ts( &file );
     ts << doc.toString();
 
     file.close();
 
-    if(_file)
-    {
-        _file->flush();
-    }
+    _log.flush();
 
     qDebug() << doc.toString();
 }
@@ -1264,8 +966,6 @@ void RTLSClient::saveConfigFile(QString filename)
 
 void RTLSClient::updateAnchorXYZ(int id, int x, double value)
 {
-    QDateTime now = QDateTime::currentDateTime();
-    QString nowstr = now.toString("T:hhmmsszzz:");
     if(x == 1)
     {
         _ancArray[id].x = value;
@@ -1279,24 +979,33 @@ void RTLSClient::updateAnchorXYZ(int id, int x, double value)
         _ancArray[id].z = value;
     }
 
-    if(_file)
-    {
-        QString s =  nowstr + QString("AP:%1:%2:%3:%4\n").arg(id).arg(_ancArray[id].x).arg(_ancArray[id].y).arg(_ancArray[id].z);
-        QTextStream ts( _file );
-        ts << s;
-    }
+    _log.anchorPos(_log.now(), id, _ancArray[id].x, _ancArray[id].y, _ancArray[id].z);
 }
 
 
-void RTLSClient::updateTagCorrection(int aid, int tid, int value)
+void RTLSClient::updateTagCorrection(int aid, quint64 tid, int value)
 {
-    tid &= 0x7;
+    _corrections.setCorrection(aid, tid, value);
+}
 
-    _ancArray[aid].tagRangeCorection[tid] = value;
+void RTLSClient::setDistanceField(QSharedPointer<DistanceField> field)
+{
+    _processor.setDistanceField(field);
 
+    emit statusBarMessage(field.isNull() ? "" : "Tracking constrained to the floor plan.");
+}
+
+int RTLSClient::tagCorrection(int anc, quint64 tid)
+{
+    return _corrections.correction(anc, tid);
+}
+
+const RangeCorrections &RTLSClient::corrections(void) const
+{
+    return _corrections;
 }
 
-int* RTLSClient::getTagCorrections(int anchID)
+double RTLSClient::tagLinkRate(quint64 tid, int anc, int window)
 {
-    return &_ancArray[anchID].tagRangeCorection[0];
+    return _processor.tagLinkRate(tid, anc, window, QDateTime::currentMSecsSinceEpoch());
 }
@@ -14,68 +14,23 @@
 #define RTLSCLIENT_H
 
 #include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
 
 #include "SerialConnection.h"
-#include "trilateration.h"
+#include "TagProcessor.h"
+#include "AnchorPositioning.h"
+#include "Snapshot.h"
 #include <stdint.h>
 
 class QFile;
 class DataAnchor;
 class DataTag;
 
-#include <armadillo>
-using namespace arma;
-
 #define PI (3.141592653589793)
 
-#define MAX_NUM_ANCS_RNG 3 //A0-A1, A0-A2, A1-A2
-#define ANC_RANGE_HIST 25
-#define HIS_LENGTH 50
-#define FILTER_SIZE 10  //NOTE: filter size needs to be > 2
-#define FILTER_SIZE_SHORT 6
-
-#define MAX_NUM_TAGS (100)
-//#define MAX_NUM_TAGS (8)
-#define MAX_NUM_ANCS (4)
-
-typedef struct
-{
-    double x_arr[HIS_LENGTH];
-    double y_arr[HIS_LENGTH];
-    double z_arr[HIS_LENGTH];
-    double av_x, av_y, av_z; //average
-    double fx, fy, fz; //filter average
-    double sqx_arr[HIS_LENGTH]; //square x
-    double sqy_arr[HIS_LENGTH];
-    double sqz_arr[HIS_LENGTH];
-    double avsq_x, avsq_y, avsq_z; //average of squares
-    double errx_arr[HIS_LENGTH]; //error x (x-av_x)
-    double erry_arr[HIS_LENGTH];
-    double errz_arr[HIS_LENGTH];
-    double averr_x, averr_y, averr_z; //avearge error
-    double variancex, variancey, variancez;
-    double std_x, std_y, std_z;
-    double r95;
-    int id;
-    int arr_idx;
-    int count;
-    int numberOfLEs;
-    int filterReady;
-    bool ready;
-    int rangeSeq;
-    int printStats;
-    int rangeCount[256];
-    int rangeValue[256][MAX_NUM_ANCS]; //(mm) each tag ranges to 4 anchors - it has a range number which is modulo 256
-    int rangeCountM[256]; // mask of successful ranges with each anchor (used to calculate missing ranges)
-} tag_reports_t;
-
-typedef struct
-{
-    double x, y, z;
-    uint64_t id;
-    QString label;
-    int tagRangeCorection[MAX_NUM_TAGS];
-} anc_struct_t;
+#define ANC_RANGE_HIST 25 //default number of anchor - anchor ranges averaged, and of range sequences between two anchor auto positionings
+#define ANC_RANGE_MAX_HIST WS_MAX_SAMPLES
 
 typedef struct
 {
@@ -83,24 +38,18 @@ typedef struct
     uint64_t id;
 } pos_report_t;
 
-typedef struct
-{
-  double x;
-  double y;
-} vec2d;
-
 class RTLSClient : public QObject
 {
     Q_OBJECT
 public:
     explicit RTLSClient(QObject *parent = 0);
 
-    int calculateTagLocation(vec3d *report, int count, int *ranges);
-    void updateTagStatistics(int i, double x, double y, double z);
-    void initialiseTagList(int id);
-    double process_ma(double *array, int idx);
-    double process_me(double *array, int idx);
-    double process_avg(int idx);
+    /**
+     * Set the window sizes: the tag position history (for the averages and R95), the long and short moving
+     * average filters (the node configuration picks one of them) and the anchor - anchor range average.
+     * The sizes are limited to the sizes supported, changing the history length restarts the tag statistics.
+     */
+    void setWindowSizes(int hisLength, int filterSize, int filterSizeShort, int ancRangeHist);
     void setGWReady(bool set);
     void setUseAutoPos(bool useAutoPos);
     QStringList getLocationFilters(void);
@@ -108,28 +57,65 @@ public:
     void saveConfigFile(QString filename);
     void loadConfigFile(QString filename);
 
-    int* getTagCorrections(int anchID);
+    int tagCorrection(int anc, quint64 tid);
+
+    /**
+     * @return the tag - anchor range corrections, the tags with a correction are its rows
+     */
+    const RangeCorrections &corrections(void) const;
+
+    /**
+     * @return the success rate (%) of the ranges between tag \a tid and anchor \a anc (or of the range reports
+     * of the tag for \a anc = -1) over the last 1, 10 or 60 s (\a window 0, 1 or 2), -1 if unknown
+     */
+    double tagLinkRate(quint64 tid, int anc, int window);
 
     void addMissingAnchors(void);
 
-    void trilaterateTag(int tid, int seq, int idx);
-    int processTagRangeReports(int tid, int *range, int lnum, int seq, int mask);
     void processAnchRangeReport(int aid, int tid, int range, int lnum, int seq);
 
-    void mds(mat twrdistance, int nNodes, int viewNode, mat* transCoord);
-    void angleRotation(mat transCoord, int nNodes, mat* estCoord);
+    void autoPositionAnchors(void);
 
     void openLogFile(QString userfilename);
     void closeLogFile(void);
     const QString &getLogFilePath();
 
+    /**
+     * Log 1 in \a decimate range reports of the records of \a type and leave out the ranges and locations
+     * which moved less than \a deadband (m) since the last one logged, see LogPolicy.h
+     */
+    void setLogPolicy(int type, int decimate, double deadband);
+    const log_policy_t &logPolicy(int type) const;
+
+    /**
+     * Log one RC record instead of the RR and RM records of each range report
+     */
+    void setCombineRanges(bool combine);
+    bool combineRanges() const;
+
+    /**
+     * @return the position history of the tags, see PositionStore.h
+     */
+    PositionStore *positions();
+
+    /**
+     * Restore the tag state of the last snapshot (if it is recent enough) and start taking snapshots,
+     * once the display is ready (see setGWReady())
+     */
+    void restoreSnapshot(void);
+
 signals:
     void anchPos(quint64 anchorId, double x, double y, double z,bool, bool);
+    void anchHealth(quint64 anchorId, int state, double rate, double bias); //state is one of AH_xxx, rate in %, bias in m
     void tagPos(quint64 tagId, double x, double y, double z);
+    void tagVel(quint64 tagId, double vx, double vy, double vz); //m/s, Kalman filter only
     void tagStats(quint64 tagId, double x, double y, double z, double r95);
     void tagRange(quint64 tagId, quint64 aId, double x);
+    void tagLink(quint64 tagId, double r1, double r10, double r60); //% of range reports received over 1, 10, 60 s
+    void ancLink(quint64 tagId, quint64 aId, double r1, double r10, double r60); //% of ranges received with the anchor
     void statusBarMessage(QString status);
     void enableAutoPositioning(int);
+    void logPolicyChanged(void);
 
     void centerOnAnchors();
     void enableFiltering(void);
@@ -140,42 +126,57 @@ protected slots:
     void onConnected(QString ver, QString conf);
 
     void updateAnchorXYZ(int id, int x, double value);
-    void updateTagCorrection(int aid, int tid, int value);
+    void updateTagCorrection(int aid, quint64 tid, int value);
+
+    void setDistanceField(QSharedPointer<DistanceField> field);
 
 private slots:
     void newData();
     void connectionStateChanged(SerialConnection::ConnectionState);
+    void saveSnapshot(void);
+    void onAboutToQuit(void);
 
 private:
     bool _graphicsWidgetReady;
     bool _first;
     bool _useAutoPos;
 
-    QList <tag_reports_t> _tagList;
+    RangeCorrections _corrections;  //tag - anchor range corrections (cm and ppm)
 
     anc_struct_t _ancArray[MAX_NUM_ANCS];
 
     int _ancRangeCount;
-    double _ancRangeArray[MAX_NUM_ANCS_RNG][ANC_RANGE_HIST]; //contains the last 50 ranges so we can calculate average
+    ap_ranges_t _ancRanges;         //average anchor - anchor ranges
+    int _autoPosDim;                //2 or 3 (also locate z)
 
     double _ancRangeValues[MAX_NUM_ANCS][MAX_NUM_ANCS];
-    double _ancRangeValuesAvg[MAX_NUM_ANCS][MAX_NUM_ANCS];
 
-    QFile *_file;
+    LogWriter _log;                 //application log, written by a thread of its own
+    int _logFormat;                 //LOG_FORMAT_TEXT or LOG_FORMAT_BINARY
+    log_policies_t _logPolicy;      //records of the range reports which are logged
     QFile *_fileDbg;
 
     QSerialPort *_serial;
     QStringList _locationFilterTypes ;
-    int _usingFilter;
     uint8_t _ancRangeLastSeq;
     uint8_t _configuration;
     QString _version;
     QString _config;
     QString _logFilePath;
 
-    int _filterSize;
-};
+    int _ancRangeHist;
+
+    PositionStore _positions;       //position history of the tags, filled by _processor
+    QString _positionsSpill;        //file the older position chunks are moved to
 
-void r95Sort(double s[], int l, int r);
+    TagProcessor _processor;        //tag range reports to locations, see TagProcessor.h
+
+    SnapshotWriter _snapshot;       //state of _processor and of the tag table, read back at startup
+    QTimer _snapshotTimer;
+    QString _snapshotFile;
+    int _snapshotInterval;          //(s) 0 for no snapshots
+    int _snapshotMaxAge;            //(min)
+    bool _restored;                 //the snapshot has been read, it can be written
+};
 
 #endif // RTLSCLIENT_H
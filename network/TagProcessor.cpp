@@ -0,0 +1,934 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: TagProcessor.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "TagProcessor.h"
+
+#include <QDataStream>
+#include <math.h>
+#include <string.h>
+
+TagProcessor::TagProcessor(const anc_struct_t *anchors, const RangeCorrections *corrections, const log_policies_t *policy,
+                           LogWriter *log, QObject *parent) :
+    QObject(parent),
+    _ancArray(anchors),
+    _corrections(corrections),
+    _logPolicy(policy),
+    _log(log),
+    _positions(NULL),
+    _time(0),
+    _usingFilter(0),
+    _emitStats(false),
+    _excludeBiased(true)
+{
+    _filterSizeLong = FILTER_SIZE;
+    _filterSizeShort = FILTER_SIZE_SHORT;
+    _longFilter = false;
+    _filterSize = _filterSizeShort ;
+    _hisLength = HIS_LENGTH;
+    _r95Interval = R95_INTERVAL;
+    _rangeGateSpeed = RANGE_GATE_SPEED;
+
+    ah_init(&_ancHealth, MAX_NUM_ANCS);
+}
+
+void TagProcessor::setWindowSizes(int hisLength, int filterSize, int filterSizeShort)
+{
+    hisLength = qBound(HIS_MIN_LENGTH, hisLength, HIS_MAX_LENGTH);
+
+    _filterSizeLong = qBound(3, filterSize, qMin(RW_CAPACITY, HIS_MIN_LENGTH));
+    _filterSizeShort = qBound(3, filterSizeShort, qMin(RW_CAPACITY, HIS_MIN_LENGTH));
+    _filterSize = _longFilter ? _filterSizeLong : _filterSizeShort; //the windows are refilled on the next position
+
+    if(hisLength != _hisLength)
+    {
+        _hisLength = hisLength;
+
+        //the history is used as a ring of _hisLength samples, start it again
+        for(int i=0; i<_tags.size(); i++)
+        {
+            tag_state_t *rp = _tags.state(i);
+
+            memset(_tags.history(i), 0, sizeof(tag_history_t));
+            memset(rp->hsum, 0, sizeof(rp->hsum));
+            rp->arr_idx = 0;
+            rp->count = 0;
+            rp->filterReady = 0;
+            rp->win[0].size = 0;
+        }
+    }
+}
+
+int TagProcessor::hisLength() const
+{
+    return _hisLength;
+}
+
+int TagProcessor::filterSize() const
+{
+    return _filterSizeLong;
+}
+
+int TagProcessor::filterSizeShort() const
+{
+    return _filterSizeShort;
+}
+
+void TagProcessor::setLongFilter(bool longFilter)
+{
+    _longFilter = longFilter;
+    _filterSize = _longFilter ? _filterSizeLong : _filterSizeShort ;
+}
+
+void TagProcessor::setR95Interval(int interval)
+{
+    _r95Interval = qMax(1, interval);
+}
+
+int TagProcessor::r95Interval() const
+{
+    return _r95Interval;
+}
+
+void TagProcessor::setRangeGateSpeed(double speed)
+{
+    _rangeGateSpeed = qMax(0.0, speed);
+}
+
+double TagProcessor::rangeGateSpeed() const
+{
+    return _rangeGateSpeed;
+}
+
+/*
+Filter Types
+0 - No Filtering
+1 - Moving Average
+2 - Moving Average excluding max and min
+3 - Particle Filter
+4 - Kalman Filter
+*/
+void TagProcessor::setLocationFilter(int filter)
+{
+    if((filter == 3) && (_usingFilter != 3))
+    {
+        _particleFilter.reset();
+    }
+
+    if((filter == 4) && (_usingFilter != 4))
+    {
+        _kalmanFilter.reset();
+    }
+
+    _usingFilter = filter ;
+}
+
+int TagProcessor::locationFilter() const
+{
+    return _usingFilter;
+}
+
+KalmanFilter *TagProcessor::kalmanFilter()
+{
+    return &_kalmanFilter;
+}
+
+void TagProcessor::setDistanceField(QSharedPointer<DistanceField> field)
+{
+    _distanceField = field;
+    _particleFilter.setDistanceField(field);
+}
+
+void TagProcessor::setEmitStats(bool emitStats)
+{
+    _emitStats = emitStats;
+}
+
+void TagProcessor::setExcludeBiased(bool exclude)
+{
+    _excludeBiased = exclude;
+}
+
+/* false if the ranges of anchor anc are left out of the filters and the solver */
+bool TagProcessor::usable(int anc) const
+{
+    return !_excludeBiased || ah_usable(&_ancHealth, anc);
+}
+
+double TagProcessor::tagLinkRate(quint64 tid, int anc, int window, qint64 time)
+{
+    int idx = _tags.find(tid);
+
+    if((idx == -1) || (anc >= MAX_NUM_ANCS) || (window < 0) || (window >= LQ_WINDOWS))
+    {
+        return -1;
+    }
+
+    return lq_rate(&_tags.state(idx)->link, window, anc, time);
+}
+
+int TagProcessor::tagCount() const
+{
+    return _tags.size();
+}
+
+QByteArray TagProcessor::saveState() const
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+
+    //the structures are saved as they are: the layout tells a snapshot of another version apart, the sizes one of
+    //another compiler or platform
+    out << (qint32) TAG_STATE_LAYOUT << (qint32) sizeof(tag_state_t) << (qint32) sizeof(anchor_health_t);
+    out << (qint32) _hisLength << (qint32) _tags.size();
+
+    for(int i=0; i<_tags.size(); i++)
+    {
+        const tag_history_t *h = _tags.history(i);
+
+        out.writeRawData((const char *) _tags.state(i), sizeof(tag_state_t));
+
+        //only the first _hisLength samples of the history are used
+        out.writeRawData((const char *) h->x_arr, _hisLength * sizeof(double));
+        out.writeRawData((const char *) h->y_arr, _hisLength * sizeof(double));
+        out.writeRawData((const char *) h->z_arr, _hisLength * sizeof(double));
+        out << h->av_x << h->av_y << h->av_z;
+    }
+
+    out.writeRawData((const char *) &_ancHealth, sizeof(anchor_health_t));
+
+    return state;
+}
+
+bool TagProcessor::restoreState(const QByteArray &state)
+{
+    QDataStream in(state);
+    qint32 layout, stateSize, healthSize, hisLength, tags;
+
+    in >> layout >> stateSize >> healthSize >> hisLength >> tags;
+
+    if((in.status() != QDataStream::Ok) || (layout != TAG_STATE_LAYOUT) || (stateSize != (qint32) sizeof(tag_state_t)) ||
+       (healthSize != (qint32) sizeof(anchor_health_t)) || (hisLength != _hisLength) || (tags < 0) || (_tags.size() > 0))
+    {
+        return false;
+    }
+
+    //check the length before adding any tag
+    qint64 length = 20 + tags * (qint64)(sizeof(tag_state_t) + (3 * _hisLength + 3) * sizeof(double)) + sizeof(anchor_health_t);
+
+    if(state.size() != length)
+    {
+        return false;
+    }
+
+    for(int i=0; i<tags; i++)
+    {
+        tag_state_t rp;
+
+        in.readRawData((char *) &rp, sizeof(tag_state_t));
+
+        int idx = _tags.add(rp.id);
+        tag_history_t *h = _tags.history(idx);
+
+        memcpy(_tags.state(idx), &rp, sizeof(tag_state_t));
+        in.readRawData((char *) h->x_arr, _hisLength * sizeof(double));
+        in.readRawData((char *) h->y_arr, _hisLength * sizeof(double));
+        in.readRawData((char *) h->z_arr, _hisLength * sizeof(double));
+        in >> h->av_x >> h->av_y >> h->av_z;
+    }
+
+    in.readRawData((char *) &_ancHealth, sizeof(anchor_health_t));
+
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        ah_anchor_t *a = &_ancHealth.anc[k];
+
+        emit anchHealth(k, a->state, a->rate, a->bias);
+    }
+
+    //the statistics are valid until the next update, the filtering is enabled as soon as one tag has a full history
+    bool filtering = false;
+
+    for(int i=0; i<_tags.size(); i++)
+    {
+        tag_state_t *rp = _tags.state(i);
+        tag_history_t *h = _tags.history(i);
+
+        if(rp->filterReady > 0)
+        {
+            vec2d centre;
+
+            filtering = true;
+            rp->r95 = calculateR95(h, &centre);
+
+            if(_emitStats)
+            {
+                emit tagStats(rp->id, centre.x, centre.y, h->av_z, rp->r95);
+            }
+        }
+    }
+
+    if(filtering)
+    {
+        emit enableFiltering();
+    }
+
+    return true;
+}
+
+void TagProcessor::setPositionStore(PositionStore *positions)
+{
+    _positions = positions;
+}
+
+void TagProcessor::processReport(qint64 time, qint64 logTime, quint64 tid, int *range, int lnum, int seq, int mask)
+{
+    _time = time;
+
+    int idx = processTagRangeReports(time, logTime, tid, range, lnum, seq, mask); //this is received when tags range to anchors
+
+    if(idx != -1)
+        trilaterateTag(time, logTime, tid, seq, idx);
+}
+
+void TagProcessor::processFilters(void)
+{
+    if(_usingFilter == 3)
+    {
+        processParticleFilter();
+    }
+    else if(_usingFilter == 4)
+    {
+        processKalmanFilter();
+    }
+}
+
+/* send a position to the display and keep it in the position history, its quality is the number of ranges of the
+   last range report of the tag */
+void TagProcessor::sendPosition(qint64 time, int idx, double x, double y, double z)
+{
+    tag_state_t *rp = _tags.state(idx);
+
+    if(_positions)
+    {
+        int quality = 0;
+
+        for(int k=0; k<MAX_NUM_ANCS; k++)
+        {
+            if(rp->rangeValue[k] > 0)
+            {
+                quality++;
+            }
+        }
+
+        _positions->append(rp->id, time, x, y, z, quality);
+    }
+
+    emit tagPos(rp->id, x, y, z);
+}
+
+//restart a moving average window from the history (of length len), ending with the sample before idx
+static void refillWindow(running_window_t *w, const double *array, int idx, int len, int size)
+{
+    rw_init(w, size);
+
+    for(int j=size-1; j>0; j--)
+    {
+        rw_push(w, array[(idx - j + len) % len]);
+    }
+}
+
+/**
+ * @brief calculate the R95 of the tag's history: the radius around the centre of the samples (leaving out the
+ *        outliers) which contains 95% of the samples
+ *        this is only done when the statistics are shown/logged, see _r95Interval
+ */
+double TagProcessor::calculateR95(tag_history_t *h, vec2d *centre)
+{
+    //R95 = SQRT(meanErrx*meanErrx + meanErry*meanErry) + 2*SQRT(stdx*stdx+stdy*stdy)
+    //rp.r95 = sqrt((rp.averr_x*rp.averr_x) + (rp.averr_y*rp.averr_y)) +
+    //        2.0 * sqrt((rp.std_x*rp.std_x) + (rp.std_y*rp.std_y)) ;
+
+    return ws_r95(h->x_arr, h->y_arr, _hisLength, h->av_x, h->av_y, &centre->x, &centre->y);
+}
+
+void TagProcessor::updateTagStatistics(qint64 logTime, int i, double x, double y, double z)
+//update the history array and the average
+{
+    tag_state_t *rp = _tags.state(i);
+    tag_history_t *h = _tags.history(i);
+    int idx = rp->arr_idx;
+    uint64_t id = rp->id;
+
+    //update the value in the array
+    rp->hsum[0] += rw_quantise(x) - rw_quantise(h->x_arr[idx]);
+    rp->hsum[1] += rw_quantise(y) - rw_quantise(h->y_arr[idx]);
+    rp->hsum[2] += rw_quantise(z) - rw_quantise(h->z_arr[idx]);
+
+    h->x_arr[idx] = x;
+    h->y_arr[idx] = y;
+    h->z_arr[idx] = z;
+
+    //the filter size depends on the configuration of the connected node
+    if(rp->win[0].size != _filterSize)
+    {
+        refillWindow(&rp->win[0], h->x_arr, idx, _hisLength, _filterSize);
+        refillWindow(&rp->win[1], h->y_arr, idx, _hisLength, _filterSize);
+        refillWindow(&rp->win[2], h->z_arr, idx, _hisLength, _filterSize);
+    }
+
+    rw_push(&rp->win[0], x);
+    rw_push(&rp->win[1], y);
+    rw_push(&rp->win[2], z);
+
+    rp->arr_idx++;
+    //wrap the index
+    if(rp->arr_idx >= _hisLength)
+    {
+        rp->arr_idx = 0;
+        if(rp->filterReady == 0)
+        {
+            rp->filterReady = 1;
+        }
+    }
+
+    rp->count++;
+
+    //the statistics are updated every _r95Interval positions once the history is full
+    rp->ready = (rp->filterReady > 0) && ((rp->count % _r95Interval) == 0);
+
+    if(rp->filterReady > 0)
+    {
+        if(_usingFilter == 2)
+        {
+            rp->fx = rw_trimmed_mean(&rp->win[0]);
+            rp->fy = rw_trimmed_mean(&rp->win[1]);
+            rp->fz = rw_trimmed_mean(&rp->win[2]);
+        }
+        else if (_usingFilter == 1)
+        {
+            rp->fx = rw_mean(&rp->win[0]);
+            rp->fy = rw_mean(&rp->win[1]);
+            rp->fz = rw_mean(&rp->win[2]);
+        }
+
+        //qDebug() << rp->fx << rp->fy << rp->fz ;
+
+        if(rp->filterReady == 1)
+        {
+            emit enableFiltering();
+            rp->filterReady++;
+        }
+    }
+
+    if(rp->ready)
+    {
+        vec2d CentrerXY;
+
+        //the averages include the new position
+        h->av_x = (rp->hsum[0] / RW_SCALE) / _hisLength;
+        h->av_y = (rp->hsum[1] / RW_SCALE) / _hisLength;
+        h->av_z = (rp->hsum[2] / RW_SCALE) / _hisLength;
+        rp->r95 = calculateR95(h, &CentrerXY);
+
+        if(_emitStats)
+        {
+            emit tagStats(id, CentrerXY.x, CentrerXY.y, h->av_z, rp->r95);
+        }
+
+        //log data to file
+        _log->tagStats(logTime, id, h->av_x, h->av_y, h->av_z, rp->r95);
+        rp->ready = false;
+    }
+}
+
+void TagProcessor::processParticleFilter(void)
+{
+    vec3d anchorArray[MAX_NUM_ANCS];
+
+    for(int i=0; i<MAX_NUM_ANCS; i++)
+    {
+        anchorArray[i].x = _ancArray[i].x;
+        anchorArray[i].y = _ancArray[i].y;
+        anchorArray[i].z = _ancArray[i].z;
+    }
+
+    _particleFilter.setAnchors(anchorArray, MAX_NUM_ANCS);
+
+    QVector<int> updated = _particleFilter.process();
+
+    for(int i=0; i<updated.size(); i++)
+    {
+        int idx = updated.at(i);
+        vec3d pos = _particleFilter.estimate(idx);
+
+        //the estimate is a weighted mean, which can fall inside a thin wall
+        if(_distanceField)
+        {
+            _distanceField->project(&pos.x, &pos.y, DF_MARGIN);
+        }
+
+        sendPosition(_time, idx, pos.x, pos.y, pos.z); //send the update to graphic
+    }
+}
+
+void TagProcessor::processKalmanFilter(void)
+{
+    vec3d anchorArray[MAX_NUM_ANCS];
+
+    for(int i=0; i<MAX_NUM_ANCS; i++)
+    {
+        anchorArray[i].x = _ancArray[i].x;
+        anchorArray[i].y = _ancArray[i].y;
+        anchorArray[i].z = _ancArray[i].z;
+    }
+
+    _kalmanFilter.setAnchors(anchorArray, MAX_NUM_ANCS);
+
+    QVector<int> updated = _kalmanFilter.process();
+
+    for(int i=0; i<updated.size(); i++)
+    {
+        int idx = updated.at(i);
+        quint64 id = _tags.state(idx)->id;
+        vec3d pos = _kalmanFilter.position(idx);
+        vec3d vel = _kalmanFilter.velocity(idx);
+
+        if(_distanceField)
+        {
+            _distanceField->project(&pos.x, &pos.y, DF_MARGIN);
+        }
+
+        sendPosition(_time, idx, pos.x, pos.y, pos.z); //send the update to graphic
+        emit tagVel(id, vel.x, vel.y, vel.z);
+    }
+}
+
+int TagProcessor::processTagRangeReports(qint64 time, qint64 logTime, quint64 tid, int *range, int lnum, int seq, int mask)
+{
+    int range_corrected = 0;
+    int idx = 0;
+    int seq_i ;
+    int tag_index = -1;
+    uint8_t seq_diff = 0;
+    int seqs = 1;
+
+    //qDebug() << "a and t " << aid << tid << "correction = " << (_ancArray[aid].tagRangeCorection[tid] * 0.01);
+
+    //find the tag in the list
+    tag_index = _tags.find(tid);
+
+    //if we don't have this tag in the list add it
+    idx = (tag_index == -1) ? _tags.add(tid) : tag_index;
+
+    tag_state_t *rp = _tags.state(idx);
+
+    seq_i =  seq & 0xFF;
+
+    if(rp->rangeSeq != -1)
+    {
+        seq_diff = (seq_i - rp->rangeSeq) & 0xFF;
+
+        rp->printStats += seq_diff;
+        seqs = qMax(1, (int) seq_diff);
+
+        //qDebug() << rp->printStats ;
+    }
+    else
+    {
+        rp->printStats = 1;
+    }
+    rp->rangeCount = 0;
+    rp->rangeSeq = seq_i;
+
+    //the records the log policies leave out are never handed to the log writer
+    lp_report(&rp->log);
+
+    bool logRanges = lp_decimate(_logPolicy, &rp->log, LOG_RR);
+    int corrected[MAX_NUM_ANCS] = {0};
+
+    //check the mask and process the tag - anchor ranges
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        if((0x1 << k) & mask) //we have a valid range
+        {
+            range_corrected = _corrections->apply(k, tid, range[k]); //range correction is in cm and ppm (range is in mm)
+            corrected[k] = range_corrected;
+
+            //log data to file
+            if(logRanges && !_logPolicy->combineRanges && lp_range(_logPolicy, &rp->log, LOG_RR, k, range_corrected))
+            {
+                _log->tagRange(LOG_RR, logTime, tid, k, range[k], range_corrected, seq, lnum);
+            }
+
+            //drop the ranges which moved faster than the tag can, they are not used for the location
+            if(!tag_range_gate(rp, k, range_corrected, time, _rangeGateSpeed))
+            {
+                if(lp_decimate(_logPolicy, &rp->log, LOG_RJ))
+                {
+                    _log->tagRange(LOG_RJ, logTime, tid, k, range_corrected, rp->gate[k].range, seq, lnum);
+                }
+
+                rp->rangeValue[k & 0x3] = 0;
+
+                emit tagRange(tid, k, -1);
+                continue;
+            }
+
+            emit tagRange(tid, k, (range_corrected * 0.001)); //convert to meters
+
+            rp->rangeCount++;
+            rp->rangeValue[k & 0x3] = range_corrected;
+        }
+        else
+        {
+            rp->rangeValue[k & 0x3] = 0;
+
+            emit tagRange(tid, k, -1); //report no/missing range
+        }
+    }
+
+    //log data to file
+    if(_logPolicy->combineRanges)
+    {
+        if(logRanges && lp_ranges(_logPolicy, &rp->log, LOG_RR, mask, corrected))
+        {
+            _log->rangeReport(logTime, tid, mask, range, corrected, seq, lnum);
+        }
+    }
+    else if(lp_decimate(_logPolicy, &rp->log, LOG_RM))
+    {
+        _log->rangeMask(logTime, tid, mask, seq, lnum);
+    }
+
+    tag_set_range_mask(rp, seq_i, mask);
+
+    //the link quality is sent to the display once a second
+    if(lq_push(&rp->link, time, seqs, mask))
+    {
+        emit tagLink(tid, lq_rate(&rp->link, 0, -1, time), lq_rate(&rp->link, 1, -1, time), lq_rate(&rp->link, 2, -1, time));
+
+        for(int k=0; k<MAX_NUM_ANCS; k++)
+        {
+            emit ancLink(tid, k, lq_rate(&rp->link, 0, k, time), lq_rate(&rp->link, 1, k, time), lq_rate(&rp->link, 2, k, time));
+        }
+    }
+
+    //anchor health, over all the tags
+    ah_count(&_ancHealth, seqs, mask);
+
+    {
+        int state[MAX_NUM_ANCS];
+
+        for(int k=0; k<MAX_NUM_ANCS; k++)
+        {
+            state[k] = _ancHealth.anc[k].state;
+        }
+
+        if(ah_update(&_ancHealth, time))
+        {
+            for(int k=0; k<MAX_NUM_ANCS; k++)
+            {
+                ah_anchor_t *h = &_ancHealth.anc[k];
+
+                //log data to file
+                if(h->state != state[k])
+                {
+                    _log->anchorHealth(logTime, k, h->state, h->rate, h->bias);
+                }
+
+                emit anchHealth(k, h->state, h->rate, h->bias);
+            }
+        }
+    }
+
+    if(rp->printStats == 256) //print every 256 ranges
+    {
+        float rates[MAX_NUM_ANCS];
+        int missing = tag_missing_count(rp);
+
+        for(int k=0; k<MAX_NUM_ANCS; k++)
+        {
+            rates[k] = tag_range_count(rp, k);
+            rates[k] *= 100.0/256;
+        }
+
+        tag_clear_range_mask(rp); //clear all masks/data
+
+        //log data to file
+        _log->rangeStats(logTime, tid, rates, missing);
+
+        //number of ranges rejected by the range gate, per anchor
+        _log->gateStats(logTime, tid, rp->rejected);
+
+        memset(rp->rejected, 0, sizeof(rp->rejected));
+
+        rp->printStats = 0;
+    }
+
+    return tag_index;
+}
+
+void TagProcessor::trilaterateTag(qint64 time, qint64 logTime, quint64 tid, int seq, int idx)
+{
+    int count = 0;
+    //bool trilaterate = false;
+    vec3d report;
+    int ranges[MAX_NUM_ANCS];
+    bool newposition = false;
+    int nolocation = 0;
+    int lastSeq = 0;
+
+    tag_state_t *rp = _tags.state(idx);
+
+    //lastSeq = (seq-1) & 0xFF ;
+    lastSeq = seq;
+    count = rp->rangeCount ;
+
+    //the filters don't get the ranges of the anchors which aren't trusted
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        ranges[k] = usable(k) ? rp->rangeValue[k] : 0;
+    }
+
+    //we got next range seq. lets try and trilaterate the previous
+    if(count >= 3)
+    {
+        //qDebug() << "try to get location" ;
+
+        if(calculateTagLocation(&report, &rp->rangeValue[0]) == TRIL_3SPHERES)
+        {
+            newposition = true;
+            rp->numberOfLEs++;
+
+            //how well each anchor agrees with the others
+            anchorResiduals(&report, &rp->rangeValue[0]);
+
+            //log data to file
+            {
+                double xyz[3] = {report.x, report.y, report.z};
+
+                if(lp_decimate(_logPolicy, &rp->log, LOG_LE) && lp_location(_logPolicy, &rp->log, xyz))
+                {
+                    _log->location(logTime, tid, rp->numberOfLEs, lastSeq, xyz, rp->rangeValue);
+                }
+            }
+
+            //qDebug() << "emit tagPos" << rp->numberOfLEs;
+
+            //move the fix out of walls/obstacles (the LE log line above keeps the solver output)
+            if(_distanceField)
+            {
+                _distanceField->project(&report.x, &report.y, DF_MARGIN);
+            }
+
+            if(_usingFilter == 0)
+            {
+                sendPosition(time, idx, report.x, report.y, report.z); //send the update to graphic
+            }
+            else if((_usingFilter == 4) && !_kalmanFilter.addReport(idx, time, &ranges[0], &report))
+            {
+                sendPosition(time, idx, report.x, report.y, report.z); //too many tags for the Kalman filter, don't filter this one
+            }
+            if(nolocation)
+            {
+                emit statusBarMessage("");
+            }
+
+            nolocation = 0;
+
+        }
+        else //no solution
+        {
+            nolocation++;
+
+            //log data to file
+            if(lp_decimate(_logPolicy, &rp->log, LOG_NL))
+            {
+                _log->location(logTime, tid, rp->numberOfLEs, lastSeq, NULL, rp->rangeValue);
+            }
+
+            if( nolocation >= 5)
+            {
+                emit statusBarMessage("No location solution.");
+            }
+        }
+
+
+        //the particle filter and the Kalman filter in range mode also use the ranges when there is no trilateration result
+        if(_usingFilter == 3)
+        {
+            _particleFilter.addReport(idx, time, &ranges[0], newposition ? &report : NULL);
+        }
+        else if((_usingFilter == 4) && !newposition)
+        {
+            _kalmanFilter.addReport(idx, time, &ranges[0], NULL);
+        }
+    }
+    //clear the count
+    rp->rangeCount = 0;
+
+    //update statistics if new position has been calculated
+    if(newposition)
+    {
+        updateTagStatistics(logTime, idx, report.x, report.y, report.z);
+
+        if((_usingFilter == 1) || (_usingFilter == 2))
+        {
+            double fx = rp->fx, fy = rp->fy;
+
+            //the average of positions either side of a wall can be inside it
+            if(_distanceField)
+            {
+                _distanceField->project(&fx, &fy, DF_MARGIN);
+            }
+
+            sendPosition(time, idx, fx, fy, rp->fz); //send the update to graphic
+        }
+    }
+
+    //qDebug() << "newposition" << newposition << idx << lastSeq << seq;
+}
+
+/**
+ * @fn    calculateTagLocation
+ * @brief  solve the location from the ranges (mm, 0 if missing) of the anchors
+ *
+ *         GetLocation() trilaterates with the first 3 anchors and uses the 4th one to pick one of the two
+ *         solutions. The anchors with a range are passed in the order of their IDs, so the same anchors
+ *         always solve the location. A biased anchor (see _ancHealth) is only used as the 4th one.
+ * */
+int TagProcessor::calculateTagLocation(vec3d *report, int *ranges)
+{
+    int n = 0;
+    int excluded = -1;
+    vec3d anchorArray[MAX_NUM_ANCS];
+    int rangeArray[MAX_NUM_ANCS];
+
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        if(ranges[k] > 0)
+        {
+            if(usable(k))
+            {
+                anchorArray[n].x = _ancArray[k].x;
+                anchorArray[n].y = _ancArray[k].y;
+                anchorArray[n].z = _ancArray[k].z;
+                rangeArray[n++] = ranges[k];
+            }
+            else
+            {
+                excluded = k;
+            }
+        }
+    }
+
+    if(n < 3)
+    {
+        return -1;
+    }
+
+    if((n == 3) && (excluded != -1))
+    {
+        anchorArray[n].x = _ancArray[excluded].x;
+        anchorArray[n].y = _ancArray[excluded].y;
+        anchorArray[n].z = _ancArray[excluded].z;
+        rangeArray[n++] = ranges[excluded];
+    }
+
+    if(n == 3)
+    {
+        rangeArray[3] = 0; //not used
+    }
+
+    return GetLocation(report, ((n == 4) ? 1 : 0), &anchorArray[0], rangeArray);
+}
+
+/**
+ * @fn    anchorResiduals
+ * @brief  add the leave-one-out residuals of the anchors of location report to _ancHealth
+ *
+ *         The residual of an anchor is its range (m) minus the distance to the location solved from the
+ *         ranges of the other 3 anchors, so it needs the ranges of all 4. Anchors 0 to 2 solved report, so
+ *         the residual of anchor 3 is the only one measured. To first order, the ranges move the location along
+ *         the unit vectors u of the anchors, and the residuals of the others are that one scaled by the
+ *         weights w (sum of w[k] u[k] = 0): residual[k] = residual[3] w[3] / w[k]. An anchor with a small weight
+ *         has little of the others to check it against and gets no residual. The location of a biased anchor
+ *         is already solved without it, and the residuals of the others would include its bias, so only it
+ *         gets one then.
+ * */
+void TagProcessor::anchorResiduals(const vec3d *report, const int *ranges)
+{
+    double u[MAX_NUM_ANCS][3];
+    double w[MAX_NUM_ANCS];
+    double residual = 0, norm = 0;
+    int biased = -1;
+
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        double d;
+
+        if(ranges[k] <= 0)
+        {
+            return;
+        }
+
+        if(!usable(k))
+        {
+            biased = k;
+        }
+
+        u[k][0] = report->x - _ancArray[k].x;
+        u[k][1] = report->y - _ancArray[k].y;
+        u[k][2] = report->z - _ancArray[k].z;
+        d = sqrt(u[k][0]*u[k][0] + u[k][1]*u[k][1] + u[k][2]*u[k][2]);
+
+        if(d == 0)
+        {
+            return;
+        }
+
+        u[k][0] /= d;
+        u[k][1] /= d;
+        u[k][2] /= d;
+
+        if(k == ((biased != -1) ? biased : (MAX_NUM_ANCS - 1)))
+        {
+            residual = (ranges[k] / 1000.0) - d;
+        }
+    }
+
+    if(biased != -1)
+    {
+        ah_residual(&_ancHealth, biased, residual);
+        return;
+    }
+
+    //w[k] = (-1)^k det(u without row k)
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        const double *a = u[(k == 0) ? 1 : 0];
+        const double *b = u[(k <= 1) ? 2 : 1];
+        const double *c = u[(k <= 2) ? 3 : 2];
+        double det = a[0] * (b[1]*c[2] - b[2]*c[1]) - a[1] * (b[0]*c[2] - b[2]*c[0]) + a[2] * (b[0]*c[1] - b[1]*c[0]);
+
+        w[k] = (k & 1) ? -det : det;
+        norm += w[k] * w[k];
+    }
+
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        if((w[k] * w[k]) > (AH_MIN_WEIGHT * norm))
+        {
+            ah_residual(&_ancHealth, k, residual * w[MAX_NUM_ANCS - 1] / w[k]);
+        }
+    }
+}
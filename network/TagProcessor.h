@@ -0,0 +1,204 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: TagProcessor.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef TAGPROCESSOR_H
+#define TAGPROCESSOR_H
+
+#include <QObject>
+#include <QSharedPointer>
+
+#include "trilateration.h"
+#include "DistanceField.h"
+#include "ParticleFilter.h"
+#include "KalmanFilter.h"
+#include "TagStore.h"
+#include "PositionStore.h"
+#include "RangeCorrections.h"
+#include "AnchorHealth.h"
+#include "LogWriter.h"
+#include "LogPolicy.h"
+#include <stdint.h>
+
+#define FILTER_SIZE 10  //NOTE: filter size needs to be > 2
+#define FILTER_SIZE_SHORT 6
+#define HIS_MIN_LENGTH 20
+#define R95_INTERVAL 10 //default number of positions between two updates of the tag statistics (R95)
+#define RANGE_GATE_SPEED 5.0 //(m/s) default maximum tag speed, ranges which change faster are rejected (0 to disable)
+
+//layout of the tag state and anchor health saved by saveState(), add one when tag_state_t, tag_history_t,
+//anchor_health_t or a structure in them changes (a field, its type or its meaning), even if the size stays the same
+#define TAG_STATE_LAYOUT (1)
+
+#define MAX_NUM_ANCS (4) //the tag range report has ranges to anchors 0 to 3 only
+
+typedef struct
+{
+    double x, y, z;
+    uint64_t id;
+    QString label;
+} anc_struct_t;
+
+typedef struct
+{
+  double x;
+  double y;
+} vec2d;
+
+/**
+ * The TagProcessor class turns the tag range reports into locations: range corrections, range gate, link
+ * quality and anchor health, trilateration, the location filters and the tag statistics, and logs the records
+ * of each step.
+ *
+ * It only uses QtCore (and the filters), so the same processing runs in the application, where RTLSClient
+ * hands it the reports as they are received, and in rtlstool reprocess, where it is given the reports of a log.
+ * The times are passed in with each report: the current time in the application, the time of the log record
+ * when a log is processed again.
+ *
+ * The anchors, range corrections and log policies are read through the pointers given, they belong to the
+ * caller.
+ */
+class TagProcessor : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * The processing reads the MAX_NUM_ANCS \a anchors, the range \a corrections and the log \a policy given and
+     * writes the records to \a log, which must all outlive it.
+     */
+    TagProcessor(const anc_struct_t *anchors, const RangeCorrections *corrections, const log_policies_t *policy,
+                 LogWriter *log, QObject *parent = 0);
+
+    /**
+     * Set the window sizes: the tag position history (for the averages and R95) and the long and short moving
+     * average filters (the node configuration picks one of them, see setLongFilter()). The sizes are limited
+     * to the sizes supported, changing the history length restarts the tag statistics.
+     */
+    void setWindowSizes(int hisLength, int filterSize, int filterSizeShort);
+    int hisLength() const;
+    int filterSize() const;
+    int filterSizeShort() const;
+    void setLongFilter(bool longFilter);
+
+    void setR95Interval(int interval);
+    int r95Interval() const;
+    void setRangeGateSpeed(double speed);
+    double rangeGateSpeed() const;
+
+    /**
+     * 0 none, 1 moving average, 2 moving average without the min and max, 3 particle filter, 4 Kalman filter
+     */
+    void setLocationFilter(int filter);
+    int locationFilter() const;
+    KalmanFilter *kalmanFilter();
+
+    void setDistanceField(QSharedPointer<DistanceField> field);
+
+    /**
+     * tagStats() is only emitted once this is set (when the display is ready)
+     */
+    void setEmitStats(bool emitStats);
+
+    /**
+     * Leave the anchors the anchor health finds biased out of the filters and the solver (the default). When not,
+     * their states are still updated and reported.
+     */
+    void setExcludeBiased(bool exclude);
+
+    /**
+     * Keep the positions sent with tagPos() in \a positions (NULL for none), which must outlive the processing
+     */
+    void setPositionStore(PositionStore *positions);
+
+    /**
+     * Process a range report, received at \a time (ms since 1970-01-01 UTC, for the range gate, link quality,
+     * anchor health and filters), logged at \a logTime (us local time, see LogWriter::now())
+     */
+    void processReport(qint64 time, qint64 logTime, quint64 tid, int *range, int lnum, int seq, int mask);
+
+    /**
+     * Update the particle or Kalman filter with the reports since the last call, once per block of reports
+     */
+    void processFilters(void);
+
+    /**
+     * @return the success rate (%) of the ranges between tag \a tid and anchor \a anc (or of the range reports
+     * of the tag for \a anc = -1) over the last 1, 10 or 60 s (\a window 0, 1 or 2) at \a time, -1 if unknown
+     */
+    double tagLinkRate(quint64 tid, int anc, int window, qint64 time);
+
+    int tagCount() const;
+
+    /**
+     * @return the state of the tags (filter windows, position history, link quality, range gate...) and of the
+     * anchor health, for restoreState(). The particle and Kalman filters are not in it, they start again.
+     */
+    QByteArray saveState() const;
+
+    /**
+     * Restore the state saved by saveState(), before the first range report. The anchor health and the statistics
+     * of the tags with a full history are emitted again.
+     * @return false if it was saved with another TAG_STATE_LAYOUT, structure sizes or history length (nothing is
+     * restored)
+     */
+    bool restoreState(const QByteArray &state);
+
+    int processTagRangeReports(qint64 time, qint64 logTime, quint64 tid, int *range, int lnum, int seq, int mask);
+    void trilaterateTag(qint64 time, qint64 logTime, quint64 tid, int seq, int idx);
+    int calculateTagLocation(vec3d *report, int *ranges);
+    void anchorResiduals(const vec3d *report, const int *ranges);
+    void updateTagStatistics(qint64 logTime, int i, double x, double y, double z);
+    double calculateR95(tag_history_t *h, vec2d *centre);
+    void processParticleFilter(void);
+    void processKalmanFilter(void);
+
+signals:
+    void anchHealth(quint64 anchorId, int state, double rate, double bias); //state is one of AH_xxx, rate in %, bias in m
+    void tagPos(quint64 tagId, double x, double y, double z);
+    void tagVel(quint64 tagId, double vx, double vy, double vz); //m/s, Kalman filter only
+    void tagStats(quint64 tagId, double x, double y, double z, double r95);
+    void tagRange(quint64 tagId, quint64 aId, double x);
+    void tagLink(quint64 tagId, double r1, double r10, double r60); //% of range reports received over 1, 10, 60 s
+    void ancLink(quint64 tagId, quint64 aId, double r1, double r10, double r60); //% of ranges received with the anchor
+    void statusBarMessage(QString status);
+    void enableFiltering(void);
+
+private:
+    void sendPosition(qint64 time, int idx, double x, double y, double z);
+    bool usable(int anc) const;
+
+    const anc_struct_t *_ancArray;
+    const RangeCorrections *_corrections;
+    const log_policies_t *_logPolicy;
+    LogWriter *_log;
+    PositionStore *_positions;
+    qint64 _time;                   //(ms) of the last report, the time of the positions of the particle and Kalman filters
+
+    TagStore _tags;
+    anchor_health_t _ancHealth;
+
+    int _usingFilter;
+    int _filterSize;                //the one in use, _filterSizeLong or _filterSizeShort
+    int _filterSizeLong;
+    int _filterSizeShort;
+    bool _longFilter;               //set by the node configuration
+    int _hisLength;
+    int _r95Interval;
+    double _rangeGateSpeed;
+    bool _emitStats;
+    bool _excludeBiased;
+
+    QSharedPointer<DistanceField> _distanceField; //walkable area of the floorplan, NULL if positions are not constrained
+    ParticleFilter _particleFilter;
+    KalmanFilter _kalmanFilter;
+};
+
+#endif // TAGPROCESSOR_H
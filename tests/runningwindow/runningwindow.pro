@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Check of the running window filters against brute force averages
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TARGET = tst_runningwindow
+TEMPLATE = app
+
+INCLUDEPATH += ../../util
+
+SOURCES += tst_runningwindow.cpp \
+    ../../util/RunningWindow.cpp
+
+HEADERS  += \
+    ../../util/RunningWindow.h
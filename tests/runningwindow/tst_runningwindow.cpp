@@ -0,0 +1,146 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: tst_runningwindow.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "RunningWindow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TST_SAMPLES     (20000)     //samples per window size
+#define TST_MAX_ERROR   (1e-6)      //(m) largest difference from the averages of the unrounded samples (0.5 um rounding)
+
+/* uniform in [-1, 1) */
+static double tst_random(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+
+    return ((*seed >> 8) & 0xffffff) / (double) 0x800000 - 1.0;
+}
+
+/* mean of the last size samples before n (and the mean without the smallest and largest one in trimmed), summed
+   again from the quantised samples */
+static double tst_mean(const qint64 *q, int n, int size, double *trimmed)
+{
+    int count = qMin(n, size);
+    qint64 sum = 0, min = q[n - 1], max = q[n - 1];
+
+    for(int i=n-count; i<n; i++)
+    {
+        sum += q[i];
+        min = qMin(min, q[i]);
+        max = qMax(max, q[i]);
+    }
+
+    *trimmed = (count < 3) ? ((sum / RW_SCALE) / count) : (((sum - min - max) / RW_SCALE) / (count - 2));
+
+    return (sum / RW_SCALE) / count;
+}
+
+/* the same as the filters before the running window, with the unrounded samples */
+static double tst_double_mean(const double *x, int n, int size, double *trimmed)
+{
+    int count = qMin(n, size);
+    double sum = 0, min = x[n - 1], max = x[n - 1];
+
+    for(int i=n-count; i<n; i++)
+    {
+        sum += x[i];
+        min = qMin(min, x[i]);
+        max = qMax(max, x[i]);
+    }
+
+    *trimmed = (count < 3) ? (sum / count) : ((sum - min - max) / (count - 2));
+
+    return sum / count;
+}
+
+int main()
+{
+    static double x[TST_SAMPLES];
+    static qint64 q[TST_SAMPLES];
+    unsigned int seed = 1;
+    int failures = 0;
+    double worst = 0;
+
+    //a tag walking around with a few cm of noise, with steps and repeated values so the min/max queues see ties
+    x[0] = 0;
+    for(int i=1; i<TST_SAMPLES; i++)
+    {
+        double r = tst_random(&seed);
+
+        x[i] = x[i - 1] + 0.01 * tst_random(&seed) + ((r > 0.99) ? 50.0 * r : 0);
+
+        if(r < -0.9)
+        {
+            x[i] = x[i - 1];
+        }
+    }
+
+    for(int i=0; i<TST_SAMPLES; i++)
+    {
+        q[i] = rw_quantise(x[i]);
+    }
+
+    for(int size=1; size<=RW_CAPACITY; size++)
+    {
+        running_window_t w;
+        int bad = 0;
+
+        rw_init(&w, size);
+
+        for(int n=1; n<=TST_SAMPLES; n++)
+        {
+            double trimmed, dtrimmed;
+
+            rw_push(&w, x[n - 1]);
+
+            double mean = tst_mean(q, n, size, &trimmed);
+            double dmean = tst_double_mean(x, n, size, &dtrimmed);
+
+            //the running sums must give the same bits as summing the window again
+            if((rw_mean(&w) != mean) || ((size >= 3) && (rw_trimmed_mean(&w) != trimmed)))
+            {
+                if(bad++ == 0)
+                {
+                    printf("size %d sample %d: mean %.9f %.9f trimmed %.9f %.9f\n", size, n, rw_mean(&w), mean,
+                           rw_trimmed_mean(&w), trimmed);
+                }
+            }
+
+            //and stay within the rounding of the samples of the averages of the unrounded ones
+            worst = qMax(worst, fabs(mean - dmean));
+            if(size >= 3)
+            {
+                worst = qMax(worst, fabs(trimmed - dtrimmed));
+            }
+        }
+
+        if(bad)
+        {
+            printf("size %d: %d samples differ\n", size, bad);
+            failures++;
+        }
+    }
+
+    printf("largest difference from the unrounded averages: %.3g m\n", worst);
+
+    if(worst > TST_MAX_ERROR)
+    {
+        printf("larger than %g m\n", TST_MAX_ERROR);
+        failures++;
+    }
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+
+    return failures ? 1 : 0;
+}
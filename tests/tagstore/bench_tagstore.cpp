@@ -0,0 +1,209 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: bench_tagstore.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "TagProcessor.h"
+
+#include <QList>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define BENCH_REPORTS   (200)       //range reports per tag
+#define BENCH_LINE      (64)        //(bytes) cache line
+
+/**
+ * The tag state before TagStore, which was copied out of a QList and written back three times per range report
+ * (processTagRangeReports(), trilaterateTag() and updateTagStatistics())
+ */
+typedef struct
+{
+    double x_arr[50];
+    double y_arr[50];
+    double z_arr[50];
+    double av_x, av_y, av_z;
+    double fx, fy, fz;
+    double sqx_arr[50];
+    double sqy_arr[50];
+    double sqz_arr[50];
+    double avsq_x, avsq_y, avsq_z;
+    double errx_arr[50];
+    double erry_arr[50];
+    double errz_arr[50];
+    double averr_x, averr_y, averr_z;
+    double variancex, variancey, variancez;
+    double std_x, std_y, std_z;
+    double r95;
+    int id;
+    int arr_idx;
+    int count;
+    int numberOfLEs;
+    int filterReady;
+    bool ready;
+    int rangeSeq;
+    int printStats;
+    int rangeCount[256];
+    int rangeValue[256][4];
+    int rangeCountM[256];
+} bench_tag_reports_t;
+
+/* ranges (mm) of tag t at report i, walking around between the 4 anchors of a 10 m x 10 m square at 3 m */
+static void bench_ranges(int t, int i, int *range)
+{
+    double ax[4] = {0, 10, 0, 10}, ay[4] = {0, 0, 10, 10};
+    double x = 5 + 3 * cos(0.01 * i + t), y = 5 + 3 * sin(0.013 * i + 2 * t);
+
+    for(int k=0; k<4; k++)
+    {
+        range[k] = (int) (1000 * sqrt((x - ax[k]) * (x - ax[k]) + (y - ay[k]) * (y - ay[k]) + 4.0));
+    }
+}
+
+/* number of cache lines which differ between the states a and b (of saveState()) from offset to offset + size */
+static int bench_lines(const QByteArray &a, const QByteArray &b, int offset, int size)
+{
+    int lines = 0;
+
+    for(int o=offset; o<offset+size; o+=BENCH_LINE)
+    {
+        int n = qMin(BENCH_LINE, offset + size - o);
+
+        if(memcmp(a.constData() + o, b.constData() + o, n) != 0)
+        {
+            lines++;
+        }
+    }
+
+    return lines;
+}
+
+/* time per range report (ns) of copying the old tag state out of the list and back three times */
+static double bench_copies(int tags)
+{
+    QList<bench_tag_reports_t> list;
+    bench_tag_reports_t r;
+    QElapsedTimer timer;
+    qint64 sum = 0;
+
+    memset(&r, 0, sizeof(r));
+    for(int t=0; t<tags; t++)
+    {
+        list.append(r);
+    }
+
+    timer.start();
+
+    for(int i=0; i<BENCH_REPORTS; i++)
+    {
+        for(int t=0; t<tags; t++)
+        {
+            for(int k=0; k<3; k++)
+            {
+                bench_tag_reports_t rp = list.at(t);
+
+                rp.rangeSeq = i & 0xff;
+                rp.count++;
+                list.replace(t, rp);
+            }
+        }
+    }
+
+    for(int t=0; t<tags; t++)
+    {
+        sum += list.at(t).count;
+    }
+
+    return (sum == (qint64) tags * BENCH_REPORTS * 3) ? (timer.nsecsElapsed() / ((double) tags * BENCH_REPORTS)) : -1;
+}
+
+int main()
+{
+    anc_struct_t anchors[MAX_NUM_ANCS];
+    double ax[4] = {0, 10, 0, 10}, ay[4] = {0, 0, 10, 10};
+    RangeCorrections corrections;
+    log_policies_t policy;
+    LogWriter log;
+    int tagCounts[3] = {10, 100, 1000};
+
+    for(int k=0; k<MAX_NUM_ANCS; k++)
+    {
+        anchors[k].id = k;
+        anchors[k].x = ax[k];
+        anchors[k].y = ay[k];
+        anchors[k].z = 3.0;
+    }
+
+    lp_init(&policy);
+
+    printf("tag state: %d bytes per tag (tag_state_t %d, tag_history_t %d), was %d (tag_reports_t)\n",
+           (int) (sizeof(tag_state_t) + sizeof(tag_history_t)), (int) sizeof(tag_state_t), (int) sizeof(tag_history_t),
+           (int) sizeof(bench_tag_reports_t));
+    printf("copied per range report before: %d bytes (3 copies out of the list and 3 back)\n",
+           (int) (6 * sizeof(bench_tag_reports_t)));
+
+    //cache lines of the tag state written by one range report, from the state before and after it
+    {
+        TagProcessor p(anchors, &corrections, &policy, &log);
+        int range[4];
+        int record = sizeof(tag_state_t) + 3 * HIS_LENGTH * sizeof(double) + 3 * sizeof(double);
+        qint64 lines = 0, history = 0;
+
+        p.setLocationFilter(1);
+
+        for(int i=0; i<BENCH_REPORTS; i++)
+        {
+            QByteArray before = p.saveState();
+
+            bench_ranges(0, i, range);
+            p.processReport(1000000 + i * 100LL, i * 100000LL, 0, range, 0, i & 0xff, 0xf);
+
+            QByteArray after = p.saveState();
+
+            //the first report adds the tag, the state starts after the 5 qint32 of the header
+            if((i > 0) && (before.size() == after.size()))
+            {
+                lines += bench_lines(before, after, 20, sizeof(tag_state_t));
+                history += bench_lines(before, after, 20 + sizeof(tag_state_t), record - sizeof(tag_state_t));
+            }
+        }
+
+        printf("written per range report: %.1f cache lines of tag_state_t, %.1f of the history (%d byte lines)\n",
+               lines / (double) (BENCH_REPORTS - 1), history / (double) (BENCH_REPORTS - 1), BENCH_LINE);
+    }
+
+    for(int c=0; c<3; c++)
+    {
+        TagProcessor p(anchors, &corrections, &policy, &log);
+        QElapsedTimer timer;
+        int tags = tagCounts[c];
+        int range[4];
+
+        p.setLocationFilter(1);
+        timer.start();
+
+        for(int i=0; i<BENCH_REPORTS; i++)
+        {
+            for(int t=0; t<tags; t++)
+            {
+                bench_ranges(t, i, range);
+                p.processReport(1000000 + i * 100LL, i * 100000LL, t, range, 0, i & 0xff, 0xf);
+            }
+        }
+
+        double ns = timer.nsecsElapsed() / ((double) tags * BENCH_REPORTS);
+
+        printf("%4d tags: %.0f ns per range report processed, %.0f ns per report for the copies of the old tag state\n",
+               tags, ns, bench_copies(tags));
+    }
+
+    return 0;
+}
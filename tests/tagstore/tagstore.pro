@@ -0,0 +1,56 @@
+#-------------------------------------------------
+#
+# Benchmark of the tag state: bytes written and time per range report
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+QT       -= widgets
+
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+LIBS += -lz
+
+TARGET = bench_tagstore
+TEMPLATE = app
+
+INCLUDEPATH += ../../models ../../network ../../util ../../tools
+
+SOURCES += bench_tagstore.cpp \
+    ../../network/TagProcessor.cpp \
+    ../../models/RangeCorrections.cpp \
+    ../../models/TagStore.cpp \
+    ../../models/PositionStore.cpp \
+    ../../models/PositionIndex.cpp \
+    ../../models/AnchorHealth.cpp \
+    ../../models/DistanceField.cpp \
+    ../../util/IdMap.cpp \
+    ../../util/LogRecord.cpp \
+    ../../util/LogWriter.cpp \
+    ../../util/LogPolicy.cpp \
+    ../../util/RunningWindow.cpp \
+    ../../util/LinkQuality.cpp \
+    ../../util/WindowStats.cpp \
+    ../../tools/trilateration.cpp \
+    ../../tools/ParticleFilter.cpp \
+    ../../tools/KalmanFilter.cpp
+
+HEADERS  += \
+    ../../network/TagProcessor.h \
+    ../../models/RangeCorrections.h \
+    ../../models/TagStore.h \
+    ../../models/PositionStore.h \
+    ../../models/PositionIndex.h \
+    ../../models/AnchorHealth.h \
+    ../../models/DistanceField.h \
+    ../../util/IdMap.h \
+    ../../util/LogRecord.h \
+    ../../util/LogWriter.h \
+    ../../util/LogPolicy.h \
+    ../../util/RunningWindow.h \
+    ../../util/LinkQuality.h \
+    ../../util/WindowStats.h \
+    ../../tools/trilateration.h \
+    ../../tools/ParticleFilter.h \
+    ../../tools/KalmanFilter.h
@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# Checks and benchmarks of the processing, each one a console program
+# which returns 0 when it passes
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += runningwindow \
+    tagstore
@@ -0,0 +1,313 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorPositioning.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "AnchorPositioning.h"
+
+#include <string.h>
+#include <math.h>
+
+#define AP_JACOBI_SWEEPS    (50)
+#define AP_MIN_LENGTH       (1e-6)  //(m) shorter vectors can't give a direction
+
+void ap_init(ap_ranges_t *a)
+{
+    memset(a, 0, sizeof(ap_ranges_t));
+}
+
+void ap_add(ap_ranges_t *a, int i, int j, double r, int len)
+{
+    if((i == j) || (i < 0) || (j < 0) || (i >= AP_MAX_ANCS) || (j >= AP_MAX_ANCS))
+    {
+        return;
+    }
+
+    ap_range_t *p = (i < j) ? &a->r[i][j] : &a->r[j][i];
+
+    if(p->n == 0)
+    {
+        p->est = r;
+        p->dev = 0;
+    }
+    else
+    {
+        //average the first len ranges, then 2/(len+1) is the weight of an exponential average over about len ranges
+        double w = (p->n < len) ? (1.0 / (p->n + 1)) : (2.0 / (len + 1));
+        double lim = 3 * ((p->dev > AP_MIN_DEV) ? p->dev : AP_MIN_DEV);
+        double e = r - p->est;
+        double ae = fabs(e);
+
+        if(ae > lim)
+        {
+            e = (e > 0) ? lim : -lim;
+            ae = lim;
+        }
+
+        p->est += w * e;
+        p->dev += w * (ae - p->dev);
+    }
+
+    p->n++;
+}
+
+double ap_range(const ap_ranges_t *a, int i, int j)
+{
+    if((i == j) || (i < 0) || (j < 0) || (i >= AP_MAX_ANCS) || (j >= AP_MAX_ANCS))
+    {
+        return 0;
+    }
+
+    const ap_range_t *p = (i < j) ? &a->r[i][j] : &a->r[j][i];
+
+    return (p->n > 0) ? p->est : 0;
+}
+
+int ap_anchors(const ap_ranges_t *a, int n, int *idx)
+{
+    int count = 0;
+
+    for(int k=0; (k<n) && (k<AP_MAX_ANCS); k++)
+    {
+        bool all = true;
+
+        for(int i=0; i<count; i++)
+        {
+            all = all && (a->r[idx[i]][k].n > 0);
+        }
+
+        if(all)
+        {
+            idx[count++] = k;
+        }
+    }
+
+    return count;
+}
+
+/* eigenvalues w and eigenvectors (columns of v) of the symmetric matrix a (destroyed), cyclic Jacobi method */
+static void jacobi(double a[AP_MAX_LOCATE][AP_MAX_LOCATE], int n, double *w, double v[AP_MAX_LOCATE][AP_MAX_LOCATE])
+{
+    for(int i=0; i<n; i++)
+    {
+        for(int j=0; j<n; j++)
+        {
+            v[i][j] = (i == j) ? 1 : 0;
+        }
+    }
+
+    for(int sweep=0; sweep<AP_JACOBI_SWEEPS; sweep++)
+    {
+        double off = 0, diag = 0;
+
+        for(int p=0; p<n; p++)
+        {
+            diag += a[p][p] * a[p][p];
+
+            for(int q=p+1; q<n; q++)
+            {
+                off += a[p][q] * a[p][q];
+            }
+        }
+
+        if(off <= (1e-24 * diag))
+        {
+            break;
+        }
+
+        for(int p=0; p<n; p++)
+        {
+            for(int q=p+1; q<n; q++)
+            {
+                if(a[p][q] == 0)
+                {
+                    continue;
+                }
+
+                //rotate in the p, q plane so that a[p][q] becomes 0
+                double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                double t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1));
+                double c = 1 / sqrt(t*t + 1);
+                double s = t * c;
+
+                for(int k=0; k<n; k++)
+                {
+                    double akp = a[k][p], akq = a[k][q];
+
+                    a[k][p] = c*akp - s*akq;
+                    a[k][q] = s*akp + c*akq;
+                }
+
+                for(int k=0; k<n; k++)
+                {
+                    double apk = a[p][k], aqk = a[q][k];
+
+                    a[p][k] = c*apk - s*aqk;
+                    a[q][k] = s*apk + c*aqk;
+                }
+
+                for(int k=0; k<n; k++)
+                {
+                    double vkp = v[k][p], vkq = v[k][q];
+
+                    v[k][p] = c*vkp - s*vkq;
+                    v[k][q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        w[i] = a[i][i];
+    }
+}
+
+static double dot3(const double *a, const double *b)
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+bool ap_locate(const double *d, int n, int dim, double *xyz)
+{
+    double b[AP_MAX_LOCATE][AP_MAX_LOCATE];
+    double v[AP_MAX_LOCATE][AP_MAX_LOCATE];
+    double w[AP_MAX_LOCATE];
+    double rowMean[AP_MAX_LOCATE];
+    double x[AP_MAX_LOCATE][3];
+    double mean = 0;
+    int order[3] = {0, 0, 0};
+    bool used[AP_MAX_LOCATE];
+
+    if((n > AP_MAX_LOCATE) || (dim < 2) || (dim > 3) || (n < (dim + 1)))
+    {
+        return false;
+    }
+
+    //double centred squared distances: B = -1/2 J D^2 J, J = I - 1/n
+    for(int i=0; i<n; i++)
+    {
+        rowMean[i] = 0;
+
+        for(int j=0; j<n; j++)
+        {
+            rowMean[i] += d[i*n + j] * d[i*n + j] / n;
+        }
+
+        mean += rowMean[i] / n;
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        for(int j=0; j<n; j++)
+        {
+            b[i][j] = -0.5 * (d[i*n + j] * d[i*n + j] - rowMean[i] - rowMean[j] + mean);
+        }
+    }
+
+    jacobi(b, n, w, v);
+
+    //the coordinates are the eigenvectors of the dim largest eigenvalues, scaled by their square root
+    memset(used, 0, sizeof(used));
+
+    for(int k=0; k<dim; k++)
+    {
+        int best = -1;
+
+        for(int i=0; i<n; i++)
+        {
+            if(!used[i] && ((best == -1) || (w[i] > w[best])))
+            {
+                best = i;
+            }
+        }
+
+        used[best] = true;
+        order[k] = best;
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        for(int k=0; k<3; k++)
+        {
+            x[i][k] = ((k < dim) && (w[order[k]] > 0)) ? v[i][order[k]] * sqrt(w[order[k]]) : 0;
+        }
+    }
+
+    //anchor 0 at the origin, anchor 1 on the x axis, anchor 2 in the x, y plane (Gram-Schmidt)
+    double e1[3], e2[3], e3[3];
+    double o[3] = {x[0][0], x[0][1], x[0][2]};
+
+    for(int i=0; i<n; i++)
+    {
+        for(int k=0; k<3; k++)
+        {
+            x[i][k] -= o[k];
+        }
+    }
+
+    double l1 = sqrt(dot3(x[1], x[1]));
+
+    if(l1 < AP_MIN_LENGTH)
+    {
+        return false;
+    }
+
+    for(int k=0; k<3; k++)
+    {
+        e1[k] = x[1][k] / l1;
+    }
+
+    double p = dot3(x[2], e1);
+
+    for(int k=0; k<3; k++)
+    {
+        e2[k] = x[2][k] - p * e1[k];
+    }
+
+    double l2 = sqrt(dot3(e2, e2));
+
+    if(l2 < AP_MIN_LENGTH)
+    {
+        return false; //in a line
+    }
+
+    for(int k=0; k<3; k++)
+    {
+        e2[k] /= l2;
+    }
+
+    e3[0] = e1[1]*e2[2] - e1[2]*e2[1];
+    e3[1] = e1[2]*e2[0] - e1[0]*e2[2];
+    e3[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+    double zsign = 1;
+
+    if(dim == 3)
+    {
+        double z3 = dot3(x[3], e3);
+
+        if(fabs(z3) < AP_MIN_LENGTH)
+        {
+            return false; //in a plane
+        }
+
+        zsign = (z3 < 0) ? -1 : 1;
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        xyz[i*3 + 0] = dot3(x[i], e1);
+        xyz[i*3 + 1] = dot3(x[i], e2);
+        xyz[i*3 + 2] = (dim == 3) ? zsign * dot3(x[i], e3) : 0;
+    }
+
+    return true;
+}
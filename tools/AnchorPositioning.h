@@ -0,0 +1,61 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: AnchorPositioning.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef ANCHORPOSITIONING_H
+#define ANCHORPOSITIONING_H
+
+#define AP_MAX_ANCS         (4)     //anchors with ranges, the anchor range reports only have A0 - A1, A0 - A2 and A1 - A2
+#define AP_MAX_LOCATE       (4)     //largest number of anchors located with the fixed size matrices (MAX_NUM_ANCS)
+#define AP_MIN_DEV          (0.02)  //(m) smallest range deviation used to reject outliers
+
+/*
+ * Anchor auto positioning from the anchor - anchor ranges.
+ *
+ * The ranges of each pair of anchors are averaged as they arrive: the first len ranges are averaged, after
+ * that it is an exponential average over about len ranges. Ranges further than 3 deviations from the average
+ * only move it by 3 deviations, so a few outliers don't shift the anchors.
+ *
+ * The anchors are located by classical multidimensional scaling. The matrices are fixed size arrays on the
+ * stack and the eigenvectors are found with the Jacobi method, which is fast and accurate for these sizes.
+ */
+
+typedef struct
+{
+    double est;             //(m) average range
+    double dev;             //(m) mean deviation
+    int n;                  //number of ranges
+} ap_range_t;
+
+typedef struct
+{
+    ap_range_t r[AP_MAX_ANCS][AP_MAX_ANCS]; //r[i][j] with i < j
+} ap_ranges_t;
+
+void ap_init(ap_ranges_t *a);
+
+/* add range r (m) between anchors i and j, averaged over about len ranges */
+void ap_add(ap_ranges_t *a, int i, int j, double r, int len);
+
+/* average range (m) between anchors i and j, 0 if there were no ranges */
+double ap_range(const ap_ranges_t *a, int i, int j);
+
+/* anchors (of the first n) which have ranges with all the anchors before them, returns how many are in idx */
+int ap_anchors(const ap_ranges_t *a, int n, int *idx);
+
+/*
+ * Locate n anchors (n <= AP_MAX_LOCATE) from the distances d (n x n, row major) in dim (2 or 3) dimensions.
+ * The coordinates (n x 3, row major, z is 0 in 2D) have anchor 0 at the origin, anchor 1 on the +x axis,
+ * anchor 2 at y > 0 and, in 3D, anchor 3 at z >= 0. Returns false if the anchors are in a line (or a plane in 3D).
+ */
+bool ap_locate(const double *d, int n, int dim, double *xyz);
+
+#endif // ANCHORPOSITIONING_H
@@ -0,0 +1,363 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: KalmanFilter.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "KalmanFilter.h"
+
+#include <math.h>
+#include <string.h>
+
+KalmanFilter::KalmanFilter() :
+    _numAnchors(0),
+    _mode(KF_MODE_POSITION),
+    _q(KF_DEFAULT_Q),
+    _r2(KF_DEFAULT_R * KF_DEFAULT_R)
+{
+    _bank = new kf_bank_t;
+
+    reset();
+}
+
+KalmanFilter::~KalmanFilter()
+{
+    delete _bank;
+}
+
+void KalmanFilter::reset()
+{
+    memset(_bank, 0, sizeof(kf_bank_t));
+    _numTags = 0;
+
+    for(int i=0; i<KF_MAX_TAGS; i++)
+    {
+        _initialised[i] = false;
+        _pending[i] = false;
+        _hasFix[i] = false;
+        _time[i] = 0;
+        _reportTime[i] = 0;
+    }
+}
+
+void KalmanFilter::setMode(int mode)
+{
+    if(mode != _mode)
+    {
+        _mode = mode;
+        reset(); //the two modes don't use the same covariance
+    }
+}
+
+int KalmanFilter::mode() const
+{
+    return _mode;
+}
+
+void KalmanFilter::setNoise(double q, double r)
+{
+    _q = q;
+    _r2 = r * r;
+}
+
+double KalmanFilter::processNoise() const
+{
+    return _q;
+}
+
+double KalmanFilter::measurementNoise() const
+{
+    return sqrt(_r2);
+}
+
+void KalmanFilter::setAnchors(const vec3d *anchors, int n)
+{
+    _numAnchors = qMin(n, KF_MAX_ANCS);
+
+    for(int i=0; i<_numAnchors; i++)
+    {
+        _anchors[i] = anchors[i];
+    }
+}
+
+vec3d KalmanFilter::position(int idx) const
+{
+    vec3d p;
+
+    p.x = _bank->x[idx];
+    p.y = _bank->y[idx];
+    p.z = _bank->z[idx];
+
+    return p;
+}
+
+vec3d KalmanFilter::velocity(int idx) const
+{
+    vec3d v;
+
+    v.x = _bank->vx[idx];
+    v.y = _bank->vy[idx];
+    v.z = _bank->vz[idx];
+
+    return v;
+}
+
+bool KalmanFilter::addReport(int idx, qint64 time, const int *ranges, const vec3d *fix)
+{
+    kf_bank_t *b = _bank;
+
+    if(idx >= KF_MAX_TAGS)
+    {
+        return false;
+    }
+
+    _numTags = qMax(_numTags, idx + 1);
+
+    //only the last report of a tag is used if there is more than one in a tick
+    _reportTime[idx] = time;
+    _hasFix[idx] = (fix != NULL);
+    if(fix)
+    {
+        _fix[idx] = *fix;
+    }
+
+    if(_mode == KF_MODE_POSITION)
+    {
+        if(fix == NULL)
+        {
+            return true;
+        }
+
+        b->mx[idx] = fix->x;
+        b->my[idx] = fix->y;
+        b->mz[idx] = fix->z;
+        b->mw[idx] = 1;
+    }
+    else
+    {
+        for(int k=0; k<KF_MAX_ANCS; k++)
+        {
+            b->range[k][idx] = (ranges[k] > 0) ? (ranges[k] * 0.001f) : 0;
+            b->rw[k][idx] = (ranges[k] > 0) ? 1 : 0;
+        }
+    }
+
+    _pending[idx] = true;
+
+    return true;
+}
+
+QVector<int> KalmanFilter::process()
+{
+    kf_bank_t *b = _bank;
+    QVector<int> updated;
+    int n = (_numTags + 3) & ~3;
+
+    for(int i=0; i<_numTags; i++)
+    {
+        b->dt[i] = 0;
+
+        if(!_pending[i])
+        {
+            continue;
+        }
+
+        _pending[i] = false;
+
+        //new tags, and tags which haven't been seen for a while, start again from their fix
+        if(!_initialised[i] || ((_reportTime[i] - _time[i]) > KF_LOST_TIME))
+        {
+            b->mw[i] = 0;
+            for(int k=0; k<KF_MAX_ANCS; k++)
+            {
+                b->rw[k][i] = 0;
+            }
+
+            if(_hasFix[i])
+            {
+                initialise(i, _fix[i]);
+                _time[i] = _reportTime[i];
+                updated.append(i);
+            }
+            continue;
+        }
+
+        //in range mode only x and y are estimated
+        if((_mode == KF_MODE_RANGE) && _hasFix[i])
+        {
+            b->z[i] = _fix[i].z;
+        }
+
+        b->dt[i] = qBound(0.0f, (_reportTime[i] - _time[i]) * 0.001f, 1.0f);
+        _time[i] = _reportTime[i];
+        updated.append(i);
+    }
+
+    //all the tags go through the same loops, the ones without a measurement have dt = 0 and a weight of 0
+    predict(n);
+
+    if(_mode == KF_MODE_RANGE)
+    {
+        updateRange(n);
+    }
+    else
+    {
+        updatePosition(n);
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        b->mw[i] = 0;
+    }
+
+    for(int k=0; k<KF_MAX_ANCS; k++)
+    {
+        for(int i=0; i<n; i++)
+        {
+            b->rw[k][i] = 0;
+        }
+    }
+
+    return updated;
+}
+
+void KalmanFilter::initialise(int i, const vec3d &fix)
+{
+    kf_bank_t *b = _bank;
+
+    b->x[i] = fix.x;
+    b->y[i] = fix.y;
+    b->z[i] = fix.z;
+    b->vx[i] = b->vy[i] = b->vz[i] = 0;
+
+    b->pxx[i] = b->pyy[i] = KF_INIT_POS_VAR;
+    b->pvxvx[i] = b->pvyvy[i] = KF_INIT_VEL_VAR;
+    b->pxy[i] = b->pxvx[i] = b->pxvy[i] = 0;
+    b->pyvx[i] = b->pyvy[i] = b->pvxvy[i] = 0;
+
+    _initialised[i] = true;
+}
+
+/* x' = F x, P' = F P F^T + Q with F = [I dt*I; 0 I] and Q the white noise acceleration model */
+void KalmanFilter::predict(int n)
+{
+    kf_bank_t *b = _bank;
+    const float q = _q;
+
+    for(int i=0; i<n; i++)
+    {
+        float dt = b->dt[i];
+        float dt2 = dt * dt;
+        float q1 = q * dt;
+        float q2 = q * dt2 * 0.5f;
+        float q3 = q * dt2 * dt * (1.0f / 3.0f);
+
+        float pxvx = b->pxvx[i], pxvy = b->pxvy[i];
+        float pyvx = b->pyvx[i], pyvy = b->pyvy[i];
+        float pvxvx = b->pvxvx[i], pvxvy = b->pvxvy[i], pvyvy = b->pvyvy[i];
+
+        b->x[i] += dt * b->vx[i];
+        b->y[i] += dt * b->vy[i];
+        b->z[i] += dt * b->vz[i];
+
+        b->pxx[i] += 2.0f * dt * pxvx + dt2 * pvxvx + q3;
+        b->pxy[i] += dt * (pxvy + pyvx) + dt2 * pvxvy;
+        b->pxvx[i] = pxvx + dt * pvxvx + q2;
+        b->pxvy[i] = pxvy + dt * pvxvy;
+        b->pyy[i] += 2.0f * dt * pyvy + dt2 * pvyvy + q3;
+        b->pyvx[i] = pyvx + dt * pvxvy;
+        b->pyvy[i] = pyvy + dt * pvyvy + q2;
+        b->pvxvx[i] = pvxvx + q1;
+        b->pvyvy[i] = pvyvy + q1;
+    }
+}
+
+/* position mode: the axes are independent and share the covariance pxx, pxvx, pvxvx */
+void KalmanFilter::updatePosition(int n)
+{
+    kf_bank_t *b = _bank;
+    const float r2 = _r2;
+
+    for(int i=0; i<n; i++)
+    {
+        float pxx = b->pxx[i], pxvx = b->pxvx[i];
+        float s = b->mw[i] / (pxx + r2);
+        float k0 = pxx * s;
+        float k1 = pxvx * s;
+        float ex = b->mx[i] - b->x[i];
+        float ey = b->my[i] - b->y[i];
+        float ez = b->mz[i] - b->z[i];
+
+        b->x[i] += k0 * ex;
+        b->y[i] += k0 * ey;
+        b->z[i] += k0 * ez;
+        b->vx[i] += k1 * ex;
+        b->vy[i] += k1 * ey;
+        b->vz[i] += k1 * ez;
+
+        b->pxx[i] = (1.0f - k0) * pxx;
+        b->pxvx[i] = (1.0f - k0) * pxvx;
+        b->pvxvx[i] -= k1 * pxvx;
+    }
+}
+
+/* range mode: one scalar EKF update per anchor, the range is linearised around the predicted position */
+void KalmanFilter::updateRange(int n)
+{
+    kf_bank_t *b = _bank;
+    const float r2 = _r2;
+
+    for(int a=0; a<_numAnchors; a++)
+    {
+        const float ax = _anchors[a].x;
+        const float ay = _anchors[a].y;
+        const float az = _anchors[a].z;
+        const float *range = b->range[a];
+        const float *rw = b->rw[a];
+
+        for(int i=0; i<n; i++)
+        {
+            float dx = b->x[i] - ax;
+            float dy = b->y[i] - ay;
+            float dz = b->z[i] - az;
+            float rp = sqrtf(dx*dx + dy*dy + dz*dz);
+
+            rp = (rp > 0.001f) ? rp : 0.001f;
+
+            float hx = dx / rp;
+            float hy = dy / rp;
+
+            //u = P h^T
+            float ua = b->pxx[i] * hx + b->pxy[i] * hy;
+            float ub = b->pxy[i] * hx + b->pyy[i] * hy;
+            float uc = b->pxvx[i] * hx + b->pyvx[i] * hy;
+            float ud = b->pxvy[i] * hx + b->pyvy[i] * hy;
+
+            float g = rw[i] / (hx * ua + hy * ub + r2);
+            float e = (range[i] - rp) * g;
+
+            b->x[i] += ua * e;
+            b->y[i] += ub * e;
+            b->vx[i] += uc * e;
+            b->vy[i] += ud * e;
+
+            //P -= u u^T / S
+            b->pxx[i] -= g * ua * ua;
+            b->pxy[i] -= g * ua * ub;
+            b->pxvx[i] -= g * ua * uc;
+            b->pxvy[i] -= g * ua * ud;
+            b->pyy[i] -= g * ub * ub;
+            b->pyvx[i] -= g * ub * uc;
+            b->pyvy[i] -= g * ub * ud;
+            b->pvxvx[i] -= g * uc * uc;
+            b->pvxvy[i] -= g * uc * ud;
+            b->pvyvy[i] -= g * ud * ud;
+        }
+    }
+}
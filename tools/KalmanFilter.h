@@ -0,0 +1,118 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: KalmanFilter.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef KALMANFILTER_H
+#define KALMANFILTER_H
+
+#include <QVector>
+
+#include "trilateration.h"
+
+#define KF_MAX_TAGS             (4096)      //tags above this are not filtered
+#define KF_MAX_ANCS             (4)
+
+#define KF_MODE_POSITION        (0)         //the measurements are the trilateration results
+#define KF_MODE_RANGE           (1)         //the measurements are the anchor ranges (extended Kalman filter)
+
+#define KF_DEFAULT_Q            (1.0)       //process noise, spectral density of the acceleration (m^2/s^3)
+#define KF_DEFAULT_R            (0.1)       //standard deviation (m) of the positions or ranges
+#define KF_INIT_POS_VAR         (0.25f)     //initial variance (m^2) of the position...
+#define KF_INIT_VEL_VAR         (1.0f)      //...and of the velocity (m^2/s^2)
+#define KF_LOST_TIME            (5000)      //ms without updates after which the tag is initialised again
+
+/**
+ * Constant velocity filter state of all the tags. Each variable is an array indexed by the tag, so the
+ * predict/update loops run over contiguous memory and can be vectorised by the compiler.
+ *
+ * In position mode the three axes are independent and have the same covariance, which is stored in
+ * pxx (position), pxvx (position/velocity) and pvxvx (velocity).
+ * In range mode the state is x, y, vx, vy with a full 4x4 covariance, z is taken from the last fix.
+ */
+typedef struct
+{
+    float x[KF_MAX_TAGS], y[KF_MAX_TAGS], z[KF_MAX_TAGS];
+    float vx[KF_MAX_TAGS], vy[KF_MAX_TAGS], vz[KF_MAX_TAGS];
+
+    float pxx[KF_MAX_TAGS], pxy[KF_MAX_TAGS], pxvx[KF_MAX_TAGS], pxvy[KF_MAX_TAGS];
+    float pyy[KF_MAX_TAGS], pyvx[KF_MAX_TAGS], pyvy[KF_MAX_TAGS];
+    float pvxvx[KF_MAX_TAGS], pvxvy[KF_MAX_TAGS], pvyvy[KF_MAX_TAGS];
+
+    //measurements of the current tick, a weight of 0 means no measurement
+    float dt[KF_MAX_TAGS];
+    float mx[KF_MAX_TAGS], my[KF_MAX_TAGS], mz[KF_MAX_TAGS], mw[KF_MAX_TAGS];
+    float range[KF_MAX_ANCS][KF_MAX_TAGS], rw[KF_MAX_ANCS][KF_MAX_TAGS];
+} kf_bank_t;
+
+/**
+ * The KalmanFilter class filters the positions of all the tags with a constant velocity model.
+ *
+ * Reports are queued with addReport() while the serial data is parsed, process() then runs one predict/update
+ * for all the tags at once. Unlike the moving average filters the estimate does not lag behind the tag,
+ * and the velocity is estimated as well.
+ */
+class KalmanFilter
+{
+public:
+    KalmanFilter();
+    ~KalmanFilter();
+
+    void reset();
+
+    void setMode(int mode);
+    int mode() const;
+    void setNoise(double q, double r);
+    double processNoise() const;
+    double measurementNoise() const;
+
+    void setAnchors(const vec3d *anchors, int n);
+
+    /**
+     * Queue a report of tag \a idx, \a ranges are in mm, 0 if missing.
+     * \a fix is the trilateration result or NULL if there isn't one.
+     * @return false if the tag can't be filtered (too many tags)
+     */
+    bool addReport(int idx, qint64 time, const int *ranges, const vec3d *fix);
+
+    /**
+     * Run one predict/update for all the queued reports.
+     * @return the indices of the tags which have a new estimate
+     */
+    QVector<int> process();
+
+    vec3d position(int idx) const;
+    vec3d velocity(int idx) const;
+
+private:
+    void initialise(int i, const vec3d &fix);
+    void predict(int n);
+    void updatePosition(int n);
+    void updateRange(int n);
+
+    kf_bank_t *_bank;
+    int _numTags;                   //tags in use, the loops run over this rounded up to a multiple of 4
+
+    bool _initialised[KF_MAX_TAGS];
+    bool _pending[KF_MAX_TAGS];
+    qint64 _time[KF_MAX_TAGS];      //time (ms) of the last update
+    qint64 _reportTime[KF_MAX_TAGS];
+    vec3d _fix[KF_MAX_TAGS];
+    bool _hasFix[KF_MAX_TAGS];
+
+    vec3d _anchors[KF_MAX_ANCS];
+    int _numAnchors;
+
+    int _mode;
+    float _q;
+    float _r2;
+};
+
+#endif // KALMANFILTER_H
@@ -0,0 +1,469 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: ParticleFilter.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "ParticleFilter.h"
+
+#include <QtConcurrent>
+#include <math.h>
+#include <string.h>
+
+#define PF_TWO_PI (6.283185307179586f)
+
+/* xorshift32, each tag has its own state so the tags can be processed in parallel */
+static inline quint32 pf_rand(quint32 *s)
+{
+    quint32 x = *s;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+
+    return x;
+}
+
+/* uniform in [0, 1) */
+static inline float pf_uniform(quint32 *s)
+{
+    return (pf_rand(s) >> 8) * (1.0f / 16777216.0f);
+}
+
+/* standard normal (Box-Muller) */
+static inline float pf_gauss(quint32 *s)
+{
+    float u1 = pf_uniform(s) + (1.0f / 16777216.0f);
+    float u2 = pf_uniform(s);
+
+    return sqrtf(-2.0f * logf(u1)) * cosf(PF_TWO_PI * u2);
+}
+
+/**
+ * Functor processing the reports of one tag, used by QtConcurrent::blockingMap()
+ */
+struct ProcessTag
+{
+    ProcessTag(ParticleFilter *filter) : _filter(filter) {}
+
+    void operator()(const int &idx) const
+    {
+        _filter->processTag(idx);
+    }
+
+    ParticleFilter *_filter;
+};
+
+ParticleFilter::ParticleFilter() :
+    _numAnchors(0),
+    _particles(PF_DEFAULT_PARTICLES),
+    _busy(0)
+{
+}
+
+ParticleFilter::~ParticleFilter()
+{
+    qDeleteAll(_tags);
+}
+
+void ParticleFilter::reset()
+{
+    for(int i=0; i<_tags.size(); i++)
+    {
+        _tags[i]->initialised = false;
+        _tags[i]->updated = false;
+        _tags[i]->numPending = 0;
+    }
+
+    _pendingTags.clear();
+}
+
+void ParticleFilter::setAnchors(const vec3d *anchors, int n)
+{
+    _numAnchors = qMin(n, PF_MAX_ANCS);
+
+    for(int i=0; i<_numAnchors; i++)
+    {
+        _anchors[i] = anchors[i];
+    }
+}
+
+void ParticleFilter::setDistanceField(QSharedPointer<DistanceField> field)
+{
+    _field = field;
+}
+
+int ParticleFilter::particleCount() const
+{
+    return _particles;
+}
+
+vec3d ParticleFilter::estimate(int idx) const
+{
+    return _tags.at(idx)->estimate;
+}
+
+void ParticleFilter::addReport(int idx, qint64 time, const int *ranges, const vec3d *fix)
+{
+    while(_tags.size() <= idx)
+    {
+        pf_tag_t *t = new pf_tag_t;
+
+        memset(t, 0, sizeof(pf_tag_t));
+        t->seed = 0x9E3779B9u ^ ((quint32)(_tags.size() + 1) * 2654435761u);
+
+        _tags.append(t);
+    }
+
+    pf_tag_t *t = _tags.at(idx);
+
+    if(t->numPending == 0)
+    {
+        _pendingTags.append(idx);
+    }
+    else if(t->numPending == PF_MAX_PENDING) //drop the oldest report
+    {
+        memmove(&t->pending[0], &t->pending[1], (PF_MAX_PENDING - 1) * sizeof(pf_report_t));
+        t->numPending--;
+    }
+
+    pf_report_t *r = &t->pending[t->numPending++];
+
+    r->time = time;
+    for(int k=0; k<PF_MAX_ANCS; k++)
+    {
+        r->range[k] = (ranges[k] > 0) ? (ranges[k] * 0.001f) : 0;
+    }
+
+    r->hasFix = (fix != NULL);
+    if(fix)
+    {
+        r->fix = *fix;
+    }
+}
+
+QVector<int> ParticleFilter::process()
+{
+    QElapsedTimer timer;
+    QVector<int> tags = _pendingTags;
+    QVector<int> updated;
+
+    timer.start();
+
+    if(!_loadTimer.isValid())
+    {
+        _loadTimer.start();
+    }
+
+    _pendingTags.clear();
+
+    if(tags.size() == 1)
+    {
+        processTag(tags.at(0));
+    }
+    else if(tags.size() > 1)
+    {
+        QtConcurrent::blockingMap(tags, ProcessTag(this));
+    }
+
+    for(int i=0; i<tags.size(); i++)
+    {
+        pf_tag_t *t = _tags.at(tags.at(i));
+
+        if(t->updated)
+        {
+            updated.append(tags.at(i));
+            t->updated = false;
+        }
+    }
+
+    adaptParticleCount(timer.nsecsElapsed());
+
+    return updated;
+}
+
+void ParticleFilter::adaptParticleCount(qint64 busy)
+{
+    qint64 elapsed;
+
+    _busy += busy;
+    elapsed = _loadTimer.elapsed();
+
+    if(elapsed < PF_LOAD_WINDOW)
+    {
+        return;
+    }
+
+    double load = (double)_busy / (elapsed * 1000000.0);
+
+    if(load > PF_LOAD_HIGH)
+    {
+        _particles = qMax(PF_MIN_PARTICLES, (_particles * 4) / 5);
+    }
+    else if(load < PF_LOAD_LOW)
+    {
+        _particles = qMin(PF_MAX_PARTICLES, (_particles * 11) / 10 + 1);
+    }
+
+    _busy = 0;
+    _loadTimer.restart();
+}
+
+void ParticleFilter::processTag(int idx)
+{
+    pf_tag_t *t = _tags.at(idx);
+
+    for(int i=0; i<t->numPending; i++)
+    {
+        const pf_report_t *r = &t->pending[i];
+
+        if(r->hasFix)
+        {
+            t->z = r->fix.z;
+        }
+
+        if(!t->initialised || ((r->time - t->time) > PF_LOST_TIME))
+        {
+            if(r->hasFix)
+            {
+                initialise(t, r->fix);
+                t->time = r->time;
+            }
+            continue;
+        }
+
+        float dt = qBound(0.01f, (r->time - t->time) * 0.001f, 1.0f);
+
+        predict(t, dt);
+
+        float error = update(t, r->range);
+
+        //none of the particles agree with the ranges, start again from the trilateration result
+        if((error > PF_LOST_ERROR) && r->hasFix)
+        {
+            initialise(t, r->fix);
+        }
+        else
+        {
+            updateEstimate(t);
+
+            //resample when the weights have degenerated, or to apply a new particle count
+            float sum2 = 0;
+            for(int j=0; j<t->n; j++)
+            {
+                sum2 += t->w[j] * t->w[j];
+            }
+
+            if(((1.0f / sum2) < (t->n / 2)) || (t->n != _particles))
+            {
+                resample(t, _particles);
+            }
+        }
+
+        t->time = r->time;
+    }
+
+    t->numPending = 0;
+}
+
+void ParticleFilter::initialise(pf_tag_t *t, const vec3d &fix)
+{
+    t->n = _particles;
+
+    for(int i=0; i<t->n; i++)
+    {
+        float x = fix.x, y = fix.y;
+
+        //don't start particles inside walls
+        for(int tries=0; tries<10; tries++)
+        {
+            float px = fix.x + PF_INIT_SPREAD * pf_gauss(&t->seed);
+            float py = fix.y + PF_INIT_SPREAD * pf_gauss(&t->seed);
+
+            if(!_field || (_field->distance(px, py) >= 0))
+            {
+                x = px;
+                y = py;
+                break;
+            }
+        }
+
+        t->x[i] = x;
+        t->y[i] = y;
+        t->w[i] = 1.0f / t->n;
+    }
+
+    t->z = fix.z;
+    t->initialised = true;
+    t->estimate = fix;
+    t->updated = true;
+}
+
+void ParticleFilter::predict(pf_tag_t *t, float dt)
+{
+    const int n = t->n;
+    float s = PF_PROCESS_NOISE * sqrtf(dt);
+
+    //the random moves come one after the other from the generator of the tag, so they are drawn in a loop of their own
+    for(int i=0; i<n; i++)
+    {
+        t->tx[i] = s * pf_gauss(&t->seed);
+        t->ty[i] = s * pf_gauss(&t->seed);
+    }
+
+    if(!_field)
+    {
+        //the compiler can vectorise this one
+        for(int i=0; i<n; i++)
+        {
+            t->x[i] += t->tx[i];
+            t->y[i] += t->ty[i];
+        }
+
+        return;
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        float x = t->x[i] + t->tx[i];
+        float y = t->y[i] + t->ty[i];
+
+        //particles can't go through walls
+        if(_field->crosses(t->x[i], t->y[i], x, y))
+        {
+            continue;
+        }
+
+        t->x[i] = x;
+        t->y[i] = y;
+    }
+}
+
+float ParticleFilter::update(pf_tag_t *t, const float *ranges)
+{
+    const int n = t->n;
+    const float *x = t->x;
+    const float *y = t->y;
+    float *ll = t->tx;
+    float *w = t->w;
+    const float k = -0.5f / (PF_RANGE_SIGMA * PF_RANGE_SIGMA);
+    float best, sum = 0;
+    int used = 0;
+
+    for(int i=0; i<n; i++)
+    {
+        ll[i] = 0;
+    }
+
+    //log likelihood of each particle, one anchor at a time so the inner loop runs over contiguous particle arrays
+    for(int a=0; a<_numAnchors; a++)
+    {
+        if(ranges[a] <= 0)
+        {
+            continue;
+        }
+
+        const float ax = _anchors[a].x;
+        const float ay = _anchors[a].y;
+        const float dz = t->z - _anchors[a].z;
+        const float dz2 = dz * dz;
+        const float r = ranges[a];
+        const float c2 = PF_RANGE_CLAMP * PF_RANGE_CLAMP;
+
+        //the clamp is a select and sqrtf an instruction (-fno-math-errno), so the compiler can vectorise it
+        for(int i=0; i<n; i++)
+        {
+            float dx = x[i] - ax;
+            float dy = y[i] - ay;
+            float e = sqrtf(dx*dx + dy*dy + dz2) - r;
+            float e2 = e * e;
+
+            ll[i] += k * ((e2 < c2) ? e2 : c2);
+        }
+
+        used++;
+    }
+
+    if(used == 0)
+    {
+        return 0;
+    }
+
+    best = ll[0];
+    for(int i=1; i<n; i++)
+    {
+        best = fmaxf(best, ll[i]);
+    }
+
+    //expf is a library call, this loop is only vectorised where the compiler has a vector expf (e.g. glibc libmvec
+    //with -ffast-math), the normalisation below is
+    for(int i=0; i<n; i++)
+    {
+        w[i] *= expf(ll[i] - best);
+        sum += w[i];
+    }
+
+    for(int i=0; i<n; i++)
+    {
+        w[i] /= sum;
+    }
+
+    //RMS range error of the best particle
+    return sqrtf(best / (k * used));
+}
+
+void ParticleFilter::updateEstimate(pf_tag_t *t)
+{
+    float x = 0, y = 0;
+
+    for(int i=0; i<t->n; i++)
+    {
+        x += t->w[i] * t->x[i];
+        y += t->w[i] * t->y[i];
+    }
+
+    t->estimate.x = x;
+    t->estimate.y = y;
+    t->estimate.z = t->z;
+    t->updated = true;
+}
+
+void ParticleFilter::resample(pf_tag_t *t, int count)
+{
+    float step = 1.0f / count;
+    float u = pf_uniform(&t->seed) * step;
+    float c = t->w[0];
+    int j = 0;
+
+    //systematic resampling: one random offset, then evenly spaced picks through the cumulative weights
+    for(int i=0; i<count; i++)
+    {
+        float target = u + i * step;
+
+        while((target > c) && (j < (t->n - 1)))
+        {
+            j++;
+            c += t->w[j];
+        }
+
+        t->tx[i] = t->x[j];
+        t->ty[i] = t->y[j];
+    }
+
+    memcpy(t->x, t->tx, count * sizeof(float));
+    memcpy(t->y, t->ty, count * sizeof(float));
+
+    for(int i=0; i<count; i++)
+    {
+        t->w[i] = step;
+    }
+
+    t->n = count;
+}
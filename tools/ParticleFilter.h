@@ -0,0 +1,134 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: ParticleFilter.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef PARTICLEFILTER_H
+#define PARTICLEFILTER_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+#include "trilateration.h"
+#include "DistanceField.h"
+
+#define PF_MAX_ANCS             (4)
+#define PF_MAX_PARTICLES        (1000)
+#define PF_MIN_PARTICLES        (100)
+#define PF_DEFAULT_PARTICLES    (500)
+#define PF_MAX_PENDING          (8)         //range reports kept per tag between two process() calls
+
+#define PF_INIT_SPREAD          (0.5f)      //standard deviation (m) of the particles around the first fix
+#define PF_PROCESS_NOISE        (1.0f)      //standard deviation (m/s) of the random walk
+#define PF_RANGE_SIGMA          (0.15f)     //standard deviation (m) of the ranges
+#define PF_RANGE_CLAMP          (1.0f)      //range errors above this (m) count the same (NLOS, reflections)
+#define PF_LOST_ERROR           (0.75f)     //RMS range error (m) of the best particle above which the tag is lost
+#define PF_LOST_TIME            (5000)      //ms without reports after which the tag is initialised again
+
+#define PF_LOAD_HIGH            (0.5)       //fraction of the time spent in process() above which particles are removed...
+#define PF_LOAD_LOW             (0.2)       //...and below which particles are added
+#define PF_LOAD_WINDOW          (1000)      //ms over which the load is measured
+
+/**
+ * One range report waiting to be processed
+ */
+typedef struct
+{
+    qint64 time;                    //ms
+    float range[PF_MAX_ANCS];       //m, 0 if missing
+    vec3d fix;                      //trilateration result, only valid if hasFix
+    bool hasFix;
+} pf_report_t;
+
+/**
+ * Particle filter state of one tag. The particles are stored as separate arrays (structure of arrays)
+ * so that the likelihood and normalisation loops, and the move of the particles without a floorplan, can be
+ * vectorised by the compiler.
+ */
+typedef struct
+{
+    float x[PF_MAX_PARTICLES];
+    float y[PF_MAX_PARTICLES];
+    float w[PF_MAX_PARTICLES];      //normalised weights
+    float tx[PF_MAX_PARTICLES];     //work buffers (log likelihood, resampled particles)
+    float ty[PF_MAX_PARTICLES];
+    int n;                          //number of particles in use
+    float z;                        //tag height (m), from the last fix
+    quint32 seed;                   //random number generator state
+    bool initialised;
+    qint64 time;                    //time of the last update (ms)
+    vec3d estimate;
+    bool updated;
+
+    pf_report_t pending[PF_MAX_PENDING];
+    int numPending;
+} pf_tag_t;
+
+/**
+ * The ParticleFilter class tracks tags directly from their anchor ranges.
+ *
+ * Each tag has its own set of particles. Reports are queued with addReport() while the serial data is parsed, and
+ * process() then updates all the tags which have new reports in parallel. Particles which would go through a wall
+ * of the floorplan (if a distance field is set) stay where they are.
+ *
+ * The number of particles per tag adapts to the time process() takes, so the filter uses fewer particles when there
+ * are many tags and a slow CPU.
+ */
+class ParticleFilter
+{
+public:
+    ParticleFilter();
+    ~ParticleFilter();
+
+    void reset();
+
+    void setAnchors(const vec3d *anchors, int n);
+    void setDistanceField(QSharedPointer<DistanceField> field);
+
+    /**
+     * Queue a range report of tag \a idx, \a ranges are in mm, 0 if missing.
+     * \a fix is the trilateration result or NULL if there isn't one.
+     */
+    void addReport(int idx, qint64 time, const int *ranges, const vec3d *fix);
+
+    /**
+     * Process all the queued reports.
+     * @return the indices of the tags which have a new estimate
+     */
+    QVector<int> process();
+
+    vec3d estimate(int idx) const;
+
+    int particleCount() const;
+
+    void processTag(int idx);
+
+private:
+    void initialise(pf_tag_t *t, const vec3d &fix);
+    void predict(pf_tag_t *t, float dt);
+    float update(pf_tag_t *t, const float *ranges);
+    void resample(pf_tag_t *t, int count);
+    void adaptParticleCount(qint64 busy);
+    void updateEstimate(pf_tag_t *t);
+
+    QVector<pf_tag_t *> _tags;
+    QVector<int> _pendingTags;
+
+    vec3d _anchors[PF_MAX_ANCS];
+    int _numAnchors;
+    QSharedPointer<DistanceField> _field;
+
+    int _particles;                 //number of particles per tag
+    QElapsedTimer _loadTimer;
+    qint64 _busy;                   //ns spent in process() since _loadTimer was started
+};
+
+#endif // PARTICLEFILTER_H
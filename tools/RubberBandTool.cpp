@@ -105,7 +105,7 @@ void RubberBandTool::mouseMoveEvent(const QPointF &scenePos)
 
 void RubberBandTool::mouseReleaseEvent(const QPointF &scenePos)
 {
-    Q_UNUSED(scenePos)
+    emit areaSelected(QRectF(_start, scenePos).normalized());
     emit done();
 }
 
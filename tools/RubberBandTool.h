@@ -16,6 +16,7 @@
 #include "AbstractTool.h"
 
 #include <QPointF>
+#include <QRectF>
 #include <QSet>
 
 class QGraphicsItem;
@@ -63,13 +64,18 @@ public:
 
     /**
      Handle mouse release events.
-     This function simply emits the done() signal to signify the selection processs is complete.
+     This function emits the areaSelected() signal, then the done() signal to signify the selection processs is complete.
 
      * @param scenePos the event's position, in scene coordinates
      */
     virtual void mouseReleaseEvent(const QPointF &scenePos);
 
 signals:
+    /**
+     * Emitted when the selection is complete.
+     * @param area the rectangle selected, in scene coordinates
+     */
+    void areaSelected(const QRectF &area);
 
 public slots:
     virtual void cancel();
@@ -0,0 +1,107 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: gdop.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "math.h"
+
+#include "gdop.h"
+
+/* Determinants smaller than this are treated as a singular geometry (e.g. all anchors colinear with the point) */
+#define GDOP_MIN_DET    (1e-9)
+
+gdop_row_t gdop_row(const vec3d p, const vec3d a, double maxRange)
+{
+    gdop_row_t row;
+    double d = vdist(p, a);
+
+    row.ux = 0;
+    row.uy = 0;
+    row.visible = 0;
+
+    if((d > 0) && ((maxRange <= 0) || (d <= maxRange)))
+    {
+        //the tag height is known, so only the horizontal part of the unit vector constrains the fix
+        row.ux = (float)((p.x - a.x) / d);
+        row.uy = (float)((p.y - a.y) / d);
+        row.visible = 1;
+    }
+
+    return row;
+}
+
+void gdop_info_clear(gdop_info_t *info)
+{
+    info->xx = 0;
+    info->xy = 0;
+    info->yy = 0;
+    info->n = 0;
+}
+
+void gdop_info_add(gdop_info_t *info, const gdop_row_t *row)
+{
+    if(row->visible)
+    {
+        info->xx += row->ux * row->ux;
+        info->xy += row->ux * row->uy;
+        info->yy += row->uy * row->uy;
+        info->n++;
+    }
+}
+
+void gdop_info_sub(gdop_info_t *info, const gdop_row_t *row)
+{
+    if(row->visible)
+    {
+        info->xx -= row->ux * row->ux;
+        info->xy -= row->ux * row->uy;
+        info->yy -= row->uy * row->uy;
+        info->n--;
+    }
+}
+
+double gdop_value(const gdop_info_t *info)
+{
+    double det, g;
+
+    if(info->n < GDOP_MIN_ANCHORS)
+    {
+        return GDOP_MAX;
+    }
+
+    det = info->xx * info->yy - info->xy * info->xy;
+
+    if(det < GDOP_MIN_DET)
+    {
+        return GDOP_MAX;
+    }
+
+    //trace of the inverse of a 2x2 matrix is (xx + yy) / det
+    g = sqrt((info->xx + info->yy) / det);
+
+    return (g < GDOP_MAX) ? g : GDOP_MAX;
+}
+
+double gdop(const vec3d p, const vec3d *anchors, int n, double maxRange)
+{
+    gdop_info_t info;
+    gdop_row_t row;
+    int i;
+
+    gdop_info_clear(&info);
+
+    for(i=0; i<n; i++)
+    {
+        row = gdop_row(p, anchors[i], maxRange);
+        gdop_info_add(&info, &row);
+    }
+
+    return gdop_value(&info);
+}
@@ -0,0 +1,66 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: gdop.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+//
+
+#ifndef __GDOP_H__
+#define __GDOP_H__
+
+#include "trilateration.h"
+
+#define GDOP_MIN_ANCHORS    (3)         //a 2D fix with a known tag height needs at least 3 ranges
+#define GDOP_MAX            (50.0)      //GDOP reported for points which can't be solved
+
+/* Information matrix (H'H) of the 2D range solution at one point.
+ * Only the upper triangle is kept: | xx xy |
+ *                                  | xy yy |
+ * n is the number of anchors contributing to it.
+ */
+typedef struct
+{
+    double xx;
+    double xy;
+    double yy;
+    int n;
+} gdop_info_t;
+
+/* Range Jacobian row of one anchor seen from one point: the horizontal
+ * components of the unit vector from the anchor to the point.
+ * visible is 0 if the anchor is out of range, in which case ux/uy are 0.
+ */
+typedef struct
+{
+    float ux;
+    float uy;
+    int visible;
+} gdop_row_t;
+
+/* Calculate the Jacobian row of anchor a seen from point p.
+ * Anchors further than maxRange (m) away are not visible (maxRange <= 0 means no limit).
+ */
+gdop_row_t gdop_row(const vec3d p, const vec3d a, double maxRange);
+
+/* Clear the information matrix. */
+void gdop_info_clear(gdop_info_t *info);
+
+/* Add/remove one anchor contribution to/from the information matrix. */
+void gdop_info_add(gdop_info_t *info, const gdop_row_t *row);
+void gdop_info_sub(gdop_info_t *info, const gdop_row_t *row);
+
+/* Return the GDOP, sqrt(trace((H'H)^-1)), for the information matrix,
+ * or GDOP_MAX if it has fewer than GDOP_MIN_ANCHORS or is singular.
+ */
+double gdop_value(const gdop_info_t *info);
+
+/* Return the GDOP of tag position p with n anchors (convenience wrapper). */
+double gdop(const vec3d p, const vec3d *anchors, int n, double maxRange);
+
+#endif
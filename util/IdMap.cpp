@@ -0,0 +1,100 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: IdMap.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "IdMap.h"
+
+#define IDMAP_MIN_SLOTS (64) //must be a power of 2
+
+/* the IDs are often small consecutive numbers, mix the bits so they don't all end up next to each other */
+static inline quint64 idmap_hash(quint64 id)
+{
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+
+    return id;
+}
+
+IdMap::IdMap()
+{
+    clear();
+}
+
+void IdMap::clear()
+{
+    _keys.fill(0, IDMAP_MIN_SLOTS);
+    _values.fill(-1, IDMAP_MIN_SLOTS);
+    _size = 0;
+}
+
+int IdMap::size() const
+{
+    return _size;
+}
+
+/* the slot holding id, or the empty slot where it would go */
+int IdMap::slot(quint64 id) const
+{
+    int mask = _keys.size() - 1;
+    int i = idmap_hash(id) & mask;
+
+    while((_values.at(i) != -1) && (_keys.at(i) != id))
+    {
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+int IdMap::value(quint64 id) const
+{
+    return _values.at(slot(id));
+}
+
+void IdMap::insert(quint64 id, int index)
+{
+    int i = slot(id);
+
+    if(_values.at(i) == -1)
+    {
+        if((_size + 1) * 2 > _keys.size())
+        {
+            grow();
+            i = slot(id);
+        }
+
+        _keys[i] = id;
+        _size++;
+    }
+
+    _values[i] = index;
+}
+
+void IdMap::grow()
+{
+    QVector<quint64> keys = _keys;
+    QVector<int> values = _values;
+
+    _keys.fill(0, keys.size() * 2);
+    _values.fill(-1, keys.size() * 2);
+
+    for(int i=0; i<keys.size(); i++)
+    {
+        if(values.at(i) != -1)
+        {
+            int j = slot(keys.at(i));
+
+            _keys[j] = keys.at(i);
+            _values[j] = values.at(i);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: IdMap.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#include <QVector>
+
+/**
+ * The IdMap class maps 64 bit tag/anchor IDs to dense indices (0, 1, 2...).
+ *
+ * It is an open addressing hash table with linear probing: the keys and the values are kept in two flat
+ * arrays, so a lookup is a hash and usually a single comparison, without any allocation. The table is
+ * kept at most half full. Entries can't be removed, clear() empties the whole map.
+ */
+class IdMap
+{
+public:
+    IdMap();
+
+    void clear();
+
+    int size() const;
+
+    /**
+     * @return the index of \a id, or -1 if it is not in the map
+     */
+    int value(quint64 id) const;
+
+    /**
+     * Add \a id with \a index, or change its index if it is already in the map. \a index must not be negative.
+     */
+    void insert(quint64 id, int index);
+
+private:
+    int slot(quint64 id) const;
+    void grow();
+
+    QVector<quint64> _keys;
+    QVector<int> _values;       //-1 for empty slots
+    int _size;
+};
+
+#endif // IDMAP_H
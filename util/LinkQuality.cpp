@@ -0,0 +1,111 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LinkQuality.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LinkQuality.h"
+
+#include <string.h>
+
+#define LQ_MASK (LQ_SECONDS - 1)
+
+static const int lq_length[LQ_WINDOWS] = {1, 10, 60};
+
+/* anchor n of the mask to bit 16n */
+static inline quint64 lq_spread(int mask)
+{
+    quint64 m = mask & 0xF;
+
+    return (m & 0x1) | ((m & 0x2) << 15) | ((m & 0x4) << 30) | ((m & 0x8) << 45);
+}
+
+static inline int lq_lane(quint64 v, int n)
+{
+    return (v >> (16 * n)) & 0xFFFF;
+}
+
+void lq_init(link_quality_t *lq)
+{
+    memset(lq, 0, sizeof(link_quality_t));
+}
+
+bool lq_push(link_quality_t *lq, qint64 time, int seqs, int mask)
+{
+    qint64 s = time / 1000;
+    bool tick = false;
+
+    if((lq->second == 0) || ((s - lq->second) > LQ_SECONDS)) //nothing to keep
+    {
+        lq_init(lq);
+        lq->second = s;
+        tick = true;
+    }
+
+    //close the seconds which have ended
+    while(lq->second < s)
+    {
+        int idx = lq->second & LQ_MASK;
+
+        for(int w=0; w<LQ_WINDOWS; w++)
+        {
+            int old = (lq->second - lq_length[w]) & LQ_MASK;
+
+            lq->hitSum[w] += lq->hits[idx] - lq->hits[old];
+            lq->frameSum[w] += lq->frames[idx] - lq->frames[old];
+        }
+
+        lq->second++;
+        lq->hits[lq->second & LQ_MASK] = 0;
+        lq->frames[lq->second & LQ_MASK] = 0;
+        tick = true;
+    }
+
+    //the time may go back a little, count it in the current second
+    int idx = lq->second & LQ_MASK;
+
+    lq->hits[idx] += lq_spread(mask);
+    lq->frames[idx] += (quint64) (seqs & 0xFFFF) | (1ULL << 16);
+
+    return tick;
+}
+
+int lq_window_length(int w)
+{
+    return lq_length[w];
+}
+
+double lq_rate(const link_quality_t *lq, int w, int a, qint64 time)
+{
+    qint64 s = time / 1000;
+    quint64 hits = lq->hitSum[w];
+    quint64 frames = lq->frameSum[w];
+
+    //no reports since the sums were updated, add up the buckets still in the window
+    if(s > lq->second)
+    {
+        hits = 0;
+        frames = 0;
+
+        for(qint64 t=qMax(s - lq_length[w], lq->second - LQ_SECONDS + 1); t<=lq->second; t++)
+        {
+            hits += lq->hits[t & LQ_MASK];
+            frames += lq->frames[t & LQ_MASK];
+        }
+    }
+
+    int seqs = lq_lane(frames, 0);
+
+    if(seqs == 0)
+    {
+        return -1;
+    }
+
+    return (100.0 * ((a < 0) ? lq_lane(frames, 1) : lq_lane(hits, a))) / seqs;
+}
@@ -0,0 +1,52 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LinkQuality.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LINKQUALITY_H
+#define LINKQUALITY_H
+
+#include <QtGlobal>
+
+#define LQ_SECONDS      (64)        //one bucket per second, must be a power of 2 and longer than the longest window
+#define LQ_WINDOWS      (3)         //1 s, 10 s and 60 s
+#define LQ_ANCS         (4)         //one 16 bit counter per anchor in a quint64
+
+/**
+ * Success rates of the ranging of a tag over the last 1, 10 and 60 seconds.
+ *
+ * The reports are counted in one bucket per second. The counters of the 4 anchors are 16 bit lanes of a
+ * single quint64, so the range mask of a report is spread over the lanes and added to all 4 counters at
+ * once. The window sums cover the last complete seconds and are updated when a second ends (add the
+ * bucket which ended, subtract the one which left the window), so they can be read at any time in O(1).
+ */
+typedef struct
+{
+    quint64 hits[LQ_SECONDS];       //ranges with each anchor in each second (lane n: anchor n)
+    quint64 frames[LQ_SECONDS];     //lane 0: range sequences, lane 1: range reports received
+    quint64 hitSum[LQ_WINDOWS];
+    quint64 frameSum[LQ_WINDOWS];
+    qint64 second;                  //the current second (its bucket isn't in the sums yet), 0 if empty
+} link_quality_t;
+
+void lq_init(link_quality_t *lq);
+
+/* count a range report with the anchors in mask, received at time (ms) after seqs range sequences,
+   returns true if a new second has started (the window sums have changed) */
+bool lq_push(link_quality_t *lq, qint64 time, int seqs, int mask);
+
+/* length (s) of window w */
+int lq_window_length(int w);
+
+/* success rate (%) of the ranges with anchor a (or of the range reports for a = -1) over window w at time (ms),
+   -1 if there were no range sequences in the window */
+double lq_rate(const link_quality_t *lq, int w, int a, qint64 time);
+
+#endif // LINKQUALITY_H
@@ -0,0 +1,99 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogPolicy.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LogPolicy.h"
+
+#include <string.h>
+
+void lp_init(log_policies_t *p)
+{
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        p->type[t].decimate = 1;
+        p->type[t].deadband = 0;
+    }
+
+    p->combineRanges = false;
+}
+
+void lp_report(log_filter_t *f)
+{
+    f->reports++;
+}
+
+bool lp_decimate(const log_policies_t *p, const log_filter_t *f, int type)
+{
+    int n = p->type[type].decimate;
+
+    //the first report of a tag is always logged
+    return (n <= 1) || (((f->reports - 1) % n) == 0);
+}
+
+bool lp_range(const log_policies_t *p, log_filter_t *f, int type, int k, int range)
+{
+    int deadband = (int) (p->type[type].deadband * 1000);
+
+    if((deadband > 0) && (f->range[k] != 0) && (qAbs(range - f->range[k]) < deadband))
+    {
+        return false;
+    }
+
+    f->range[k] = range;
+
+    return true;
+}
+
+bool lp_ranges(const log_policies_t *p, log_filter_t *f, int type, int mask, const int *range)
+{
+    int deadband = (int) (p->type[type].deadband * 1000);
+    bool log = (deadband <= 0);
+
+    for(int k=0; (k<LP_ANCS) && !log; k++)
+    {
+        //a range which appears or disappears is a change
+        int r = ((1 << k) & mask) ? range[k] : 0;
+
+        log = ((r == 0) != (f->range[k] == 0)) || (qAbs(r - f->range[k]) >= deadband);
+    }
+
+    if(log)
+    {
+        for(int k=0; k<LP_ANCS; k++)
+        {
+            f->range[k] = ((1 << k) & mask) ? range[k] : 0;
+        }
+    }
+
+    return log;
+}
+
+bool lp_location(const log_policies_t *p, log_filter_t *f, const double *xyz)
+{
+    double deadband = p->type[LOG_LE].deadband;
+
+    if((deadband > 0) && f->located)
+    {
+        double dx = xyz[0] - f->xyz[0];
+        double dy = xyz[1] - f->xyz[1];
+        double dz = xyz[2] - f->xyz[2];
+
+        if(dx*dx + dy*dy + dz*dz < deadband*deadband)
+        {
+            return false;
+        }
+    }
+
+    memcpy(f->xyz, xyz, sizeof(f->xyz));
+    f->located = true;
+
+    return true;
+}
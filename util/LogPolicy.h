@@ -0,0 +1,72 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogPolicy.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LOGPOLICY_H
+#define LOGPOLICY_H
+
+#include "LogRecord.h"
+
+#define LP_ANCS             (4)     //ranges in a range report
+#define LP_MAX_DECIMATE     (1000)
+
+/*
+ * Logging policies of the records of the range reports (RR, RJ, RM, LE and NL).
+ *
+ * The checks are made before a record is handed to the LogWriter, so a record which is left out isn't
+ * copied or formatted. Decimation counts the range reports of each tag, so the records of the same report
+ * are either all logged or all left out (for the types with the same decimation). The deadband leaves out
+ * the ranges (RR, RC) and the locations (LE) which moved less than it from the last one logged. The range
+ * and tag statistics (RS, RG, TS) are logged as before, they show that a static tag is still there.
+ */
+
+typedef struct
+{
+    int decimate;                   //log the records of 1 in n range reports, 1 logs all of them
+    double deadband;                //(m) smallest change of a range or location which is logged, 0 logs all
+} log_policy_t;
+
+typedef struct
+{
+    log_policy_t type[LOG_TYPES];
+    bool combineRanges;             //one RC record instead of the RR and RM records of a range report
+} log_policies_t;
+
+/**
+ * Logging state of a tag, all 0 before its first range report
+ */
+typedef struct
+{
+    quint32 reports;                //range reports so far
+    int range[LP_ANCS];             //(mm) last range logged to each anchor, 0 if none
+    double xyz[3];                  //last location logged
+    bool located;                   //xyz is set
+} log_filter_t;
+
+/* log all the records */
+void lp_init(log_policies_t *p);
+
+/* count a range report of the tag, call before the checks of its records */
+void lp_report(log_filter_t *f);
+
+/* true if the records of type are logged for the current range report */
+bool lp_decimate(const log_policies_t *p, const log_filter_t *f, int type);
+
+/* true if range (mm) to anchor k is outside the deadband of type around the last one logged, which it then becomes */
+bool lp_range(const log_policies_t *p, log_filter_t *f, int type, int k, int range);
+
+/* true if any of the ranges (mm) of mask is outside the deadband of type, all of them are then the last ones logged */
+bool lp_ranges(const log_policies_t *p, log_filter_t *f, int type, int mask, const int *range);
+
+/* true if location xyz (m) is outside the deadband of LOG_LE around the last one logged, which it then becomes */
+bool lp_location(const log_policies_t *p, log_filter_t *f, const double *xyz);
+
+#endif // LOGPOLICY_H
@@ -0,0 +1,847 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogRecord.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LogRecord.h"
+
+#include <QByteArray>
+#include <QtEndian>
+#include <QtNumeric>
+#include <limits.h>
+#include <string.h>
+
+/* the formatting functions write at p and return the end, they give the same text as QString::arg() */
+
+static inline char *lt_char(char *p, char c)
+{
+    *p = c;
+    return p + 1;
+}
+
+static inline char *lt_uint(char *p, quint64 v)
+{
+    char tmp[20];
+    int n = 0;
+
+    do
+    {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    }
+    while(v);
+
+    while(n)
+    {
+        *p++ = tmp[--n];
+    }
+
+    return p;
+}
+
+static inline char *lt_int(char *p, qint64 v)
+{
+    if(v < 0)
+    {
+        *p++ = '-';
+        return lt_uint(p, 0 - (quint64) v);
+    }
+
+    return lt_uint(p, v);
+}
+
+/* QString::arg(double) and QString::number() format doubles with the C locale, QByteArray::number() goes through
+   the same Qt code, so the text is the same (rounding, -0, nan and inf included) whatever LC_NUMERIC is */
+static inline char *lt_bytes(char *p, const QByteArray &text)
+{
+    memcpy(p, text.constData(), text.size());
+    return p + text.size();
+}
+
+/* arg(double): 6 significant digits */
+static inline char *lt_double(char *p, double v)
+{
+    return lt_bytes(p, QByteArray::number(v, 'g', 6));
+}
+
+/* QString::number(v, 'f', prec) */
+static inline char *lt_fixed(char *p, double v, int prec)
+{
+    return lt_bytes(p, QByteArray::number(v, 'f', prec));
+}
+
+static inline char *lt_two(char *p, int v)
+{
+    p[0] = '0' + v / 10;
+    p[1] = '0' + v % 10;
+    return p + 2;
+}
+
+char *log_format_time(char *p, qint64 time)
+{
+    int ms = (time / 1000) % 86400000;
+    int s = ms / 1000;
+
+    p = lt_char(p, 'T');
+    p = lt_char(p, ':');
+    p = lt_two(p, s / 3600);
+    p = lt_two(p, (s / 60) % 60);
+    p = lt_two(p, s % 60);
+    p = lt_char(p, '0' + (ms % 1000) / 100);
+    p = lt_two(p, ms % 100);
+    return lt_char(p, ':');
+}
+
+static inline char *lt_tag(char *p, const char *type)
+{
+    p[0] = type[0];
+    p[1] = type[1];
+    p[2] = ':';
+    return p + 3;
+}
+
+/* ":v" for each of the n values */
+static inline char *lt_ints(char *p, const int *v, int n)
+{
+    for(int i=0; i<n; i++)
+    {
+        p = lt_int(lt_char(p, ':'), v[i]);
+    }
+
+    return p;
+}
+
+char *log_format_text(char *p, const log_record_t *r)
+{
+    p = log_format_time(p, r->time);
+
+    switch(r->type)
+    {
+    case LOG_TEXT:
+        memcpy(p, r->text, r->length);
+        return p + r->length;
+
+    case LOG_RR: //RR:tid:k:range:corrected:seq:lnum
+    case LOG_RJ: //RJ:tid:k:corrected:gate:seq:lnum
+        p = lt_uint(lt_tag(p, (r->type == LOG_RR) ? "RR" : "RJ"), r->id);
+        p = lt_ints(p, r->i, 5);
+        break;
+
+    case LOG_RM: //RM:tid:mask:seq:lnum
+        p = lt_uint(lt_tag(p, "RM"), r->id);
+        p = lt_ints(p, r->i, 3);
+        break;
+
+    case LOG_LE: //LE:tid:count:seq:[x,y,z]:r0:r1:r2:r3
+    case LOG_NL: //NL:tid:count:seq:[nan,nan,nan]:r0:r1:r2:r3
+        p = lt_uint(lt_tag(p, (r->type == LOG_LE) ? "LE" : "NL"), r->id);
+        p = lt_ints(p, r->i, 2);
+
+        if(r->type == LOG_LE)
+        {
+            p = lt_double(lt_char(lt_char(p, ':'), '['), r->d[0]);
+            p = lt_double(lt_char(p, ','), r->d[1]);
+            p = lt_double(lt_char(p, ','), r->d[2]);
+            p = lt_char(lt_char(p, ']'), ':');
+        }
+        else
+        {
+            memcpy(p, ":[nan,nan,nan]:", 15);
+            p += 15;
+        }
+
+        p = lt_int(p, r->i[2]);
+        p = lt_ints(p, r->i + 3, 3);
+        break;
+
+    case LOG_RA: //RA:j:i:range:0:seq:lnum
+        p = lt_int(lt_tag(p, "RA"), r->i[0]);
+        p = lt_ints(p, r->i + 1, 2);
+        p = lt_char(lt_char(p, ':'), '0');
+        p = lt_ints(p, r->i + 3, 2);
+        break;
+
+    case LOG_AP: //AP:id:x:y:z
+        p = lt_int(lt_tag(p, "AP"), r->i[0]);
+        p = lt_double(lt_char(p, ':'), r->d[0]);
+        p = lt_double(lt_char(p, ':'), r->d[1]);
+        p = lt_double(lt_char(p, ':'), r->d[2]);
+        break;
+
+    case LOG_AH: //AH:id:state:rate:bias
+        p = lt_int(lt_tag(p, "AH"), r->i[0]);
+        p = lt_ints(p, r->i + 1, 1);
+        p = lt_fixed(lt_char(p, ':'), r->d[0], 1);
+        p = lt_fixed(lt_char(p, ':'), r->d[1], 3);
+        break;
+
+    case LOG_TS: //TS:tid avx:x avy:y avz:z r95:r
+        p = lt_uint(lt_tag(p, "TS"), r->id);
+        memcpy(p, " avx:", 5);
+        p = lt_double(p + 5, r->d[0]);
+        memcpy(p, " avy:", 5);
+        p = lt_double(p + 5, r->d[1]);
+        memcpy(p, " avz:", 5);
+        p = lt_double(p + 5, r->d[2]);
+        memcpy(p, " r95:", 5);
+        p = lt_double(p + 5, r->d[3]);
+        break;
+
+    case LOG_RS: //RS:tid:a0:a1:a2:a3:missing
+        p = lt_uint(lt_tag(p, "RS"), r->id);
+
+        for(int k=0; k<4; k++)
+        {
+            p = lt_fixed(lt_char(p, ':'), r->d[k], 2);
+        }
+
+        p = lt_ints(p, r->i, 1);
+        break;
+
+    case LOG_RG: //RG:tid:r0:r1:r2:r3
+        p = lt_uint(lt_tag(p, "RG"), r->id);
+        p = lt_ints(p, r->i, 4);
+        break;
+
+    case LOG_RC: //RC:tid:mask:r0:r1:r2:r3:c0:c1:c2:c3:seq:lnum
+        p = lt_uint(lt_tag(p, "RC"), r->id);
+        p = lt_ints(p, r->i, 11);
+        break;
+    }
+
+    return lt_char(p, '\n');
+}
+
+/* the parsing functions read at p (up to end) and return the end of what they read, NULL if it isn't there or p
+   is NULL, so they can be chained */
+
+static const double lt_pow10[23] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+    1e20, 1e21, 1e22
+};
+
+static inline const char *lt_get_char(const char *p, const char *end, char c)
+{
+    return (p && (p < end) && (*p == c)) ? p + 1 : NULL;
+}
+
+static inline const char *lt_get_uint(const char *p, const char *end, quint64 *v)
+{
+    const char *start = p;
+    quint64 x = 0;
+
+    if(!p)
+    {
+        return NULL;
+    }
+
+    while((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+        x = x * 10 + (*p++ - '0');
+    }
+
+    *v = x;
+
+    return (p > start) ? p : NULL;
+}
+
+static inline const char *lt_get_int(const char *p, const char *end, int *v)
+{
+    bool negative = (p && (p < end) && (*p == '-'));
+    quint64 x = 0;
+
+    p = lt_get_uint(negative ? p + 1 : p, end, &x);
+    *v = negative ? -(int) x : (int) x;
+
+    return p;
+}
+
+/* ":v" for each of the n values */
+static inline const char *lt_get_ints(const char *p, const char *end, int *v, int n)
+{
+    for(int i=0; i<n; i++)
+    {
+        p = lt_get_int(lt_get_char(p, end, ':'), end, &v[i]);
+    }
+
+    return p;
+}
+
+/* a number as written by lt_double() or lt_fixed(), the ones with up to 15 digits and small exponents (all of them
+   in practice) are converted exactly without strtod(), which also depends on the locale */
+static inline const char *lt_get_double(const char *p, const char *end, double *v)
+{
+    const char *start = p;
+    bool negative = false;
+    quint64 m = 0;
+    int digits = 0, e = 0, read = 0;
+
+    if(!p)
+    {
+        return NULL;
+    }
+
+    if((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p++ == '-');
+    }
+
+    if((end - p >= 3) && ((memcmp(p, "nan", 3) == 0) || (memcmp(p, "inf", 3) == 0)))
+    {
+        *v = (*p == 'n') ? qQNaN() : (negative ? -qInf() : qInf());
+        return p + 3;
+    }
+
+    for(bool fraction = false; p < end; p++)
+    {
+        if((*p == '.') && !fraction)
+        {
+            fraction = true;
+            continue;
+        }
+
+        if((*p < '0') || (*p > '9'))
+        {
+            break;
+        }
+
+        read++;
+
+        if(digits < 19)
+        {
+            m = m * 10 + (*p - '0');
+            digits += (m != 0);
+            e -= fraction;
+        }
+        else
+        {
+            e += !fraction;
+        }
+    }
+
+    if(read == 0)
+    {
+        return NULL;
+    }
+
+    if((p < end) && ((*p == 'e') || (*p == 'E')))
+    {
+        int x;
+
+        p = lt_get_int((p + 1 < end) && (p[1] == '+') ? p + 2 : p + 1, end, &x);
+
+        if(!p)
+        {
+            return NULL;
+        }
+
+        e += x;
+    }
+
+    if((digits <= 15) && (e >= -22) && (e <= 22))
+    {
+        *v = (e < 0) ? (m / lt_pow10[-e]) : (m * lt_pow10[e]);
+        *v = negative ? -*v : *v;
+    }
+    else
+    {
+        *v = QByteArray(start, p - start).toDouble();
+    }
+
+    return p;
+}
+
+bool log_parse_text(const char *p, const char *end, log_record_t *r)
+{
+    static const char *ts_names[4] = {" avx:", " avy:", " avz:", " r95:"};
+    int t[9];
+
+    if((end - p < 12) || (p[0] != 'T') || (p[1] != ':') || (p[11] != ':'))
+    {
+        return false;
+    }
+
+    for(int k=0; k<9; k++)
+    {
+        t[k] = p[2 + k] - '0';
+
+        if((t[k] < 0) || (t[k] > 9))
+        {
+            return false;
+        }
+    }
+
+    int ms = (((t[0] * 10 + t[1]) * 60 + t[2] * 10 + t[3]) * 60 + t[4] * 10 + t[5]) * 1000 + t[6] * 100 + t[7] * 10 + t[8];
+
+    r->time = ms * 1000LL;
+    p += 12;
+
+    //the lines of the records start with their type, all the others are text
+    r->type = LOG_TEXT;
+
+    if((end - p >= 3) && (p[2] == ':'))
+    {
+        char name[3] = {p[0], p[1], 0};
+
+        r->type = qMax(log_type(name), (int) LOG_TEXT);
+    }
+
+    if(r->type == LOG_TEXT)
+    {
+        r->text = p;
+        r->length = end - p;
+        return true;
+    }
+
+    p += 3;
+
+    quint64 id = 0;
+    const char *q = p;
+
+    switch(r->type)
+    {
+    case LOG_RR:
+    case LOG_RJ:
+        q = lt_get_ints(lt_get_uint(p, end, &id), end, r->i, 5);
+        break;
+
+    case LOG_RM:
+        q = lt_get_ints(lt_get_uint(p, end, &id), end, r->i, 3);
+        break;
+
+    case LOG_LE:
+    case LOG_NL:
+        q = lt_get_ints(lt_get_uint(p, end, &id), end, r->i, 2);
+        q = lt_get_char(lt_get_char(q, end, ':'), end, '[');
+        q = lt_get_double(q, end, &r->d[0]);
+        q = lt_get_double(lt_get_char(q, end, ','), end, &r->d[1]);
+        q = lt_get_double(lt_get_char(q, end, ','), end, &r->d[2]);
+        q = lt_get_char(lt_get_char(q, end, ']'), end, ':');
+        q = lt_get_int(q, end, &r->i[2]);
+        q = lt_get_ints(q, end, r->i + 3, 3);
+        break;
+
+    case LOG_RA:
+    {
+        int zero;
+
+        q = lt_get_ints(lt_get_int(p, end, &r->i[0]), end, r->i + 1, 2);
+        q = lt_get_ints(q, end, &zero, 1);
+        q = lt_get_ints(q, end, r->i + 3, 2);
+        break;
+    }
+
+    case LOG_AP:
+        q = lt_get_int(p, end, &r->i[0]);
+        q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[0]);
+        q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[1]);
+        q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[2]);
+        break;
+
+    case LOG_AH:
+        q = lt_get_ints(lt_get_int(p, end, &r->i[0]), end, r->i + 1, 1);
+        q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[0]);
+        q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[1]);
+        break;
+
+    case LOG_TS:
+        q = lt_get_uint(p, end, &id);
+
+        for(int k=0; (k<4) && q; k++)
+        {
+            q = ((end - q >= 5) && (memcmp(q, ts_names[k], 5) == 0)) ? lt_get_double(q + 5, end, &r->d[k]) : NULL;
+        }
+        break;
+
+    case LOG_RS:
+        q = lt_get_uint(p, end, &id);
+
+        for(int k=0; k<4; k++)
+        {
+            q = lt_get_double(lt_get_char(q, end, ':'), end, &r->d[k]);
+        }
+
+        q = lt_get_ints(q, end, r->i, 1);
+        break;
+
+    case LOG_RG:
+        q = lt_get_ints(lt_get_uint(p, end, &id), end, r->i, 4);
+        break;
+
+    case LOG_RC:
+        q = lt_get_ints(lt_get_uint(p, end, &id), end, r->i, 11);
+        break;
+    }
+
+    r->id = id;
+
+    return (q == end);
+}
+
+/* field codes of the records of this version, in the order of the types */
+static const char *log_schema[LOG_TYPES][2] =
+{
+    {"TX", "s"},
+    {"RR", "Tbiiii"},           //tag, k, range, corrected, seq, lnum
+    {"RJ", "Tbiiii"},           //tag, k, corrected, gate range, seq, lnum
+    {"RM", "Tiii"},             //tag, mask, seq, lnum
+    {"LE", "Tiiiiiiddd"},       //tag, count, seq, 4 ranges, x, y, z
+    {"NL", "Tiiiiii"},          //tag, count, seq, 4 ranges
+    {"RA", "iiiii"},            //j, i, range, seq, lnum
+    {"AP", "iddd"},             //anchor, x, y, z
+    {"AH", "iidd"},             //anchor, state, rate, bias
+    {"TS", "Tdddd"},            //tag, x, y, z, r95
+    {"RS", "Tffffi"},           //tag, 4 rates, missing
+    {"RG", "Tiiii"},            //tag, 4 rejected
+    {"RC", "Tbiiiiiiiiii"}      //tag, mask, 4 ranges, 4 corrected, seq, lnum
+};
+
+const char *log_type_name(int type)
+{
+    return log_schema[type][0];
+}
+
+int log_type(const char *name)
+{
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        if(strcmp(log_schema[t][0], name) == 0)
+        {
+            return t;
+        }
+    }
+
+    return -1;
+}
+
+void log_fields(int type, int *ni, int *nd)
+{
+    *ni = 0;
+    *nd = 0;
+
+    for(const char *f = log_schema[type][1]; *f; f++)
+    {
+        *ni += ((*f == 'b') || (*f == 'i'));
+        *nd += ((*f == 'f') || (*f == 'd'));
+    }
+}
+
+static inline uchar *lb_u8(uchar *p, int v)
+{
+    *p = (uchar) v;
+    return p + 1;
+}
+
+static inline uchar *lb_u16(uchar *p, int v)
+{
+    qToLittleEndian<quint16>(v, p);
+    return p + 2;
+}
+
+static inline uchar *lb_i32(uchar *p, qint32 v)
+{
+    qToLittleEndian<qint32>(v, p);
+    return p + 4;
+}
+
+static inline uchar *lb_i64(uchar *p, qint64 v)
+{
+    qToLittleEndian<qint64>(v, p);
+    return p + 8;
+}
+
+static inline uchar *lb_f32(uchar *p, float v)
+{
+    quint32 u;
+
+    memcpy(&u, &v, 4);
+    qToLittleEndian<quint32>(u, p);
+    return p + 4;
+}
+
+static inline uchar *lb_f64(uchar *p, double v)
+{
+    quint64 u;
+
+    memcpy(&u, &v, 8);
+    qToLittleEndian<quint64>(u, p);
+    return p + 8;
+}
+
+static inline float lb_get_f32(const uchar *p)
+{
+    quint32 u = qFromLittleEndian<quint32>(p);
+    float v;
+
+    memcpy(&v, &u, 4);
+    return v;
+}
+
+static inline double lb_get_f64(const uchar *p)
+{
+    quint64 u = qFromLittleEndian<quint64>(p);
+    double v;
+
+    memcpy(&v, &u, 8);
+    return v;
+}
+
+QByteArray log_encode_header(const log_header_t *h)
+{
+    QByteArray header(24 + 4 + h->text.size() + 4 + h->anchors.size() * 28 + 4 + LOG_TYPES * 16, 0);
+    uchar *p = (uchar *) header.data();
+
+    memcpy(p, LOG_MAGIC, sizeof(LOG_MAGIC));
+    p = lb_u16(p + 8, LOG_VERSION);
+    p = lb_u16(p, 0);
+    p = lb_i64(p, h->start);
+    p = lb_i32(p, h->utcOffset);
+
+    p = lb_i32(p, h->text.size());
+    memcpy(p, h->text.constData(), h->text.size());
+    p += h->text.size();
+
+    p = lb_i32(p, h->anchors.size());
+
+    for(int a=0; a<h->anchors.size(); a++)
+    {
+        const log_anchor_t *anc = &h->anchors.at(a);
+
+        p = lb_i32(p, anc->id);
+        p = lb_f64(p, anc->x);
+        p = lb_f64(p, anc->y);
+        p = lb_f64(p, anc->z);
+    }
+
+    p = lb_i32(p, LOG_TYPES);
+
+    for(int t=0; t<LOG_TYPES; t++)
+    {
+        int n = strlen(log_schema[t][1]);
+
+        p = lb_u8(p, t);
+        p = lb_u8(p, log_schema[t][0][0]);
+        p = lb_u8(p, log_schema[t][0][1]);
+        p = lb_u8(p, n);
+        memcpy(p, log_schema[t][1], n);
+        p += n;
+    }
+
+    header.resize(p - (uchar *) header.data());
+
+    return header;
+}
+
+int log_decode_header(const uchar *data, qint64 len, log_header_t *h)
+{
+    const uchar *p = data, *end = data + len;
+    quint32 n;
+
+    if(len < 28)
+    {
+        return 0;
+    }
+
+    if(memcmp(p, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0)
+    {
+        return -1;
+    }
+
+    h->version = qFromLittleEndian<quint16>(p + 8);
+    h->start = qFromLittleEndian<qint64>(p + 12);
+    h->utcOffset = qFromLittleEndian<qint32>(p + 20);
+    p += 24;
+
+    n = qFromLittleEndian<quint32>(p);
+    p += 4;
+
+    if((qint64) n + 4 > end - p)
+    {
+        return 0;
+    }
+
+    h->text = QByteArray((const char *) p, n);
+    p += n;
+
+    n = qFromLittleEndian<quint32>(p);
+    p += 4;
+
+    if((qint64) n * 28 + 4 > end - p)
+    {
+        return 0;
+    }
+
+    h->anchors.resize(n);
+
+    for(quint32 a=0; a<n; a++)
+    {
+        log_anchor_t *anc = &h->anchors[a];
+
+        anc->id = qFromLittleEndian<qint32>(p);
+        anc->x = lb_get_f64(p + 4);
+        anc->y = lb_get_f64(p + 12);
+        anc->z = lb_get_f64(p + 20);
+        p += 28;
+    }
+
+    n = qFromLittleEndian<quint32>(p);
+    p += 4;
+
+    for(int t=0; t<LOG_MAX_TYPES; t++)
+    {
+        h->schema[t].clear();
+    }
+
+    for(quint32 k=0; k<n; k++)
+    {
+        if(end - p < 4)
+        {
+            return 0;
+        }
+
+        int t = p[0];
+        int m = p[3];
+
+        if(end - p < 4 + m)
+        {
+            return 0;
+        }
+
+        h->schema[t] = QByteArray((const char *) p + 4, m);
+        p += 4 + m;
+    }
+
+    return p - data;
+}
+
+int log_encode(uchar *p, const log_record_t *r)
+{
+    const char *f = log_schema[r->type][1];
+    uchar *start = p;
+    int ni = 0, nd = 0;
+
+    p = lb_u8(p, r->type);
+    p = lb_i64(p, r->time);
+
+    for(; *f; f++)
+    {
+        switch(*f)
+        {
+        case 'T':
+            p = lb_i64(p, r->id);
+            break;
+        case 'b':
+            p = lb_u8(p, r->i[ni++]);
+            break;
+        case 'i':
+            p = lb_i32(p, r->i[ni++]);
+            break;
+        case 'f':
+            p = lb_f32(p, r->d[nd++]);
+            break;
+        case 'd':
+            p = lb_f64(p, r->d[nd++]);
+            break;
+        case 's':
+            p = lb_i32(p, r->length);
+            memcpy(p, r->text, r->length);
+            p += r->length;
+            break;
+        }
+    }
+
+    return p - start;
+}
+
+int log_decode(const uchar *data, qint64 len, const log_header_t *h, log_record_t *r)
+{
+    const uchar *p = data + 9, *end = data + len;
+    int ni = 0, nd = 0;
+
+    if(len < 9)
+    {
+        return 0;
+    }
+
+    r->type = data[0];
+    r->time = qFromLittleEndian<qint64>(data + 1);
+
+    const QByteArray &schema = h->schema[r->type];
+
+    if(schema.isEmpty())
+    {
+        return -1;
+    }
+
+    for(int k=0; k<schema.size(); k++)
+    {
+        int size;
+
+        switch(schema.at(k))
+        {
+        case 'b': size = 1; break;
+        case 'i':
+        case 'f': size = 4; break;
+        case 'T':
+        case 'd': size = 8; break;
+        case 's': size = 4; break;
+        default: return -1;
+        }
+
+        if(end - p < size)
+        {
+            return 0;
+        }
+
+        switch(schema.at(k))
+        {
+        case 'T':
+            r->id = qFromLittleEndian<quint64>(p);
+            break;
+        case 'b':
+            if(ni < LOG_MAX_INTS) r->i[ni++] = *p;
+            break;
+        case 'i':
+            if(ni < LOG_MAX_INTS) r->i[ni++] = qFromLittleEndian<qint32>(p);
+            break;
+        case 'f':
+            if(nd < 4) r->d[nd++] = lb_get_f32(p);
+            break;
+        case 'd':
+            if(nd < 4) r->d[nd++] = lb_get_f64(p);
+            break;
+        case 's':
+        {
+            quint32 n = qFromLittleEndian<quint32>(p);
+
+            //the length of the record is returned as an int
+            if(n > (quint32) (INT_MAX - LOG_MAX_RECORD))
+            {
+                return -1;
+            }
+
+            if((quint64) n > (quint64) (end - p - 4))
+            {
+                return 0;
+            }
+
+            r->length = n;
+            r->text = (const char *) p + 4;
+            p += n;
+            break;
+        }
+        }
+
+        p += size;
+    }
+
+    return p - data;
+}
@@ -0,0 +1,130 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogRecord.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LOGRECORD_H
+#define LOGRECORD_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+
+#define LOG_FORMAT_TEXT     (0)     //"T:hhmmsszzz:XX:..." lines
+#define LOG_FORMAT_BINARY   (1)     //header and fixed width records, see below
+
+#define LOG_MAGIC           "RTLSLOG"
+#define LOG_VERSION         (1)
+#define LOG_MAX_TEXT_LINE   (512)   //longest text line of a record (without a LOG_TEXT line)
+#define LOG_MAX_RECORD      (128)   //longest binary record (without a LOG_TEXT line)
+#define LOG_MAX_TYPES       (256)   //record types a binary log can have, the ones from LOG_TYPES on are skipped
+#define LOG_MAX_INTS        (12)    //integer fields of a record
+
+enum
+{
+    LOG_TEXT = 0,   //line given as text
+    LOG_RR,         //tag - anchor range
+    LOG_RJ,         //tag - anchor range rejected by the range gate
+    LOG_RM,         //range mask of a range report
+    LOG_LE,         //location
+    LOG_NL,         //no location
+    LOG_RA,         //anchor - anchor range
+    LOG_AP,         //anchor position
+    LOG_AH,         //anchor health
+    LOG_TS,         //tag statistics
+    LOG_RS,         //range statistics
+    LOG_RG,         //ranges rejected by the range gate
+    LOG_RC,         //range report (the RR and RM records in one)
+    LOG_TYPES
+};
+
+/*
+ * Application log records.
+ *
+ * A record holds the values of one log line, which of the fields are used depends on the type. The time is
+ * the local time in us since 1970-01-01 00:00, so the time of day of the text line is (time / 1000) modulo
+ * one day.
+ *
+ * The binary log starts with a header:
+ *   char[8]  "RTLSLOG\0"
+ *   u16      version
+ *   u16      0
+ *   i64      (us) local time the log was opened
+ *   i32      (s) local time - UTC
+ *   u32 n, n bytes: device version and configuration ("DecaRangeRTLS:LogFile:..." line without the time)
+ *   u32 n, n times: i32 anchor ID, f64 x, y, z (m)
+ *   u32 n, n times the record schema: u8 type, char[2] name, u8 m, m field codes
+ * and is followed by the records: u8 type, i64 (us) time and the fields of the type. The field codes are
+ * 'T' u64 tag ID (id), 'b' u8 and 'i' i32 (the next of i[]), 'f' f32 and 'd' f64 (the next of d[]) and
+ * 's' u32 n, n bytes (text). All the values are little endian.
+ */
+
+typedef struct
+{
+    int type;                       //LOG_xx
+    qint64 time;                    //(us) local time
+    quint64 id;                     //tag ID
+    int i[LOG_MAX_INTS];
+    double d[4];
+    const char *text;               //LOG_TEXT only, not 0 terminated
+    int length;                     //of text
+} log_record_t;
+
+typedef struct
+{
+    int id;
+    double x, y, z;
+} log_anchor_t;
+
+typedef struct
+{
+    int version;
+    qint64 start;                   //(us) local time
+    int utcOffset;                  //(s)
+    QByteArray text;                //device version and configuration
+    QVector<log_anchor_t> anchors;
+    QByteArray schema[LOG_MAX_TYPES]; //field codes of each record type in the file, empty if it has none
+} log_header_t;
+
+/* two letter name of type ("RR"), "TX" for LOG_TEXT */
+const char *log_type_name(int type);
+
+/* type of the two letter name, -1 if it isn't one */
+int log_type(const char *name);
+
+/* number of integer (i[]) and floating point (d[]) fields of the records of type */
+void log_fields(int type, int *ni, int *nd);
+
+/* read the text line from p to end (without the line end) into r, returns false if it isn't a log line. The time is
+   the time of day (the text line doesn't have the date), a line which isn't a record of a known type is a LOG_TEXT
+   record with the text (after the time) in r->text. */
+bool log_parse_text(const char *p, const char *end, log_record_t *r);
+
+/* text line of record r (with the line end) at p, returns the end */
+char *log_format_text(char *p, const log_record_t *r);
+
+/* "T:hhmmsszzz:" of time (us) at p, returns the end */
+char *log_format_time(char *p, qint64 time);
+
+/* binary header, the schema of this version is used */
+QByteArray log_encode_header(const log_header_t *h);
+
+/* read the header at the start of data (of length len), returns its length, 0 if data is too short and -1 if it isn't
+   a binary log */
+int log_decode_header(const uchar *data, qint64 len, log_header_t *h);
+
+/* binary record r at p, returns its length, the text of a LOG_TEXT record isn't limited to LOG_MAX_RECORD */
+int log_encode(uchar *p, const log_record_t *r);
+
+/* read the record at data with the schema of the header, returns its length, 0 if data is too short and -1 if it
+   isn't a record. The text of a LOG_TEXT record points into data. */
+int log_decode(const uchar *data, qint64 len, const log_header_t *h, log_record_t *r);
+
+#endif // LOGRECORD_H
@@ -0,0 +1,800 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogWriter.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "LogWriter.h"
+
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QtEndian>
+#include <QtConcurrent>
+#include <string.h>
+#include <chrono>
+#include <zlib.h>
+
+#define LW_COMPRESS_CHUNK   (1 << 20)
+
+/* gzip path to path.gz and remove it, the .gz is removed instead if it can't be written (pool thread) */
+static void lw_compress(const QString &path)
+{
+    QFile in(path);
+    QString name = path + ".gz";
+    gzFile out;
+
+    if (!in.open(QIODevice::ReadOnly) || !(out = gzopen(QFile::encodeName(name).constData(), "wb6")))
+    {
+        return;
+    }
+
+    QByteArray chunk(LW_COMPRESS_CHUNK, 0);
+    bool ok = true;
+    qint64 n;
+
+    while(ok && ((n = in.read(chunk.data(), chunk.size())) > 0))
+    {
+        ok = (gzwrite(out, chunk.constData(), (unsigned) n) == n);
+    }
+
+    ok = (gzclose(out) == Z_OK) && ok && (n == 0);
+    in.close();
+
+    //the .gz keeps the time the segment was closed, which orders the logs for lw_prune()
+    QFile gz(name);
+
+    if(ok && gz.open(QIODevice::ReadWrite))
+    {
+        gz.setFileTime(QFileInfo(path).lastModified(), QFileDevice::FileModificationTime);
+        gz.close();
+    }
+
+    QFile::remove(ok ? path : name);
+}
+
+/* remove the oldest logs of dir while all of them take up more than keep bytes, except active (pool thread) */
+static void lw_prune(const QString &dir, const QString &active, qint64 keep)
+{
+    QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*RTLS_log*", QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+
+    foreach(const QFileInfo &f, files)
+    {
+        total += f.size();
+    }
+
+    foreach(const QFileInfo &f, files)
+    {
+        if(total <= keep)
+        {
+            break;
+        }
+
+        if((f.absoluteFilePath() != active) && QFile::remove(f.filePath()))
+        {
+            total -= f.size();
+        }
+    }
+}
+
+/* a closed segment: compress it, then keep the folder within its size */
+static void lw_finish(const QString &path, const QString &active, bool compress, qint64 keep)
+{
+    if(compress)
+    {
+        lw_compress(path);
+    }
+
+    if(keep > 0)
+    {
+        lw_prune(QFileInfo(path).path(), active, keep);
+    }
+}
+
+LogWriter::LogWriter(QObject *parent) :
+    QThread(parent),
+    _open(false),
+    _format(LOG_FORMAT_TEXT),
+    _utcOffset(0),
+    _offsetUntil(0),
+    _head(0),
+    _tail(0),
+    _sleeping(0),
+    _queued(0),
+    _dropped(0),
+    _maxPending(0),
+    _flushInterval(LOG_FLUSH_INTERVAL),
+    _stop(false),
+    _maxSize(LOG_MAX_SIZE),
+    _maxMinutes(0),
+    _keep(0),
+    _compress(false),
+    _len(0),
+    _offset(0),
+    _segment(0),
+    _segmentStart(0),
+    _rotateBytes(0),
+    _rotateTime(0),
+    _lost(0),
+    _capture(NULL)
+{
+    _ring = new log_record_t[LOG_RING_SIZE];
+    _buf = new char[LOG_BUFFER_SIZE];
+    _pool.setMaxThreadCount(1);
+}
+
+LogWriter::~LogWriter()
+{
+    close();
+
+    delete[] _ring;
+    delete[] _buf;
+}
+
+bool LogWriter::open(const QString &filename, int format, const QString &text, const QVector<log_anchor_t> &anchors)
+{
+    close();
+
+    _filename = filename;
+    _format = format;
+    _file.setFileName(filename);
+
+    //written in whole blocks from the buffer, so QFile doesn't need one of its own
+    if (!_file.open(QFile::ReadWrite | QFile::Unbuffered | ((format == LOG_FORMAT_TEXT) ? QFile::Text : QFile::NotOpen)))
+    {
+        return false;
+    }
+
+    _head.store(0);
+    _tail.store(0);
+    _queued = 0;
+    _dropped = 0;
+    _maxPending = 0;
+    _stop = false;
+    _len = 0;
+    _offset = 0;
+    _segment = 0;
+    _segmentStart = now();
+    _lost = 0;
+    _held.start();
+    _open = true;
+
+    _header.start = _segmentStart;
+    _header.utcOffset = _utcOffset;
+    _header.text = text.toLocal8Bit();
+    _header.anchors = anchors;
+
+    if(_format == LOG_FORMAT_BINARY)
+    {
+        QByteArray h = log_encode_header(&_header);
+
+        _offset = _file.write(h);
+    }
+    else
+    {
+        this->text(_segmentStart, text);
+    }
+
+    //the logs of the sessions before may already be over the retention size
+    {
+        QMutexLocker lock(&_mutex);
+
+        if(_keep > 0)
+        {
+            QtConcurrent::run(&_pool, lw_prune, QFileInfo(filename).path(), QFileInfo(filename).absoluteFilePath(), _keep * 1048576LL);
+        }
+    }
+
+    start(QThread::LowPriority);
+
+    return true;
+}
+
+void LogWriter::close()
+{
+    if(!_open)
+    {
+        return;
+    }
+
+    {
+        QMutexLocker lock(&_mutex);
+
+        _stop = true;
+    }
+
+    _wakeup.release();
+
+    wait();
+
+    _file.close();
+    finish(true);
+    _open = false;
+}
+
+bool LogWriter::isOpen() const
+{
+    return _open;
+}
+
+int LogWriter::format() const
+{
+    return _format;
+}
+
+qint64 LogWriter::now()
+{
+    qint64 utc = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    //the time zone offsets change on a full quarter of an hour
+    if(utc >= _offsetUntil)
+    {
+        _utcOffset = QDateTime::fromMSecsSinceEpoch(utc / 1000).offsetFromUtc();
+        _offsetUntil = (utc / LOG_OFFSET_INTERVAL + 1) * LOG_OFFSET_INTERVAL;
+    }
+
+    return utc + _utcOffset * 1000000LL;
+}
+
+QString LogWriter::errorString() const
+{
+    return _file.errorString();
+}
+
+void LogWriter::setFlushInterval(int ms)
+{
+    QMutexLocker lock(&_mutex);
+
+    _flushInterval = qBound(LOG_MIN_FLUSH_INTERVAL, ms, LOG_MAX_FLUSH_INTERVAL);
+}
+
+int LogWriter::flushInterval() const
+{
+    return _flushInterval;
+}
+
+void LogWriter::setRotation(int maxSize, int maxMinutes)
+{
+    QMutexLocker lock(&_mutex);
+
+    _maxSize = qMax(0, maxSize);
+    _maxMinutes = qMax(0, maxMinutes);
+}
+
+int LogWriter::maxSize() const
+{
+    return _maxSize;
+}
+
+int LogWriter::maxMinutes() const
+{
+    return _maxMinutes;
+}
+
+void LogWriter::setRetention(int keep, bool compress)
+{
+    QMutexLocker lock(&_mutex);
+
+    _keep = qMax(0, keep);
+    _compress = compress;
+}
+
+int LogWriter::keep() const
+{
+    return _keep;
+}
+
+bool LogWriter::compress() const
+{
+    return _compress;
+}
+
+void LogWriter::flush()
+{
+    _wakeup.release();
+}
+
+void LogWriter::setCapture(QVector<log_record_t> *records)
+{
+    _capture = records;
+}
+
+quint64 LogWriter::queued() const
+{
+    return _queued;
+}
+
+quint64 LogWriter::dropped() const
+{
+    return _dropped;
+}
+
+int LogWriter::maxPending() const
+{
+    return _maxPending;
+}
+
+int LogWriter::segments() const
+{
+    return _segment + 1;
+}
+
+qint64 LogWriter::lost() const
+{
+    return _lost;
+}
+
+/* free slot for the next record, NULL if the file isn't open or the ring is full */
+log_record_t *LogWriter::next()
+{
+    if(_capture)
+    {
+        _capture->resize(_capture->size() + 1);
+        return &_capture->last();
+    }
+
+    if(!_open)
+    {
+        return NULL;
+    }
+
+    quint32 head = _head.load();
+    int pending = head - _tail.loadAcquire();
+
+    if(pending >= LOG_RING_SIZE)
+    {
+        _dropped++;
+        return NULL;
+    }
+
+    _maxPending = qMax(_maxPending, pending + 1);
+
+    //don't wait for the end of the interval when the ring fills up
+    if(pending == LOG_RING_SIZE / 2)
+    {
+        wake();
+    }
+
+    return &_ring[head & (LOG_RING_SIZE - 1)];
+}
+
+/* wake the writer thread up if it waits for the end of the interval, without a lock unless it does */
+void LogWriter::wake()
+{
+    if(_sleeping.testAndSetOrdered(1, 0))
+    {
+        _wakeup.release();
+    }
+}
+
+/* hand the record filled in after next() to the writer thread */
+void LogWriter::push()
+{
+    if(_capture)
+    {
+        return;
+    }
+
+    _queued++;
+    _head.storeRelease(_head.load() + 1);
+}
+
+void LogWriter::text(qint64 time, const QString &line)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        QByteArray s = line.toLocal8Bit();
+
+        r->type = LOG_TEXT;
+        r->time = time;
+        r->text = qstrdup(s.constData());
+        r->length = s.size();
+        push();
+    }
+}
+
+void LogWriter::tagRange(int type, qint64 time, quint64 tag, int k, int range, int range2, int seq, int lnum)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = type;
+        r->time = time;
+        r->id = tag;
+        r->i[0] = k;
+        r->i[1] = range;
+        r->i[2] = range2;
+        r->i[3] = seq;
+        r->i[4] = lnum;
+        push();
+    }
+}
+
+void LogWriter::rangeMask(qint64 time, quint64 tag, int mask, int seq, int lnum)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_RM;
+        r->time = time;
+        r->id = tag;
+        r->i[0] = mask;
+        r->i[1] = seq;
+        r->i[2] = lnum;
+        push();
+    }
+}
+
+void LogWriter::rangeReport(qint64 time, quint64 tag, int mask, const int *ranges, const int *corrected, int seq, int lnum)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_RC;
+        r->time = time;
+        r->id = tag;
+        r->i[0] = mask;
+        memcpy(&r->i[1], ranges, 4 * sizeof(int));
+        memcpy(&r->i[5], corrected, 4 * sizeof(int));
+        r->i[9] = seq;
+        r->i[10] = lnum;
+        push();
+    }
+}
+
+void LogWriter::location(qint64 time, quint64 tag, int count, int seq, const double *xyz, const int *ranges)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = xyz ? LOG_LE : LOG_NL;
+        r->time = time;
+        r->id = tag;
+        r->i[0] = count;
+        r->i[1] = seq;
+        memcpy(&r->i[2], ranges, 4 * sizeof(int));
+
+        if(xyz)
+        {
+            memcpy(r->d, xyz, 3 * sizeof(double));
+        }
+
+        push();
+    }
+}
+
+void LogWriter::anchorRange(qint64 time, int j, int i, int range, int seq, int lnum)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_RA;
+        r->time = time;
+        r->i[0] = j;
+        r->i[1] = i;
+        r->i[2] = range;
+        r->i[3] = seq;
+        r->i[4] = lnum;
+        push();
+    }
+}
+
+void LogWriter::anchorPos(qint64 time, int id, double x, double y, double z)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_AP;
+        r->time = time;
+        r->i[0] = id;
+        r->d[0] = x;
+        r->d[1] = y;
+        r->d[2] = z;
+        push();
+    }
+}
+
+void LogWriter::anchorHealth(qint64 time, int id, int state, double rate, double bias)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_AH;
+        r->time = time;
+        r->i[0] = id;
+        r->i[1] = state;
+        r->d[0] = rate;
+        r->d[1] = bias;
+        push();
+    }
+}
+
+void LogWriter::tagStats(qint64 time, quint64 tag, double x, double y, double z, double r95)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_TS;
+        r->time = time;
+        r->id = tag;
+        r->d[0] = x;
+        r->d[1] = y;
+        r->d[2] = z;
+        r->d[3] = r95;
+        push();
+    }
+}
+
+void LogWriter::rangeStats(qint64 time, quint64 tag, const float *rates, int missing)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_RS;
+        r->time = time;
+        r->id = tag;
+
+        for(int k=0; k<4; k++)
+        {
+            r->d[k] = rates[k];
+        }
+
+        r->i[0] = missing;
+        push();
+    }
+}
+
+void LogWriter::gateStats(qint64 time, quint64 tag, const int *rejected)
+{
+    log_record_t *r = next();
+
+    if(r)
+    {
+        r->type = LOG_RG;
+        r->time = time;
+        r->id = tag;
+        memcpy(r->i, rejected, 4 * sizeof(int));
+        push();
+    }
+}
+
+/* write the buffer up to the last whole block of the file, or all of it (writer thread) */
+void LogWriter::write(bool all)
+{
+    int n = all ? _len : (int) (((_offset + _len) & ~(qint64) (LOG_ALIGN - 1)) - _offset);
+
+    if(n <= 0)
+    {
+        return;
+    }
+
+    qint64 written = _file.isOpen() ? _file.write(_buf, n) : -1;
+
+    //a full disk: the data is lost, but the ring keeps going
+    if(written < n)
+    {
+        _lost += n - qMax(written, 0LL);
+    }
+
+    _offset += qMax(written, 0LL);
+    _len -= n;
+    memmove(_buf, _buf + n, _len);
+
+    if(_len == 0)
+    {
+        _held.restart();
+    }
+}
+
+QString LogWriter::segmentName(int segment) const
+{
+    if(segment == 0)
+    {
+        return _filename;
+    }
+
+    QFileInfo info(_filename);
+
+    return info.path() + "/" + info.completeBaseName() + QString("_%1.").arg(segment, 3, 10, QChar('0')) + info.suffix();
+}
+
+/* hand the closed segment file to the pool (the last one when the log is closed, which is left as written) */
+void LogWriter::finish(bool last)
+{
+    QMutexLocker lock(&_mutex);
+
+    bool compress = _compress && !last;
+
+    if(compress || (_keep > 0))
+    {
+        QString active = last ? QString() : QFileInfo(segmentName(_segment + 1)).absoluteFilePath();
+
+        QtConcurrent::run(&_pool, lw_finish, _file.fileName(), active, compress, _keep * 1048576LL);
+    }
+}
+
+/* close the segment and go on with the next one, which starts at time (writer thread) */
+void LogWriter::rotate(qint64 time)
+{
+    write(true);
+    _file.close();
+    finish(false);
+
+    _segment++;
+    _segmentStart = time;
+    _offset = 0;
+    _held.restart();
+    _file.setFileName(segmentName(_segment));
+
+    if (!_file.open(QFile::ReadWrite | QFile::Unbuffered | ((_format == LOG_FORMAT_TEXT) ? QFile::Text : QFile::NotOpen)))
+    {
+        return;
+    }
+
+    _header.start = time;
+
+    if(_format == LOG_FORMAT_BINARY)
+    {
+        QByteArray h = log_encode_header(&_header);
+
+        _offset = qMax(_file.write(h), 0LL);
+    }
+    else
+    {
+        //the header line of the first segment, then the anchor positions as they are now (the header of a binary
+        //segment has them), written with the records which follow
+        log_record_t r;
+
+        r.type = LOG_TEXT;
+        r.time = time;
+        r.text = _header.text.constData();
+        r.length = _header.text.size();
+        _len = log_format_text(_buf, &r) - _buf;
+
+        r.type = LOG_AP;
+
+        for(int k=0; k<_header.anchors.size(); k++)
+        {
+            r.i[0] = _header.anchors[k].id;
+            r.d[0] = _header.anchors[k].x;
+            r.d[1] = _header.anchors[k].y;
+            r.d[2] = _header.anchors[k].z;
+            _len = log_format_text(_buf + _len, &r) - _buf;
+        }
+    }
+}
+
+/* format and write all the queued records, all of the buffer if all is set (writer thread) */
+void LogWriter::drain(bool all)
+{
+    quint32 tail = _tail.load();
+    quint32 head = _head.loadAcquire();
+    int maxLength = (_format == LOG_FORMAT_TEXT) ? LOG_MAX_TEXT_LINE : LOG_MAX_RECORD;
+
+    while(tail != head)
+    {
+        log_record_t *r = &_ring[tail & (LOG_RING_SIZE - 1)];
+        int length = maxLength + ((r->type == LOG_TEXT) ? r->length : 0);
+
+        if(((_rotateBytes > 0) && (_offset + _len >= _rotateBytes)) || ((_rotateTime > 0) && (r->time - _segmentStart >= _rotateTime)))
+        {
+            rotate(r->time);
+        }
+
+        if(_len + length > LOG_BUFFER_SIZE)
+        {
+            write(length > LOG_BUFFER_SIZE - LOG_ALIGN);
+        }
+
+        if(length > LOG_BUFFER_SIZE)
+        {
+            //a text longer than the buffer: the record without it, then the text
+            log_record_t part = *r;
+
+            part.length = 0;
+            _len = (_format == LOG_FORMAT_TEXT) ? (log_format_text(_buf, &part) - _buf) : log_encode((uchar *) _buf, &part);
+
+            if(_format == LOG_FORMAT_BINARY)
+            {
+                qToLittleEndian<qint32>(r->length, (uchar *) _buf + _len - 4);
+            }
+
+            write(true);
+            _offset += qMax(_file.write(r->text, r->length), 0LL);
+        }
+        else if(_format == LOG_FORMAT_TEXT)
+        {
+            _len = log_format_text(_buf + _len, r) - _buf;
+        }
+        else
+        {
+            _len += log_encode((uchar *) _buf + _len, r);
+        }
+
+        if(r->type == LOG_TEXT)
+        {
+            delete[] r->text;
+        }
+        else if(r->type == LOG_AP)
+        {
+            //a new segment starts with the anchor positions as they are then
+            for(int k=0; k<_header.anchors.size(); k++)
+            {
+                if(_header.anchors[k].id == r->i[0])
+                {
+                    _header.anchors[k].x = r->d[0];
+                    _header.anchors[k].y = r->d[1];
+                    _header.anchors[k].z = r->d[2];
+                }
+            }
+        }
+
+        tail++;
+
+        //let the processing thread have the slots back while the rest is formatted
+        if((tail & 255) == 0)
+        {
+            _tail.storeRelease(tail);
+            head = _head.loadAcquire();
+        }
+    }
+
+    _tail.storeRelease(tail);
+
+    write(all || (_held.elapsed() >= LOG_MAX_HOLD));
+}
+
+void LogWriter::run()
+{
+    while(true)
+    {
+        bool stop;
+        int interval;
+
+        {
+            QMutexLocker lock(&_mutex);
+
+            stop = _stop;
+            interval = _flushInterval;
+            _rotateBytes = _maxSize * 1048576LL;
+            _rotateTime = _maxMinutes * 60000000LL;
+        }
+
+        drain(stop);
+
+        if(stop)
+        {
+            break;
+        }
+
+        //wake() doesn't see the records queued before _sleeping is set, they are checked here
+        _sleeping.fetchAndStoreOrdered(1);
+
+        if((int) (_head.loadAcquire() - _tail.load()) < LOG_RING_SIZE / 2)
+        {
+            _wakeup.tryAcquire(1, interval);
+        }
+
+        //a release after the end of the wait only cuts the next one short
+        _sleeping.fetchAndStoreOrdered(0);
+    }
+}
@@ -0,0 +1,199 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: LogWriter.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QSemaphore>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QFile>
+
+#include "LogRecord.h"
+
+#define LOG_RING_SIZE           (16384) //records, must be a power of 2
+#define LOG_BUFFER_SIZE         (65536) //(bytes) the formatted records are written in chunks of up to this size
+#define LOG_FLUSH_INTERVAL      (100)   //(ms) default time between two writes of the log file
+#define LOG_MIN_FLUSH_INTERVAL  (10)
+#define LOG_MAX_FLUSH_INTERVAL  (1000)  //the ring must hold the records of a whole interval
+#define LOG_OFFSET_INTERVAL     (900000000LL) //(us) the local time offset is looked up again every 15 minutes
+#define LOG_ALIGN               (4096)  //(bytes) the file is written in whole blocks of this size
+#define LOG_MAX_HOLD            (1000)  //(ms) longest time the end of a partly filled block is held back
+#define LOG_MAX_SIZE            (100)   //(MB) default size of a segment
+
+/**
+ * The LogWriter class writes the application log ("T:hhmmsszzz:XX:..." lines) from a thread of its own.
+ *
+ * The processing thread only copies the values of each record into a single producer / single consumer
+ * ring, which doesn't take a lock. The writer thread wakes up every flush interval (or when the ring is
+ * half full, the processing thread then only releases a semaphore, and only if the writer thread waits),
+ * formats all the queued records into a large buffer and writes it in one go, either as text lines or as
+ * binary records (see LogRecord.h). When the ring is
+ * full the new records are dropped and counted, the processing thread never waits for the disk.
+ *
+ * The file is written in whole blocks (LOG_ALIGN), only the end of a partly filled block is written
+ * after LOG_MAX_HOLD. When a segment reaches the size or age of setRotation() the writer thread goes
+ * on with the next one ("..._001.txt" and so on), which starts with the same header (with the current
+ * anchor positions). With setRetention() the segments closed by a rotation are compressed (.gz) one at a
+ * time by a thread of their own, which then removes the oldest logs of the folder while they take up more
+ * than the retention size. The last segment is never compressed.
+ *
+ * All the functions must be called from the same (the processing) thread.
+ */
+class LogWriter : public QThread
+{
+public:
+    LogWriter(QObject *parent = 0);
+    ~LogWriter();
+
+    /**
+     * Open (create) \a filename and start the writer thread. The log starts with \a text (the device version and
+     * configuration, the first line of a text log), a binary log also has the \a anchors in its header.
+     * @param format LOG_FORMAT_TEXT or LOG_FORMAT_BINARY
+     * @return false if the file can't be opened, see errorString()
+     */
+    bool open(const QString &filename, int format, const QString &text, const QVector<log_anchor_t> &anchors);
+
+    /**
+     * Write all the queued records, close the file and stop the writer thread
+     */
+    void close();
+
+    bool isOpen() const;
+    int format() const;
+    QString errorString() const;
+
+    /**
+     * @return the local time (us since 1970-01-01 00:00) for the records
+     */
+    qint64 now();
+
+    /**
+     * Set the time between two writes of the file (ms), limited to the supported range
+     */
+    void setFlushInterval(int ms);
+    int flushInterval() const;
+
+    /**
+     * Start a new segment when the current one reaches \a maxSize (MB) or \a maxMinutes, 0 for no limit
+     */
+    void setRotation(int maxSize, int maxMinutes);
+    int maxSize() const;
+    int maxMinutes() const;
+
+    /**
+     * If \a compress, compress (gzip) the segments closed by a rotation (off by default), and keep up to \a keep (MB)
+     * of logs in the folder of the log, 0 to keep them all. The oldest logs are removed first, the segment being
+     * written never is.
+     */
+    void setRetention(int keep, bool compress);
+    int keep() const;
+    bool compress() const;
+
+    /**
+     * Have the queued records written now, without waiting for them
+     */
+    void flush();
+
+    /**
+     * Append the records to \a records instead of queueing them for the file, NULL to queue them again. Nothing is
+     * dropped then, rtlstool reprocess uses this to merge the records of several threads. The text of a LOG_TEXT
+     * record is a copy, to be deleted with delete[].
+     */
+    void setCapture(QVector<log_record_t> *records);
+
+    /**
+     * Backpressure counters since open(): the records queued, the records dropped because the ring was
+     * full and the highest number of records waiting in the ring
+     */
+    quint64 queued() const;
+    quint64 dropped() const;
+    int maxPending() const;
+
+    /**
+     * The segments written and the bytes which couldn't be written (disk full) since open()
+     */
+    int segments() const;
+    qint64 lost() const;
+
+    /* the records, time from now() */
+    void text(qint64 time, const QString &line);    //line without the time, with the line end
+    void tagRange(int type, qint64 time, quint64 tag, int k, int range, int range2, int seq, int lnum); //LOG_RR or LOG_RJ
+    void rangeMask(qint64 time, quint64 tag, int mask, int seq, int lnum);
+    void rangeReport(qint64 time, quint64 tag, int mask, const int *ranges, const int *corrected, int seq, int lnum);
+    void location(qint64 time, quint64 tag, int count, int seq, const double *xyz, const int *ranges); //xyz NULL for NL
+    void anchorRange(qint64 time, int j, int i, int range, int seq, int lnum);
+    void anchorPos(qint64 time, int id, double x, double y, double z);
+    void anchorHealth(qint64 time, int id, int state, double rate, double bias);
+    void tagStats(qint64 time, quint64 tag, double x, double y, double z, double r95);
+    void rangeStats(qint64 time, quint64 tag, const float *rates, int missing);
+    void gateStats(qint64 time, quint64 tag, const int *rejected);
+
+protected:
+    void run();
+
+private:
+    log_record_t *next();
+    void push();
+    void wake();
+    void drain(bool all);
+    void write(bool all);
+    void rotate(qint64 time);
+    void finish(bool last);
+    QString segmentName(int segment) const;
+
+    QFile _file;
+    bool _open;
+    int _format;
+    QString _filename;              //of the first segment
+    log_header_t _header;           //header of the segments, with the anchor positions of the last AP records
+
+    int _utcOffset;                 //(s) of the local time
+    qint64 _offsetUntil;            //(us) UTC time to look it up again
+
+    log_record_t *_ring;
+    QAtomicInteger<quint32> _head;  //next record to queue, only changed by the processing thread
+    QAtomicInteger<quint32> _tail;  //next record to write, only changed by the writer thread
+    QAtomicInt _sleeping;           //1 while the writer thread waits for _wakeup
+    QSemaphore _wakeup;             //released to wake the writer thread up before the end of the interval
+
+    quint64 _queued;
+    quint64 _dropped;
+    int _maxPending;
+
+    QMutex _mutex;                  //for the fields below, the ring doesn't use it
+    int _flushInterval;
+    bool _stop;
+    int _maxSize;
+    int _maxMinutes;
+    int _keep;
+    bool _compress;
+
+    char *_buf;                     //formatted records not written yet (writer thread)
+    int _len;
+    qint64 _offset;                 //of the end of the segment file
+    QElapsedTimer _held;            //since the buffer was last empty
+    int _segment;                   //number of the segment written
+    qint64 _segmentStart;           //(us) time of its first record
+    qint64 _rotateBytes;            //limits copied from the fields above on each wake up, 0 for none
+    qint64 _rotateTime;
+    qint64 _lost;
+
+    QThreadPool _pool;              //compresses the closed segments, one at a time
+
+    QVector<log_record_t> *_capture; //records kept instead of written, see setCapture()
+};
+
+#endif // LOGWRITER_H
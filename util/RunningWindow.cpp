@@ -0,0 +1,92 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RunningWindow.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "RunningWindow.h"
+
+#include <string.h>
+
+#define RW_MASK (RW_CAPACITY - 1)
+
+void rw_init(running_window_t *w, int size)
+{
+    memset(w, 0, sizeof(running_window_t));
+    w->size = qBound(1, size, RW_CAPACITY);
+}
+
+void rw_push(running_window_t *w, double x)
+{
+    qint64 q = rw_quantise(x);
+    int n = w->n;
+
+    //remove the oldest sample from the sum
+    if(w->count == w->size)
+    {
+        w->sum -= w->v[(n - w->size) & RW_MASK];
+    }
+    else
+    {
+        w->count++;
+    }
+
+    w->v[n & RW_MASK] = q;
+    w->sum += q;
+
+    //drop the samples which have left the window from the front of the queues...
+    if((w->minLen > 0) && (w->minq[w->minHead] <= (n - w->size)))
+    {
+        w->minHead = (w->minHead + 1) & RW_MASK;
+        w->minLen--;
+    }
+    if((w->maxLen > 0) && (w->maxq[w->maxHead] <= (n - w->size)))
+    {
+        w->maxHead = (w->maxHead + 1) & RW_MASK;
+        w->maxLen--;
+    }
+
+    //...and the ones which can't be the minimum/maximum any more from the back
+    while((w->minLen > 0) && (w->v[w->minq[(w->minHead + w->minLen - 1) & RW_MASK] & RW_MASK] >= q))
+    {
+        w->minLen--;
+    }
+    while((w->maxLen > 0) && (w->v[w->maxq[(w->maxHead + w->maxLen - 1) & RW_MASK] & RW_MASK] <= q))
+    {
+        w->maxLen--;
+    }
+
+    w->minq[(w->minHead + w->minLen++) & RW_MASK] = n;
+    w->maxq[(w->maxHead + w->maxLen++) & RW_MASK] = n;
+
+    w->n = n + 1;
+}
+
+double rw_mean(const running_window_t *w)
+{
+    if(w->count == 0)
+    {
+        return 0;
+    }
+
+    return (w->sum / RW_SCALE) / w->count;
+}
+
+double rw_trimmed_mean(const running_window_t *w)
+{
+    if(w->count < 3)
+    {
+        return rw_mean(w);
+    }
+
+    qint64 min = w->v[w->minq[w->minHead] & RW_MASK];
+    qint64 max = w->v[w->maxq[w->maxHead] & RW_MASK];
+
+    return ((w->sum - min - max) / RW_SCALE) / (w->count - 2);
+}
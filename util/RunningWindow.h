@@ -0,0 +1,55 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: RunningWindow.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef RUNNINGWINDOW_H
+#define RUNNINGWINDOW_H
+
+#include <QtGlobal>
+
+#define RW_CAPACITY     (16)        //maximum window size, must be a power of 2
+#define RW_SCALE        (1000000.0) //samples are stored in micrometres so that the running sums are exact
+
+/**
+ * Sliding window over the last \a size samples, with the mean and the mean excluding the minimum and
+ * the maximum available in O(1) after each sample.
+ *
+ * The sum is kept as an integer, so it is always the same as adding up the samples in the window again.
+ * The minimum and maximum are kept with monotonic queues of sample numbers: the front of minq is the
+ * smallest sample in the window, and each later entry is larger than the one before it (maxq likewise).
+ */
+typedef struct
+{
+    qint64 v[RW_CAPACITY];  //samples, v[n % RW_CAPACITY] is sample number n
+    qint64 sum;
+    int size;               //window size
+    int count;              //samples in the window (< size until the window is full)
+    int n;                  //number of the next sample
+
+    int minq[RW_CAPACITY];  //sample numbers, ring buffers
+    int minHead, minLen;
+    int maxq[RW_CAPACITY];
+    int maxHead, maxLen;
+} running_window_t;
+
+void rw_init(running_window_t *w, int size);
+void rw_push(running_window_t *w, double x);
+
+double rw_mean(const running_window_t *w);
+double rw_trimmed_mean(const running_window_t *w); //needs at least 3 samples
+
+/* samples are rounded the same way in the window and in the history sums */
+inline qint64 rw_quantise(double x)
+{
+    return qRound64(x * RW_SCALE);
+}
+
+#endif // RUNNINGWINDOW_H
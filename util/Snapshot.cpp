@@ -0,0 +1,106 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: Snapshot.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "Snapshot.h"
+
+#include <QSaveFile>
+#include <QFile>
+#include <QDebug>
+#include <QtConcurrent>
+#include <string.h>
+#include <zlib.h>
+
+/* compress data and write it to filename (pool thread) */
+static bool ss_write(const QString &filename, qint64 time, const QByteArray &data)
+{
+    QByteArray packed = qCompress(data, 1);
+    snapshot_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RTSS", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.time = time;
+    header.size = data.size();
+    header.length = packed.size();
+    header.crc = crc32(0L, (const Bytef *) packed.constData(), packed.size());
+
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug(qPrintable(QString("Error: Cannot write file %1 %2").arg(filename).arg(file.errorString())));
+        return false;
+    }
+
+    file.write((const char *) &header, sizeof(header));
+    file.write(packed);
+
+    return file.commit();
+}
+
+SnapshotWriter::SnapshotWriter()
+{
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    wait();
+}
+
+bool SnapshotWriter::write(const QString &filename, qint64 time, const QByteArray &data)
+{
+    if(_pending.isRunning())
+    {
+        return false;
+    }
+
+    _pending = QtConcurrent::run(ss_write, filename, time, data);
+
+    return true;
+}
+
+void SnapshotWriter::wait()
+{
+    _pending.waitForFinished();
+}
+
+bool SnapshotWriter::read(const QString &filename, QByteArray *data, qint64 *time)
+{
+    QFile file(filename);
+    snapshot_header_t header;
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    if((file.read((char *) &header, sizeof(header)) != sizeof(header)) || (memcmp(header.magic, "RTSS", 4) != 0) ||
+       (header.version != SNAPSHOT_VERSION) || (file.size() != (qint64)(sizeof(header) + header.length)))
+    {
+        qDebug(qPrintable(QString("Error: Invalid snapshot %1").arg(filename)));
+        return false;
+    }
+
+    QByteArray packed = file.readAll();
+
+    if((packed.size() != (int) header.length) ||
+       (crc32(0L, (const Bytef *) packed.constData(), packed.size()) != header.crc))
+    {
+        qDebug(qPrintable(QString("Error: Invalid snapshot %1").arg(filename)));
+        return false;
+    }
+
+    *data = qUncompress(packed);
+    *time = header.time;
+
+    return (data->size() == (int) header.size);
+}
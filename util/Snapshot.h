@@ -0,0 +1,70 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: Snapshot.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QFuture>
+
+#define SNAPSHOT_VERSION    (1)
+#define SNAPSHOT_INTERVAL   (10)            //(s) default time between two snapshots
+#define SNAPSHOT_MAX_AGE    (60)            //(min) default age of the oldest snapshot which is restored
+
+typedef struct
+{
+    char magic[4];          //"RTSS"
+    qint32 version;         //SNAPSHOT_VERSION
+    qint64 time;            //(ms) since 1970-01-01 UTC, when the snapshot was taken
+    quint32 size;           //(bytes) of the data before it was compressed
+    quint32 length;         //(bytes) of the compressed data which follows the header
+    quint32 crc;            //CRC-32 of the compressed data
+    quint32 reserved;
+} snapshot_header_t;
+
+/**
+ * The SnapshotWriter class saves the state of the application (an opaque blob, see TagProcessor::saveState()) to
+ * a snapshot file, which is read back at startup so the processing goes on where it stopped.
+ *
+ * The blob is compressed and written by a thread of the global pool, the caller only copies it (QByteArray is
+ * implicitly shared). A snapshot is skipped while the one before is still being written. The file is replaced
+ * atomically (QSaveFile), so a crash while it is written leaves the previous snapshot.
+ */
+class SnapshotWriter
+{
+public:
+    SnapshotWriter();
+    ~SnapshotWriter();
+
+    /**
+     * Write \a data taken at \a time (ms since 1970-01-01 UTC) to \a filename.
+     * @return false if the snapshot before is still being written (this one is skipped)
+     */
+    bool write(const QString &filename, qint64 time, const QByteArray &data);
+
+    /**
+     * Wait until the snapshot being written (if any) is in the file
+     */
+    void wait();
+
+    /**
+     * Read the snapshot \a filename into \a data and the time it was taken into \a time.
+     * @return false if there isn't any, or it is not a valid snapshot of this version
+     */
+    static bool read(const QString &filename, QByteArray *data, qint64 *time);
+
+private:
+    QFuture<bool> _pending;
+};
+
+#endif // SNAPSHOT_H
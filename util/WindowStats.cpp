@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: WindowStats.cpp
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#include "WindowStats.h"
+
+#include <math.h>
+#include <algorithm>
+
+/* N > 0: kernel for windows of N samples, N = 0: any window of n samples */
+template<int N>
+static double r95Kernel(const double *x, const double *y, int n, double avx, double avy, double *cx, double *cy)
+{
+    const int len = (N > 0) ? N : n;
+    double DistanceXY[(N > 0) ? N : WS_MAX_SAMPLES];
+    double DstCentreXY[(N > 0) ? N : WS_MAX_SAMPLES];
+    double avDistanceXY = 0;
+    double sum_std = 0;
+    double stdevXY = 0;
+    double sumx = 0, sumy = 0;
+    int counterXY = 0;
+
+    for(int j=0; j<len; j++)
+    {
+        DistanceXY[j] = sqrt((x[j] - avx)*(x[j] - avx) + (y[j] - avy)*(y[j] - avy));
+    }
+
+    for(int j=0; j<len; j++)
+    {
+        avDistanceXY += DistanceXY[j]/len;
+    }
+
+    for(int j=0; j<len; j++)
+    {
+        sum_std += (DistanceXY[j]-avDistanceXY)*(DistanceXY[j]-avDistanceXY);
+    }
+
+    stdevXY = sqrt(sum_std/len);
+
+    for(int j=0; j<len; j++)
+    {
+        if(DistanceXY[j] < stdevXY*2)
+        {
+            sumx += x[j];
+            sumy += y[j];
+            counterXY++;
+        }
+    }
+
+    *cx = sumx/counterXY;
+    *cy = sumy/counterXY;
+
+    for(int j=0; j<len; j++)
+    {
+        DstCentreXY[j] = sqrt((x[j] - *cx)*(x[j] - *cx) + (y[j] - *cy)*(y[j] - *cy));
+    }
+
+    //only one element is needed, so select it rather than sorting the whole array
+    std::nth_element(DstCentreXY, DstCentreXY + int(0.95*len), DstCentreXY + len);
+
+    return DstCentreXY[int(0.95*len)];
+}
+
+double ws_r95(const double *x, const double *y, int n, double avx, double avy, double *cx, double *cy)
+{
+    n = qBound(1, n, WS_MAX_SAMPLES);
+
+    switch(n)
+    {
+        case 25:
+            return r95Kernel<25>(x, y, n, avx, avy, cx, cy);
+        case 50:
+            return r95Kernel<50>(x, y, n, avx, avy, cx, cy);
+        case 100:
+            return r95Kernel<100>(x, y, n, avx, avy, cx, cy);
+        default:
+            return r95Kernel<0>(x, y, n, avx, avy, cx, cy);
+    }
+}
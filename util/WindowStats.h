@@ -0,0 +1,30 @@
+// -------------------------------------------------------------------------------------------------------------------
+//
+//  File: WindowStats.h
+//
+//  Copyright 2016 (c) Decawave Ltd, Dublin, Ireland.
+//
+//  All rights reserved.
+//
+//  Author:
+//
+// -------------------------------------------------------------------------------------------------------------------
+
+#ifndef WINDOWSTATS_H
+#define WINDOWSTATS_H
+
+#include <QtGlobal>
+
+#define WS_MAX_SAMPLES  (128)   //largest window
+
+/*
+ * Statistics over a window of n samples. The window sizes are set at run time, the common ones (25, 50 and
+ * 100 samples) use kernels built for that size so the loops are unrolled/vectorised, the others use the same
+ * code with the size as a parameter.
+ */
+
+/* R95 of the positions x, y with average avx, avy: the radius around the centre of the positions (leaving out
+   the outliers) which contains 95% of them, the centre is returned in cx, cy */
+double ws_r95(const double *x, const double *y, int n, double avx, double avy, double *cx, double *cy);
+
+#endif // WINDOWSTATS_H
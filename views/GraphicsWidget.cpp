@@ -17,15 +17,18 @@
 #include "ViewSettings.h"
 
 #include <QDomDocument>
+#include <QDataStream>
 #include <QGraphicsScene>
 #include <QGraphicsItem>
 #include <QGraphicsItemGroup>
 #include <QGraphicsRectItem>
+#include <QPainterPath>
 #include <QDebug>
 #include <QInputDialog>
 #include <QFile>
 #include <QPen>
 #include <QDesktopWidget>
+#include <math.h>
 
 #define PEN_WIDTH (0.04)
 #define ANC_SIZE (0.15)
@@ -53,6 +56,7 @@ GraphicsWidget::GraphicsWidget(QWidget *parent) :
     QStringList tableHeader;
     tableHeader << "Tag ID/Label" << "X\n(m)" << "Y\n(m)" << "Z\n(m)" << "R95 \n(m)"
                 << "Anc 0\n range (m)" << "Anc 1\n range (m)" << "Anc 2\n range (m)" << "Anc 3\n range (m)"
+                << "Link (%)\n1s/10s/60s"
                    ;
     ui->tagTable->setHorizontalHeaderLabels(tableHeader);
 
@@ -68,6 +72,7 @@ GraphicsWidget::GraphicsWidget(QWidget *parent) :
     ui->tagTable->setColumnWidth(ColumnRA1,70);
     ui->tagTable->setColumnWidth(ColumnRA2,70);
     ui->tagTable->setColumnWidth(ColumnRA3,70);
+    ui->tagTable->setColumnWidth(ColumnLink,90);
 
     ui->tagTable->setColumnHidden(ColumnIDr, true); //ID raw hex
     //ui->tagTable->setColumnWidth(ColumnIDr,70); //ID raw hex
@@ -78,25 +83,17 @@ GraphicsWidget::GraphicsWidget(QWidget *parent) :
     }
 
     //anchorTable
-    //Anchor ID, x, y, z,
+    //Anchor ID, x, y, z, health, then the tag range corrections (cm), one column per tag (see correctionColumn())
     QStringList anchorHeader;
-    anchorHeader << "Anchor ID" << "X\n(m)" << "Y\n(m)" << "Z\n(m)"
-                    << "T0\n(cm)" << "T1\n(cm)" << "T2\n(cm)" << "T3\n(cm)"
-                    << "T4\n(cm)" << "T5\n(cm)" << "T6\n(cm)" << "T7\n(cm)" ;
+    anchorHeader << "Anchor ID" << "X\n(m)" << "Y\n(m)" << "Z\n(m)" << "Health" ;
+    ui->anchorTable->setColumnCount(AnchorColumnTag0);
     ui->anchorTable->setHorizontalHeaderLabels(anchorHeader);
 
     ui->anchorTable->setColumnWidth(ColumnID,100);    //ID
     ui->anchorTable->setColumnWidth(ColumnX,55); //x
     ui->anchorTable->setColumnWidth(ColumnY,55); //y
     ui->anchorTable->setColumnWidth(ColumnZ,55); //z
-    ui->anchorTable->setColumnWidth(4,55); //t0
-    ui->anchorTable->setColumnWidth(5,55); //t1
-    ui->anchorTable->setColumnWidth(6,55); //t2
-    ui->anchorTable->setColumnWidth(7,55); //t3
-    ui->anchorTable->setColumnWidth(8,55); //t4
-    ui->anchorTable->setColumnWidth(9,55); //t5
-    ui->anchorTable->setColumnWidth(10,55); //t6
-    ui->anchorTable->setColumnWidth(11,55); //t7
+    ui->anchorTable->setColumnWidth(AnchorColumnHealth,80);
 
     //hide Anchor/Tag range corection table
     hideTACorrectionTable(true);
@@ -113,6 +110,7 @@ GraphicsWidget::GraphicsWidget(QWidget *parent) :
     _ignore = true;
 
     _selectedTagIdx = -1;
+    _colourH = 0.1;
 
     zone1 = NULL;
     zone2 = NULL;
@@ -132,6 +130,10 @@ GraphicsWidget::GraphicsWidget(QWidget *parent) :
     _line01 = NULL;
     _line02 = NULL;
     _line12 = NULL;
+
+    _areaRect = NULL;
+    _areaFrom = 0;
+    _areaTo = 0;
     RTLSDisplayApplication::connectReady(this, "onReady()");
 }
 
@@ -143,6 +145,7 @@ void GraphicsWidget::onReady()
     QObject::connect(ui->anchorTable, SIGNAL(cellClicked(int, int)), this, SLOT(anchorTableClicked(int, int)));
     QObject::connect(ui->tagTable, SIGNAL(itemSelectionChanged()), this, SLOT(itemSelectionChanged()));
     QObject::connect(ui->anchorTable, SIGNAL(itemSelectionChanged()), this, SLOT(itemSelectionChangedAnc()));
+    QObject::connect(ui->graphicsView, SIGNAL(visibleRectChanged(QRectF)), this, SLOT(visibleRectChanged(QRectF)));
 
     QObject::connect(this, SIGNAL(centerAt(double,double)), graphicsView(), SLOT(centerAt(double, double)));
     QObject::connect(this, SIGNAL(centerRect(QRectF)), graphicsView(), SLOT(centerRect(QRectF)));
@@ -223,14 +226,45 @@ void GraphicsWidget::loadConfigFile(QString filename)
 
 void GraphicsWidget::hideTACorrectionTable(bool hidden)
 {
-    ui->anchorTable->setColumnHidden(4,hidden); //t0
-    ui->anchorTable->setColumnHidden(5,hidden); //t1
-    ui->anchorTable->setColumnHidden(6,hidden); //t2
-    ui->anchorTable->setColumnHidden(7,hidden); //t3
-    ui->anchorTable->setColumnHidden(8,hidden); //t4
-    ui->anchorTable->setColumnHidden(9,hidden); //t5
-    ui->anchorTable->setColumnHidden(10,hidden); //t6
-    ui->anchorTable->setColumnHidden(11,hidden); //t7
+    _corrHidden = hidden;
+
+    for(int col = AnchorColumnTag0; col < ui->anchorTable->columnCount(); col++)
+    {
+        ui->anchorTable->setColumnHidden(col, hidden);
+    }
+}
+
+int GraphicsWidget::correctionColumn(quint64 tagId)
+{
+    RTLSClient *client = RTLSDisplayApplication::instance()->client();
+    int i = _corrIndex.value(tagId);
+    bool ignore = _ignore;
+
+    if(i >= 0)
+    {
+        return AnchorColumnTag0 + i;
+    }
+
+    i = _corrTags.size();
+    _corrIndex.insert(tagId, i);
+    _corrTags.append(tagId);
+
+    _ignore = true;
+    ui->anchorTable->insertColumn(AnchorColumnTag0 + i);
+    ui->anchorTable->setHorizontalHeaderItem(AnchorColumnTag0 + i, new QTableWidgetItem(QString("T%1\n(cm)").arg(tagId)));
+    ui->anchorTable->setColumnWidth(AnchorColumnTag0 + i, 55);
+    ui->anchorTable->setColumnHidden(AnchorColumnTag0 + i, _corrHidden);
+
+    for(int ridx = 0; ridx < ui->anchorTable->rowCount(); ridx++)
+    {
+        QTableWidgetItem* item = new QTableWidgetItem();
+        item->setText(QString::number(client->tagCorrection(ridx, tagId)));
+        item->setTextAlignment(Qt::AlignHCenter);
+        ui->anchorTable->setItem(ridx, AnchorColumnTag0 + i, item);
+    }
+    _ignore = ignore;
+
+    return AnchorColumnTag0 + i;
 }
 
 
@@ -351,7 +385,7 @@ void GraphicsWidget::clearTags(void)
                 }
             }
             {
-                QMap<quint64, Tag*>::iterator i = _tags.find(tagID);
+                QHash<quint64, Tag*>::iterator i = _tags.find(tagID);
 
                 if(i != _tags.end()) _tags.erase(i);
             }
@@ -466,18 +500,12 @@ void GraphicsWidget::anchorTableChanged(int r, int c)
                 }
             }
             break;
-            case 4:
-            case 5:
-            case 6:
-            case 7:
-            case 8:
-            case 9:
-            case 10:
-            case 11:
+            default:
+            if(c >= AnchorColumnTag0)
             {
                 int value = (ui->anchorTable->item(r,c)->text()).toInt(&ok);
                 if(ok)
-                    emit updateTagCorrection(r, c-4, value);
+                    emit updateTagCorrection(r, _corrTags.at(c - AnchorColumnTag0), value);
             }
             break;
         }
@@ -628,16 +656,23 @@ void GraphicsWidget::insertTag(int ridx, QString &t, bool showR95, bool showLabe
  * @brief  insert Anchor/Tag correction values into the anchorTable at row ridx
  *
  * */
-void GraphicsWidget::insertAnchor(int ridx, double x, double y, double z,int *array, bool show)
+void GraphicsWidget::insertAnchor(int ridx, double x, double y, double z, bool show)
 {
-    int i = 0;
+    RTLSClient *client = RTLSDisplayApplication::instance()->client();
     _ignore = true;
 
-    //add tag offsets
-    for( int col = 4 ; col < ui->anchorTable->columnCount(); col++)
+    //add a column for each tag with a correction, then the tag offsets
+    const RangeCorrections &corrections = client->corrections();
+
+    for(int row = 0; row < corrections.rows(); row++)
+    {
+        correctionColumn(corrections.rowTag(row));
+    }
+
+    for( int col = AnchorColumnTag0 ; col < ui->anchorTable->columnCount(); col++)
     {
         QTableWidgetItem* item = new QTableWidgetItem();
-        item->setText(QString::number(array[i]));
+        item->setText(QString::number(client->tagCorrection(ridx, _corrTags.at(col-AnchorColumnTag0))));
         item->setTextAlignment(Qt::AlignHCenter);
         //item->setFlags((item->flags() ^ Qt::ItemIsEditable) | Qt::ItemIsSelectable);
         ui->anchorTable->setItem(ridx, col, item);
@@ -656,6 +691,15 @@ void GraphicsWidget::insertAnchor(int ridx, double x, double y, double z,int *ar
     ui->anchorTable->setItem(ridx, ColumnY, itemy);
     ui->anchorTable->setItem(ridx, ColumnZ, itemz);
 
+    if(!ui->anchorTable->item(ridx, AnchorColumnHealth))
+    {
+        QTableWidgetItem *itemh = new QTableWidgetItem();
+
+        itemh->setTextAlignment(Qt::AlignHCenter);
+        itemh->setFlags((itemh->flags() ^ Qt::ItemIsEditable) | Qt::ItemIsSelectable);
+        ui->anchorTable->setItem(ridx, AnchorColumnHealth, itemh);
+    }
+
     {
         QTableWidgetItem *pItem = new QTableWidgetItem();
 
@@ -686,7 +730,6 @@ void GraphicsWidget::insertAnchor(int ridx, double x, double y, double z,int *ar
  * */
 void GraphicsWidget::addNewTag(quint64 tagId)
 {
-    static double c_h = 0.1;
     Tag *tag;
     int tid = tagId ;
     QString taglabel = QString("Tag %1").arg(tid); //taglabels.value(tagId, NULL);
@@ -699,10 +742,10 @@ void GraphicsWidget::addNewTag(quint64 tagId)
     tag = this->_tags.value(tagId, NULL);
     tag->p.resize(_historyLength);
 
-    c_h += 0.568034;
-    if (c_h >= 1)
-        c_h -= 1;
-    tag->colourH = c_h;
+    _colourH += 0.568034;
+    if (_colourH >= 1)
+        _colourH -= 1;
+    tag->colourH = _colourH;
     tag->colourS = 0.55;
     tag->colourV = 0.98;
 
@@ -742,6 +785,107 @@ void GraphicsWidget::addNewTag(quint64 tagId)
         tag->tagLabel->setPen(pen);
         this->_scene->addItem(tag->tagLabel);
     }
+
+    //and a column for its range corrections in the anchor table
+    correctionColumn(tagId);
+}
+
+/**
+ * @fn    saveState
+ * @brief  save the tags of the tag table, to show them again when the application is restarted
+ *
+ * */
+QByteArray GraphicsWidget::saveState() const
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+
+    out << _colourH;
+
+    //in the order of the table
+    for(int r=0; r<ui->tagTable->rowCount(); r++)
+    {
+        QTableWidgetItem *item = ui->tagTable->item(r, ColumnIDr);
+        bool ok;
+        quint64 id = item ? item->text().toULongLong(&ok, 16) : 0;
+        Tag *tag = item ? _tags.value(id, NULL) : NULL;
+
+        if(!tag)
+        {
+            continue;
+        }
+
+        out << id << tag->tagLabelStr << tag->showLabel << (tag->tagLabel->opacity() > 0) << tag->r95Show;
+        out << tag->colourH << tag->colourS << tag->colourV;
+        out << ui->tagTable->item(r, ColumnX)->text().toDouble() << ui->tagTable->item(r, ColumnY)->text().toDouble()
+            << ui->tagTable->item(r, ColumnZ)->text().toDouble();
+    }
+
+    return state;
+}
+
+/**
+ * @fn    restoreState
+ * @brief  add the tags saved with saveState() to the tag table, with their colour and last position
+ *
+ * */
+bool GraphicsWidget::restoreState(const QByteArray &state)
+{
+    QDataStream in(state);
+    double colourH;
+
+    in >> colourH;
+
+    if((in.status() != QDataStream::Ok) || !_tags.isEmpty() || ui->tagTable->rowCount())
+    {
+        return false;
+    }
+
+    while(!in.atEnd())
+    {
+        quint64 id;
+        QString label;
+        bool showLabel, labelShown, r95Show;
+        double h, s, v, x, y, z;
+
+        in >> id >> label >> showLabel >> labelShown >> r95Show >> h >> s >> v >> x >> y >> z;
+
+        if(in.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        if(_tags.contains(id))
+        {
+            continue;
+        }
+
+        QString t;
+        Tag *tag;
+
+        addNewTag(id);
+        tag = _tags.value(id, NULL);
+
+        tag->colourH = h;
+        tag->colourS = s;
+        tag->colourV = v;
+        tag->r95Show = r95Show;
+        tag->showLabel = showLabel;
+        tag->tagLabelStr = label;
+        tag->tagLabel->setText(label);
+        tag->tagLabel->setOpacity(labelShown ? 1.0 : 0.0);
+
+        tagIDToString(id, &t);
+        tag->ridx = ui->tagTable->rowCount();
+        insertTag(tag->ridx, t, tag->r95Show, tag->showLabel, tag->tagLabelStr);
+
+        //the first point of the tag, in its colour
+        tagPos(id, x, y, z);
+    }
+
+    _colourH = colourH;
+
+    return true;
 }
 
 /**
@@ -841,6 +985,120 @@ void GraphicsWidget::tagPos(quint64 tagId, double x, double y, double z)
 	}
 }
 
+/**
+ * @fn    tagVel
+ * @brief  show the tag speed (estimated by the Kalman filter) in the tooltip of its label and table row
+ *
+ * */
+void GraphicsWidget::tagVel(quint64 tagId, double vx, double vy, double vz)
+{
+    Tag *tag = _tags.value(tagId, NULL);
+
+    if(_busy || !tag)
+    {
+        return;
+    }
+
+    QString t;
+    double speed = sqrt(vx*vx + vy*vy + vz*vz);
+
+    tagIDToString(tagId, &t);
+    t += QString(" %1 m/s").arg(QString::number(speed, 'f', 2));
+
+    tag->tagLabel->setToolTip(t);
+
+    QTableWidgetItem *item = ui->tagTable->item(tag->ridx, ColumnID);
+
+    if(item)
+    {
+        _ignore = true;
+        item->setToolTip(t);
+        _ignore = false;
+    }
+}
+
+/* success rates as "1 s/10 s/60 s" */
+static QString linkRates(double r1, double r10, double r60)
+{
+    double r[3] = {r1, r10, r60};
+    QStringList s;
+
+    for(int i=0; i<3; i++)
+    {
+        s << ((r[i] < 0) ? QString("-") : QString::number(r[i], 'f', 0));
+    }
+
+    return s.join("/");
+}
+
+/**
+ * @fn    tagLink
+ * @brief  show the % of range reports received from the tag (over the last 1, 10 and 60 s) in the table
+ *
+ * */
+void GraphicsWidget::tagLink(quint64 tagId, double r1, double r10, double r60)
+{
+    Tag *tag = _tags.value(tagId, NULL);
+
+    if(_busy || !tag)
+    {
+        return;
+    }
+
+    QTableWidgetItem *item = ui->tagTable->item(tag->ridx, ColumnLink);
+
+    if(item)
+    {
+        _ignore = true;
+        item->setText(linkRates(r1, r10, r60));
+        _ignore = false;
+    }
+}
+
+/**
+ * @fn    ancLink
+ * @brief  show the % of ranges received between the tag and the anchor in the tooltip of the range
+ *
+ * */
+void GraphicsWidget::ancLink(quint64 tagId, quint64 aId, double r1, double r10, double r60)
+{
+    Tag *tag = _tags.value(tagId, NULL);
+
+    if(_busy || !tag)
+    {
+        return;
+    }
+
+    QTableWidgetItem *item = ui->tagTable->item(tag->ridx, ColumnRA0 + (aId & 0x3));
+
+    if(item)
+    {
+        _ignore = true;
+        item->setToolTip(QString("Ranges received (%) 1s/10s/60s: ") + linkRates(r1, r10, r60));
+        _ignore = false;
+    }
+}
+
+/**
+ * @fn    anchHealth
+ * @brief  show the anchor health state in the anchor table, with the % of ranges received and the bias in the tooltip
+ *
+ * */
+void GraphicsWidget::anchHealth(quint64 anchId, int state, double rate, double bias)
+{
+    static const char *names[] = {"-", "OK", "intermittent", "dead", "biased (excluded)"};
+    QTableWidgetItem *item = (anchId < MAX_NUM_ANCS) ? ui->anchorTable->item(anchId, AnchorColumnHealth) : NULL;
+
+    if(!item || (state < AH_UNKNOWN) || (state > AH_BIASED))
+    {
+        return;
+    }
+
+    _ignore = true;
+    item->setText(names[state]);
+    item->setToolTip(QString("%1 % ranges received, bias %2 m").arg(QString::number(rate, 'f', 1)).arg(QString::number(bias, 'f', 3)));
+    _ignore = false;
+}
 
 void GraphicsWidget::tagStats(quint64 tagId, double x, double y, double z, double r95)
 {
@@ -1514,7 +1772,7 @@ void GraphicsWidget::setShowTagHistory(bool set)
         //for each tag
         if(set == false) //we want to hide history - clear the array
         {
-            QMap<quint64, Tag*>::iterator i = _tags.begin();
+            QHash<quint64, Tag*>::iterator i = _tags.begin();
 
             while(i != _tags.end())
             {
@@ -1651,7 +1909,7 @@ void GraphicsWidget::anchPos(quint64 anchId, double x, double y, double z, bool
         if(!anc) //add new anchor to the anchors array
         {
             addNewAnchor(anchId, show);
-            insertAnchor(anchId, x, y, z, RTLSDisplayApplication::instance()->client()->getTagCorrections(anchId), show);
+            insertAnchor(anchId, x, y, z, show);
             anc = this->_anchors.value(anchId, NULL);
         }
 
@@ -1714,3 +1972,156 @@ void GraphicsWidget::anchTableEditing(bool enable)
     }
 
 }
+
+/**
+ * @fn    showAreaPaths
+ * @brief  show the area searched and the paths of the tags which were in it
+ *
+ * */
+void GraphicsWidget::showAreaPaths(const QRectF &area, const QVector<quint64> &tags, qint64 from, qint64 to)
+{
+    QPen pen = QPen(QColor::fromRgb(85, 60, 150, 255));
+
+    clearAreaPaths();
+
+    pen.setStyle(Qt::DashLine);
+    pen.setWidthF(PEN_WIDTH);
+    _areaRect = this->_scene->addRect(area.normalized(), pen);
+
+    _areaTags = tags;
+    _areaFrom = from;
+    _areaTo = to;
+    _areaPaths.fill(NULL, tags.size());
+    _areaLevels.fill(PS_RAW - 1, tags.size());
+
+    for(int i=0; i<tags.size(); i++)
+    {
+        areaPath(i);
+    }
+}
+
+/**
+ * @fn    areaPath
+ * @brief  draw the path of tag i of the area from the fixes, or from the rollups when the view is zoomed out
+ *         enough for them to look the same (their extent is less than a pixel)
+ *
+ * */
+void GraphicsWidget::areaPath(int i)
+{
+    PositionStore *positions = RTLSDisplayApplication::client()->positions();
+    quint64 tagId = _areaTags.at(i);
+    double pixel = 1.0 / qMax(qAbs(ui->graphicsView->transform().m11()), 1e-6);
+    int level = positions->pathLevel(tagId, _areaFrom, _areaTo, pixel);
+
+    if(level == _areaLevels.at(i))
+    {
+        return;
+    }
+
+    if(_areaPaths.at(i))
+    {
+        this->_scene->removeItem(_areaPaths.at(i));
+        delete _areaPaths.at(i);
+        _areaPaths[i] = NULL;
+    }
+
+    _areaLevels[i] = level;
+
+    QVector<QPointF> points;
+
+    if(level == PS_RAW)
+    {
+        QVector<position_fix_t> fixes;
+
+        positions->query(tagId, _areaFrom, _areaTo, &fixes);
+
+        for(int k=0; k<fixes.size(); k++)
+        {
+            points.append(QPointF(fixes.at(k).x, fixes.at(k).y));
+        }
+    }
+    else
+    {
+        QVector<position_rollup_t> periods;
+
+        positions->rollups(tagId, level, _areaFrom, _areaTo, &periods);
+
+        for(int k=0; k<periods.size(); k++)
+        {
+            points.append(QPointF(periods.at(k).x, periods.at(k).y));
+        }
+    }
+
+    if(points.isEmpty())
+    {
+        return;
+    }
+
+    QPainterPath path(points.at(0));
+
+    for(int k=1; k<points.size(); k++)
+    {
+        path.lineTo(points.at(k));
+    }
+
+    //same colour as the tag, if it is shown
+    Tag *tag = this->_tags.value(tagId, NULL);
+    QColor c = tag ? QColor::fromHsvF(tag->colourH, tag->colourS, tag->colourV).darker() : QColor(Qt::red);
+    QPen p = QPen(c);
+    QString t;
+    const char *resolution[PS_LEVELS + 1] = {"all positions", "1 s", "1 min", "1 h"};
+
+    p.setWidthF(2 * PEN_WIDTH);
+    p.setCapStyle(Qt::RoundCap);
+    p.setJoinStyle(Qt::RoundJoin);
+
+    QGraphicsPathItem *item = this->_scene->addPath(path, p);
+
+    tagIDToString(tagId, &t);
+    item->setToolTip(QString("%1: %2 m (%3)").arg(t).arg(positions->distance(tagId, _areaFrom, _areaTo), 0, 'f', 1)
+                     .arg(resolution[level + 1]));
+    _areaPaths[i] = item;
+}
+
+/**
+ * @fn    visibleRectChanged
+ * @brief  draw the paths of the area at the resolution of the new zoom
+ *
+ * */
+void GraphicsWidget::visibleRectChanged(const QRectF &rect)
+{
+    Q_UNUSED(rect)
+
+    for(int i=0; i<_areaTags.size(); i++)
+    {
+        areaPath(i);
+    }
+}
+
+void GraphicsWidget::clearAreaPaths(void)
+{
+    for(int i=0; i<_areaPaths.size(); i++)
+    {
+        if(_areaPaths.at(i))
+        {
+            this->_scene->removeItem(_areaPaths.at(i));
+            delete _areaPaths.at(i);
+        }
+    }
+
+    _areaPaths.clear();
+    _areaLevels.clear();
+    _areaTags.clear();
+
+    if(_areaRect)
+    {
+        this->_scene->removeItem(_areaRect);
+        delete _areaRect;
+        _areaRect = NULL;
+    }
+}
+
+QString GraphicsWidget::tagLabel(quint64 tagId)
+{
+    return _tagLabels.value(tagId, QString());
+}
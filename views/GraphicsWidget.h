@@ -17,7 +17,9 @@
 #include <QWidget>
 #include <QAbstractItemView>
 #include <QGraphicsView>
+#include <QHash>
 #include "RTLSClient.h"
+#include "IdMap.h"
 
 namespace Ui {
 class GraphicsWidget;
@@ -29,6 +31,7 @@ class QModelIndex;
 class GraphicsView;
 class QAbstractGraphicsShapeItem;
 class QGraphicsItem;
+class QGraphicsPathItem;
 
 struct Tag
 {
@@ -92,10 +95,16 @@ public:
         ColumnRA1,
         ColumnRA2,
         ColumnRA3,
+        ColumnLink,      ///< % of range reports received over 1 s, 10 s and 60 s
         ColumnIDr,       ///< ID raw (hex) hidden
         ColumnCount
     };
 
+    enum AnchorColumn {
+        AnchorColumnHealth = 4, ///< anchor health (AH_xxx)
+        AnchorColumnTag0 = 5    ///< range correction (cm) of the first tag of _corrTags, one column per tag follows
+    };
+
     explicit GraphicsWidget(QWidget *parent = 0);
     ~GraphicsWidget();
 
@@ -106,15 +115,34 @@ public:
     void tagIDToString(quint64 tagId, QString *t);
     void addNewTag(quint64 tagId);
     void addNewAnchor(quint64 ancId, bool show);
-    void insertAnchor(int ridx, double x, double y, double z, int *array, bool show);
+    void insertAnchor(int ridx, double x, double y, double z, bool show);
     void loadConfigFile(QString filename);
     void saveConfigFile(QString filename);
 
     void hideTACorrectionTable(bool hidden);
 
+    /**
+     * Show \a area and the paths of \a tags from \a from to \a to (ms), from the position history of the client,
+     * instead of the ones shown before. The paths are drawn from the rollups of the history when the view is zoomed
+     * out enough, see PositionStore::pathLevel().
+     */
+    void showAreaPaths(const QRectF &area, const QVector<quint64> &tags, qint64 from, qint64 to);
+    QString tagLabel(quint64 tagId);
+
+    /**
+     * @return the tags of the table (labels, colours, the check boxes and the last positions), for restoreState()
+     */
+    QByteArray saveState() const;
+
+    /**
+     * Add the tags saved by saveState() to the table and the scene, before any tag is shown
+     * @return false if there are tags already or the state can't be read
+     */
+    bool restoreState(const QByteArray &state);
+
 signals:
     void updateAnchorXYZ(int id, int x, double value);
-    void updateTagCorrection(int aid, int tid, int value);
+    void updateTagCorrection(int aid, quint64 tid, int value);
     void centerAt(double x, double y);
     void centerRect(const QRectF &visibleRect);
 
@@ -127,9 +155,13 @@ public slots:
 
     void tagPos(quint64 tagId, double x, double y, double z);
     void tagStats(quint64 tagId, double x, double y, double z, double r95);
+    void tagVel(quint64 tagId, double vx, double vy, double vz);
     void tagRange(quint64 tagId, quint64 aId, double range);
+    void tagLink(quint64 tagId, double r1, double r10, double r60);
+    void ancLink(quint64 tagId, quint64 aId, double r1, double r10, double r60);
 
     void anchPos(quint64 anchId, double x, double y, double z, bool show, bool updatetable);
+    void anchHealth(quint64 anchId, int state, double rate, double bias);
 
     void tagTableChanged(int r, int c);
     void anchorTableChanged(int r, int c);
@@ -138,6 +170,8 @@ public slots:
     void itemSelectionChanged(void);
     void itemSelectionChangedAnc(void);
     void clearTags(void);
+    void clearAreaPaths(void);
+    void visibleRectChanged(const QRectF &rect);
 
     void setShowTagHistory(bool);
     void setShowTagAncTable(bool anchorTable, bool tagTable, bool ancTagCorr);
@@ -154,12 +188,19 @@ protected slots:
 
 protected:
     void tagHistory(quint64 tagId);
+    void areaPath(int i);
+
+    /**
+     * Add a range correction column of \a tagId to the anchor table, if it has none
+     * @return the column of \a tagId
+     */
+    int correctionColumn(quint64 tagId);
 
 private:
     Ui::GraphicsWidget *ui;
     QGraphicsScene *_scene;
 
-    QMap<quint64, Tag*> _tags;
+    QHash<quint64, Tag*> _tags;
     QMap<quint64, Anchor *> _anchors;
     QMap<quint64, QString> _tagLabels;
     float _tagSize;
@@ -172,6 +213,11 @@ private:
     bool _alarmOut;
 
     int _selectedTagIdx;
+    double _colourH;                //hue of the last tag added, the next one is 0.568 further round
+
+    QVector<quint64> _corrTags;     //tag of each range correction column of the anchor table
+    IdMap _corrIndex;               //tag ID to index in _corrTags
+    bool _corrHidden;
 
     QAbstractGraphicsShapeItem *zone1;
     QAbstractGraphicsShapeItem *zone2;
@@ -188,6 +234,13 @@ private:
     QGraphicsLineItem * _line02;
     QGraphicsLineItem * _line12;
 
+    QGraphicsRectItem *_areaRect;   //area and paths of the tags found in it, see showAreaPaths()
+    QVector<quint64> _areaTags;
+    QVector<QGraphicsPathItem *> _areaPaths;    //of each tag, NULL if it has no fixes
+    QVector<int> _areaLevels;       //the paths are drawn from, PS_RAW or a rollup level
+    qint64 _areaFrom;
+    qint64 _areaTo;
+
 };
 
 #endif // GRAPHICSWIDGET_H
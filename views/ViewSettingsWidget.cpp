@@ -18,11 +18,14 @@
 #include "ViewSettings.h"
 #include "OriginTool.h"
 #include "ScaleTool.h"
+#include "RubberBandTool.h"
 #include "GraphicsView.h"
 #include "GraphicsWidget.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QDateTime>
+#include <QElapsedTimer>
 
 ViewSettingsWidget::ViewSettingsWidget(QWidget *parent) :
     QWidget(parent),
@@ -35,6 +38,7 @@ ViewSettingsWidget::ViewSettingsWidget(QWidget *parent) :
     //ui->tabWidget->removeTab(2);
 
     QObject::connect(ui->floorplanOpen_pb, SIGNAL(clicked()), this, SLOT(floorplanOpenClicked()));
+    QObject::connect(ui->maskOpen_pb, SIGNAL(clicked()), this, SLOT(maskOpenClicked()));
 
     QObject::connect(ui->scaleX_pb, SIGNAL(clicked()), this, SLOT(scaleClicked()));
     QObject::connect(ui->scaleY_pb, SIGNAL(clicked()), this, SLOT(scaleClicked()));
@@ -65,12 +69,30 @@ ViewSettingsWidget::ViewSettingsWidget(QWidget *parent) :
     QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(showSave(bool)), this, SLOT(showSave(bool)));
     QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(showGO(bool, bool)), this, SLOT(showOriginGrid(bool, bool)));
     QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(setFloorPlanPic()), this, SLOT(getFloorPlanPic()));
+    QObject::connect(RTLSDisplayApplication::viewSettings(), SIGNAL(maskChanged()), this, SLOT(maskChanged()));
     QObject::connect(RTLSDisplayApplication::client(), SIGNAL(enableFiltering()), this, SLOT(enableFiltering()));
 
     QObject::connect(ui->logging_pb, SIGNAL(clicked()), this, SLOT(loggingClicked()));
 
+    QObject::connect(ui->logRRDecimate_sb, SIGNAL(valueChanged(int)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logRJDecimate_sb, SIGNAL(valueChanged(int)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logRMDecimate_sb, SIGNAL(valueChanged(int)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logLEDecimate_sb, SIGNAL(valueChanged(int)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logNLDecimate_sb, SIGNAL(valueChanged(int)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logRRDeadband_sb, SIGNAL(valueChanged(double)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logLEDeadband_sb, SIGNAL(valueChanged(double)), this, SLOT(logPolicyEdited()));
+    QObject::connect(ui->logCombineRanges_cb, SIGNAL(clicked()), this, SLOT(logPolicyEdited()));
+    QObject::connect(RTLSDisplayApplication::client(), SIGNAL(logPolicyChanged()), this, SLOT(showLogPolicy()));
+
     QObject::connect(RTLSDisplayApplication::client(), SIGNAL(enableAutoPositioning(int)), this, SLOT(enableAutoPositioning(int)));
 
+    QObject::connect(ui->historyArea_pb, SIGNAL(clicked()), this, SLOT(historyAreaClicked()));
+    QObject::connect(ui->historyClear_pb, SIGNAL(clicked()), this, SLOT(historyClearClicked()));
+
+    //the last hour by default
+    ui->historyTo_dte->setDateTime(QDateTime::currentDateTime());
+    ui->historyFrom_dte->setDateTime(ui->historyTo_dte->dateTime().addSecs(-3600));
+
     _logging = false ;
 
     ui->label_logfile->setText("");
@@ -101,6 +123,7 @@ void ViewSettingsWidget::onReady()
     mapper->addMapping(ui->floorplanFlipY_cb, "floorplanFlipY", "checked");
     mapper->addMapping(ui->gridShow, "showGrid", "checked");
     mapper->addMapping(ui->showOrigin, "showOrigin", "checked");
+    mapper->addMapping(ui->mapConstraint_cb, "mapConstraint", "checked");
 
     mapper->addMapping(ui->floorplanXOff_sb, "floorplanXOffset");
     mapper->addMapping(ui->floorplanYOff_sb, "floorplanYOffset");
@@ -113,6 +136,7 @@ void ViewSettingsWidget::onReady()
     QObject::connect(ui->floorplanFlipY_cb, SIGNAL(clicked()), mapper, SLOT(submit()));
     QObject::connect(ui->gridShow, SIGNAL(clicked()), mapper, SLOT(submit())); // Bug with QDataWidgetMapper (QTBUG-1818)
     QObject::connect(ui->showOrigin, SIGNAL(clicked()), mapper, SLOT(submit()));
+    QObject::connect(ui->mapConstraint_cb, SIGNAL(clicked()), mapper, SLOT(submit()));
 
     //by default the Geo-Fencing is OFF
 
@@ -206,6 +230,38 @@ void ViewSettingsWidget::floorplanOpenClicked()
     }
 }
 
+void ViewSettingsWidget::maskOpenClicked()
+{
+    if(RTLSDisplayApplication::viewSettings()->getMaskPath().isEmpty())
+    {
+        //the mask must have the same size as the floor plan, dark areas are obstacles
+        QString path = QFileDialog::getOpenFileName(this, "Open Mask", QString(), "Image (*.png *.jpg *.jpeg *.bmp)");
+        if (path.isNull()) return;
+
+        RTLSDisplayApplication::viewSettings()->setMaskPath(path);
+    }
+    else
+    {
+        RTLSDisplayApplication::viewSettings()->setMaskPath("");
+    }
+}
+
+void ViewSettingsWidget::maskChanged()
+{
+    const QString &path = RTLSDisplayApplication::viewSettings()->getMaskPath();
+
+    if(path.isEmpty())
+    {
+        ui->maskPath_lb->setText("No Mask");
+        ui->maskOpen_pb->setText("Open Mask");
+    }
+    else
+    {
+        ui->maskPath_lb->setText(QFileInfo(path).fileName());
+        ui->maskOpen_pb->setText("Clear Mask");
+    }
+}
+
 void ViewSettingsWidget::showOriginGrid(bool orig, bool grid)
 {
     Q_UNUSED(orig)
@@ -365,6 +421,100 @@ void ViewSettingsWidget::loggingClicked(void)
     }
 }
 
+void ViewSettingsWidget::logPolicyEdited(void)
+{
+    RTLSClient *client = RTLSDisplayApplication::client();
+
+    client->setLogPolicy(LOG_RR, ui->logRRDecimate_sb->value(), ui->logRRDeadband_sb->value());
+    client->setLogPolicy(LOG_RJ, ui->logRJDecimate_sb->value(), 0);
+    client->setLogPolicy(LOG_RM, ui->logRMDecimate_sb->value(), 0);
+    client->setLogPolicy(LOG_LE, ui->logLEDecimate_sb->value(), ui->logLEDeadband_sb->value());
+    client->setLogPolicy(LOG_NL, ui->logNLDecimate_sb->value(), 0);
+    client->setCombineRanges(ui->logCombineRanges_cb->isChecked());
+
+    //the range mask is in the RC line
+    ui->logRMDecimate_sb->setEnabled(!ui->logCombineRanges_cb->isChecked());
+}
+
+void ViewSettingsWidget::showLogPolicy(void)
+{
+    RTLSClient *client = RTLSDisplayApplication::client();
+    QWidget *widgets[] = {ui->logRRDecimate_sb, ui->logRJDecimate_sb, ui->logRMDecimate_sb, ui->logLEDecimate_sb,
+                          ui->logNLDecimate_sb, ui->logRRDeadband_sb, ui->logLEDeadband_sb, ui->logCombineRanges_cb};
+
+    //don't write the values back to the client while they are set
+    for(unsigned int k=0; k<sizeof(widgets)/sizeof(widgets[0]); k++)
+    {
+        widgets[k]->blockSignals(true);
+    }
+
+    ui->logRRDecimate_sb->setValue(client->logPolicy(LOG_RR).decimate);
+    ui->logRJDecimate_sb->setValue(client->logPolicy(LOG_RJ).decimate);
+    ui->logRMDecimate_sb->setValue(client->logPolicy(LOG_RM).decimate);
+    ui->logLEDecimate_sb->setValue(client->logPolicy(LOG_LE).decimate);
+    ui->logNLDecimate_sb->setValue(client->logPolicy(LOG_NL).decimate);
+    ui->logRRDeadband_sb->setValue(client->logPolicy(LOG_RR).deadband);
+    ui->logLEDeadband_sb->setValue(client->logPolicy(LOG_LE).deadband);
+    ui->logCombineRanges_cb->setChecked(client->combineRanges());
+    ui->logRMDecimate_sb->setEnabled(!client->combineRanges());
+
+    for(unsigned int k=0; k<sizeof(widgets)/sizeof(widgets[0]); k++)
+    {
+        widgets[k]->blockSignals(false);
+    }
+}
+
+void ViewSettingsWidget::historyAreaClicked(void)
+{
+    RubberBandTool *tool = new RubberBandTool(this);
+    QObject::connect(tool, SIGNAL(areaSelected(QRectF)), this, SLOT(historyAreaSelected(QRectF)));
+    QObject::connect(tool, SIGNAL(done()), tool, SLOT(deleteLater()));
+    RTLSDisplayApplication::graphicsView()->setTool(tool);
+}
+
+void ViewSettingsWidget::historyAreaSelected(const QRectF &area)
+{
+    qint64 from = ui->historyFrom_dte->dateTime().toMSecsSinceEpoch();
+    qint64 to = ui->historyTo_dte->dateTime().toMSecsSinceEpoch();
+    QVector<quint64> tags;
+    QElapsedTimer timer;
+
+    timer.start();
+    RTLSDisplayApplication::client()->positions()->find(area, from, to, &tags);
+
+    ui->label_historyResult->setText(QString("%1 tags in (%2, %3) - (%4, %5) m, %6 ms").arg(tags.size())
+                                     .arg(area.left(), 0, 'f', 1).arg(area.top(), 0, 'f', 1)
+                                     .arg(area.right(), 0, 'f', 1).arg(area.bottom(), 0, 'f', 1)
+                                     .arg(timer.elapsed()));
+    ui->historyTags_list->clear();
+
+    for(int i=0; i<tags.size(); i++)
+    {
+        QString t;
+        QString label = RTLSDisplayApplication::graphicsWidget()->tagLabel(tags.at(i));
+
+        RTLSDisplayApplication::graphicsWidget()->tagIDToString(tags.at(i), &t);
+
+        if(!label.isEmpty())
+        {
+            t += " " + label;
+        }
+
+        //from the 1 min rollups
+        double d = RTLSDisplayApplication::client()->positions()->distance(tags.at(i), from, to);
+
+        ui->historyTags_list->addItem(QString("%1: %2 m").arg(t).arg(d, 0, 'f', 1));
+    }
+
+    RTLSDisplayApplication::graphicsWidget()->showAreaPaths(area, tags, from, to);
+}
+
+void ViewSettingsWidget::historyClearClicked(void)
+{
+    ui->historyTags_list->clear();
+    ui->label_historyResult->setText("");
+    RTLSDisplayApplication::graphicsWidget()->clearAreaPaths();
+}
 
 void ViewSettingsWidget::alarmSetClicked()
 {
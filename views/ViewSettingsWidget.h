@@ -14,6 +14,7 @@
 #define VIEWSETTINGSWIDGET_H
 
 #include <QWidget>
+#include <QRectF>
 
 namespace Ui {
 class ViewSettingsWidget;
@@ -38,6 +39,8 @@ protected slots:
     void enableAutoPositioning(int enable);
 
     void floorplanOpenClicked();
+    void maskOpenClicked();
+    void maskChanged();
     void updateLocationFilter(int index);
     void enableFiltering(void);
     void originClicked();
@@ -66,6 +69,12 @@ protected slots:
 
     void setTagHistory(int h);
     void loggingClicked(void);
+    void logPolicyEdited(void);
+    void showLogPolicy(void);
+
+    void historyAreaClicked(void);
+    void historyAreaSelected(const QRectF &area);
+    void historyClearClicked(void);
 private:
     Ui::ViewSettingsWidget *ui;
 
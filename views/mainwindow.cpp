@@ -321,6 +321,8 @@ void MainWindow::loadConfigFile(QString filename)
                     RTLSDisplayApplication::viewSettings()->setFloorplanYScale((e.attribute( "scaleY", "" )).toDouble());
                     RTLSDisplayApplication::viewSettings()->floorplanFlipX((e.attribute( "flipX", "" )).toInt());
                     RTLSDisplayApplication::viewSettings()->floorplanFlipY((e.attribute( "flipY", "" )).toInt());
+                    RTLSDisplayApplication::viewSettings()->setMaskPath(e.attribute( "mask", "" ));
+                    RTLSDisplayApplication::viewSettings()->setMapConstraint(((e.attribute( "mapC", "0" )).toInt() == 1) ? true : false);
 
                     RTLSDisplayApplication::viewSettings()->setFloorplanPathN();
                     RTLSDisplayApplication::viewSettings()->setSaveFP(((e.attribute( "saveFP", "" )).toInt() == 1) ? true : false);
@@ -374,6 +376,8 @@ void MainWindow::saveConfigFile(QString filename, QString cfg)
             cn.setAttribute("offsetX",  QString::number(RTLSDisplayApplication::viewSettings()->floorplanXOffset(), 'g', 3));
             cn.setAttribute("offsetY",  QString::number(RTLSDisplayApplication::viewSettings()->floorplanYOffset(), 'g', 3));
             cn.setAttribute("fplan", RTLSDisplayApplication::viewSettings()->getFloorplanPath());
+            cn.setAttribute("mask", RTLSDisplayApplication::viewSettings()->getMaskPath());
+            cn.setAttribute("mapC",  QString::number((RTLSDisplayApplication::viewSettings()->mapConstraint() == true) ? 1 : 0));
         }
         else
         {